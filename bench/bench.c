@@ -0,0 +1,74 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#include <time.h>
+#include <math.h>
+#include <SCE/utils/SCEUtils.h>
+#include "bench.h"
+
+/* monotonic time in seconds */
+double SCE_Bench_Now (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* density of a rolling terrain, the surface crosses the grid around half
+   its height, \p seed shifts the hills */
+void SCE_Bench_Terrain (SCEubyte *data, int w, int h, int d, int seed)
+{
+    int x, y, z;
+
+    for (z = 0; z < d; z++) {
+        for (x = 0; x < w; x++) {
+            float height = h * 0.5f +
+                h * 0.15f * sinf ((x + 7 * seed) * 0.11f) +
+                h * 0.10f * cosf ((z + 3 * seed) * 0.07f) +
+                h * 0.05f * sinf ((x + z) * 0.23f);
+            for (y = 0; y < h; y++) {
+                float v = 128.0f + (height - y) * 48.0f;
+                data[(z * h + y) * w + x] = v < 0.0f ? 0 : v > 255.0f ?
+                    255 : (SCEubyte)v;
+            }
+        }
+    }
+}
+
+/* density of a field of caves, many small surfaces */
+void SCE_Bench_Caves (SCEubyte *data, int w, int h, int d, int seed)
+{
+    int x, y, z;
+
+    for (z = 0; z < d; z++) {
+        for (y = 0; y < h; y++) {
+            for (x = 0; x < w; x++) {
+                float v = sinf ((x + seed) * 0.31f) * cosf (y * 0.27f) +
+                    sinf ((z + seed) * 0.29f) * cosf (x * 0.19f) +
+                    sinf (y * 0.23f + z * 0.17f);
+                v = 128.0f + v * 96.0f;
+                data[(z * h + y) * w + x] = v < 0.0f ? 0 : v > 255.0f ?
+                    255 : (SCEubyte)v;
+            }
+        }
+    }
+}
@@ -0,0 +1,182 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+/* compares SCE_VGrid_ComputeDensityLOD() with the per voxel gather it
+   replaced, checks that both give the same voxels */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SCE/utils/SCEUtils.h>
+#include <SCE/core/SCECore.h>
+
+#include "bench.h"
+
+#define N_SIZES 3
+#define N_FIELDS 3
+
+/* the previous implementation, kept here as the reference */
+static void Bench_DensityLODPoint (SCE_SVoxelGrid *in, SCE_SVoxelGrid *out,
+                                   SCEulong x, SCEulong y, SCEulong z)
+{
+    SCEubyte buf[28] = {0};
+    float kernel[28] = {
+        /* slice 0 */
+        1.0/8.0, 1.0/4.0, 1.0/8.0,
+        1.0/4.0, 1.0/2.0, 1.0/4.0,
+        1.0/8.0, 1.0/4.0, 1.0/8.0,
+
+        /* slice 1 */
+        1.0/4.0, 1.0/2.0, 1.0/4.0,
+        1.0/2.0, 1.0/1.0, 1.0/2.0,
+        1.0/4.0, 1.0/2.0, 1.0/4.0,
+
+        /* slice 2 */
+        1.0/8.0, 1.0/4.0, 1.0/8.0,
+        1.0/4.0, 1.0/2.0, 1.0/4.0,
+        1.0/8.0, 1.0/4.0, 1.0/8.0,
+    };
+    float value = 0.0;
+    size_t i, j, k, offset;
+    SCEubyte *ptr = NULL;
+
+    offset = 0;
+    for (k = z - 1; k < z + 2; k++) {
+        for (j = y - 1; j < y + 2; j++) {
+            for (i = x - 1; i < x + 2; i++) {
+                buf[offset] = *SCE_VGrid_Offset (in, i, j, k);
+                offset++;
+            }
+        }
+    }
+
+    for (i = 0; i < 28; i++)
+        value += (kernel[i] * buf[i]) / 256.0;
+
+    value /= 8.0;
+
+    ptr = SCE_VGrid_Offset (out, (x - 1) / 2, (y - 1) / 2, (z - 1) / 2);
+    *ptr = value * 256.0;
+}
+static void Bench_DensityLOD (SCE_SVoxelGrid *in, SCE_SVoxelGrid *out)
+{
+    SCEulong x, y, z;
+
+    for (z = 1; z < in->d - 1; z += 2) {
+        for (y = 1; y < in->h - 1; y += 2) {
+            for (x = 1; x < in->w - 1; x += 2)
+                Bench_DensityLODPoint (in, out, x, y, z);
+        }
+    }
+}
+
+/* uniform noise, every value of every voxel is possible */
+static void Bench_Noise (SCEubyte *data, int w, int h, int d, int seed)
+{
+    size_t i, n = (size_t)w * h * d;
+
+    srand (seed);
+    for (i = 0; i < n; i++)
+        data[i] = rand () & 0xff;
+}
+
+int main (void)
+{
+    const SCEulong sizes[N_SIZES] = {34, 66, 130};
+    const char *names[N_FIELDS] = {"terrain", "caves", "noise"};
+    void (*fills[N_FIELDS])(SCEubyte*, int, int, int, int) = {
+        SCE_Bench_Terrain, SCE_Bench_Caves, Bench_Noise
+    };
+    SCE_SVoxelGrid in, out, ref;
+    int i, j, n_diffs = 0, ret = 1;
+
+    if (SCE_Init_Core (stderr, 0) < 0)
+        return 1;
+
+    SCE_VGrid_Init (&in);
+    SCE_VGrid_Init (&out);
+    SCE_VGrid_Init (&ref);
+#ifdef __SSE2__
+    printf ("SSE2 row filter\n");
+#else
+    printf ("scalar row filter\n");
+#endif
+    printf ("%5s %-8s %12s %12s %8s %s\n", "size", "field", "gather",
+            "separable", "speedup", "output");
+    for (i = 0; i < N_SIZES; i++) {
+        SCEulong n = sizes[i], m = (n - 1) / 2;
+
+        SCE_VGrid_Clear (&in);
+        SCE_VGrid_Clear (&out);
+        SCE_VGrid_Clear (&ref);
+        SCE_VGrid_Init (&in);
+        SCE_VGrid_Init (&out);
+        SCE_VGrid_Init (&ref);
+        SCE_VGrid_SetDimensions (&in, n, n, n);
+        SCE_VGrid_SetDimensions (&out, m, m, m);
+        SCE_VGrid_SetDimensions (&ref, m, m, m);
+        SCE_VGrid_SetNumComponents (&in, 1);
+        SCE_VGrid_SetNumComponents (&out, 1);
+        SCE_VGrid_SetNumComponents (&ref, 1);
+        if (SCE_VGrid_Build (&in) < 0 || SCE_VGrid_Build (&out) < 0 ||
+            SCE_VGrid_Build (&ref) < 0)
+            goto end;
+
+        for (j = 0; j < N_FIELDS; j++) {
+            double t0, t_ref = 0.0, t_sep = 0.0;
+            int k, n_runs = 0, same;
+
+            fills[j] (SCE_VGrid_GetRaw (&in), n, n, n, j);
+            do {
+                for (k = 0; k < 4; k++) {
+                    t0 = SCE_Bench_Now ();
+                    Bench_DensityLOD (&in, &ref);
+                    t_ref += SCE_Bench_Now () - t0;
+                    t0 = SCE_Bench_Now ();
+                    if (SCE_VGrid_ComputeDensityLOD (&in, &out) < 0)
+                        goto end;
+                    t_sep += SCE_Bench_Now () - t0;
+                }
+                n_runs += 4;
+            } while (t_ref + t_sep < 0.5);
+
+            same = !memcmp (SCE_VGrid_GetRaw (&ref), SCE_VGrid_GetRaw (&out),
+                            SCE_VGrid_GetSize (&out));
+            if (!same)
+                n_diffs++;
+            printf ("%5lu %-8s %9.3f ms %9.3f ms %7.1fx %s\n",
+                    (unsigned long)n, names[j], t_ref * 1e3 / n_runs,
+                    t_sep * 1e3 / n_runs, t_ref / t_sep,
+                    same ? "same" : "DIFFERS");
+        }
+    }
+    /* the separable filter must give the same voxels */
+    ret = n_diffs ? 1 : 0;
+end:
+    if (ret)
+        fprintf (stderr, "benchmark failed\n");
+    SCE_VGrid_Clear (&in);
+    SCE_VGrid_Clear (&out);
+    SCE_VGrid_Clear (&ref);
+    SCE_Quit_Core ();
+    return ret;
+}
@@ -0,0 +1,215 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+/* compares the triangle count and the time per chunk of the surface nets
+   mesher, the marching cubes generator and the incremental marching cubes
+   mesh */
+
+#include <stdio.h>
+#include <string.h>
+#include <SCE/utils/SCEUtils.h>
+#include <SCE/core/SCECore.h>
+
+#include "bench.h"
+
+#define CHUNK_SIZE 32
+#define N_CHUNKS 16
+/* the region of a chunk has one more cell, which is not triangulated, and
+   the grid a border of one voxel around it */
+#define REGION_SIZE (CHUNK_SIZE + 1)
+#define GRID_SIZE (REGION_SIZE + 3)
+#define N_MESHERS 3
+
+typedef void (*FBenchFill)(SCEubyte*, int, int, int, int);
+
+typedef struct {
+    SCEvertices *vertices, *normals;
+    SCEindices32 *indices;
+    size_t max_vertices, max_indices;
+    size_t n_vertices, n_indices;
+} BenchMesh;
+
+static int Bench_Reserve (BenchMesh *m, size_t n_v, size_t n_i)
+{
+    if (n_v > m->max_vertices) {
+        SCE_free (m->vertices);
+        SCE_free (m->normals);
+        m->max_vertices = 0;
+        if (!(m->vertices = SCE_malloc (3 * n_v * sizeof *m->vertices)) ||
+            !(m->normals = SCE_malloc (3 * n_v * sizeof *m->normals)))
+            return SCE_ERROR;
+        m->max_vertices = n_v;
+    }
+    if (n_i > m->max_indices) {
+        SCE_free (m->indices);
+        m->max_indices = 0;
+        if (!(m->indices = SCE_malloc (n_i * sizeof *m->indices)))
+            return SCE_ERROR;
+        m->max_indices = n_i;
+    }
+    return SCE_OK;
+}
+
+/* both meshers count the chunk first to allocate exact buffers, as their
+   GenerateArrays() functions do */
+static int Bench_MC (SCE_SMCGenerator *mc, SCE_SThreadPool *pool,
+                     const SCE_SIntRect3 *r, const SCE_SGrid *grid,
+                     BenchMesh *m)
+{
+    size_t n_v, n_i;
+
+    if (SCE_MC_Count (mc, r, grid, &n_v, &n_i) < 0 ||
+        Bench_Reserve (m, MAX (n_v, 1), MAX (n_i, 1)) < 0)
+        return SCE_ERROR;
+    return SCE_MC_GenerateParallel (mc, r, grid, pool, m->vertices,
+                                    m->normals, m->indices, &m->n_vertices,
+                                    &m->n_indices);
+}
+static int Bench_SN (SCE_SSNGenerator *sn, const SCE_SIntRect3 *r,
+                     const SCE_SGrid *grid, BenchMesh *m)
+{
+    size_t n_v, n_i;
+
+    if (SCE_SN_Count (sn, r, grid, &n_v, &n_i) < 0 ||
+        Bench_Reserve (m, MAX (n_v, 1), MAX (n_i, 1)) < 0)
+        return SCE_ERROR;
+    return SCE_SN_Generate (sn, r, grid, m->vertices, m->normals,
+                            m->indices, &m->n_vertices, &m->n_indices);
+}
+/* the incremental mesh keeps its own buffers */
+static int Bench_MCMesh (SCE_SMCMesh *mesh, const SCE_SGrid *grid,
+                         BenchMesh *m)
+{
+    if (SCE_MCMesh_Generate (mesh, grid) < 0)
+        return SCE_ERROR;
+    m->n_vertices = SCE_MCMesh_GetNumVertices (mesh);
+    m->n_indices = SCE_MCMesh_GetNumIndices (mesh);
+    return SCE_OK;
+}
+
+int main (void)
+{
+    const char *names[2] = {"terrain", "caves"};
+    FBenchFill fills[2] = {SCE_Bench_Terrain, SCE_Bench_Caves};
+    const char *meshers[N_MESHERS] = {"surface nets", "marching cubes",
+                                      "mc mesh"};
+    SCE_SGrid grids[N_CHUNKS];
+    SCE_SMCGenerator mc;
+    SCE_SSNGenerator sn;
+    SCE_SMCMesh mcmesh;
+    SCE_SThreadPool pool;
+    SCE_SIntRect3 r;
+    BenchMesh mesh;
+    int i, j, k, ret = 1;
+
+    if (SCE_Init_Core (stderr, 0) < 0)
+        return 1;
+
+    memset (&mesh, 0, sizeof mesh);
+    SCE_MC_Init (&mc);
+    SCE_SN_Init (&sn);
+    SCE_MCMesh_Init (&mcmesh);
+    SCE_TPool_Init (&pool);
+    for (i = 0; i < N_CHUNKS; i++)
+        SCE_Grid_Init (&grids[i]);
+
+    /* a single worker, so that both meshers run on one core */
+    SCE_TPool_SetNumThreads (&pool, 1);
+    if (SCE_TPool_Start (&pool) < 0)
+        goto end;
+    SCE_MC_SetNumCells (&mc, REGION_SIZE * REGION_SIZE * REGION_SIZE);
+    SCE_MC_SetIndicesType (&mc, SCE_INDICES32_TYPE);
+    if (SCE_MC_Build (&mc) < 0)
+        goto end;
+    SCE_SN_SetIndicesType (&sn, SCE_INDICES32_TYPE);
+
+    for (i = 0; i < N_CHUNKS; i++) {
+        SCE_Grid_SetPointSize (&grids[i], 1);
+        SCE_Grid_SetDimensions (&grids[i], GRID_SIZE, GRID_SIZE, GRID_SIZE);
+        if (SCE_Grid_Build (&grids[i]) < 0)
+            goto end;
+    }
+    SCE_Rectangle3_Set (&r, 1, 1, 1, 1 + REGION_SIZE, 1 + REGION_SIZE,
+                        1 + REGION_SIZE);
+    SCE_MCMesh_SetRegion (&mcmesh, &r);
+    SCE_MCMesh_SetIndicesType (&mcmesh, SCE_INDICES32_TYPE);
+    if (SCE_MCMesh_Build (&mcmesh) < 0)
+        goto end;
+
+    printf ("%d chunks of %d^3 cells, one thread\n", N_CHUNKS, CHUNK_SIZE);
+    for (i = 0; i < 2; i++) {
+        size_t tris[N_MESHERS] = {0}, verts[N_MESHERS] = {0};
+        double t[N_MESHERS] = {0.0}, t0, total;
+        int n_runs = 0;
+
+        for (j = 0; j < N_CHUNKS; j++)
+            fills[i] (SCE_Grid_GetRaw (&grids[j]), GRID_SIZE, GRID_SIZE,
+                      GRID_SIZE, j);
+        do {
+            for (j = 0; j < N_CHUNKS; j++) {
+                for (k = 0; k < N_MESHERS; k++) {
+                    int err;
+                    t0 = SCE_Bench_Now ();
+                    if (k == 0)
+                        err = Bench_SN (&sn, &r, &grids[j], &mesh);
+                    else if (k == 1)
+                        err = Bench_MC (&mc, &pool, &r, &grids[j], &mesh);
+                    else
+                        err = Bench_MCMesh (&mcmesh, &grids[j], &mesh);
+                    if (err < 0)
+                        goto end;
+                    t[k] += SCE_Bench_Now () - t0;
+                    if (!n_runs) {
+                        verts[k] += mesh.n_vertices;
+                        tris[k] += mesh.n_indices / 3;
+                    }
+                }
+            }
+            n_runs++;
+            for (k = 0, total = 0.0; k < N_MESHERS; k++)
+                total += t[k];
+        } while (total < 0.5);
+
+        printf ("%s:\n", names[i]);
+        for (k = 0; k < N_MESHERS; k++) {
+            printf ("  %-14s %8.0f triangles %8.0f vertices %8.3f ms "
+                    "per chunk\n", meshers[k], (double)tris[k] / N_CHUNKS,
+                    (double)verts[k] / N_CHUNKS,
+                    t[k] * 1e3 / (n_runs * N_CHUNKS));
+        }
+    }
+    ret = 0;
+end:
+    if (ret)
+        fprintf (stderr, "benchmark failed\n");
+    for (i = 0; i < N_CHUNKS; i++)
+        SCE_Grid_Clear (&grids[i]);
+    SCE_free (mesh.vertices);
+    SCE_free (mesh.normals);
+    SCE_free (mesh.indices);
+    SCE_TPool_Clear (&pool);
+    SCE_MCMesh_Clear (&mcmesh);
+    SCE_SN_Clear (&sn);
+    SCE_MC_Clear (&mc);
+    SCE_Quit_Core ();
+    return ret;
+}
@@ -0,0 +1,142 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+/* times SCE_Geometry_SortPrimitives() on clouds of random triangles seen
+   from a point of view turning slowly around them, with the radix sort and
+   with the incremental sort */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <SCE/utils/SCEUtils.h>
+#include <SCE/core/SCECore.h>
+
+#include "bench.h"
+
+#define N_SIZES 3
+#define N_FRAMES 100
+/* angle the point of view turns by between two frames, in radians */
+#define FRAME_STEP 0.01f
+
+static float Bench_Random (float scale)
+{
+    return scale * ((float)rand () / RAND_MAX - 0.5f);
+}
+
+/* n_prim triangles of independent vertices scattered in a cube */
+static int Bench_MakeTriangles (size_t n_prim, SCEvertices **pos,
+                                SCEindices32 **indices)
+{
+    size_t i, j;
+
+    if (!(*pos = SCE_malloc (9 * n_prim * sizeof **pos)) ||
+        !(*indices = SCE_malloc (3 * n_prim * sizeof **indices)))
+        return SCE_ERROR;
+    for (i = 0; i < n_prim; i++) {
+        float x = Bench_Random (100.0f), y = Bench_Random (100.0f),
+            z = Bench_Random (100.0f);
+        for (j = 0; j < 3; j++) {
+            (*pos)[9 * i + 3 * j] = x + Bench_Random (1.0f);
+            (*pos)[9 * i + 3 * j + 1] = y + Bench_Random (1.0f);
+            (*pos)[9 * i + 3 * j + 2] = z + Bench_Random (1.0f);
+            (*indices)[3 * i + j] = 3 * i + j;
+        }
+    }
+    return SCE_OK;
+}
+
+/* returns the average time of a sort in seconds, or a negative value on
+   error */
+static double Bench_Sort (SCEvertices *pos, SCEindices32 *indices,
+                          size_t n_prim, int incremental)
+{
+    SCE_SGeometry *geom = NULL;
+    SCE_TVector3 from;
+    double t0, t = -1.0;
+    int i;
+
+    if (!(geom = SCE_Geometry_Create ()))
+        return -1.0;
+    SCE_Geometry_SetPrimitiveType (geom, SCE_TRIANGLES);
+    if (SCE_Geometry_SetDataDup (geom, pos, NULL, NULL, SCE_INDICES32_TYPE,
+                                 indices, 3 * n_prim, 3 * n_prim) < 0)
+        goto end;
+    SCE_Geometry_SetIncrementalSort (geom, incremental);
+
+    /* the first sort starts from a random order */
+    SCE_Vector3_Set (from, 200.0f, 0.0f, 0.0f);
+    if (SCE_Geometry_SortPrimitives (geom, SCE_SORT_FAR_TO_NEAR, from) < 0)
+        goto end;
+    t0 = SCE_Bench_Now ();
+    for (i = 1; i <= N_FRAMES; i++) {
+        SCE_Vector3_Set (from, 200.0f * cosf (i * FRAME_STEP),
+                         20.0f * sinf (i * FRAME_STEP * 3.0f),
+                         200.0f * sinf (i * FRAME_STEP));
+        if (SCE_Geometry_SortPrimitives (geom, SCE_SORT_FAR_TO_NEAR,
+                                         from) < 0)
+            goto end;
+    }
+    t = (SCE_Bench_Now () - t0) / N_FRAMES;
+end:
+    SCE_Geometry_Delete (geom);
+    return t;
+}
+
+int main (void)
+{
+    const size_t sizes[N_SIZES] = {1000, 10000, 100000};
+    SCEvertices *pos = NULL;
+    SCEindices32 *indices = NULL;
+    int i, ret = 1;
+
+    if (SCE_Init_Core (stderr, 0) < 0)
+        return 1;
+
+    srand (42);
+    printf ("far to near sort, the point of view turns by %.2f radians "
+            "per frame\n", FRAME_STEP);
+    printf ("%10s %12s %12s\n", "primitives", "radix", "incremental");
+    for (i = 0; i < N_SIZES; i++) {
+        double radix, incremental;
+
+        if (Bench_MakeTriangles (sizes[i], &pos, &indices) < 0)
+            goto end;
+        radix = Bench_Sort (pos, indices, sizes[i], SCE_FALSE);
+        incremental = Bench_Sort (pos, indices, sizes[i], SCE_TRUE);
+        if (radix < 0.0 || incremental < 0.0)
+            goto end;
+        printf ("%10lu %9.3f ms %9.3f ms\n", (unsigned long)sizes[i],
+                radix * 1e3, incremental * 1e3);
+        SCE_free (pos);
+        SCE_free (indices);
+        pos = NULL;
+        indices = NULL;
+    }
+    ret = 0;
+end:
+    if (ret)
+        fprintf (stderr, "benchmark failed\n");
+    SCE_free (pos);
+    SCE_free (indices);
+    SCE_Quit_Core ();
+    return ret;
+}
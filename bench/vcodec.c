@@ -0,0 +1,136 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+/* compares the compression ratio and speed of the voxel codecs on density
+   fields the size of an octree node */
+
+#include <stdio.h>
+#include <string.h>
+#include <SCE/utils/SCEUtils.h>
+#include <SCE/core/SCECore.h>
+
+#include "bench.h"
+
+#define NODE_SIZE 64
+#define N_NODES 16
+#define N_CODECS 5
+
+typedef void (*FBenchFill)(SCEubyte*, int, int, int, int);
+
+static void Bench_Empty (SCEubyte *data, int w, int h, int d, int seed)
+{
+    (void)seed;
+    memset (data, 0, w * h * d);
+}
+
+/* compresses and decompresses every node until at least 0.2s elapsed */
+static int Bench_Codec (const SCE_SVoxelCodec *codec, SCEubyte **nodes,
+                        size_t size)
+{
+    SCEubyte *out = NULL, *back = NULL;
+    size_t i, n_in = 0, n_out = 0, n_runs = 0, out_size;
+    double t, t_comp = 0.0, t_decomp = 0.0;
+
+    if (!(back = SCE_malloc (size)))
+        goto fail;
+
+    do {
+        for (i = 0; i < N_NODES; i++) {
+            t = SCE_Bench_Now ();
+            if (SCE_VCodec_Compress (codec, nodes[i], size, &out,
+                                     &out_size) < 0)
+                goto fail;
+            t_comp += SCE_Bench_Now () - t;
+
+            t = SCE_Bench_Now ();
+            if (SCE_VCodec_Decompress (codec, out, out_size, back, size) < 0)
+                goto fail;
+            t_decomp += SCE_Bench_Now () - t;
+
+            if (memcmp (nodes[i], back, size)) {
+                fprintf (stderr, "%s: decompressed data differ\n",
+                         SCE_VCodec_GetName (codec));
+                goto fail;
+            }
+            SCE_free (out);
+            out = NULL;
+            n_in += size;
+            n_out += out_size;
+        }
+        n_runs++;
+    } while (t_comp + t_decomp < 0.2);
+
+    printf ("  %-8s level %d  ratio %7.2f  compress %8.1f MB/s  "
+            "decompress %8.1f MB/s\n", SCE_VCodec_GetName (codec),
+            codec->level, (double)n_in / n_out, n_in / t_comp / 1e6,
+            n_in / t_decomp / 1e6);
+
+    SCE_free (back);
+    return SCE_OK;
+fail:
+    SCE_free (out);
+    SCE_free (back);
+    return SCE_ERROR;
+}
+
+int main (void)
+{
+    const char *names[3] = {"terrain", "caves", "empty"};
+    FBenchFill fills[3] = {SCE_Bench_Terrain, SCE_Bench_Caves, Bench_Empty};
+    SCE_SVoxelCodec codecs[N_CODECS];
+    SCEubyte *nodes[N_NODES] = {NULL};
+    size_t size = NODE_SIZE * NODE_SIZE * NODE_SIZE;
+    int i, j, ret = 1;
+
+    if (SCE_Init_Core (stderr, 0) < 0)
+        return 1;
+
+    SCE_VCodec_Init (&codecs[0]);
+    SCE_VCodec_InitRLE (&codecs[1]);
+    SCE_VCodec_InitZlib (&codecs[2], 1);
+    SCE_VCodec_InitZlib (&codecs[3], 6);
+    SCE_VCodec_InitZlib (&codecs[4], 9);
+
+    for (i = 0; i < N_NODES; i++) {
+        if (!(nodes[i] = SCE_malloc (size)))
+            goto end;
+    }
+
+    printf ("%d nodes of %d^3 voxels\n", N_NODES, NODE_SIZE);
+    for (i = 0; i < 3; i++) {
+        printf ("%s:\n", names[i]);
+        for (j = 0; j < N_NODES; j++)
+            fills[i] (nodes[j], NODE_SIZE, NODE_SIZE, NODE_SIZE, j);
+        for (j = 0; j < N_CODECS; j++) {
+            if (Bench_Codec (&codecs[j], nodes, size) < 0)
+                goto end;
+        }
+    }
+    ret = 0;
+end:
+    for (i = 0; i < N_NODES; i++)
+        SCE_free (nodes[i]);
+    if (ret)
+        fprintf (stderr, "benchmark failed\n");
+    SCE_Quit_Core ();
+    return ret;
+}
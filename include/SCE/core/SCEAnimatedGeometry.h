@@ -17,7 +17,7 @@
  -----------------------------------------------------------------------------*/
 
 /* created: 06/04/2009
-   updated: 06/08/2009 */
+   updated: 17/10/2026 */
 
 #ifndef SCEANIMATEDGEOMETRY_H
 #define SCEANIMATEDGEOMETRY_H
@@ -56,7 +56,8 @@ struct sce_sanimatedgeometry {
 
     SCE_SVertex *vertices;
     SCE_SVertexWeight *weights;
-    SCEindices *indices;
+    SCE_EType indices_type;
+    void *indices;
     unsigned int n_vertices;
     unsigned int n_weights;
     unsigned int n_indices;
@@ -64,6 +65,7 @@ struct sce_sanimatedgeometry {
     SCEvertices *base[SCE_MAX_ANIMATED_VERTEX_ATTRIBUTES];
     int local[SCE_MAX_ANIMATED_VERTEX_ATTRIBUTES];
     SCEvertices *output[SCE_MAX_ANIMATED_VERTEX_ATTRIBUTES];
+    size_t output_stride;       /* SCEvertices between two output vertices */
     SCE_SGeometryArray *arrays[SCE_MAX_ANIMATED_VERTEX_ATTRIBUTES];
 
     SCE_FApplySkeletonFunc applyskel;
@@ -94,7 +96,8 @@ SCE_SVertex* SCE_AnimGeom_GetVertices (SCE_SAnimatedGeometry*);
 SCE_SVertexWeight* SCE_AnimGeom_GetWeights (SCE_SAnimatedGeometry*);
 SCEvertices* SCE_AnimGeom_GetBaseVertices (SCE_SAnimatedGeometry*, int);
 
-void SCE_AnimGeom_SetIndices (SCE_SAnimatedGeometry*, size_t, SCEindices*, int);
+void SCE_AnimGeom_SetIndices (SCE_SAnimatedGeometry*, SCE_EType, size_t, void*,
+                              int);
 
 void SCE_AnimGeom_ApplySkeleton (SCE_SAnimatedGeometry*, SCE_SSkeleton*);
 void SCE_AnimGeom_ApplyBaseSkeleton (SCE_SAnimatedGeometry*);
@@ -104,6 +107,7 @@ void SCE_AnimGeom_ApplyAnimSkeleton (SCE_SAnimatedGeometry*);
 int SCE_AnimGeom_SetGlobal (SCE_SAnimatedGeometry*);
 
 int SCE_AnimGeom_BuildGeometry (SCE_SAnimatedGeometry*);
+int SCE_AnimGeom_Interleave (SCE_SAnimatedGeometry*);
 
 SCE_SAnimatedGeometry* SCE_AnimGeom_Load (const char*, int);
 
@@ -17,7 +17,7 @@
  -----------------------------------------------------------------------------*/
  
 /* created: 11/04/2010
-   updated: 10/03/2013 */
+   updated: 17/10/2026 */
 
 #ifndef SCECORE_H
 #define SCECORE_H
@@ -41,15 +41,21 @@
 #include "SCE/core/SCEQEMDecimator.h"
 #include "SCE/core/SCEImage.h"
 #include "SCE/core/SCETextureData.h"
+#include "SCE/core/SCEThreadPool.h"
 #include "SCE/core/SCEGrid.h"
 #include "SCE/core/SCEVoxelGrid.h"
 #include "SCE/core/SCEVoxelStore.h"
+#include "SCE/core/SCEVoxelCodec.h"
+#include "SCE/core/SCEVoxelPack.h"
 #include "SCE/core/SCEVoxelOctree.h"
+#include "SCE/core/SCEVoxelEdit.h"
 #include "SCE/core/SCEVoxelWorld.h"
 #include "SCE/core/SCEMarchingTetrahedra.h"
 #include "SCE/core/SCEMarchingCube.h"
+#include "SCE/core/SCESurfaceNets.h"
 #include "SCE/core/SCEForestTree.h"
 #include "SCE/core/SCEOBJLoader.h"
+#include "SCE/core/SCEGeometryCache.h"
 #include "SCE/core/SCESphereGeometry.h"
 #include "SCE/core/SCEBoxGeometry.h"
 #include "SCE/core/SCEConeGeometry.h"
@@ -73,7 +73,8 @@ struct sce_sforesttree {
     SCEvertices *matrix_data;
     SCEvertices *drad_data;          /* distance and radius */
     SCEuint *npoly_data;
-    SCEindices *indices_data;
+    SCE_EType indices_data_type;
+    void *indices_data;
     SCE_SGeometryArray ar1, ar2, ar3, ar4, ar5, ar6, ind;
 
     size_t *vindex;             /* temporary buffer to store location
@@ -81,7 +82,8 @@ struct sce_sforesttree {
 
     SCE_SGeometry final_geom;
     SCEvertices *vertices;
-    SCEindices *indices;
+    SCE_EType indices_type;
+    void *indices;
     SCE_SGeometryArray pos, nor, tc, idx;
 
     /* TODO: matrix type */
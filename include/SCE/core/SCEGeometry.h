@@ -17,7 +17,7 @@
  -----------------------------------------------------------------------------*/
 
 /* created: 25/07/2009
-   updated: 09/03/2013 */
+   updated: 17/10/2026 */
 
 #ifndef SCEGEOMETRY_H
 #define SCEGEOMETRY_H
@@ -70,6 +70,21 @@ typedef SCEushort SCEindices;
  * data type
  */
 #define SCE_INDICES_TYPE SCE_UNSIGNED_SHORT
+/**
+ * \brief Number of vertices that SCE_INDICES_TYPE can address
+ */
+#define SCE_INDICES_MAX_VERTICES 65536
+
+/**
+ * \brief Wide indices data type, for geometries with more vertices than
+ * SCE_INDICES_MAX_VERTICES
+ * \sa SCE_Geometry_GetIndicesTypeFor()
+ */
+typedef SCEuint SCEindices32;
+/**
+ * \brief Wide indices data type
+ */
+#define SCE_INDICES32_TYPE SCE_UNSIGNED_INT
 
 /**
  * \brief Primitive types
@@ -153,6 +168,21 @@ enum sce_evertexattribute {
 typedef enum sce_evertexattribute SCE_EVertexAttribute;
 
 
+/**
+ * \brief Encodings of vertex data
+ * \sa SCE_Geometry_ConvertArray(), SCE_Geometry_DecodeArray()
+ */
+enum sce_earrayencoding {
+    SCE_ARRAY_RAW = 0,          /**< Values are used as they are */
+    SCE_ARRAY_NORMALIZED,       /**< Normalized integers, decoded as
+                                   offset + scale * value */
+    SCE_ARRAY_OCTAHEDRAL,       /**< Unit vectors folded onto an octahedron,
+                                   stored in 2 normalized integers */
+    SCE_ARRAY_HALF_FLOAT        /**< 16 bits floats in SCE_UNSIGNED_SHORT */
+};
+/** \copydoc sce_earrayencoding */
+typedef enum sce_earrayencoding SCE_EArrayEncoding;
+
 /** \copydoc sce_sgeometryarraydata */
 typedef struct sce_sgeometryarraydata SCE_SGeometryArrayData;
 struct sce_sgeometryarraydata {
@@ -161,6 +191,8 @@ struct sce_sgeometryarraydata {
     SCEsizei stride;      /**< Stride between two consecutive vertices */
     SCEint size;          /**< Number of dimensions of the vectors */
     void *data;           /**< User is always the owner of the data */
+    SCE_EArrayEncoding encoding; /**< How to decode \c data */
+    SCEfloat offset[4], scale[4]; /**< Used by SCE_ARRAY_NORMALIZED */
 };
 
 /** \copydoc sce_sgeometry */
@@ -207,8 +239,13 @@ typedef struct sce_sgeometryprimitivesort SCE_SGeometryPrimitiveSort;
  */
 struct sce_sgeometryprimitivesort {
     float dist;
-    SCEindices index;
+    SCEuint index;              /**< Primitive number */
 };
+/**
+ * \brief Frees the memory a geometry is built on
+ * \sa SCE_Geometry_SetStorage()
+ */
+typedef void (*SCE_FFreeGeometryStorage)(void*);
 /**
  * \brief Contains geometry of a mesh
  * \sa SCE_SGeometryArray, SCE_SGeometryArrayUser, SCE_SMesh
@@ -223,14 +260,21 @@ struct sce_sgeometry {
 
     SCE_SGeometryArray *pos_array, *nor_array, *tex_array;
     SCEvertices *pos_data, *nor_data, *tex_data;
-    SCEindices *index_data;
+    void *index_data;
+    SCE_EType index_type;             /**< Type of \c index_data */
 
     SCE_SGeometryPrimitiveSort *sorted;
+    SCE_SGeometryPrimitiveSort *sorted_tmp; /* radix sort buffer */
+    void *sorted_indices;       /* copy of the indices being permuted */
     size_t sorted_length;
+    int sort_incremental;
 
     SCE_SBox box;
     SCE_SSphere sphere;
     int box_uptodate, sphere_uptodate; /* Bounding volumes state */
+
+    void *storage;              /**< Memory the arrays point into */
+    SCE_FFreeGeometryStorage free_storage;
 };
 
 /** @} */
@@ -289,6 +333,7 @@ void SCE_Geometry_SetArrayTangent (SCE_SGeometryArray*, size_t, SCEvertices*,
 void SCE_Geometry_SetArrayBinormal (SCE_SGeometryArray*, size_t, SCEvertices*,
                                     int);
 void SCE_Geometry_SetArrayIndices (SCE_SGeometryArray*, SCE_EType, void*, int);
+void* SCE_Geometry_AllocArrayData (SCE_SGeometryArray*, size_t);
 
 void* SCE_Geometry_GetData (SCE_SGeometryArray*);
 SCE_EVertexAttribute
@@ -313,6 +358,7 @@ SCE_SGeometryArray* SCE_Geometry_AddArrayRecDupDup (SCE_SGeometry*,
 void SCE_Geometry_RemoveArray (SCE_SGeometryArray*);
 
 void SCE_Geometry_SetIndexArray (SCE_SGeometry*, SCE_SGeometryArray*, int);
+void SCE_Geometry_UpdatePointers (SCE_SGeometry*);
 SCE_SGeometryArray* SCE_Geometry_SetIndexArrayDup (SCE_SGeometry*,
                                                    SCE_SGeometryArray*, int);
 SCE_SGeometryArray* SCE_Geometry_SetIndexArrayDupDup (SCE_SGeometry*,
@@ -320,9 +366,10 @@ SCE_SGeometryArray* SCE_Geometry_SetIndexArrayDupDup (SCE_SGeometry*,
 SCE_SGeometryArray* SCE_Geometry_GetIndexArray (SCE_SGeometry*);
 
 int SCE_Geometry_SetData (SCE_SGeometry*, SCEvertices*, SCEvertices*,
-                          SCEvertices*, SCEindices*, SCEuint, SCEuint);
+                          SCEvertices*, SCE_EType, void*, SCEuint, SCEuint);
 int SCE_Geometry_SetDataDup (SCE_SGeometry*, SCEvertices*, SCEvertices*,
-                             SCEvertices*, SCEindices*, SCEuint, SCEuint);
+                             SCEvertices*, SCE_EType, void*, SCEuint,
+                             SCEuint);
 
 SCE_SGeometryArray* SCE_Geometry_GetPositionsArray (SCE_SGeometry*);
 SCE_SGeometryArray* SCE_Geometry_GetNormalsArray (SCE_SGeometry*);
@@ -330,7 +377,12 @@ SCE_SGeometryArray* SCE_Geometry_GetTexCoordsArray (SCE_SGeometry*);
 SCEvertices* SCE_Geometry_GetPositions (SCE_SGeometry*);
 SCEvertices* SCE_Geometry_GetNormals (SCE_SGeometry*);
 SCEvertices* SCE_Geometry_GetTexCoords (SCE_SGeometry*);
-SCEindices* SCE_Geometry_GetIndices (SCE_SGeometry*);
+void* SCE_Geometry_GetIndices (SCE_SGeometry*);
+SCE_EType SCE_Geometry_GetIndicesType (SCE_SGeometry*);
+
+SCE_EType SCE_Geometry_GetIndicesTypeFor (size_t);
+SCEuint SCE_Geometry_GetIndex (SCE_EType, const void*, size_t);
+void SCE_Geometry_SetIndex (SCE_EType, void*, size_t, SCEuint);
 
 void SCE_Geometry_SetPrimitiveType (SCE_SGeometry*, SCE_EPrimitiveType);
 SCEenum SCE_Geometry_GetPrimitiveType (SCE_SGeometry*);
@@ -344,6 +396,8 @@ size_t SCE_Geometry_GetPrimitiveVertices (SCE_EPrimitiveType);
 size_t SCE_Geometry_GetNumVerticesPerPrimitive (SCE_SGeometry*);
 size_t SCE_Geometry_GetNumPrimitives (SCE_SGeometry*);
 size_t SCE_Geometry_GetTotalStride (SCE_SGeometryArray*);
+int SCE_Geometry_Interleave (SCE_SGeometry*);
+int SCE_Geometry_Deinterleave (SCE_SGeometry*);
 
 SCE_SList* SCE_Geometry_GetArrays (SCE_SGeometry*);
 SCE_SList* SCE_Geometry_GetModifiedArrays (SCE_SGeometry*);
@@ -364,14 +418,33 @@ SCE_SSphere* SCE_Geometry_GetSphere (SCE_SGeometry*);
 void SCE_Geometry_BoxUpToDate (SCE_SGeometry*);
 void SCE_Geometry_SphereUpToDate (SCE_SGeometry*);
 
+void SCE_Geometry_SetStorage (SCE_SGeometry*, void*, SCE_FFreeGeometryStorage);
+
 /* bonus functions */
 typedef int (*SCE_FGeometryForEach)(SCE_TVector3, SCE_TVector3, SCE_TVector3,
-                                    SCEindices, void*);
+                                    SCEuint, void*);
 
 void SCE_Geometry_ForEachTriangle (SCE_SGeometry*, SCE_FGeometryForEach, void*);
 
+void SCE_Geometry_SetIncrementalSort (SCE_SGeometry*, int);
 int SCE_Geometry_SortPrimitives (SCE_SGeometry*, SCE_ESortOrder, SCE_TVector3);
 
+float SCE_Geometry_ComputeACMR (SCE_EType, const void*, size_t, size_t, size_t);
+int SCE_Geometry_OptimizeIndices (SCE_EType, void*, size_t, size_t, size_t);
+void SCE_Geometry_ReorderVertices (SCE_EType, void*, size_t, size_t, SCEuint*);
+int SCE_Geometry_RemapVertices (void*, size_t, size_t, const SCEuint*);
+int SCE_Geometry_OptimizeVertexCache (SCE_SGeometry*, size_t, float*);
+
+SCEushort SCE_Geometry_FloatToHalf (float);
+float SCE_Geometry_HalfToFloat (SCEushort);
+void SCE_Geometry_EncodeOctahedral (const float*, float*);
+void SCE_Geometry_DecodeOctahedral (const float*, float*);
+int SCE_Geometry_ConvertArray (SCE_SGeometryArray*, SCE_EType,
+                               SCE_EArrayEncoding);
+int SCE_Geometry_GetDecodedSize (const SCE_SGeometryArray*);
+void SCE_Geometry_DecodeArray (const SCE_SGeometryArray*, size_t, size_t,
+                               SCEvertices*);
+
 void SCE_Mesh_ComputeTriangleTBN (SCEvertices*, SCEvertices*, size_t*,
                                   SCEvertices*, SCEvertices*, SCEvertices*);
 int SCE_Geometry_ComputeTBN (SCE_EPrimitiveType, SCEvertices*, SCEvertices*,
@@ -381,8 +454,8 @@ int SCE_Geometry_GenerateTBN (SCE_SGeometry*, SCEvertices**, SCEvertices**,
                               SCEvertices**, unsigned int);
 int SCE_Geometry_AddGenerateTBN (SCE_SGeometry*, unsigned int, int);
 
-int SCE_Geometry_ComputeNormals (SCEvertices*, SCEindices*, size_t, size_t,
-                                 SCEvertices*);
+int SCE_Geometry_ComputeNormals (SCEvertices*, SCE_EType, void*, size_t,
+                                 size_t, SCEvertices*);
 int SCE_Geometry_GenerateNormals (SCE_SGeometry*, SCEvertices**);
 int SCE_Geometry_AddGenerateNormals (SCE_SGeometry*);
 
@@ -0,0 +1,46 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#ifndef SCEGEOMETRYCACHE_H
+#define SCEGEOMETRYCACHE_H
+
+#include "SCE/core/SCEGeometry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief File extension of the precompiled geometry files
+ */
+#define SCE_GCACHE_FILE_EXTENSION "sgeom"
+
+int SCE_Init_GCache (void);
+void SCE_Quit_GCache (void);
+
+int SCE_GCache_Save (SCE_SGeometry*, const char*);
+int SCE_GCache_Convert (const char*, const char*);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* guard */
@@ -25,6 +25,8 @@
 #include <SCE/utils/SCEUtils.h>
 #include "SCE/core/SCEGeometry.h"
 #include "SCE/core/SCEGrid.h"
+#include "SCE/core/SCEVoxelGrid.h"
+#include "SCE/core/SCEThreadPool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -59,6 +61,48 @@ struct sce_smcgenerator {
     /* used for split vertex processing */
     SCEuint last_x, last_y, last_z;
     int finished;
+
+    /* rolling z-slices of the fused generator */
+    SCEubyte *slices;
+    size_t slices_size;
+
+    SCE_EType itype;            /* type of the generated indices */
+    const SCE_SVoxelGrid *summary; /* min/max summary of the grid */
+};
+
+#define SCE_MCMESH_MAX_TRIANGLES 5
+
+/**
+ * \brief Marching cubes mesh of a resident chunk, updated incrementally
+ *
+ * Each cell keeps its edge vertices in stable vertex slots and its
+ * triangles in a block of indices, so that an update only rewrites the
+ * cells around the modified voxels. Free vertex slots and index blocks are
+ * recycled, unused index blocks hold degenerate triangles.
+ */
+typedef struct sce_smcmesh SCE_SMCMesh;
+struct sce_smcmesh {
+    SCE_SMCGenerator mc;        /* cells, dimensions and origin in the grid */
+    long origin[3];             /* world coordinates of the first grid point */
+    SCEuint *blocks;            /* first index of the triangles of a cell */
+
+    SCEvertices *vertices;
+    SCEvertices *normals;
+    size_t n_vertices;          /* used vertex slots, free ones included */
+    size_t max_vertices;
+    SCEuint *free_vertices;
+    size_t n_free_vertices;
+
+    void *indices;              /* of type mc.itype */
+    size_t n_indices;
+    size_t max_indices;
+    SCEuint *free_blocks[SCE_MCMESH_MAX_TRIANGLES]; /* by number of triangles*/
+    size_t n_free_blocks[SCE_MCMESH_MAX_TRIANGLES];
+    size_t max_free_blocks[SCE_MCMESH_MAX_TRIANGLES];
+
+    size_t vrange[2], irange[2]; /* modified by the last update */
+    int resized;                /* buffers moved during the last update */
+    SCE_SGeometryArray *pos, *nor, *idx;
 };
 
 void SCE_MC_Init (SCE_SMCGenerator*);
@@ -69,14 +113,60 @@ size_t SCE_MC_GetNumCells (const SCE_SMCGenerator*);
 
 int SCE_MC_Build (SCE_SMCGenerator*);
 
+void SCE_MC_SetIndicesType (SCE_SMCGenerator*, SCE_EType);
+SCE_EType SCE_MC_GetIndicesType (const SCE_SMCGenerator*);
+void SCE_MC_SetSummary (SCE_SMCGenerator*, const SCE_SVoxelGrid*);
+
 size_t SCE_MC_GenerateVertices (SCE_SMCGenerator*, const SCE_SIntRect3*,
                                 const SCE_SGrid*, SCEvertices*);
 size_t SCE_MC_GenerateVerticesRange (SCE_SMCGenerator*, const SCE_SIntRect3*,
                                      const SCE_SGrid*, SCEvertices*, size_t);
+size_t SCE_MC_GenerateVerticesNormalsRange (SCE_SMCGenerator*,
+                                            const SCE_SIntRect3*,
+                                            const SCE_SGrid*, SCEvertices*,
+                                            SCEvertices*, size_t);
 int SCE_MC_IsGenerationFinished (const SCE_SMCGenerator*);
 
 void SCE_MC_GenerateNormals (SCE_SMCGenerator*, const SCE_SGrid*, SCEvertices*);
-size_t SCE_MC_GenerateIndices (SCE_SMCGenerator*, SCEindices*);
+size_t SCE_MC_GenerateIndices (SCE_SMCGenerator*, void*);
+
+int SCE_MC_GenerateParallel (SCE_SMCGenerator*, const SCE_SIntRect3*,
+                             const SCE_SGrid*, SCE_SThreadPool*, SCEvertices*,
+                             SCEvertices*, void*, size_t*, size_t*);
+
+void SCE_MCMesh_Init (SCE_SMCMesh*);
+void SCE_MCMesh_Clear (SCE_SMCMesh*);
+SCE_SMCMesh* SCE_MCMesh_Create (void);
+void SCE_MCMesh_Delete (SCE_SMCMesh*);
+
+void SCE_MCMesh_SetRegion (SCE_SMCMesh*, const SCE_SIntRect3*);
+void SCE_MCMesh_SetOrigin (SCE_SMCMesh*, long, long, long);
+void SCE_MCMesh_SetIndicesType (SCE_SMCMesh*, SCE_EType);
+int SCE_MCMesh_Build (SCE_SMCMesh*);
+void SCE_MCMesh_SetArrays (SCE_SMCMesh*, SCE_SGeometryArray*,
+                           SCE_SGeometryArray*, SCE_SGeometryArray*);
+
+int SCE_MCMesh_Generate (SCE_SMCMesh*, const SCE_SGrid*);
+int SCE_MCMesh_Update (SCE_SMCMesh*, const SCE_SGrid*, const SCE_SIntRect3*);
+int SCE_MCMesh_UpdateZone (SCE_SMCMesh*, const SCE_SGrid*,
+                           const SCE_SLongRect3*);
+
+SCEvertices* SCE_MCMesh_GetVertices (SCE_SMCMesh*);
+SCEvertices* SCE_MCMesh_GetNormals (SCE_SMCMesh*);
+void* SCE_MCMesh_GetIndices (SCE_SMCMesh*);
+SCE_EType SCE_MCMesh_GetIndicesType (const SCE_SMCMesh*);
+size_t SCE_MCMesh_GetNumVertices (const SCE_SMCMesh*);
+size_t SCE_MCMesh_GetNumIndices (const SCE_SMCMesh*);
+const size_t* SCE_MCMesh_GetVerticesRange (const SCE_SMCMesh*);
+const size_t* SCE_MCMesh_GetIndicesRange (const SCE_SMCMesh*);
+int SCE_MCMesh_IsResized (const SCE_SMCMesh*);
+
+int SCE_MC_Count (SCE_SMCGenerator*, const SCE_SIntRect3*, const SCE_SGrid*,
+                  size_t*, size_t*);
+int SCE_MC_GenerateArrays (SCE_SMCGenerator*, const SCE_SIntRect3*,
+                           const SCE_SGrid*, SCE_SThreadPool*,
+                           SCE_SGeometryArray*, SCE_SGeometryArray*,
+                           SCE_SGeometryArray*, size_t*, size_t*);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -41,9 +41,25 @@ size_t SCE_MT_GenerateCell (SCEvertices[3 * 36], const float[8],
 
 size_t SCE_MT_Generate (SCEvertices*, const unsigned char*,
                         const SCE_SIntRect3*, SCEuint, SCEuint, SCEuint);
+size_t SCE_MT_Count (const unsigned char*, const SCE_SIntRect3*,
+                     SCEuint, SCEuint, SCEuint);
 void SCE_MT_GenerateNormals (SCEvertices*, const SCEvertices*, size_t,
                              const unsigned char*, SCEuint, SCEuint, SCEuint);
 
+int SCE_MT_GenerateArrays (SCE_SGeometryArray*, SCE_SGeometryArray*,
+                           const unsigned char*, const SCE_SIntRect3*,
+                           SCEuint, SCEuint, SCEuint, size_t*);
+
+int SCE_MT_GenerateIndexed (SCEvertices*, SCE_EType, void*,
+                            const unsigned char*, const SCE_SIntRect3*,
+                            SCEuint, SCEuint, SCEuint, size_t*, size_t*);
+void SCE_MT_CountIndexed (const unsigned char*, const SCE_SIntRect3*,
+                          SCEuint, SCEuint, SCEuint, size_t*, size_t*);
+int SCE_MT_GenerateIndexedArrays (SCE_SGeometryArray*, SCE_SGeometryArray*,
+                                  SCE_SGeometryArray*, const unsigned char*,
+                                  const SCE_SIntRect3*, SCEuint, SCEuint,
+                                  SCEuint, size_t*, size_t*);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -17,27 +17,50 @@
  -----------------------------------------------------------------------------*/
 
 /* created: 09/03/2013
-   updated: 11/03/2013 */
+   updated: 17/10/2026 */
 
 #ifndef SCEQEMDECIMATION_H
 #define SCEQEMDECIMATION_H
 
+#include <pthread.h>
 #include <SCE/utils/SCEUtils.h>
 #include "SCE/core/SCEGeometry.h"
+#include "SCE/core/SCEThreadPool.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* disables the error bound of SCE_QEMD_Decimate() */
+#define SCE_QEMD_NO_MAX_ERROR (-1.0)
+
+/**
+ * \brief Symmetric quadric, upper triangle of the 4x4 matrix row by row:
+ * a2 ab ac ad b2 bc bd c2 cd d2
+ */
+typedef float SCE_TQEMQuadric[10];
+
 typedef struct sce_sqemvertex SCE_SQEMVertex;
 struct sce_sqemvertex {
-    SCE_TMatrix4 q;
+    SCE_TQEMQuadric q;
     SCE_TVector3 v, n;
-    SCEubyte color;
-    long index;                 /* in case this vertex has been merged, index
-                                   to the new vertex, -1 otherwise */
+    SCEuint parent;             /* union-find of the merged vertices, the
+                                   root holds the data of the set */
+    SCEuint next;               /* circular list of the vertices of a set */
+    SCEuint stamp;              /* incremented each time the vertex changes */
+    SCEuint mark;               /* see SCE_QEMD_QueueEdges() */
     SCEuint final;
     int anchor;
+    SCEubyte color;
+};
+
+/* a queued collapse, stale if the stamps of its vertices have changed */
+typedef struct sce_sqemedge SCE_SQEMEdge;
+struct sce_sqemedge {
+    float error;
+    SCEuint v1, v2;             /* v2 is merged into v1 */
+    SCEuint stamp1, stamp2;
+    SCE_TVector3 v, n;          /* resulting vertex */
 };
 
 typedef struct sce_sqemmesh SCE_SQEMMesh;
@@ -50,11 +73,66 @@ struct sce_sqemmesh {
 
     const SCEvertices *original_vertices;
     SCE_SQEMVertex *vertices;
-    SCEindices *indices;
+    SCEuint *indices;
+    SCEuint n_faces;            /* non degenerate triangles */
+
+    SCEuint *offsets;           /* faces of vertex i are faces[offsets[i]] */
+    SCEuint *faces;             /* to faces[offsets[i + 1]] */
+    SCE_SQEMEdge *heap;         /* binary heap of the collapses */
+    size_t heap_size;
+    size_t max_heap;
+    SCEuint mark;
 
     int interleaved;
 };
 
+/**
+ * \brief A mesh to decimate with SCE_QEMBatch_Process()
+ *
+ * The output arrays must be as large as the input ones, \c out_indices is
+ * of the type \c itype.
+ */
+typedef struct sce_sqemjob SCE_SQEMJob;
+struct sce_sqemjob {
+    const SCEvertices *vertices;
+    const SCEvertices *normals; /* can be NULL */
+    const SCEubyte *colors;     /* can be NULL */
+    const SCEubyte *anchors;    /* can be NULL */
+    SCE_EType itype;
+    const void *indices;
+    SCEuint n_vertices;
+    SCEuint n_indices;
+
+    SCEuint n_triangles;        /* see SCE_QEMD_Decimate() */
+    float max_error;
+
+    SCEvertices *out_vertices;
+    SCEvertices *out_normals;   /* can be NULL */
+    SCEubyte *out_colors;       /* can be NULL */
+    void *out_indices;
+    SCEuint out_n_vertices;
+    SCEuint out_n_indices;
+    int error;                  /* SCE_OK or SCE_ERROR once processed */
+};
+
+typedef struct sce_sqemworker SCE_SQEMWorker;
+
+/**
+ * \brief Decimates many meshes on a thread pool
+ *
+ * Each worker keeps its SCE_SQEMMesh between batches, it is only rebuilt
+ * when a job does not fit in it.
+ */
+typedef struct sce_sqembatch SCE_SQEMBatch;
+struct sce_sqembatch {
+    pthread_mutex_t mutex;      /* protects next */
+    SCE_SQEMWorker *workers;
+    size_t n_workers;
+    SCE_SQEMJob *jobs;          /* jobs of the running batch */
+    size_t n_jobs;
+    size_t next;                /* next job to process */
+};
+
 void SCE_QEMD_Init (SCE_SQEMMesh*);
 void SCE_QEMD_Clear (SCE_SQEMMesh*);
 
@@ -64,15 +142,26 @@ void SCE_QEMD_SetMaxIndices (SCE_SQEMMesh*, SCEuint);
 int SCE_QEMD_Build (SCE_SQEMMesh*);
 
 void SCE_QEMD_Set (SCE_SQEMMesh*, const SCEvertices*, const SCEvertices*,
-                   const SCEubyte*, const SCEubyte*, const SCEindices*,
+                   const SCEubyte*, const SCEubyte*, SCE_EType, const void*,
                    SCEuint, SCEuint);
-void SCE_QEMD_SetInterleaved (SCE_SQEMMesh*, const SCEvertices*,
-                              const SCEindices*, SCEuint, SCEuint);
-void SCE_QEMD_AnchorVertices (SCE_SQEMMesh*, const SCEindices*, SCEuint);
+void SCE_QEMD_SetInterleaved (SCE_SQEMMesh*, const SCEvertices*, SCE_EType,
+                              const void*, SCEuint, SCEuint);
+void SCE_QEMD_AnchorVertices (SCE_SQEMMesh*, SCE_EType, const void*, SCEuint);
 void SCE_QEMD_Get (SCE_SQEMMesh*, SCEvertices*, SCEvertices*, SCEubyte*,
-                   SCEindices*, SCEuint*, SCEuint*);
+                   SCE_EType, void*, SCEuint*, SCEuint*);
+
+int SCE_QEMD_Process (SCE_SQEMMesh*, SCEuint);
+int SCE_QEMD_Decimate (SCE_SQEMMesh*, SCEuint, float);
+
+void SCE_QEMD_InitJob (SCE_SQEMJob*);
+
+void SCE_QEMBatch_Init (SCE_SQEMBatch*);
+void SCE_QEMBatch_Clear (SCE_SQEMBatch*);
+SCE_SQEMBatch* SCE_QEMBatch_Create (void);
+void SCE_QEMBatch_Delete (SCE_SQEMBatch*);
 
-void SCE_QEMD_Process (SCE_SQEMMesh*, SCEuint);
+int SCE_QEMBatch_Process (SCE_SQEMBatch*, SCE_SThreadPool*, SCE_SQEMJob*,
+                          size_t);
 
 #ifdef __cplusplus
 } /* extern "C" */
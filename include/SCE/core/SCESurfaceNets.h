@@ -0,0 +1,82 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#ifndef SCESURFACENETS_H
+#define SCESURFACENETS_H
+
+#include <SCE/utils/SCEUtils.h>
+#include "SCE/core/SCEGeometry.h"
+#include "SCE/core/SCEGrid.h"
+#include "SCE/core/SCEVoxelGrid.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Surface nets mesher
+ *
+ * Places one vertex in each cell crossed by the surface and joins the
+ * vertices of the 4 cells around each crossed lattice edge with a quad.
+ * Regions follow the conventions of SCE_SMCGenerator: the last cell along
+ * each axis is not triangulated, so regions overlapping by one cell mesh
+ * seamlessly.
+ */
+typedef struct sce_ssngenerator SCE_SSNGenerator;
+struct sce_ssngenerator {
+    SCEuint x, y, z;            /* first cell of the region */
+    SCEuint w, h, d;            /* number of cells of the region */
+
+    /* two rolling z-planes of points and cells */
+    SCEubyte *points;
+    SCEubyte *confs;
+    SCEuint *slots;             /* vertex of each cell */
+    size_t planes_size;         /* number of points of a plane */
+
+    SCE_EType itype;            /* type of the generated indices */
+    const SCE_SVoxelGrid *summary; /* min/max summary of the grid */
+};
+
+void SCE_SN_Init (SCE_SSNGenerator*);
+void SCE_SN_Clear (SCE_SSNGenerator*);
+SCE_SSNGenerator* SCE_SN_Create (void);
+void SCE_SN_Delete (SCE_SSNGenerator*);
+
+void SCE_SN_SetIndicesType (SCE_SSNGenerator*, SCE_EType);
+SCE_EType SCE_SN_GetIndicesType (const SCE_SSNGenerator*);
+void SCE_SN_SetSummary (SCE_SSNGenerator*, const SCE_SVoxelGrid*);
+
+int SCE_SN_Count (SCE_SSNGenerator*, const SCE_SIntRect3*, const SCE_SGrid*,
+                  size_t*, size_t*);
+int SCE_SN_Generate (SCE_SSNGenerator*, const SCE_SIntRect3*,
+                     const SCE_SGrid*, SCEvertices*, SCEvertices*, void*,
+                     size_t*, size_t*);
+int SCE_SN_GenerateArrays (SCE_SSNGenerator*, const SCE_SIntRect3*,
+                           const SCE_SGrid*, SCE_SGeometryArray*,
+                           SCE_SGeometryArray*, SCE_SGeometryArray*,
+                           size_t*, size_t*);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* guard */
@@ -0,0 +1,97 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#ifndef SCETHREADPOOL_H
+#define SCETHREADPOOL_H
+
+#include <pthread.h>
+#include <SCE/utils/SCEUtils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*SCE_FThreadPoolJobFunc)(void*);
+
+typedef enum {
+    SCE_TPOOL_JOB_IDLE = 0,     /* not queued */
+    SCE_TPOOL_JOB_QUEUED,
+    SCE_TPOOL_JOB_RUNNING,
+    SCE_TPOOL_JOB_DONE
+} SCE_EThreadPoolJobState;
+
+typedef struct sce_sthreadpooljob SCE_SThreadPoolJob;
+struct sce_sthreadpooljob {
+    SCE_FThreadPoolJobFunc fun; /* job function */
+    SCE_FThreadPoolJobFunc del; /* called once the job is over, can free it */
+    void *data;                 /* argument of both functions */
+    int priority;               /* highest priority jobs run first */
+    SCE_EThreadPoolJobState state;
+    SCE_SListIterator it;
+};
+
+typedef struct sce_sthreadpool SCE_SThreadPool;
+struct sce_sthreadpool {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* a job was queued or the pool is stopping */
+    pthread_cond_t done_cond;   /* a job is over */
+    pthread_t *threads;
+    size_t n_threads;
+    int running;
+    int quit;
+    SCE_SList jobs;             /* queued jobs */
+    size_t n_busy;              /* number of running jobs */
+};
+
+int SCE_Init_TPool (void);
+void SCE_Quit_TPool (void);
+
+void SCE_TPool_InitJob (SCE_SThreadPoolJob*);
+void SCE_TPool_SetJobFunc (SCE_SThreadPoolJob*, SCE_FThreadPoolJobFunc);
+void SCE_TPool_SetJobFreeFunc (SCE_SThreadPoolJob*, SCE_FThreadPoolJobFunc);
+void SCE_TPool_SetJobData (SCE_SThreadPoolJob*, void*);
+void SCE_TPool_SetJobPriority (SCE_SThreadPoolJob*, int);
+SCE_EThreadPoolJobState SCE_TPool_GetJobState (SCE_SThreadPoolJob*);
+
+void SCE_TPool_Init (SCE_SThreadPool*);
+void SCE_TPool_Clear (SCE_SThreadPool*);
+SCE_SThreadPool* SCE_TPool_Create (void);
+void SCE_TPool_Delete (SCE_SThreadPool*);
+
+void SCE_TPool_SetNumThreads (SCE_SThreadPool*, size_t);
+size_t SCE_TPool_GetNumThreads (const SCE_SThreadPool*);
+
+int SCE_TPool_Start (SCE_SThreadPool*);
+void SCE_TPool_Stop (SCE_SThreadPool*);
+int SCE_TPool_IsRunning (SCE_SThreadPool*);
+
+void SCE_TPool_Push (SCE_SThreadPool*, SCE_SThreadPoolJob*);
+int SCE_TPool_Cancel (SCE_SThreadPool*, SCE_SThreadPoolJob*);
+void SCE_TPool_WaitJob (SCE_SThreadPool*, SCE_SThreadPoolJob*);
+void SCE_TPool_Wait (SCE_SThreadPool*);
+
+SCE_SThreadPool* SCE_TPool_GetDefault (void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* guard */
@@ -0,0 +1,77 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#ifndef SCEVOXELCODEC_H
+#define SCEVOXELCODEC_H
+
+#include <SCE/utils/SCEUtils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* built-in codecs */
+#define SCE_VCODEC_RAW 0
+#define SCE_VCODEC_ZLIB 1
+#define SCE_VCODEC_RLE 2
+#define SCE_VCODEC_NUM_BUILTIN 3
+
+#define SCE_VCODEC_MAX 256
+
+typedef struct sce_svoxelcodec SCE_SVoxelCodec;
+
+/* allocates the output with SCE_malloc() */
+typedef int (*SCE_FVoxelCodecCompress)(const SCE_SVoxelCodec*,
+                                       const SCEubyte*, size_t,
+                                       SCEubyte**, size_t*);
+/* output size is known, the codec must fill it exactly */
+typedef int (*SCE_FVoxelCodecDecompress)(const SCE_SVoxelCodec*,
+                                         const SCEubyte*, size_t,
+                                         SCEubyte*, size_t);
+
+struct sce_svoxelcodec {
+    SCEuint id;                 /* stored in the compressed data, < 256 */
+    const char *name;
+    int level;                  /* compression level, codec specific */
+    SCE_FVoxelCodecCompress compress;
+    SCE_FVoxelCodecDecompress decompress;
+};
+
+void SCE_VCodec_Init (SCE_SVoxelCodec*);
+void SCE_VCodec_InitZlib (SCE_SVoxelCodec*, int);
+void SCE_VCodec_InitRLE (SCE_SVoxelCodec*);
+
+int SCE_VCodec_Register (SCE_SVoxelCodec*);
+SCE_SVoxelCodec* SCE_VCodec_Get (SCEuint);
+
+SCEuint SCE_VCodec_GetID (const SCE_SVoxelCodec*);
+const char* SCE_VCodec_GetName (const SCE_SVoxelCodec*);
+
+int SCE_VCodec_Compress (const SCE_SVoxelCodec*, const SCEubyte*, size_t,
+                         SCEubyte**, size_t*);
+int SCE_VCodec_Decompress (const SCE_SVoxelCodec*, const SCEubyte*, size_t,
+                           SCEubyte*, size_t);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* guard */
@@ -0,0 +1,92 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#ifndef SCEVOXELEDIT_H
+#define SCEVOXELEDIT_H
+
+#include <SCE/utils/SCEUtils.h>
+#include "SCE/core/SCEVoxelOctree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    SCE_VEDIT_SPHERE,
+    SCE_VEDIT_BOX,
+    SCE_VEDIT_CYLINDER          /* along the z axis */
+} SCE_EVoxelBrushShape;
+
+typedef enum {
+    SCE_VEDIT_ADD,              /* adds matter */
+    SCE_VEDIT_SUBTRACT,         /* removes matter */
+    SCE_VEDIT_PAINT             /* sets the voxels inside the shape */
+} SCE_EVoxelBrushOperation;
+
+typedef struct sce_svoxelbrush SCE_SVoxelBrush;
+struct sce_svoxelbrush {
+    SCE_EVoxelBrushShape shape;
+    SCE_EVoxelBrushOperation op;
+    float center[3];            /* in level 0's space */
+    float size[3];              /* radius or half dimensions */
+    SCEubyte value;             /* density or material */
+    SCE_SLongRect3 bounds;      /* voxels affected by the brush */
+};
+
+/**
+ * \brief A list of brushes applied at once on a voxel world
+ * \sa SCE_VWorld_ApplyEdits()
+ */
+typedef struct sce_svoxeleditbatch SCE_SVoxelEditBatch;
+struct sce_svoxeleditbatch {
+    SCE_SVoxelBrush *brushes;
+    size_t n_brushes;
+    size_t max_brushes;         /* allocated brushes */
+    SCE_SLongRect3 bounds;      /* union of the bounds of the brushes */
+};
+
+void SCE_VEdit_Init (SCE_SVoxelEditBatch*);
+void SCE_VEdit_Clear (SCE_SVoxelEditBatch*);
+SCE_SVoxelEditBatch* SCE_VEdit_Create (void);
+void SCE_VEdit_Delete (SCE_SVoxelEditBatch*);
+
+void SCE_VEdit_Flush (SCE_SVoxelEditBatch*);
+
+int SCE_VEdit_AddSphere (SCE_SVoxelEditBatch*, SCE_EVoxelBrushOperation,
+                         float, float, float, float, SCEubyte);
+int SCE_VEdit_AddBox (SCE_SVoxelEditBatch*, SCE_EVoxelBrushOperation,
+                      float, float, float, float, float, float, SCEubyte);
+int SCE_VEdit_AddCylinder (SCE_SVoxelEditBatch*, SCE_EVoxelBrushOperation,
+                           float, float, float, float, float, SCEubyte);
+
+size_t SCE_VEdit_GetNumBrushes (const SCE_SVoxelEditBatch*);
+SCE_SVoxelBrush* SCE_VEdit_GetBrush (SCE_SVoxelEditBatch*, size_t);
+void SCE_VEdit_GetBounds (const SCE_SVoxelEditBatch*, SCE_SLongRect3*);
+
+void SCE_VEdit_ApplyBrush (const SCE_SVoxelBrush*, SCE_EVoxelOctreeUsage,
+                           const SCE_SLongRect3*, SCEubyte*);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* guard */
@@ -26,6 +26,10 @@
 extern "C" {
 #endif
 
+/* dimensions of the bricks of the min/max summary, log2 */
+#define SCE_VGRID_BRICK_SHIFT 3
+#define SCE_VGRID_BRICK_SIZE (1 << SCE_VGRID_BRICK_SHIFT)
+
 typedef struct sce_svoxelgrid SCE_SVoxelGrid;
 struct sce_svoxelgrid {
     SCEulong w, h, d;
@@ -34,6 +38,12 @@ struct sce_svoxelgrid {
 
     int full_checked, empty_checked;
     int full, empty;
+
+    /* minimum and maximum density of each brick, followed by the levels
+       of coarser bricks, NULL if not tracked */
+    SCEubyte *bmin, *bmax;
+    SCEulong bw, bh, bd;        /* number of bricks of the finest level */
+    SCEuint n_blevels;          /* number of levels, the last is 1 brick */
 };
 
 void SCE_VGrid_Init (SCE_SVoxelGrid*);
@@ -68,6 +78,18 @@ void SCE_VGrid_FillStats2 (const SCE_SLongRect3*, SCE_SVoxelGrid*, SCEubyte,
 
 SCEubyte* SCE_VGrid_Offset (SCE_SVoxelGrid*, SCEulong, SCEulong, SCEulong);
 
+int SCE_VGrid_ComputeDensityLOD (const SCE_SVoxelGrid*, SCE_SVoxelGrid*);
+
+int SCE_VGrid_AllocBricks (SCE_SVoxelGrid*);
+void SCE_VGrid_UpdateBricks (SCE_SVoxelGrid*, const SCE_SLongRect3*);
+void SCE_VGrid_SwapBricks (SCE_SVoxelGrid*, SCE_SVoxelGrid*);
+int SCE_VGrid_HasBricks (const SCE_SVoxelGrid*);
+size_t SCE_VGrid_GetBricksSize (const SCE_SVoxelGrid*);
+void SCE_VGrid_GetBricks (const SCE_SVoxelGrid*, SCEubyte*);
+void SCE_VGrid_SetBricks (SCE_SVoxelGrid*, const SCEubyte*);
+int SCE_VGrid_GetRange (const SCE_SVoxelGrid*, const SCE_SLongRect3*,
+                        SCEubyte*, SCEubyte*);
+
 int SCE_VGrid_IsEmpty (SCE_SVoxelGrid*, const SCE_SLongRect3*);
 int SCE_VGrid_IsFull (SCE_SVoxelGrid*, const SCE_SLongRect3*);
 
@@ -22,8 +22,11 @@
 #ifndef SCEVOXELOCTREE_H
 #define SCEVOXELOCTREE_H
 
+#include <pthread.h>
 #include <SCE/utils/SCEUtils.h>
 #include "SCE/core/SCEVoxelGrid.h"
+#include "SCE/core/SCEVoxelCodec.h"
+#include "SCE/core/SCEVoxelPack.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +54,7 @@ struct sce_svoxeloctreenode {
     SCEuint level;
     long x, y, z;          /* coordinates of the origin, in level's space */
     char fname[SCE_VOCTREE_NODE_FNAME_LENGTH];
+    long key[4];           /* level and origin of the file, for packs */
     SCE_SVoxelGrid grid;
     SCE_SFile file;
     int is_open;           /* is \c file open? */
@@ -60,6 +64,10 @@ struct sce_svoxeloctreenode {
     long in_volume;        /* number of voxels in the volume */
     long *in;              /* number of voxels of each type */
     int material;          /* material ID if full */
+    int pending;           /* number of queued background jobs */
+    int loading;           /* is \c grid being decompressed by a thread? */
+    int pinned;            /* number of readers of \c grid, it can't be
+                              evicted while they are reading */
 
     void *udata, *udata2;               /* user data */
     SCE_FVoxelOctreeFreeFunc fun, fun2; /* not so fun, this is actually awful */
@@ -67,6 +75,18 @@ struct sce_svoxeloctreenode {
     SCE_SVoxelOctree *vo;
 };
 
+/**
+ * \brief Statistics of the node cache of an octree
+ */
+typedef struct sce_svoxeloctreecachestats SCE_SVoxelOctreeCacheStats;
+struct sce_svoxeloctreecachestats {
+    SCEulong n_nodes;           /**< Number of cached nodes */
+    size_t size;                /**< Decompressed memory used, in bytes */
+    SCEulong hits;              /**< Requested nodes that were in memory */
+    SCEulong misses;            /**< Requested nodes that had to be loaded */
+    SCEulong evictions;         /**< Nodes removed from memory */
+};
+
 typedef enum {
     SCE_VOCTREE_DENSITY_FIELD,
     SCE_VOCTREE_MATERIAL
@@ -84,10 +104,19 @@ struct sce_svoxeloctree {
 
     SCE_SFileSystem *fs;
     SCE_SFileCache *fcache;
+    const SCE_SVoxelCodec *codec; /* used to compress the node files */
+    SCE_SVoxelPack *pack;       /* replaces the node files if not NULL */
 
+    pthread_mutex_t cache_mutex;
+    pthread_cond_t cache_cond;  /* signaled when a node is done loading */
+    pthread_mutex_t sync_mutex; /* serializes the writing of node files */
+    pthread_mutex_t *file_mutex; /* shared with the users of \c fs */
     SCEulong n_cached;
     SCEulong max_cached;
-    SCE_SList cached;
+    size_t cached_size;         /* bytes of decompressed grids in memory */
+    size_t max_cached_size;     /* 0: derived from max_cached */
+    SCE_SList cached;           /* least recently used node first */
+    SCEulong cache_hits, cache_misses, cache_evictions;
 
     void *udata;
     SCE_FVoxelOctreeFreeFunc fun;
@@ -108,7 +137,14 @@ void SCE_VOctree_SetPrefix (SCE_SVoxelOctree*, const char*);
 
 void SCE_VOctree_SetFileSystem (SCE_SVoxelOctree*, SCE_SFileSystem*);
 void SCE_VOctree_SetFileCache (SCE_SVoxelOctree*, SCE_SFileCache*);
+void SCE_VOctree_SetFileMutex (SCE_SVoxelOctree*, pthread_mutex_t*);
+void SCE_VOctree_SetPack (SCE_SVoxelOctree*, SCE_SVoxelPack*);
+SCE_SVoxelPack* SCE_VOctree_GetPack (SCE_SVoxelOctree*);
+void SCE_VOctree_SetCodec (SCE_SVoxelOctree*, const SCE_SVoxelCodec*);
+const SCE_SVoxelCodec* SCE_VOctree_GetCodec (const SCE_SVoxelOctree*);
 void SCE_VOctree_SetMaxCachedNodes (SCE_SVoxelOctree*, SCEulong);
+void SCE_VOctree_SetMaxCachedSize (SCE_SVoxelOctree*, size_t);
+size_t SCE_VOctree_GetMaxCachedSize (const SCE_SVoxelOctree*);
 
 void SCE_VOctree_SetData (SCE_SVoxelOctree*, void*);
 void* SCE_VOctree_GetData (SCE_SVoxelOctree*);
@@ -123,6 +159,11 @@ void SCE_VOctree_SetNodeFreeFunc2 (SCE_SVoxelOctreeNode*,
                                   SCE_FVoxelOctreeFreeFunc);
 const char* SCE_VOctree_GetNodeFilename (const SCE_SVoxelOctreeNode*);
 SCE_EVoxelOctreeStatus SCE_VOctree_GetNodeStatus (const SCE_SVoxelOctreeNode*);
+SCE_EVoxelOctreeStatus
+SCE_VOctree_GetNodeRegionStatus (SCE_SVoxelOctree*, SCE_SVoxelOctreeNode*,
+                                 const SCE_SLongRect3*);
+int SCE_VOctree_IsNodeLoading (const SCE_SVoxelOctreeNode*);
+void SCE_VOctree_AddNodePending (SCE_SVoxelOctreeNode*, int);
 SCEuint SCE_VOctree_GetNodeLevel (const SCE_SVoxelOctreeNode*);
 void SCE_VOctree_GetNodeOriginv (const SCE_SVoxelOctreeNode*,long*,long*,long*);
 SCE_SVoxelOctreeNode** SCE_VOctree_GetNodeChildren (SCE_SVoxelOctreeNode*);
@@ -151,14 +192,24 @@ int SCE_VOctree_SetRegion (SCE_SVoxelOctree*, SCEuint, const SCE_SLongRect3*,
                            const SCEubyte*);
 int SCE_VOctree_FillRegion (SCE_SVoxelOctree*, SCEuint, const SCE_SLongRect3*,
                             SCEubyte);
+int SCE_VOctree_GetNodeVoxels (SCE_SVoxelOctree*, SCE_SVoxelOctreeNode*,
+                               SCEubyte*);
+int SCE_VOctree_SetNodeVoxels (SCE_SVoxelOctree*, SCE_SVoxelOctreeNode*,
+                               const SCE_SLongRect3*, const SCEubyte*);
+int SCE_VOctree_GetRegionStatus (SCE_SVoxelOctree*, SCEuint,
+                                 const SCE_SLongRect3*,
+                                 SCE_EVoxelOctreeStatus*);
 int SCE_VOctree_FetchNodes (SCE_SVoxelOctree*, SCEuint, const SCE_SLongRect3*,
                             SCE_SList*);
 SCE_SVoxelOctreeNode* SCE_VOctree_FetchNode (SCE_SVoxelOctree*, SCEuint,
                                              long, long, long);
 int SCE_VOctree_FetchAllNodes (SCE_SVoxelOctree*, SCEuint, SCE_SList*);
+SCE_SVoxelOctreeNode* SCE_VOctree_FindNode (SCE_SVoxelOctree*, SCEuint,
+                                            long, long, long);
 
 int SCE_VOctree_SyncNode (SCE_SVoxelOctree*, SCE_SVoxelOctreeNode*);
 int SCE_VOctree_CacheNode (SCE_SVoxelOctree*, SCE_SVoxelOctreeNode*);
+int SCE_VOctree_TouchNode (SCE_SVoxelOctree*, SCE_SVoxelOctreeNode*);
 
 size_t SCE_VOctree_GetNodeCompressedSize (SCE_SVoxelOctreeNode*);
 void* SCE_VOctree_GetNodeCompressedData (SCE_SVoxelOctreeNode*);
@@ -166,6 +217,9 @@ void* SCE_VOctree_GetNodeCompressedData (SCE_SVoxelOctreeNode*);
 int SCE_VOctree_UpdateCache (SCE_SVoxelOctree*);
 int SCE_VOctree_SyncCache (SCE_SVoxelOctree*);
 
+void SCE_VOctree_GetCacheStats (SCE_SVoxelOctree*,SCE_SVoxelOctreeCacheStats*);
+void SCE_VOctree_ResetCacheStats (SCE_SVoxelOctree*);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,96 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#ifndef SCEVOXELPACK_H
+#define SCEVOXELPACK_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <SCE/utils/SCEUtils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCE_VPACK_FNAME_LENGTH 256
+
+typedef struct sce_svoxelpackentry SCE_SVoxelPackEntry;
+struct sce_svoxelpackentry {
+    int used;                   /* state of the hash table slot */
+    long level, x, y, z;        /* key */
+    size_t offset;              /* offset of the data in the file */
+    size_t size;
+    SCEubyte *data;             /* data not written yet, NULL if none */
+};
+
+/**
+ * \brief A single file archive of voxel node data
+ *
+ * Blobs are indexed by (level, x, y, z) keys. The file is mapped read-only
+ * in memory, modified blobs are kept in memory until the next call to
+ * SCE_VPack_Sync() which appends them at the end of the file along with a
+ * new index.
+ */
+typedef struct sce_svoxelpack SCE_SVoxelPack;
+struct sce_svoxelpack {
+    pthread_rwlock_t rwlock;
+    char fname[SCE_VPACK_FNAME_LENGTH];
+    FILE *fp;
+    SCEubyte *map;              /* the whole file, read-only */
+    size_t map_size;
+    int mapped;                 /* is \c map a memory mapping? */
+    size_t file_size;
+    size_t index_size;          /* size of the index at the end of the file */
+    SCE_SVoxelPackEntry *entries; /* hash table */
+    size_t n_slots;
+    size_t n_used;              /* used and removed slots */
+    size_t n_entries;
+    size_t wasted;              /* bytes of the file not used anymore */
+    int dirty;
+};
+
+void SCE_VPack_Init (SCE_SVoxelPack*);
+void SCE_VPack_Clear (SCE_SVoxelPack*);
+SCE_SVoxelPack* SCE_VPack_Create (void);
+void SCE_VPack_Delete (SCE_SVoxelPack*);
+
+int SCE_VPack_Open (SCE_SVoxelPack*, const char*);
+void SCE_VPack_Close (SCE_SVoxelPack*);
+int SCE_VPack_IsOpen (const SCE_SVoxelPack*);
+
+void SCE_VPack_Lock (SCE_SVoxelPack*);
+void SCE_VPack_Unlock (SCE_SVoxelPack*);
+const SCEubyte* SCE_VPack_Get (SCE_SVoxelPack*, long, long, long, long,
+                               size_t*);
+int SCE_VPack_Put (SCE_SVoxelPack*, long, long, long, long, SCEubyte*, size_t);
+void SCE_VPack_Remove (SCE_SVoxelPack*, long, long, long, long);
+
+size_t SCE_VPack_GetNumEntries (SCE_SVoxelPack*);
+size_t SCE_VPack_GetWastedSize (SCE_SVoxelPack*);
+
+int SCE_VPack_Sync (SCE_SVoxelPack*);
+int SCE_VPack_Compact (SCE_SVoxelPack*);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* guard */
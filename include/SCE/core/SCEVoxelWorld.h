@@ -25,6 +25,8 @@
 #include <pthread.h>
 #include <SCE/utils/SCEUtils.h>
 #include "SCE/core/SCEVoxelOctree.h"
+#include "SCE/core/SCEVoxelEdit.h"
+#include "SCE/core/SCEThreadPool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,7 +42,20 @@ struct sce_svoxelworldtree {
     SCE_SListIterator it, it2;
 };
 
-#define SCE_MAX_VWORLD_UPDATE_ZONES 128
+#define SCE_MAX_VWORLD_STREAMING_LEVELS 16
+
+/* minimum number of recorded regions merged together */
+#define SCE_VWORLD_ZONE_BATCH 64
+/* levels whose updates are kept even when memory runs out */
+#define SCE_MAX_VWORLD_LEVELS 32
+
+/* modified region waiting to be processed */
+typedef struct sce_svoxelworldzone SCE_SVoxelWorldZone;
+struct sce_svoxelworldzone {
+    SCE_SLongRect3 zone;
+    SCEuint level;
+    SCE_SListIterator it;
+};
 
 typedef struct sce_svoxelworldbuffer SCE_SVoxelWorldBuffer;
 struct sce_svoxelworldbuffer {
@@ -49,6 +64,39 @@ struct sce_svoxelworldbuffer {
 };
 
 typedef struct sce_svoxelworld SCE_SVoxelWorld;
+
+/**
+ * \brief Called by a worker thread once a background job is over
+ *
+ * The node is NULL for jobs working on a whole tree or if the node no longer
+ * exists. The read lock of the tree is held during the call, thus the
+ * callback must not modify the world.
+ * \sa SCE_VWorld_QueueLoadNode()
+ */
+typedef void (*SCE_FVoxelWorldJobCallback)(SCE_SVoxelWorld*,
+                                           SCE_SVoxelOctreeNode*, int, void*);
+
+typedef enum {
+    SCE_VWORLD_JOB_LOAD_NODE,   /* decompress a node */
+    SCE_VWORLD_JOB_SYNC_NODE,   /* compress a node into its file */
+    SCE_VWORLD_JOB_UPDATE_TREE, /* evict the nodes of a tree over budget */
+    SCE_VWORLD_JOB_SYNC_TREE    /* compress every modified node of a tree */
+} SCE_EVoxelWorldJobType;
+
+typedef struct sce_svoxelworldjob SCE_SVoxelWorldJob;
+struct sce_svoxelworldjob {
+    SCE_SThreadPoolJob job;
+    SCE_EVoxelWorldJobType type;
+    SCE_SVoxelWorld *vw;
+    long tx, ty, tz;            /* coordinates of the tree */
+    SCEuint level;              /* level and origin of the node */
+    long x, y, z;
+    int streaming;              /* queued by the streaming ring */
+    SCE_FVoxelWorldJobCallback fun;
+    void *udata;
+    SCE_SListIterator it;       /* in the list of prefetch jobs */
+};
+
 struct sce_svoxelworld {
     SCE_SList trees;            /* list of VoxelWorldTree */
     SCE_SArray2D trees_grid;
@@ -65,17 +113,35 @@ struct sce_svoxelworld {
     SCE_FVoxelWorldMkdirFunc fmkdir;
     SCE_SFileSystem *fs;
     SCE_SFileCache *fcache;
+    pthread_mutex_t file_mutex; /* protects fs and fcache */
     SCEulong max_cached_nodes;
-
-    SCE_SLongRect3 zones[SCE_MAX_VWORLD_UPDATE_ZONES];
-    int zones_level[SCE_MAX_VWORLD_UPDATE_ZONES];
-    int last, first;
+    size_t max_cached_size;
+    const SCE_SVoxelCodec *codec;
+    SCE_SVoxelPack *pack;
+
+    SCE_SList zones;            /* updated regions, protected by mutex */
+    size_t n_zones;
+    size_t n_new_zones;         /* zones recorded since the last merge */
+    /* union of the zones of each level that could not be allocated */
+    SCE_SLongRect3 lost_zones[SCE_MAX_VWORLD_LEVELS];
+    SCEulong lost;              /* levels having a lost zone, bit field */
     int record_updates;
 
     /* some memory pre-allocated for LOD computation */
     SCE_SVoxelWorldBuffer *buffers;
     size_t n_buffers;
     size_t size1, size2;
+
+    /* background compression/decompression of nodes */
+    SCE_SThreadPool workers;
+
+    /* prefetching and streaming ring */
+    pthread_mutex_t prefetch_mutex;
+    SCE_SList prefetched;       /* prefetch jobs, owned by the world */
+    long focus[3];              /* center of the ring, in level 0 space */
+    long radius[SCE_MAX_VWORLD_STREAMING_LEVELS]; /* in voxels of each level,
+                                                     negative: not streamed */
+    int streaming_priority;
 };
 
 void SCE_VWorld_InitTree (SCE_SVoxelWorldTree*);
@@ -106,7 +172,11 @@ void SCE_VWorld_SetMkdirFunc (SCE_SVoxelWorld*, SCE_FVoxelWorldMkdirFunc);
 void SCE_VWorld_SetFileSystem (SCE_SVoxelWorld*, SCE_SFileSystem*);
 void SCE_VWorld_SetFileCache (SCE_SVoxelWorld*, SCE_SFileCache*);
 void SCE_VWorld_SetMaxCachedNodes (SCE_SVoxelWorld*, SCEulong);
+void SCE_VWorld_SetMaxCachedSize (SCE_SVoxelWorld*, size_t);
+void SCE_VWorld_SetCodec (SCE_SVoxelWorld*, const SCE_SVoxelCodec*);
+void SCE_VWorld_SetPack (SCE_SVoxelWorld*, SCE_SVoxelPack*);
 void SCE_VWorld_SetNumBuffers (SCE_SVoxelWorld*, size_t);
+void SCE_VWorld_SetNumWorkers (SCE_SVoxelWorld*, size_t);
 
 SCE_SVoxelWorldTree* SCE_VWorld_NewTree (SCE_SVoxelWorld*, long, long, long);
 int SCE_VWorld_AddTree (SCE_SVoxelWorld*, SCE_SVoxelWorldTree*);
@@ -140,10 +210,15 @@ int SCE_VWorld_GetRegion (SCE_SVoxelWorld*, SCEuint, const SCE_SLongRect3*,
 int SCE_VWorld_SetRegion (SCE_SVoxelWorld*, const SCE_SLongRect3*,
                           const SCEubyte*);
 int SCE_VWorld_FillRegion (SCE_SVoxelWorld*, const SCE_SLongRect3*, SCEubyte);
+int SCE_VWorld_ApplyEdits (SCE_SVoxelWorld*, SCE_SVoxelEditBatch*,
+                           SCE_SLongRect3*);
 
 void SCE_VWorld_AddUpdatedRegion (SCE_SVoxelWorld*, SCEuint,
                                   const SCE_SLongRect3*);
 int SCE_VWorld_GetNextUpdatedRegion (SCE_SVoxelWorld*, SCE_SLongRect3*);
+size_t SCE_VWorld_GetUpdatedRegions (SCE_SVoxelWorld*, SCEuint,
+                                     SCE_SLongRect3*, size_t);
+size_t SCE_VWorld_GetNumUpdatedRegions (SCE_SVoxelWorld*);
 void SCE_VWorld_EnableUpdateRecording (SCE_SVoxelWorld*);
 void SCE_VWorld_DisableUpdateRecording (SCE_SVoxelWorld*);
 
@@ -170,6 +245,28 @@ SCE_VWorld_GetRegionStatus (SCE_SVoxelWorld*, SCEuint, const SCE_SLongRect3*);
 
 int SCE_VWorld_UpdateCache (SCE_SVoxelWorld*);
 int SCE_VWorld_SyncCache (SCE_SVoxelWorld*);
+int SCE_VWorld_QueueLoadNode (SCE_SVoxelWorld*, SCE_SVoxelOctreeNode*, int,
+                              SCE_FVoxelWorldJobCallback, void*);
+int SCE_VWorld_QueueSyncNode (SCE_SVoxelWorld*, SCE_SVoxelOctreeNode*,
+                              SCE_FVoxelWorldJobCallback, void*);
+int SCE_VWorld_QueueUpdateCache (SCE_SVoxelWorld*, SCE_FVoxelWorldJobCallback,
+                                 void*);
+int SCE_VWorld_QueueSyncCache (SCE_SVoxelWorld*, SCE_FVoxelWorldJobCallback,
+                               void*);
+void SCE_VWorld_WaitJobs (SCE_SVoxelWorld*);
+
+int SCE_VWorld_Prefetch (SCE_SVoxelWorld*, SCEuint, const SCE_SLongRect3*,
+                         int);
+void SCE_VWorld_CancelPrefetch (SCE_SVoxelWorld*);
+size_t SCE_VWorld_GetNumPrefetching (SCE_SVoxelWorld*);
+void SCE_VWorld_SetStreamingRadius (SCE_SVoxelWorld*, SCEuint, long);
+long SCE_VWorld_GetStreamingRadius (const SCE_SVoxelWorld*, SCEuint);
+void SCE_VWorld_SetStreamingPriority (SCE_SVoxelWorld*, int);
+void SCE_VWorld_SetStreamingFocus (SCE_SVoxelWorld*, long, long, long);
+int SCE_VWorld_UpdateStreaming (SCE_SVoxelWorld*);
+
+void SCE_VWorld_GetCacheStats (SCE_SVoxelWorld*, SCE_SVoxelOctreeCacheStats*);
+void SCE_VWorld_ResetCacheStats (SCE_SVoxelWorld*);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -17,7 +17,7 @@
  -----------------------------------------------------------------------------*/
 
 /* created: 06/04/2009
-   updated: 04/06/2009 */
+   updated: 17/10/2026 */
 
 #include <SCE/utils/SCEUtils.h>
 #include "SCE/core/SCEAnimatedGeometry.h"
@@ -112,6 +112,7 @@ static void SCE_AnimGeom_Init (SCE_SAnimatedGeometry *ageom)
         ageom->canfree_indices = SCE_FALSE;
     ageom->vertices = NULL;
     ageom->weights = NULL;
+    ageom->indices_type = SCE_INDICES_TYPE;
     ageom->indices = NULL;
     ageom->n_vertices = 0;
     ageom->n_weights = 0;
@@ -122,6 +123,7 @@ static void SCE_AnimGeom_Init (SCE_SAnimatedGeometry *ageom)
         ageom->output[i] = NULL;
         ageom->arrays[i] = NULL;
     }
+    ageom->output_stride = 3;
     ageom->applyskel = SCE_AnimGeom_ApplySkeletonP;
 }
 /**
@@ -352,13 +354,15 @@ SCEvertices* SCE_AnimGeom_GetBaseVertices (SCE_SAnimatedGeometry *ageom,
 
 /**
  * \brief Sets the vertices indices of an animated geometry
+ * \param type type of \p indices, SCE_INDICES_TYPE or SCE_INDICES32_TYPE
  * \sa SCE_AnimGeom_SetVertices(), SCE_Mesh_SetIndices()
  */
-void SCE_AnimGeom_SetIndices (SCE_SAnimatedGeometry *ageom, size_t n,
-                              SCEindices *indices, int canfree)
+void SCE_AnimGeom_SetIndices (SCE_SAnimatedGeometry *ageom, SCE_EType type,
+                              size_t n, void *indices, int canfree)
 {
     if (ageom->canfree_indices)
         SCE_free (ageom->indices);
+    ageom->indices_type = type;
     ageom->indices = indices;
     ageom->n_indices = n;
 }
@@ -433,7 +437,7 @@ static void SCE_AnimGeom_ApplySkeletonLocalPQuat (SCE_SAnimatedGeometry*,
 static void SCE_AnimGeom_ApplySkeletonP (SCE_SAnimatedGeometry *ageom,
                                          SCE_SSkeleton *skel)
 {
-    size_t i, j;
+    size_t i, j, stride = ageom->output_stride;
 
     for (i = 0; i < ageom->n_vertices; i++) {
         SCE_TMatrix4x3 mat;
@@ -449,7 +453,8 @@ static void SCE_AnimGeom_ApplySkeletonP (SCE_SAnimatedGeometry *ageom,
                           mat);
         }
 
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[0][i*4], &ageom->output[0][i*3]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[0][i*4],
+                             &ageom->output[0][i * stride]);
     }
     /* TODO: how to estimate modified vertices range...?
        use joint-ranged skeletons? */
@@ -459,7 +464,7 @@ static void SCE_AnimGeom_ApplySkeletonP (SCE_SAnimatedGeometry *ageom,
 static void SCE_AnimGeom_ApplySkeletonPN (SCE_SAnimatedGeometry *ageom,
                                           SCE_SSkeleton *skel)
 {
-    size_t i, j;
+    size_t i, j, stride = ageom->output_stride;
 
     for (i = 0; i < ageom->n_vertices; i++) {
         SCE_TMatrix4x3 mat;
@@ -475,8 +480,10 @@ static void SCE_AnimGeom_ApplySkeletonPN (SCE_SAnimatedGeometry *ageom,
                           mat);
         }
 
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[0][i*4], &ageom->output[0][i*3]);
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[1][i*4], &ageom->output[1][i*3]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[0][i*4],
+                             &ageom->output[0][i * stride]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[1][i*4],
+                             &ageom->output[1][i * stride]);
     }
     if (ageom->arrays[0])
         SCE_Geometry_Modified (ageom->arrays[0], NULL);
@@ -486,7 +493,7 @@ static void SCE_AnimGeom_ApplySkeletonPN (SCE_SAnimatedGeometry *ageom,
 static void SCE_AnimGeom_ApplySkeletonPNT (SCE_SAnimatedGeometry *ageom,
                                            SCE_SSkeleton *skel)
 {
-    size_t i, j;
+    size_t i, j, stride = ageom->output_stride;
 
     for (i = 0; i < ageom->n_vertices; i++) {
         SCE_TMatrix4x3 mat;
@@ -502,9 +509,12 @@ static void SCE_AnimGeom_ApplySkeletonPNT (SCE_SAnimatedGeometry *ageom,
                           mat);
         }
 
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[0][i*4], &ageom->output[0][i*3]);
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[1][i*4], &ageom->output[1][i*3]);
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[2][i*4], &ageom->output[2][i*3]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[0][i*4],
+                             &ageom->output[0][i * stride]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[1][i*4],
+                             &ageom->output[1][i * stride]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[2][i*4],
+                             &ageom->output[2][i * stride]);
     }
     if (ageom->arrays[0])
         SCE_Geometry_Modified (ageom->arrays[0], NULL);
@@ -516,7 +526,7 @@ static void SCE_AnimGeom_ApplySkeletonPNT (SCE_SAnimatedGeometry *ageom,
 static void SCE_AnimGeom_ApplySkeletonPNTB (SCE_SAnimatedGeometry *ageom,
                                             SCE_SSkeleton *skel)
 {
-    size_t i, j;
+    size_t i, j, stride = ageom->output_stride;
 
     for (i = 0; i < ageom->n_vertices; i++) {
         SCE_TMatrix4x3 mat;
@@ -532,10 +542,14 @@ static void SCE_AnimGeom_ApplySkeletonPNTB (SCE_SAnimatedGeometry *ageom,
                           mat);
         }
 
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[0][i*4], &ageom->output[0][i*3]);
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[1][i*4], &ageom->output[1][i*3]);
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[2][i*4], &ageom->output[2][i*3]);
-        SCE_Matrix4x3_MulV4 (mat, &ageom->base[3][i*4], &ageom->output[3][i*3]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[0][i*4],
+                             &ageom->output[0][i * stride]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[1][i*4],
+                             &ageom->output[1][i * stride]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[2][i*4],
+                             &ageom->output[2][i * stride]);
+        SCE_Matrix4x3_MulV4 (mat, &ageom->base[3][i*4],
+                             &ageom->output[3][i * stride]);
     }
     if (ageom->arrays[0])
         SCE_Geometry_Modified (ageom->arrays[0], NULL);
@@ -560,7 +574,7 @@ static void SCE_AnimGeom_ApplySkeletonLocal (SCE_SAnimatedGeometry *ageom,
         SCE_SVertex *vert = &ageom->vertices[i];
 
         index = vert->weight_id;
-        out = &ageom->output[n][i * 3];
+        out = &ageom->output[n][i * ageom->output_stride];
 
         weight = &ageom->weights[index];
         mat = &skel->mat[0][weight->joint_id * 12];
@@ -588,7 +602,7 @@ static void SCE_AnimGeom_ApplySkeletonLocalP (SCE_SAnimatedGeometry *ageom,
         SCE_SVertex *vert = &ageom->vertices[i];
 
         index = vert->weight_id;
-        out = &ageom->output[0][i * 3];
+        out = &ageom->output[0][i * ageom->output_stride];
 
         weight = &ageom->weights[index];
         mat = &skel->mat[0][weight->joint_id * 12];
@@ -632,7 +646,7 @@ static void SCE_AnimGeom_ApplySkeletonLocalPQuat (SCE_SAnimatedGeometry *ageom,
         SCE_SJoint *joint = NULL;
 
         index = vert->weight_id;
-        out = &ageom->output[0][i * 3];
+        out = &ageom->output[0][i * ageom->output_stride];
         SCE_Vector3_Set (out, 0.0, 0.0, 0.0);
         for (j = 0; j < vert->weight_count; j++, index++) {
             weight = &ageom->weights[index];
@@ -657,8 +671,8 @@ static void SCE_AnimGeom_ApplySkeletonLocalPN (SCE_SAnimatedGeometry *ageom,
         SCE_SVertex *vert = &ageom->vertices[i];
 
         index = vert->weight_id;
-        out = &ageom->output[0][i * 3];
-        out2 = &ageom->output[1][i * 3];
+        out = &ageom->output[0][i * ageom->output_stride];
+        out2 = &ageom->output[1][i * ageom->output_stride];
 
         weight = &ageom->weights[index];
         mat = &skel->mat[0][weight->joint_id * 12];
@@ -689,9 +703,9 @@ static void SCE_AnimGeom_ApplySkeletonLocalPNT (SCE_SAnimatedGeometry *ageom,
         SCE_SVertex *vert = &ageom->vertices[i];
 
         index = vert->weight_id;
-        out = &ageom->output[0][i * 3];
-        out2 = &ageom->output[1][i * 3];
-        out3 = &ageom->output[2][i * 3];
+        out = &ageom->output[0][i * ageom->output_stride];
+        out2 = &ageom->output[1][i * ageom->output_stride];
+        out3 = &ageom->output[2][i * ageom->output_stride];
 
         weight = &ageom->weights[index];
         mat = &skel->mat[0][weight->joint_id * 12];
@@ -726,10 +740,10 @@ static void SCE_AnimGeom_ApplySkeletonLocalPNTB (SCE_SAnimatedGeometry *ageom,
         SCE_SVertex *vert = &ageom->vertices[i];
 
         index = vert->weight_id;
-        out = &ageom->output[0][i * 3];
-        out2 = &ageom->output[1][i * 3];
-        out3 = &ageom->output[2][i * 3];
-        out4 = &ageom->output[3][i * 3];
+        out = &ageom->output[0][i * ageom->output_stride];
+        out2 = &ageom->output[1][i * ageom->output_stride];
+        out3 = &ageom->output[2][i * ageom->output_stride];
+        out4 = &ageom->output[3][i * ageom->output_stride];
 
         weight = &ageom->weights[index];
         mat = &skel->mat[0][weight->joint_id * 12];
@@ -833,7 +847,8 @@ int SCE_AnimGeom_SetGlobal (SCE_SAnimatedGeometry *ageom)
             }
             SCE_AnimGeom_ApplySkeletonLocal (ageom, i, ageom->baseskel);
             for (j = 0; j < ageom->n_vertices; j++) {
-                SCE_Vector3_Copy (&vert[j * 4], &ageom->output[i][j * 3]);
+                SCE_Vector3_Copy (&vert[j * 4],
+                                  &ageom->output[i][j * ageom->output_stride]);
             }
             SCE_free (ageom->base[i]);
             ageom->base[i] = vert;
@@ -885,7 +900,7 @@ int SCE_AnimGeom_BuildGeometry (SCE_SAnimatedGeometry *ageom)
     if (ageom->indices) {
         SCE_SGeometryArray array;
         SCE_Geometry_InitArray (&array);
-        SCE_Geometry_SetArrayIndices (&array, SCE_INDICES_TYPE,
+        SCE_Geometry_SetArrayIndices (&array, ageom->indices_type,
                                       ageom->indices, SCE_FALSE);
         if (SCE_Geometry_SetIndexArrayDup (ageom->geom, &array, SCE_FALSE) < 0)
             goto fail;
@@ -900,6 +915,38 @@ fail:
     return SCE_ERROR;
 }
 
+/**
+ * \brief Interleaves the vertices of the geometry of an animated geometry
+ *
+ * Calls SCE_Geometry_Interleave() on the geometry built by
+ * SCE_AnimGeom_BuildGeometry(), the skeleton is then applied straight into
+ * the interleaved vertices. Must be called after SCE_AnimGeom_BuildGeometry().
+ * \returns SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_AnimGeom_BuildGeometry(), SCE_Geometry_Interleave()
+ */
+int SCE_AnimGeom_Interleave (SCE_SAnimatedGeometry *ageom)
+{
+    size_t i;
+
+    if (SCE_Geometry_Interleave (ageom->geom) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    for (i = 0; i < SCE_MAX_ANIMATED_VERTEX_ATTRIBUTES; i++) {
+        SCEvertices *data = NULL;
+        if (!ageom->arrays[i])
+            continue;
+        /* the arrays don't own the output buffers */
+        data = SCE_Geometry_GetData (ageom->arrays[i]);
+        if (data != ageom->output[i])
+            SCE_free (ageom->output[i]);
+        ageom->output[i] = data;
+        ageom->output_stride = SCE_Geometry_GetTotalStride (ageom->arrays[i])
+            / sizeof (SCEvertices);
+    }
+    return SCE_OK;
+}
+
 /**
  * \brief Loads an animated geometry from a file
  * \param fmesh the file of the mesh
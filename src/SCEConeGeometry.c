@@ -78,8 +78,8 @@ int SCE_ConeGeom_Generate (const SCE_SCone *cone, SCEuint segments,
     index = &index[-6];
     index[2] = index[3] = 1;
 
-    if (SCE_Geometry_SetData (geom, vertices, NULL, NULL, indices,
-                              n_vertices, n_indices) < 0)
+    if (SCE_Geometry_SetData (geom, vertices, NULL, NULL, SCE_INDICES_TYPE,
+                              indices, n_vertices, n_indices) < 0)
         goto fail;
 
     return SCE_OK;
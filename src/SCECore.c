@@ -17,7 +17,7 @@
  -----------------------------------------------------------------------------*/
  
 /* created: 16/04/2010
-   updated: 23/01/2012 */
+   updated: 17/10/2026 */
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>
@@ -63,10 +63,12 @@ int SCE_Init_Core (FILE *outlog, SCEbitfield flags)
     if (init_n == 1) {
         if (SCE_Init_Utils (outlog) < 0 ||
             SCE_Init_Noise () < 0 ||
+            SCE_Init_TPool () < 0 ||
             SCE_Init_Geometry () < 0 ||
             SCE_Init_Image () < 0 ||
             SCE_Init_BoxGeom () < 0 ||
             SCE_Init_OBJ () < 0 ||
+            SCE_Init_GCache () < 0 ||
             SCE_Init_AnimGeom () < 0 ||
             SCE_Init_Anim () < 0 ||
             SCE_Init_idTechMD5 () < 0) {
@@ -100,10 +102,12 @@ void SCE_Quit_Core (void)
             SCE_Quit_idTechMD5 ();
             SCE_Quit_Anim ();
             SCE_Quit_AnimGeom ();
+            SCE_Quit_GCache ();
             SCE_Quit_OBJ ();
             SCE_Quit_BoxGeom ();
             SCE_Quit_Image ();
             SCE_Quit_Geometry ();
+            SCE_Quit_TPool ();
             SCE_Quit_Utils ();
         }
         pthread_mutex_unlock (&init_mutex);
@@ -95,6 +95,7 @@ void SCE_FTree_Init (SCE_SForestTree *ft)
     ft->matrix_data = NULL;
     ft->drad_data = NULL;
     ft->npoly_data = NULL;
+    ft->indices_data_type = SCE_INDICES_TYPE;
     ft->indices_data = NULL;
     SCE_Geometry_InitArray (&ft->ar1);
     SCE_Geometry_InitArray (&ft->ar2);
@@ -111,6 +112,7 @@ void SCE_FTree_Init (SCE_SForestTree *ft)
 
     SCE_Geometry_Init (&ft->final_geom);
     ft->vertices = NULL;
+    ft->indices_type = SCE_INDICES_TYPE;
     ft->indices = NULL;
     SCE_Geometry_InitArray (&ft->pos);
     SCE_Geometry_InitArray (&ft->nor);
@@ -381,6 +383,8 @@ SCE_FTree_ComputeStuff (SCE_SForestTreeNode *node)
 
 static int SCE_FTree_BuildTreeGeom (SCE_SForestTree *ft)
 {
+    size_t size;
+
     /* allocate data */
     if (!(ft->matrix_data = SCE_malloc (15 * ft->root.n_vertices1 *
                                         sizeof *ft->matrix_data)))
@@ -391,8 +395,10 @@ static int SCE_FTree_BuildTreeGeom (SCE_SForestTree *ft)
     if (!(ft->npoly_data = SCE_malloc (ft->root.n_vertices1 *
                                        sizeof *ft->npoly_data)))
         goto fail;
-    if (!(ft->indices_data = SCE_malloc (ft->root.n_indices1 *
-                                         sizeof *ft->indices_data)))
+    ft->indices_data_type =
+        SCE_Geometry_GetIndicesTypeFor (ft->root.n_vertices1);
+    size = SCE_Type_Sizeof (ft->indices_data_type);
+    if (!(ft->indices_data = SCE_malloc (ft->root.n_indices1 * size)))
         goto fail;
 
     /* position */
@@ -413,8 +419,8 @@ static int SCE_FTree_BuildTreeGeom (SCE_SForestTree *ft)
     SCE_Geometry_SetArrayData (&ft->ar6, SCE_TEXCOORD4, SCE_FLOAT, 0, 2,
                                ft->drad_data, SCE_FALSE);
 
-    SCE_Geometry_SetArrayIndices (&ft->ind, SCE_INDICES_TYPE, ft->indices_data,
-                                  SCE_FALSE);
+    SCE_Geometry_SetArrayIndices (&ft->ind, ft->indices_data_type,
+                                  ft->indices_data, SCE_FALSE);
 
     SCE_Geometry_AddArrayRecDup (&ft->tree_geom, &ft->ar1, SCE_FALSE);
     SCE_Geometry_SetIndexArray (&ft->tree_geom, &ft->ind, SCE_FALSE);
@@ -433,7 +439,9 @@ static int SCE_FTree_BuildFinalGeom (SCE_SForestTree *ft)
     if (!(ft->vertices = SCE_malloc (V_SIZE * ft->root.n_vertices2 *
                                      sizeof *ft->vertices)))
         goto fail;
-    if (!(ft->indices = SCE_malloc (ft->root.n_indices2 * sizeof *ft->indices)))
+    ft->indices_type = SCE_Geometry_GetIndicesTypeFor (ft->root.n_vertices2);
+    if (!(ft->indices = SCE_malloc (ft->root.n_indices2 *
+                                    SCE_Type_Sizeof (ft->indices_type))))
         goto fail;
 
     SCE_Geometry_SetArrayData (&ft->pos, SCE_POSITION, SCE_FLOAT, 0, 3,
@@ -443,7 +451,7 @@ static int SCE_FTree_BuildFinalGeom (SCE_SForestTree *ft)
     SCE_Geometry_SetArrayData (&ft->tc, SCE_TEXCOORD0, SCE_FLOAT, 0, 2,
                                &ft->vertices[6], SCE_FALSE);
 
-    SCE_Geometry_SetArrayIndices (&ft->idx, SCE_INDICES_TYPE, ft->indices,
+    SCE_Geometry_SetArrayIndices (&ft->idx, ft->indices_type, ft->indices,
                                   SCE_FALSE);
 
     SCE_Geometry_AddArrayRecDup (&ft->final_geom, &ft->pos, SCE_FALSE);
@@ -462,13 +470,6 @@ int SCE_FTree_Build (SCE_SForestTree *ft)
 
     SCE_FTree_Count (&ft->root);
 
-    if (ft->root.n_vertices1 >= 256 * 256 ||
-        ft->root.n_vertices2 >= 256 * 256) {
-        SCEE_Log (875);
-        SCEE_LogMsg ("the tree is too big, cannot fit SCEindices");
-        return SCE_ERROR;
-    }
-
     SCE_FTree_ComputeStuff (&ft->root);
 
     if (SCE_FTree_BuildTreeGeom (ft) < 0) goto fail;
@@ -533,8 +534,10 @@ SCE_FTree_UpdateNode (SCE_SForestTree *ft, SCE_SForestTreeNode *node)
     /* output vertex and index */
     SCE_FTree_OutputVertex (ft, node);
     if (node->parent) {
-        ft->indices_data[ft->index_counter + 0] = (SCEindices)node->parent->index;
-        ft->indices_data[ft->index_counter + 1] = (SCEindices)node->index;
+        SCE_Geometry_SetIndex (ft->indices_data_type, ft->indices_data,
+                               ft->index_counter + 0, node->parent->index);
+        SCE_Geometry_SetIndex (ft->indices_data_type, ft->indices_data,
+                               ft->index_counter + 1, node->index);
         ft->index_counter += 2;
     }
     if (node->n_children > 0)
@@ -592,14 +595,15 @@ static void SCE_FTree_UpdateFinalAux (SCE_SForestTree *ft, SCE_SForestTreeNode *
 {
     int j;
     SCEvertices *v = ft->vertices;
-    SCEindices *i = ft->indices;
+    void *i = ft->indices;
     if (node->parent) {
         /* generate a segment */
         size_t i1 = ft->vertex_counter;
         size_t i2 = ft->index_counter;
         SCE_Matrix4x3_GetTranslation (node->parent->matrix, &v[i1 * V_SIZE]);
         SCE_Matrix4x3_GetTranslation (node->matrix, &v[(i1 + 1) * V_SIZE]);
-        i[i2] = i1; i[i2 + 1] = i1 + 1;
+        SCE_Geometry_SetIndex (ft->indices_type, i, i2, i1);
+        SCE_Geometry_SetIndex (ft->indices_type, i, i2 + 1, i1 + 1);
         ft->vertex_counter += 2;
         ft->index_counter += 2;
     }
@@ -713,11 +717,15 @@ void SCE_FTree_UpdateFinalGeometry (SCE_SForestTree *ft)
     /* step2: generate indices */
     for (i = 0; i < ft->root.n_indices1; i += 2) {
         /* indices of vertices from each side of the branch */
-        size_t index1 = ft->vindex[ft->indices_data[i + 0]];
-        size_t index2 = ft->vindex[ft->indices_data[i + 1]];
+        SCEuint v1 = SCE_Geometry_GetIndex (ft->indices_data_type,
+                                            ft->indices_data, i + 0);
+        SCEuint v2 = SCE_Geometry_GetIndex (ft->indices_data_type,
+                                            ft->indices_data, i + 1);
+        size_t index1 = ft->vindex[v1];
+        size_t index2 = ft->vindex[v2];
         /* number of vertices on each side */
-        size_t n1 = ft->npoly_data[ft->indices_data[i + 0]];
-        size_t n2 = ft->npoly_data[ft->indices_data[i + 1]];
+        size_t n1 = ft->npoly_data[v1];
+        size_t n2 = ft->npoly_data[v2];
 
         /* generate triangles from each side */
         for (j = 0; j < n1; j++) {
@@ -727,9 +735,12 @@ void SCE_FTree_UpdateFinalGeometry (SCE_SForestTree *ft)
 
             if (index > n2) index = n2;
 
-            ft->indices[previous_index * 3 + 1] = index1 + j;
-            ft->indices[previous_index * 3 + 0] = index2 + index;
-            ft->indices[previous_index * 3 + 2] = index1 + j + 1;
+            SCE_Geometry_SetIndex (ft->indices_type, ft->indices,
+                                   previous_index * 3 + 1, index1 + j);
+            SCE_Geometry_SetIndex (ft->indices_type, ft->indices,
+                                   previous_index * 3 + 0, index2 + index);
+            SCE_Geometry_SetIndex (ft->indices_type, ft->indices,
+                                   previous_index * 3 + 2, index1 + j + 1);
 
             previous_index++;
         }
@@ -742,9 +753,12 @@ void SCE_FTree_UpdateFinalGeometry (SCE_SForestTree *ft)
 
             if (index > n1) index = n1;
 
-            ft->indices[previous_index * 3 + 0] = index2 + j;
-            ft->indices[previous_index * 3 + 1] = index1 + index;
-            ft->indices[previous_index * 3 + 2] = index2 + j + 1;
+            SCE_Geometry_SetIndex (ft->indices_type, ft->indices,
+                                   previous_index * 3 + 0, index2 + j);
+            SCE_Geometry_SetIndex (ft->indices_type, ft->indices,
+                                   previous_index * 3 + 1, index1 + index);
+            SCE_Geometry_SetIndex (ft->indices_type, ft->indices,
+                                   previous_index * 3 + 2, index2 + j + 1);
 
             previous_index++;
         }
@@ -17,7 +17,7 @@
  -----------------------------------------------------------------------------*/
 
 /* created: 25/07/2009
-   updated: 25/03/2013 */
+   updated: 17/10/2026 */
 
 #include <SCE/utils/SCEUtils.h>
 #include "SCE/core/SCEGeometry.h"
@@ -58,6 +58,9 @@ void SCE_Geometry_InitArrayData (SCE_SGeometryArrayData *data)
     data->stride = 0;
     data->size = 3;
     data->data = NULL;
+    data->encoding = SCE_ARRAY_RAW;
+    data->offset[0] = data->offset[1] = data->offset[2] = data->offset[3] = 0.0;
+    data->scale[0] = data->scale[1] = data->scale[2] = data->scale[3] = 1.0;
 }
 SCE_SGeometryArrayData* SCE_Geometry_CreateArrayData (void)
 {
@@ -121,8 +124,17 @@ SCE_Geometry_CreateArrayFrom (SCE_EVertexAttribute attrib, SCE_EType type,
 void SCE_Geometry_DeleteArray (SCE_SGeometryArray *array)
 {
     if (array) {
-        if (array->child)
-            array->child->root = array->root;
+        SCE_SGeometryArray *a = NULL;
+        if (array->root) {
+            /* unlink it from the chain */
+            for (a = array->root; a->child != array; a = a->child);
+            a->child = array->child;
+        } else if (array->child) {
+            /* the first child becomes the root of the others */
+            for (a = array->child->child; a; a = a->child)
+                a->root = array->child;
+            array->child->root = NULL;
+        }
         SCE_List_Remove (&array->it);
         /* having a root means our data pointer is just an offset of the main
            pointer which is in and will be freed by the root array */
@@ -190,24 +202,41 @@ void SCE_Geometry_Init (SCE_SGeometry *geom)
     geom->pos_array = geom->nor_array = geom->tex_array = NULL;
     geom->pos_data = geom->nor_data = geom->tex_data = NULL;
     geom->index_data = NULL;
+    geom->index_type = SCE_INDICES_TYPE;
 
-    geom->sorted = NULL;
+    geom->sorted = geom->sorted_tmp = NULL;
+    geom->sorted_indices = NULL;
     geom->sorted_length = 0;
+    geom->sort_incremental = SCE_TRUE;
 
     SCE_Box_Init (&geom->box);
     SCE_Sphere_Init (&geom->sphere);
     geom->box_uptodate = geom->sphere_uptodate = SCE_FALSE;
+
+    geom->storage = NULL;
+    geom->free_storage = NULL;
 }
 static void SCE_Geometry_DeleteIndexArray (SCE_SGeometry *geom)
 {
-    if (geom->canfree_index)
-        SCE_Geometry_DeleteArray (geom->index_array);
+    if (geom->index_array) {
+        /* SCE_Geometry_Modified() may have put it in our lists */
+        SCE_List_Remove (&geom->index_array->it);
+        geom->index_array->geom = NULL;
+        if (geom->canfree_index)
+            SCE_Geometry_DeleteArray (geom->index_array);
+    }
 }
 void SCE_Geometry_Clear (SCE_SGeometry *geom)
 {
+    SCE_Geometry_DeleteIndexArray (geom);
     SCE_List_Clear (&geom->arrays);
     SCE_List_Clear (&geom->modified);
-    SCE_Geometry_DeleteIndexArray (geom);
+    SCE_free (geom->sorted);
+    SCE_free (geom->sorted_tmp);
+    SCE_free (geom->sorted_indices);
+    /* the arrays may point into the storage */
+    if (geom->free_storage)
+        geom->free_storage (geom->storage);
 }
 
 SCE_SGeometry* SCE_Geometry_Create (void)
@@ -482,6 +511,33 @@ void SCE_Geometry_SetArrayIndices (SCE_SGeometryArray *array, SCE_EType type,
     array->canfree_data = canfree;
 }
 
+/**
+ * \brief Replaces the data of an array by a newly allocated buffer
+ * \param array an array
+ * \param size size of the new buffer, in bytes
+ *
+ * The previous data is freed if \p array owns it, the new one is owned by
+ * \p array. The format of \p array is not modified. Geometries keep
+ * pointers to the data of their arrays, so call this function before adding
+ * \p array to a geometry.
+ * \return the new buffer, NULL on error
+ * \sa SCE_Geometry_SetArrayData()
+ */
+void* SCE_Geometry_AllocArrayData (SCE_SGeometryArray *array, size_t size)
+{
+    void *data = NULL;
+
+    if (!(data = SCE_malloc (size))) {
+        SCEE_LogSrc ();
+        return NULL;
+    }
+    if (array->canfree_data && !array->root)
+        SCE_free (array->data.data);
+    array->data.data = data;
+    array->canfree_data = SCE_TRUE;
+    return data;
+}
+
 /**
  * \brief Gets the vertex data of an array
  * \sa SCE_Geometry_GetArrayData(), SCE_SGeometryArrayData::data
@@ -722,13 +778,38 @@ void SCE_Geometry_SetIndexArray (SCE_SGeometry *geom, SCE_SGeometryArray *array,
     SCE_Geometry_DeleteIndexArray (geom);
     geom->index_array = array;
     if (array) {
+        array->geom = geom;
         geom->index_data = SCE_Geometry_GetData (array);
+        geom->index_type = SCE_Geometry_GetArrayData (array)->type;
         geom->canfree_index = canfree;
     } else {
         geom->index_data = NULL;
         geom->canfree_index = SCE_FALSE;
     }
 }
+/**
+ * \brief Updates the data pointers of a geometry from its arrays
+ *
+ * Call it when the arrays of \p geom were given new data, for instance with
+ * SCE_Geometry_SetArrayData(), so that SCE_Geometry_GetPositions(),
+ * SCE_Geometry_GetIndices() and the like return the new data. The pointers
+ * of encoded arrays stay NULL.
+ * \sa SCE_Geometry_SetArrayData(), SCE_Geometry_ConvertArray()
+ */
+void SCE_Geometry_UpdatePointers (SCE_SGeometry *geom)
+{
+    /* the float pointers are only valid for raw arrays */
+    if (geom->pos_array && geom->pos_array->data.encoding == SCE_ARRAY_RAW)
+        geom->pos_data = SCE_Geometry_GetData (geom->pos_array);
+    if (geom->nor_array && geom->nor_array->data.encoding == SCE_ARRAY_RAW)
+        geom->nor_data = SCE_Geometry_GetData (geom->nor_array);
+    if (geom->tex_array && geom->tex_array->data.encoding == SCE_ARRAY_RAW)
+        geom->tex_data = SCE_Geometry_GetData (geom->tex_array);
+    if (geom->index_array) {
+        geom->index_data = SCE_Geometry_GetData (geom->index_array);
+        geom->index_type = SCE_Geometry_GetArrayData (geom->index_array)->type;
+    }
+}
 /**
  * \brief Duplicates and set an index array
  * \returns the new array, duplicated from \p array
@@ -756,9 +837,10 @@ SCE_SGeometryArray* SCE_Geometry_SetIndexArrayDup (SCE_SGeometry *geom,
  * \brief Duplicates an index array and its data and set it to a geometry
  * \param array the index array to duplicate
  * \param keep keep data type as in \p array, otherwise they are converted to
- * an optimized data type (SCE_INDICES_TYPE)
- * \note This function requires that the number of indices have been yet
- * specified to \p geom (see SCE_Geometry_SetNumIndices()).
+ * the smallest type that can address the vertices of \p geom (see
+ * SCE_Geometry_GetIndicesTypeFor())
+ * \note This function requires that the number of indices and vertices have
+ * been yet specified to \p geom (see SCE_Geometry_SetNumIndices()).
  * \sa SCE_Geomtry_AddArrayDupDup(), SCE_Geometry_SetIndexArrayDup(),
  * SCE_Geometry_SetIndexArray(), SCE_Geometry_SetArraDataDup()
  */
@@ -769,14 +851,13 @@ SCE_SGeometryArray* SCE_Geometry_SetIndexArrayDupDup (SCE_SGeometry *geom,
     SCE_SGeometryArray *new = NULL;
     void *newdata = NULL;
     SCE_SGeometryArrayData *data;
-    SCEenum type = SCE_INDICES_TYPE;
+    SCEenum type = SCE_Geometry_GetIndicesTypeFor (geom->n_vertices);
     data = SCE_Geometry_GetArrayData (array);
     if (keep || type == data->type) {
         type = data->type;
         newdata = SCE_Mem_Dup (data->data, geom->n_indices *
                                SCE_Type_Sizeof (data->type));
     } else {
-        /* TODO: not according to definition of SCEindices, may be greater */
         newdata = SCE_Type_ConvertDup (type, data->type, data->data,
                                        geom->n_indices);
     }
@@ -811,15 +892,17 @@ SCE_SGeometryArray* SCE_Geometry_GetIndexArray (SCE_SGeometry *geom)
  * \brief User-friendly function to quickly defined data of a geometry
  * \param pos,nor,tex vertex data, can be NULL if non-defined, but \p pos
  * must be given. all these pointer will be freed by SCE_Geometry_Delete().
+ * \param index_type type of \p index, SCE_INDICES_TYPE or SCE_INDICES32_TYPE
  * \param index if specified, set as indices of the geometry
  * \returns SCE_ERROR on error, SCE_OK otherwise
  *
  * Considers the size of \p pos, \p nor and \p tex are 3, 3 and 2, respectively.
  * \sa SCE_Geometry_AddArray(), SCE_Geometry_SetIndexArray(),
- * SCE_Geometry_SetArrayData()
+ * SCE_Geometry_SetArrayData(), SCE_Geometry_GetIndicesTypeFor()
  */
 int SCE_Geometry_SetData (SCE_SGeometry *geom, SCEvertices *pos,
-                          SCEvertices *nor, SCEvertices *tex, SCEindices *index,
+                          SCEvertices *nor, SCEvertices *tex,
+                          SCE_EType index_type, void *index,
                           SCEuint n_vertices, SCEuint n_indices)
 {
     int i;
@@ -852,8 +935,7 @@ int SCE_Geometry_SetData (SCE_SGeometry *geom, SCEvertices *pos,
     if (index) {
         i++;
         SCE_Geometry_InitArray (&array);
-        SCE_Geometry_SetArrayIndices (&array, SCE_INDICES_TYPE,
-                                      index, SCE_TRUE);
+        SCE_Geometry_SetArrayIndices (&array, index_type, index, SCE_TRUE);
         if (!(arrays[i] = SCE_Geometry_SetIndexArrayDup (geom, &array,
                                                          SCE_TRUE)))
             goto fail;
@@ -873,11 +955,11 @@ fail:
  */
 int SCE_Geometry_SetDataDup (SCE_SGeometry *geom, SCEvertices *pos,
                              SCEvertices *nor, SCEvertices *tex,
-                             SCEindices *index, SCEuint n_vertices,
-                             SCEuint n_indices)
+                             SCE_EType index_type, void *index,
+                             SCEuint n_vertices, SCEuint n_indices)
 {
     SCEvertices *newpos = NULL, *newnor = NULL, *newtex = NULL;
-    SCEindices *newindex = NULL;
+    void *newindex = NULL;
     size_t size = n_vertices * sizeof (SCEvertices);
     if (!(newpos = SCE_Mem_Dup (pos, size * 3)))
         goto fail;
@@ -890,18 +972,19 @@ int SCE_Geometry_SetDataDup (SCE_SGeometry *geom, SCEvertices *pos,
             goto fail;
     }
     if (index) {
-        if (!(newindex = SCE_Mem_Dup (index, n_indices * sizeof (SCEindices))))
+        if (!(newindex = SCE_Mem_Dup (index, n_indices *
+                                      SCE_Type_Sizeof (index_type))))
             goto fail;
     }
-    if (SCE_Geometry_SetData (geom, newpos, newnor, newtex, newindex,
-                              n_vertices, n_indices) < 0)
+    if (SCE_Geometry_SetData (geom, newpos, newnor, newtex, index_type,
+                              newindex, n_vertices, n_indices) < 0)
         goto fail;
     return SCE_OK;
 fail:
-    SCE_free (index);
-    SCE_free (tex);
-    SCE_free (nor);
-    SCE_free (pos);
+    SCE_free (newindex);
+    SCE_free (newtex);
+    SCE_free (newnor);
+    SCE_free (newpos);
     SCEE_LogSrc ();
     return SCE_ERROR;
 }
@@ -950,11 +1033,62 @@ SCEvertices* SCE_Geometry_GetTexCoords (SCE_SGeometry *geom)
 }
 /**
  * \brief Gets the indices
+ * \sa SCE_Geometry_GetIndicesType(), SCE_Geometry_GetIndex()
  */
-SCEindices* SCE_Geometry_GetIndices (SCE_SGeometry *geom)
+void* SCE_Geometry_GetIndices (SCE_SGeometry *geom)
 {
     return geom->index_data;
 }
+/**
+ * \brief Gets the type of the indices of a geometry, SCE_INDICES_TYPE or
+ * SCE_INDICES32_TYPE usually
+ */
+SCE_EType SCE_Geometry_GetIndicesType (SCE_SGeometry *geom)
+{
+    return geom->index_type;
+}
+
+/**
+ * \brief Gets the most compact type of indices for a number of vertices
+ * \param n_vertices number of vertices to address
+ * \returns SCE_INDICES_TYPE if \p n_vertices is not greater than
+ * SCE_INDICES_MAX_VERTICES, SCE_INDICES32_TYPE otherwise
+ */
+SCE_EType SCE_Geometry_GetIndicesTypeFor (size_t n_vertices)
+{
+    if (n_vertices > SCE_INDICES_MAX_VERTICES)
+        return SCE_INDICES32_TYPE;
+    return SCE_INDICES_TYPE;
+}
+/**
+ * \brief Reads an index
+ * \param type type of \p indices, SCE_UNSIGNED_BYTE, SCE_UNSIGNED_SHORT or
+ * SCE_UNSIGNED_INT
+ * \param indices indices
+ * \param i index of the index to read
+ * \sa SCE_Geometry_SetIndex()
+ */
+SCEuint SCE_Geometry_GetIndex (SCE_EType type, const void *indices, size_t i)
+{
+    switch (type) {
+    case SCE_UNSIGNED_BYTE: return ((const SCEubyte*)indices)[i];
+    case SCE_UNSIGNED_SHORT: return ((const SCEushort*)indices)[i];
+    default: return ((const SCEuint*)indices)[i];
+    }
+}
+/**
+ * \brief Writes an index
+ * \sa SCE_Geometry_GetIndex()
+ */
+void SCE_Geometry_SetIndex (SCE_EType type, void *indices, size_t i,
+                            SCEuint index)
+{
+    switch (type) {
+    case SCE_UNSIGNED_BYTE: ((SCEubyte*)indices)[i] = index; break;
+    case SCE_UNSIGNED_SHORT: ((SCEushort*)indices)[i] = index; break;
+    default: ((SCEuint*)indices)[i] = index;
+    }
+}
 
 /**
  * \brief Sets primitive type of a geometry
@@ -1069,6 +1203,179 @@ size_t SCE_Geometry_GetTotalStride (SCE_SGeometryArray *array)
     return stride;
 }
 
+/* gathers the vertex arrays of a geometry sorted by attribute, so the
+   positions come first in interleaved vertices */
+static SCE_SGeometryArray** SCE_Geometry_GatherArrays (SCE_SGeometry *geom,
+                                                       size_t *n)
+{
+    SCE_SListIterator *it = NULL;
+    SCE_SGeometryArray **arrays = NULL;
+    size_t i, j, count = 0;
+
+    SCE_List_ForEach (it, &geom->arrays)
+        count++;
+    SCE_List_ForEach (it, &geom->modified)
+        count++;
+    if (!(arrays = SCE_malloc ((count + 1) * sizeof *arrays))) {
+        SCEE_LogSrc ();
+        return NULL;
+    }
+    count = 0;
+    SCE_List_ForEach (it, &geom->arrays)
+        arrays[count++] = SCE_List_GetData (it);
+    SCE_List_ForEach (it, &geom->modified)
+        arrays[count++] = SCE_List_GetData (it);
+    for (i = 0, j = 0; i < count; i++) {
+        if (arrays[i] != geom->index_array)
+            arrays[j++] = arrays[i];
+    }
+    count = j;
+    for (i = 1; i < count; i++) {
+        SCE_SGeometryArray *a = arrays[i];
+        for (j = i; j > 0 && arrays[j - 1]->data.attrib > a->data.attrib; j--)
+            arrays[j] = arrays[j - 1];
+        arrays[j] = a;
+    }
+    *n = count;
+    return arrays;
+}
+/* copies the vertices of an array, interleaved or not */
+static void SCE_Geometry_CopyVertices (SCE_SGeometryArray *array, size_t n,
+                                       char *dst, size_t dst_stride)
+{
+    size_t i, size = array->data.stride;
+    size_t src_stride = SCE_Geometry_GetTotalStride (array);
+    const char *src = array->data.data;
+
+    for (i = 0; i < n; i++)
+        memcpy (&dst[i * dst_stride], &src[i * src_stride], size);
+}
+/**
+ * \brief Repacks all the vertex arrays of a geometry into one buffer
+ *
+ * Every vertex array (the index array excluded) becomes a child of the
+ * array with the lowest vertex attribute, usually the positions, and the
+ * vertices are stored one after another with all their attributes. The
+ * modified ranges given to SCE_Geometry_Modified() keep counting vertices:
+ * any array of the buffer can be marked as modified, the range applies to
+ * the whole buffer. The root array owns the new buffer, the old buffers are
+ * freed if the arrays were allowed to. Since the layout changes, this
+ * function must be called before the renderer uses the geometry.
+ * \returns SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_Geometry_Deinterleave(), SCE_Geometry_AttachArray(),
+ * SCE_Geometry_GetTotalStride()
+ */
+int SCE_Geometry_Interleave (SCE_SGeometry *geom)
+{
+    SCE_SGeometryArray **arrays = NULL;
+    size_t i, n, stride = 0, offset = 0;
+    char *buffer = NULL;
+
+    if (!(arrays = SCE_Geometry_GatherArrays (geom, &n)))
+        goto fail;
+    for (i = 0; i < n; i++)
+        stride += arrays[i]->data.stride;
+    if (n == 0 || SCE_Geometry_GetTotalStride (arrays[0]) == stride) {
+        /* already interleaved, or nothing to interleave */
+        SCE_free (arrays);
+        return SCE_OK;
+    }
+    if (!(buffer = SCE_malloc (geom->n_vertices * stride)))
+        goto fail;
+
+    for (i = 0; i < n; i++) {
+        SCE_Geometry_CopyVertices (arrays[i], geom->n_vertices,
+                                   &buffer[offset], stride);
+        offset += arrays[i]->data.stride;
+    }
+    /* arrays with a root don't own their data */
+    for (i = 0; i < n; i++) {
+        if (!arrays[i]->root && arrays[i]->canfree_data)
+            SCE_free (arrays[i]->data.data);
+    }
+
+    offset = 0;
+    for (i = 0; i < n; i++) {
+        SCE_SGeometryArray *a = arrays[i];
+        a->root = a->child = NULL;
+        a->data.data = &buffer[offset];
+        a->canfree_data = SCE_FALSE;
+        offset += a->data.stride;
+        if (i > 0) {
+            SCE_Geometry_AttachArray (arrays[i - 1], a);
+            /* only the root can be in the modified list */
+            SCE_Geometry_Unmodified (a);
+        }
+    }
+    arrays[0]->canfree_data = SCE_TRUE;
+    SCE_Geometry_Modified (arrays[0], NULL);
+    SCE_Geometry_UpdatePointers (geom);
+    SCE_free (arrays);
+    return SCE_OK;
+fail:
+    SCE_free (arrays);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+/**
+ * \brief Gives each vertex array of a geometry its own buffer
+ *
+ * This is the inverse of SCE_Geometry_Interleave(), every interleaved array
+ * gets a buffer of its own and is marked as modified.
+ * \returns SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_Geometry_Interleave()
+ */
+int SCE_Geometry_Deinterleave (SCE_SGeometry *geom)
+{
+    SCE_SGeometryArray **arrays = NULL;
+    char **buffers = NULL;
+    size_t i, n;
+
+    if (!(arrays = SCE_Geometry_GatherArrays (geom, &n)))
+        goto fail;
+    if (!(buffers = SCE_malloc ((n + 1) * sizeof *buffers)))
+        goto fail;
+    for (i = 0; i < n; i++)
+        buffers[i] = NULL;
+    for (i = 0; i < n; i++) {
+        SCE_SGeometryArray *a = arrays[i];
+        if (!a->root && !a->child)
+            continue;
+        if (!(buffers[i] = SCE_malloc (geom->n_vertices * a->data.stride)))
+            goto fail;
+        SCE_Geometry_CopyVertices (a, geom->n_vertices, buffers[i],
+                                   a->data.stride);
+    }
+    /* every copy is done, the interleaved buffers can be released */
+    for (i = 0; i < n; i++) {
+        SCE_SGeometryArray *a = arrays[i];
+        if (buffers[i] && !a->root && a->canfree_data)
+            SCE_free (a->data.data);
+    }
+    for (i = 0; i < n; i++) {
+        SCE_SGeometryArray *a = arrays[i];
+        if (!buffers[i])
+            continue;
+        a->root = a->child = NULL;
+        a->data.data = buffers[i];
+        a->canfree_data = SCE_TRUE;
+        SCE_Geometry_Modified (a, NULL);
+    }
+    SCE_Geometry_UpdatePointers (geom);
+    SCE_free (buffers);
+    SCE_free (arrays);
+    return SCE_OK;
+fail:
+    if (buffers) {
+        for (i = 0; i < n; i++)
+            SCE_free (buffers[i]);
+    }
+    SCE_free (buffers);
+    SCE_free (arrays);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
 /**
  * \brief Gets the arrays of a geometry (not including those who are modified)
  *
@@ -1243,30 +1550,84 @@ void SCE_Geometry_SphereUpToDate (SCE_SGeometry *geom)
     geom->sphere_uptodate = SCE_TRUE;
 }
 
+/**
+ * \brief Gives a geometry the memory block its arrays point into
+ * \param storage the memory block, can be NULL
+ * \param fun function called on \p storage when \p geom is cleared, can be
+ * NULL
+ *
+ * This is meant for geometries whose arrays don't own their data, like the
+ * ones loaded from a memory mapped file. The previous storage of \p geom
+ * is not freed.
+ */
+void SCE_Geometry_SetStorage (SCE_SGeometry *geom, void *storage,
+                              SCE_FFreeGeometryStorage fun)
+{
+    geom->storage = storage;
+    geom->free_storage = fun;
+}
+
 
 /* bonus functions */
+
+/* gets the positions of a geometry as floats, encoded positions are decoded
+   into *decoded which the caller must free */
+static const char*
+SCE_Geometry_GetFloatPositions (SCE_SGeometry *geom, size_t *stride,
+                                SCEvertices **decoded)
+{
+    size_t n = geom->n_vertices;
+    int size;
+
+    *decoded = NULL;
+    if (geom->pos_data) {
+        *stride = SCE_Geometry_GetTotalStride (geom->pos_array);
+        return (const char*)geom->pos_data;
+    }
+    if (!geom->pos_array ||
+        (size = SCE_Geometry_GetDecodedSize (geom->pos_array)) < 3) {
+        SCEE_Log (SCE_INVALID_OPERATION);
+        SCEE_LogMsg ("the geometry has no 3D positions");
+        return NULL;
+    }
+    if (!(*decoded = SCE_malloc (MAX (n, 1) * size * sizeof **decoded))) {
+        SCEE_LogSrc ();
+        return NULL;
+    }
+    SCE_Geometry_DecodeArray (geom->pos_array, 0, n, *decoded);
+    *stride = size * sizeof **decoded;
+    return (const char*)*decoded;
+}
+
 void SCE_Geometry_ForEachTriangle (SCE_SGeometry *geom, SCE_FGeometryForEach f,
                                    void *data)
 {
     size_t i, j;
     size_t n_prim, stride;
-    char *v = NULL;
+    const char *v = NULL;
+    SCEvertices *decoded = NULL;
     SCE_TVector3 a, b, c;
 
     if (SCE_Geometry_GetPrimitiveType (geom) != SCE_TRIANGLES)
         return;                 /* o lol */
 
     n_prim = SCE_Geometry_GetNumPrimitives (geom);
-    v = (char*)geom->pos_data;
-    stride = SCE_Geometry_GetTotalStride (geom->pos_array);
+    if (!(v = SCE_Geometry_GetFloatPositions (geom, &stride, &decoded))) {
+        SCEE_LogSrc ();
+        return;
+    }
 
     if (geom->index_data) {
-        SCEindices *ind = geom->index_data;
+        SCE_EType type = geom->index_type;
+        void *ind = geom->index_data;
         for (i = 0, j = 0; i < n_prim; i++, j += 3) {
-            SCE_Vector3_Copy (a, &v[ind[j + 0] * stride]);
-            SCE_Vector3_Copy (b, &v[ind[j + 1] * stride]);
-            SCE_Vector3_Copy (c, &v[ind[j + 2] * stride]);
-            if (f (a, b, c, ind[j], data))
+            SCEuint i0 = SCE_Geometry_GetIndex (type, ind, j);
+            SCE_Vector3_Copy (a, &v[i0 * stride]);
+            SCE_Vector3_Copy (b, &v[SCE_Geometry_GetIndex (type, ind, j + 1) *
+                                    stride]);
+            SCE_Vector3_Copy (c, &v[SCE_Geometry_GetIndex (type, ind, j + 2) *
+                                    stride]);
+            if (f (a, b, c, i0, data))
                 break;
         }
     } else {
@@ -1278,6 +1639,7 @@ void SCE_Geometry_ForEachTriangle (SCE_SGeometry *geom, SCE_FGeometryForEach f,
                 break;
         }
     }
+    SCE_free (decoded);
 }
 
 
@@ -1287,8 +1649,16 @@ static int SCE_Geometry_UpdatePrimArray (SCE_SGeometry *geom, size_t vpp,
     if (geom->sorted_length != n_prim) {
         /* update the sorted array */
         SCE_free (geom->sorted);
-        geom->sorted = SCE_malloc (n_prim * sizeof *geom->sorted);
-        if (!geom->sorted) {
+        SCE_free (geom->sorted_tmp);
+        SCE_free (geom->sorted_indices);
+        geom->sorted_tmp = NULL;
+        geom->sorted_indices = NULL;
+        geom->sorted_length = 0;
+        if (!(geom->sorted = SCE_malloc (n_prim * sizeof *geom->sorted)) ||
+            !(geom->sorted_tmp = SCE_malloc (n_prim *
+                                             sizeof *geom->sorted_tmp)) ||
+            !(geom->sorted_indices = SCE_malloc (n_prim * vpp *
+                                                 sizeof (SCEindices32)))) {
             SCEE_LogSrc ();
             return SCE_ERROR;
         }
@@ -1296,79 +1666,143 @@ static int SCE_Geometry_UpdatePrimArray (SCE_SGeometry *geom, size_t vpp,
     }
     return SCE_OK;
 }
-static void SCE_Geometry_GetPrimCenter (SCE_TVector3 v[4], size_t vpp,
-                                        SCE_TVector3 c)
+/* distances are squared, the order is the same */
+static int SCE_Geometry_ComputePrimDistances (SCE_SGeometry *geom,
+                                              size_t vpp, SCE_TVector3 from)
 {
-    size_t i;
-    float invvpp = 1.0f / vpp;
-    SCE_Vector3_Copy (c, v[0]);
-    for (i = 1; i < vpp; i++)
-        SCE_Vector3_Operator1v (c, +=, v[i]);
-    SCE_Vector3_Operator1 (c, *=, invvpp);
-}
-static void SCE_Geometry_ComputePrimDistances (SCE_SGeometry *geom,
-                                               size_t vpp, SCE_TVector3 from)
-{
-    size_t i;
+    size_t i, j, stride;
     SCE_TVector3 center;
-    SCEvertices vprim[4][3];
-    SCEindices *indices;
-    SCEvertices *positions = geom->pos_data;
-    indices = geom->index_data;
+    const char *positions = NULL;
+    SCEvertices *decoded = NULL;
+    const void *indices = geom->index_data;
+    float invvpp = 1.0f / vpp;
+
+    positions = SCE_Geometry_GetFloatPositions (geom, &stride, &decoded);
+    if (!positions) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
     for (i = 0; i < geom->sorted_length; i++) {
-        size_t j;
-        for (j = 0; j < vpp; j++)
-            SCE_Vector3_Copy (&vprim[j], &positions[indices[(i * vpp) + j]]);
-        SCE_Geometry_GetPrimCenter (vprim, vpp, center);
-        geom->sorted[i].dist = SCE_Vector3_Distance (center, from);
-        geom->sorted[i].index = i * vpp;
+        SCE_Vector3_Set (center, 0.0, 0.0, 0.0);
+        for (j = 0; j < vpp; j++) {
+            SCEuint index = SCE_Geometry_GetIndex (geom->index_type, indices,
+                                                   i * vpp + j);
+            const SCEvertices *v = (const SCEvertices*)&positions[index *
+                                                                  stride];
+            SCE_Vector3_Operator1v (center, +=, v);
+        }
+        SCE_Vector3_Operator1 (center, *=, invvpp);
+        SCE_Vector3_Operator1v (center, -=, from);
+        geom->sorted[i].dist = SCE_Vector3_Dot (center, center);
+        geom->sorted[i].index = i;
     }
+    SCE_free (decoded);
+    return SCE_OK;
 }
-static int SCE_Geometry_FarToNear (float first, float last)
-{
-    return (first < last);
-}
-static int SCE_Geometry_NearToFar (float first, float last)
-{
-    return (first > last);
+/* distances are positive, so their bits sort like unsigned integers */
+static SCEuint SCE_Geometry_SortKey (float dist, SCE_ESortOrder order)
+{
+    SCEuint key;
+    memcpy (&key, &dist, sizeof key);
+    return order == SCE_SORT_FAR_TO_NEAR ? ~key : key;
+}
+/* LSD radix sort of 8 bits digits, passes where every key has the same
+   digit are skipped */
+static void SCE_Geometry_RadixSortPrimArray (SCE_SGeometry *geom,
+                                             SCE_ESortOrder order)
+{
+    size_t i, pass, n = geom->sorted_length;
+    size_t counts[4][256];
+    SCE_SGeometryPrimitiveSort *src = geom->sorted, *dst = geom->sorted_tmp;
+
+    memset (counts, 0, sizeof counts);
+    for (i = 0; i < n; i++) {
+        SCEuint key = SCE_Geometry_SortKey (src[i].dist, order);
+        counts[0][key & 0xff]++;
+        counts[1][(key >> 8) & 0xff]++;
+        counts[2][(key >> 16) & 0xff]++;
+        counts[3][key >> 24]++;
+    }
+
+    for (pass = 0; pass < 4; pass++) {
+        size_t *c = counts[pass], sum = 0, shift = pass * 8;
+        SCE_SGeometryPrimitiveSort *tmp = NULL;
+
+        if (c[(SCE_Geometry_SortKey (src[0].dist, order) >> shift) & 0xff]
+            == n)
+            continue;
+        for (i = 0; i < 256; i++) {
+            size_t count = c[i];
+            c[i] = sum;
+            sum += count;
+        }
+        for (i = 0; i < n; i++) {
+            SCEuint key = SCE_Geometry_SortKey (src[i].dist, order);
+            dst[c[(key >> shift) & 0xff]++] = src[i];
+        }
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    /* the sorted data must end up in geom->sorted */
+    if (src != geom->sorted) {
+        geom->sorted_tmp = geom->sorted;
+        geom->sorted = src;
+    }
 }
-static void SCE_Geometry_SortPrimArray (SCE_SGeometry *geom,
-                                        SCE_ESortOrder order)
-{
-    size_t i;
-    int (*xch)(float, float);
-    xch = (order == SCE_SORT_FAR_TO_NEAR ?
-           SCE_Geometry_FarToNear : SCE_Geometry_NearToFar);
-    for (i = 0; i < geom->sorted_length; i++) {
-        size_t j;
-        for (j = 0; j < i; j++) {
-            if (xch (geom->sorted[j].dist, geom->sorted[i].dist)) {
-                SCE_SGeometryPrimitiveSort s = geom->sorted[i];
-                geom->sorted[i] = geom->sorted[j];
-                geom->sorted[j] = s;
+/* insertion sort, gives up after max_moves moves, returns the number of
+   moves or max_moves + 1 if it gave up */
+static size_t SCE_Geometry_InsertionSortPrimArray (SCE_SGeometry *geom,
+                                                   SCE_ESortOrder order,
+                                                   size_t max_moves)
+{
+    size_t i, j, moves = 0;
+    SCE_SGeometryPrimitiveSort *s = geom->sorted;
+
+    for (i = 1; i < geom->sorted_length; i++) {
+        SCE_SGeometryPrimitiveSort p = s[i];
+        SCEuint key = SCE_Geometry_SortKey (p.dist, order);
+        for (j = i; j > 0 && SCE_Geometry_SortKey (s[j - 1].dist, order) > key;
+             j--) {
+            s[j] = s[j - 1];
+            if (++moves > max_moves) {
+                s[j - 1] = p;
+                return moves;
             }
         }
+        s[j] = p;
     }
+    return moves;
 }
-static void SCE_Geometry_ExchangeIndices (SCEindices *i1, SCEindices *i2,
-                                          size_t vpp)
+/**
+ * \brief Enables or disables incremental sorting (enabled by default)
+ *
+ * SCE_Geometry_SortPrimitives() writes the primitives in sorted order, the
+ * next sort starts from this order. When the point of view moves smoothly
+ * the primitives are nearly sorted already, an incremental sort then
+ * runs an insertion sort over them, which falls back to a radix sort if
+ * the primitives move too much.
+ */
+void SCE_Geometry_SetIncrementalSort (SCE_SGeometry *geom, int incremental)
 {
-    SCEindices tmp[4];
-    memcpy (tmp, i1, vpp * sizeof *tmp);
-    memcpy (i1, i2, vpp * sizeof *i1);
-    memcpy (i2, tmp, vpp * sizeof *i2);
+    geom->sort_incremental = incremental;
 }
 /**
  * \brief Sort the primitives of a geometry
  * \param order order of sorting
  * \param from from which sort the distance of the primitives
+ *
+ * Primitives are sorted by the distance of their center with a radix sort,
+ * or incrementally (see SCE_Geometry_SetIncrementalSort()). The indices
+ * are then permuted through a copy.
  * \returns SCE_ERROR on error, SCE_OK otherwise
  */
 int SCE_Geometry_SortPrimitives (SCE_SGeometry *geom, SCE_ESortOrder order,
                                  SCE_TVector3 from)
 {
-    size_t i, vpp, n_prim;
-    SCEindices *indices = NULL;
+    size_t i, vpp, n_prim, size, moves = 0;
+    SCEubyte *indices = NULL, *copy = NULL;
 
 #ifdef SCE_DEBUG
     /* TODO: use auto-generation of pseudo-indices (0, 1, 2, 3, ...) */
@@ -1381,17 +1815,30 @@ int SCE_Geometry_SortPrimitives (SCE_SGeometry *geom, SCE_ESortOrder order,
     indices = geom->index_data;
     vpp = SCE_Geometry_GetNumVerticesPerPrimitive (geom);
     n_prim = SCE_Geometry_GetNumPrimitives (geom);
+    if (!n_prim)
+        return SCE_OK;
 
     if (SCE_Geometry_UpdatePrimArray (geom, vpp, n_prim) < 0)
         goto fail;
-    SCE_Geometry_ComputePrimDistances (geom, vpp, from);
-    SCE_Geometry_SortPrimArray (geom, order);
-
-    /* reset indices */
-    for (i = 0; i < geom->sorted_length; i++) {
-        SCE_Geometry_ExchangeIndices (&indices[i * vpp],
-                                      &indices[geom->sorted[i].index], vpp);
+    if (SCE_Geometry_ComputePrimDistances (geom, vpp, from) < 0)
+        goto fail;
+    if (geom->sort_incremental) {
+        /* bounds the time lost when the order changed a lot to about one
+           radix sort pass */
+        moves = SCE_Geometry_InsertionSortPrimArray (geom, order, n_prim);
+        if (!moves)
+            return SCE_OK;      /* already sorted, nothing to upload */
     }
+    if (!geom->sort_incremental || moves > n_prim)
+        SCE_Geometry_RadixSortPrimArray (geom, order);
+
+    /* permute the indices */
+    size = vpp * SCE_Type_Sizeof (geom->index_type);
+    copy = geom->sorted_indices;
+    memcpy (copy, indices, n_prim * size);
+    for (i = 0; i < n_prim; i++)
+        memcpy (&indices[i * size], &copy[geom->sorted[i].index * size], size);
+
     /* TODO: how to set a good range? */
     SCE_Geometry_Modified (geom->index_array, NULL);
     return SCE_OK;
@@ -1401,6 +1848,734 @@ fail:
 }
 
 
+/* vertex cache optimization, see "Fast Triangle Reordering for Vertex
+   Locality and Reduced Overdraw", Sander et al. 2007 (Tipsify). The post
+   transform cache is modeled as a FIFO of cache_size vertices: a vertex is
+   in the cache if less than cache_size misses happened since it was last
+   loaded */
+
+/**
+ * \brief Computes the average cache miss ratio of a triangle list
+ * \param itype type of the indices
+ * \param indices the indices of the triangles
+ * \param n_vertices number of vertices addressed by \p indices
+ * \param n_indices number of indices
+ * \param cache_size size of the simulated FIFO cache
+ * \returns the number of cache misses per triangle (between 0.5 and 3 for
+ * closed meshes, the lower the better), or a negative value on error
+ * \sa SCE_Geometry_OptimizeIndices()
+ */
+float SCE_Geometry_ComputeACMR (SCE_EType itype, const void *indices,
+                                size_t n_vertices, size_t n_indices,
+                                size_t cache_size)
+{
+    size_t i, misses = 0, time = cache_size + 1;
+    size_t *stamps = NULL;
+
+    if (n_indices < 3)
+        return 0.0f;
+    if (!(stamps = SCE_malloc (n_vertices * sizeof *stamps))) {
+        SCEE_LogSrc ();
+        return -1.0f;
+    }
+    memset (stamps, 0, n_vertices * sizeof *stamps);
+    for (i = 0; i < n_indices; i++) {
+        SCEuint v = SCE_Geometry_GetIndex (itype, indices, i);
+        if (time - stamps[v] > cache_size) {
+            stamps[v] = time++;
+            misses++;
+        }
+    }
+    SCE_free (stamps);
+    return (float)misses / (n_indices / 3);
+}
+
+typedef struct sce_sgeometrytipsify SCE_SGeometryTipsify;
+struct sce_sgeometrytipsify {
+    size_t *offsets;            /* triangles of vertex v: offsets[v] to
+                                   offsets[v + 1] in triangles */
+    SCEuint *triangles;
+    SCEuint *live;              /* number of triangles not emitted yet */
+    size_t *stamps;             /* last time each vertex entered the cache */
+    SCEuint *deadend;           /* stack of recently used vertices */
+    size_t n_deadend;
+    SCEubyte *emitted;
+    size_t n_vertices;
+    size_t time;
+    size_t cursor;              /* next vertex to try after a dead end */
+};
+
+static void SCE_Geometry_ClearTipsify (SCE_SGeometryTipsify *t)
+{
+    SCE_free (t->offsets);
+    SCE_free (t->triangles);
+    SCE_free (t->live);
+    SCE_free (t->stamps);
+    SCE_free (t->deadend);
+    SCE_free (t->emitted);
+}
+static int SCE_Geometry_InitTipsify (SCE_SGeometryTipsify *t, SCE_EType itype,
+                                     const void *indices, size_t n_vertices,
+                                     size_t n_indices, size_t cache_size)
+{
+    size_t i, n_triangles = n_indices / 3;
+
+    memset (t, 0, sizeof *t);
+    if (!(t->offsets = SCE_malloc ((n_vertices + 1) * sizeof *t->offsets)) ||
+        !(t->triangles = SCE_malloc (n_indices * sizeof *t->triangles)) ||
+        !(t->live = SCE_malloc (n_vertices * sizeof *t->live)) ||
+        !(t->stamps = SCE_malloc (n_vertices * sizeof *t->stamps)) ||
+        !(t->deadend = SCE_malloc (n_indices * sizeof *t->deadend)) ||
+        !(t->emitted = SCE_malloc (n_triangles))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    memset (t->live, 0, n_vertices * sizeof *t->live);
+    memset (t->stamps, 0, n_vertices * sizeof *t->stamps);
+    memset (t->emitted, 0, n_triangles);
+    for (i = 0; i < n_indices; i++)
+        t->live[SCE_Geometry_GetIndex (itype, indices, i)]++;
+    t->offsets[0] = 0;
+    for (i = 0; i < n_vertices; i++)
+        t->offsets[i + 1] = t->offsets[i] + t->live[i];
+    /* offsets[v] is used as a cursor then shifted back */
+    for (i = 0; i < n_indices; i++) {
+        SCEuint v = SCE_Geometry_GetIndex (itype, indices, i);
+        t->triangles[t->offsets[v]++] = i / 3;
+    }
+    for (i = n_vertices; i > 0; i--)
+        t->offsets[i] = t->offsets[i - 1];
+    t->offsets[0] = 0;
+
+    t->n_vertices = n_vertices;
+    t->time = cache_size + 1;
+    return SCE_OK;
+}
+/* returns n_vertices when every triangle has been emitted */
+static size_t SCE_Geometry_SkipDeadEnd (SCE_SGeometryTipsify *t)
+{
+    while (t->n_deadend > 0) {
+        SCEuint v = t->deadend[--t->n_deadend];
+        if (t->live[v] > 0)
+            return v;
+    }
+    while (t->cursor < t->n_vertices) {
+        if (t->live[t->cursor] > 0)
+            return t->cursor;
+        t->cursor++;
+    }
+    return t->n_vertices;
+}
+/* picks the vertex among the candidates that will still be in the cache after
+   its remaining triangles are emitted, the oldest one first */
+static size_t SCE_Geometry_NextFan (SCE_SGeometryTipsify *t, size_t first,
+                                    size_t cache_size)
+{
+    size_t i, best = t->n_vertices;
+    long priority = -1;
+
+    for (i = first; i < t->n_deadend; i++) {
+        SCEuint v = t->deadend[i];
+        if (t->live[v] > 0) {
+            long p = 0;
+            size_t age = t->time - t->stamps[v];
+            if (age + 2 * t->live[v] <= cache_size)
+                p = (long)age;
+            if (p > priority) {
+                priority = p;
+                best = v;
+            }
+        }
+    }
+    if (best == t->n_vertices)
+        best = SCE_Geometry_SkipDeadEnd (t);
+    return best;
+}
+/**
+ * \brief Reorders triangles for the post transform vertex cache
+ * \param itype type of the indices
+ * \param indices the indices of the triangles, reordered
+ * \param n_vertices number of vertices addressed by \p indices
+ * \param n_indices number of indices
+ * \param cache_size size of the targeted vertex cache, 16 to 32 suit most
+ * hardware
+ *
+ * Runs the Tipsify algorithm, in linear time: triangles are emitted in fans
+ * around a vertex, the next vertex being chosen among the vertices of the last
+ * fan. The winding of the triangles is kept. The triangles are reordered in
+ * place, the vertices are left untouched, see SCE_Geometry_ReorderVertices().
+ * \returns SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_Geometry_ComputeACMR(), SCE_Geometry_OptimizeVertexCache()
+ */
+int SCE_Geometry_OptimizeIndices (SCE_EType itype, void *indices,
+                                  size_t n_vertices, size_t n_indices,
+                                  size_t cache_size)
+{
+    SCE_SGeometryTipsify t;
+    SCEuint *out = NULL;
+    size_t i, j, n_out = 0, f;
+
+    n_indices -= n_indices % 3;
+    if (n_indices == 0)
+        return SCE_OK;
+    if (SCE_Geometry_InitTipsify (&t, itype, indices, n_vertices, n_indices,
+                                  cache_size) < 0)
+        goto fail;
+    if (!(out = SCE_malloc (n_indices * sizeof *out)))
+        goto fail;
+
+    f = SCE_Geometry_SkipDeadEnd (&t);
+    while (f < n_vertices) {
+        size_t first = t.n_deadend;
+        for (i = t.offsets[f]; i < t.offsets[f + 1]; i++) {
+            SCEuint tri = t.triangles[i];
+            if (t.emitted[tri])
+                continue;
+            t.emitted[tri] = SCE_TRUE;
+            for (j = 0; j < 3; j++) {
+                SCEuint v = SCE_Geometry_GetIndex (itype, indices, tri * 3 + j);
+                out[n_out++] = v;
+                t.deadend[t.n_deadend++] = v;
+                t.live[v]--;
+                if (t.time - t.stamps[v] > cache_size)
+                    t.stamps[v] = t.time++;
+            }
+        }
+        f = SCE_Geometry_NextFan (&t, first, cache_size);
+    }
+
+    for (i = 0; i < n_out; i++)
+        SCE_Geometry_SetIndex (itype, indices, i, out[i]);
+    SCE_free (out);
+    SCE_Geometry_ClearTipsify (&t);
+    return SCE_OK;
+fail:
+    SCE_free (out);
+    SCE_Geometry_ClearTipsify (&t);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+/**
+ * \brief Renumbers vertices in the order of their first use
+ * \param itype type of the indices
+ * \param indices the indices, rewritten with the new numbers
+ * \param n_vertices number of vertices addressed by \p indices
+ * \param n_indices number of indices
+ * \param remap filled with the new number of each vertex, must hold
+ * \p n_vertices elements
+ *
+ * Vertices not referenced by \p indices are numbered last. The vertex data
+ * must then be permuted by SCE_Geometry_RemapVertices().
+ * \sa SCE_Geometry_RemapVertices(), SCE_Geometry_OptimizeIndices()
+ */
+void SCE_Geometry_ReorderVertices (SCE_EType itype, void *indices,
+                                   size_t n_vertices, size_t n_indices,
+                                   SCEuint *remap)
+{
+    size_t i;
+    SCEuint next = 0;
+
+    for (i = 0; i < n_vertices; i++)
+        remap[i] = n_vertices;
+    for (i = 0; i < n_indices; i++) {
+        SCEuint v = SCE_Geometry_GetIndex (itype, indices, i);
+        if (remap[v] == n_vertices)
+            remap[v] = next++;
+        SCE_Geometry_SetIndex (itype, indices, i, remap[v]);
+    }
+    for (i = 0; i < n_vertices; i++) {
+        if (remap[i] == n_vertices)
+            remap[i] = next++;
+    }
+}
+/**
+ * \brief Moves each vertex \c v of an array to \c remap[v]
+ * \param data the vertices
+ * \param stride size of a vertex in bytes
+ * \param n_vertices number of vertices
+ * \param remap new position of each vertex
+ * \returns SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_Geometry_ReorderVertices()
+ */
+int SCE_Geometry_RemapVertices (void *data, size_t stride, size_t n_vertices,
+                                const SCEuint *remap)
+{
+    size_t i;
+    SCEubyte *v = data, *copy = NULL;
+
+    if (!(copy = SCE_malloc (n_vertices * stride))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    for (i = 0; i < n_vertices; i++)
+        memcpy (&copy[remap[i] * stride], &v[i * stride], stride);
+    memcpy (v, copy, n_vertices * stride);
+    SCE_free (copy);
+    return SCE_OK;
+}
+static int SCE_Geometry_RemapArrays (SCE_SGeometry *geom, SCE_SList *arrays,
+                                     const SCEuint *remap)
+{
+    SCE_SListIterator *it = NULL;
+
+    /* children are interleaved in the data of their root */
+    SCE_List_ForEach (it, arrays) {
+        SCE_SGeometryArray *array = SCE_List_GetData (it);
+        if (array == geom->index_array || array->root || !array->data.data)
+            continue;
+        if (SCE_Geometry_RemapVertices (array->data.data,
+                                        SCE_Geometry_GetTotalStride (array),
+                                        geom->n_vertices, remap) < 0) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+    }
+    return SCE_OK;
+}
+/**
+ * \brief Optimizes a geometry for the post transform vertex cache
+ * \param cache_size size of the targeted vertex cache
+ * \param acmr if not NULL, receives the average cache miss ratio before and
+ * after the optimization
+ *
+ * Reorders the triangles with SCE_Geometry_OptimizeIndices() then the
+ * vertices in the order of their first use, every array of \p geom is
+ * permuted accordingly and marked as modified. Only indexed triangle lists
+ * are handled, this function is meant to be called once after loading or
+ * generating a mesh.
+ * \returns SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_Geometry_ComputeACMR()
+ */
+int SCE_Geometry_OptimizeVertexCache (SCE_SGeometry *geom, size_t cache_size,
+                                      float *acmr)
+{
+    SCE_SListIterator *it = NULL, *pro = NULL;
+    SCEuint *remap = NULL;
+    size_t n_vertices = geom->n_vertices, n_indices = geom->n_indices;
+
+    if (!geom->index_array || geom->prim != SCE_TRIANGLES) {
+        SCEE_Log (SCE_INVALID_OPERATION);
+        SCEE_LogMsg ("only indexed triangles can be optimized");
+        return SCE_ERROR;
+    }
+
+    if (acmr)
+        acmr[0] = SCE_Geometry_ComputeACMR (geom->index_type, geom->index_data,
+                                            n_vertices, n_indices, cache_size);
+    if (SCE_Geometry_OptimizeIndices (geom->index_type, geom->index_data,
+                                      n_vertices, n_indices, cache_size) < 0)
+        goto fail;
+    if (!(remap = SCE_malloc (n_vertices * sizeof *remap)))
+        goto fail;
+    SCE_Geometry_ReorderVertices (geom->index_type, geom->index_data,
+                                  n_vertices, n_indices, remap);
+    if (SCE_Geometry_RemapArrays (geom, &geom->arrays, remap) < 0 ||
+        SCE_Geometry_RemapArrays (geom, &geom->modified, remap) < 0)
+        goto fail;
+    SCE_free (remap);
+    if (acmr)
+        acmr[1] = SCE_Geometry_ComputeACMR (geom->index_type, geom->index_data,
+                                            n_vertices, n_indices, cache_size);
+
+    /* the modified arrays already are in geom->modified */
+    SCE_List_ForEach (it, &geom->modified)
+        ((SCE_SGeometryArray*)SCE_List_GetData (it))->rangeptr = NULL;
+    SCE_List_ForEachProtected (pro, it, &geom->arrays) {
+        SCE_SGeometryArray *array = SCE_List_GetData (it);
+        if (!array->root)
+            SCE_Geometry_Modified (array, NULL);
+    }
+    SCE_Geometry_Modified (geom->index_array, NULL);
+    return SCE_OK;
+fail:
+    SCE_free (remap);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/* vertex data conversions. Normalized integers follow the OpenGL rules:
+   unsigned ones map to [0, 1], signed ones to [-1, 1] */
+
+static float SCE_Geometry_NormalizedMax (SCE_EType type)
+{
+    switch (type) {
+    case SCE_BYTE: return 127.0f;
+    case SCE_UNSIGNED_BYTE: return 255.0f;
+    case SCE_SHORT: return 32767.0f;
+    case SCE_UNSIGNED_SHORT: return 65535.0f;
+    default: return 0.0f;
+    }
+}
+static int SCE_Geometry_IsSignedType (SCE_EType type)
+{
+    return type == SCE_BYTE || type == SCE_SHORT;
+}
+static void SCE_Geometry_PutNormalized (SCE_EType type, void *data, size_t i,
+                                        float x)
+{
+    float min = SCE_Geometry_IsSignedType (type) ? -1.0f : 0.0f;
+    long q;
+
+    x = MAX (min, MIN (x, 1.0f)) * SCE_Geometry_NormalizedMax (type);
+    q = (long)floor (x + 0.5f);
+    switch (type) {
+    case SCE_BYTE: ((SCEbyte*)data)[i] = q; break;
+    case SCE_UNSIGNED_BYTE: ((SCEubyte*)data)[i] = q; break;
+    case SCE_SHORT: ((SCEshort*)data)[i] = q; break;
+    case SCE_UNSIGNED_SHORT: ((SCEushort*)data)[i] = q; break;
+    default:;
+    }
+}
+static float SCE_Geometry_GetNormalized (SCE_EType type, const void *data,
+                                         size_t i)
+{
+    switch (type) {
+    case SCE_BYTE: return MAX (((const SCEbyte*)data)[i] / 127.0f, -1.0f);
+    case SCE_UNSIGNED_BYTE: return ((const SCEubyte*)data)[i] / 255.0f;
+    case SCE_SHORT: return MAX (((const SCEshort*)data)[i] / 32767.0f, -1.0f);
+    case SCE_UNSIGNED_SHORT: return ((const SCEushort*)data)[i] / 65535.0f;
+    default: return 0.0f;
+    }
+}
+
+/**
+ * \brief Converts a float to an IEEE 754 half float, rounding to the nearest
+ * \sa SCE_Geometry_HalfToFloat()
+ */
+SCEushort SCE_Geometry_FloatToHalf (float f)
+{
+    SCEuint x, sign, mant, h, rem, half;
+    int exp, shift;
+
+    memcpy (&x, &f, sizeof x);
+    sign = (x >> 16) & 0x8000;
+    mant = x & 0x7fffff;
+    if (((x >> 23) & 0xff) == 0xff)
+        return sign | 0x7c00 | (mant ? 0x200 : 0); /* infinity or NaN */
+    exp = (int)((x >> 23) & 0xff) - 127 + 15;
+    if (exp >= 31)
+        return sign | 0x7c00;
+    if (exp <= 0) {
+        /* denormalized half */
+        if (exp < -10)
+            return sign;
+        mant |= 0x800000;
+        shift = 14 - exp;
+        h = mant >> shift;
+        rem = mant & ((1u << shift) - 1);
+        half = 1u << (shift - 1);
+    } else {
+        h = ((SCEuint)exp << 10) | (mant >> 13);
+        rem = mant & 0x1fff;
+        half = 0x1000;
+    }
+    /* ties to even, a carry into the exponent gives the right result */
+    if (rem > half || (rem == half && (h & 1)))
+        h++;
+    return sign | h;
+}
+/**
+ * \brief Converts an IEEE 754 half float to a float
+ * \sa SCE_Geometry_FloatToHalf()
+ */
+float SCE_Geometry_HalfToFloat (SCEushort h)
+{
+    SCEuint x, sign = (SCEuint)(h & 0x8000) << 16;
+    SCEuint exp = (h >> 10) & 0x1f, mant = h & 0x3ff;
+    float f;
+
+    if (exp == 0) {
+        f = mant * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    } else if (exp == 31)
+        x = sign | 0x7f800000 | (mant << 13);
+    else
+        x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+    memcpy (&f, &x, sizeof f);
+    return f;
+}
+
+/**
+ * \brief Folds a unit vector onto an octahedron
+ * \param v a 3 components vector, does not need to be normalized
+ * \param p the 2 components result, in [-1, 1]
+ * \sa SCE_Geometry_DecodeOctahedral()
+ */
+void SCE_Geometry_EncodeOctahedral (const float *v, float *p)
+{
+    float l1 = SCE_Math_Fabsf (v[0]) + SCE_Math_Fabsf (v[1]) +
+        SCE_Math_Fabsf (v[2]);
+
+    if (l1 == 0.0f) {
+        p[0] = p[1] = 0.0f;
+        return;
+    }
+    p[0] = v[0] / l1;
+    p[1] = v[1] / l1;
+    if (v[2] < 0.0f) {
+        float x = p[0];
+        p[0] = (1.0f - SCE_Math_Fabsf (p[1])) * (x >= 0.0f ? 1.0f : -1.0f);
+        p[1] = (1.0f - SCE_Math_Fabsf (x)) * (p[1] >= 0.0f ? 1.0f : -1.0f);
+    }
+}
+/**
+ * \brief Unfolds a vector encoded by SCE_Geometry_EncodeOctahedral()
+ * \param p the 2 components encoded vector
+ * \param v the decoded unit vector
+ */
+void SCE_Geometry_DecodeOctahedral (const float *p, float *v)
+{
+    v[0] = p[0];
+    v[1] = p[1];
+    v[2] = 1.0f - SCE_Math_Fabsf (p[0]) - SCE_Math_Fabsf (p[1]);
+    if (v[2] < 0.0f) {
+        float x = v[0];
+        v[0] = (1.0f - SCE_Math_Fabsf (v[1])) * (x >= 0.0f ? 1.0f : -1.0f);
+        v[1] = (1.0f - SCE_Math_Fabsf (x)) * (v[1] >= 0.0f ? 1.0f : -1.0f);
+    }
+    SCE_Vector3_Normalize (v);
+}
+/* rounding each component to the nearest is not the most accurate encoding,
+   the 4 neighbors of the exact encoding are tried */
+static void SCE_Geometry_PutOctahedral (SCE_EType type, void *data, size_t i,
+                                        const float *v)
+{
+    int j;
+    float p[2], q[2], best[2], d, max = -2.0f;
+    float m = SCE_Geometry_NormalizedMax (type);
+
+    SCE_Geometry_EncodeOctahedral (v, p);
+    best[0] = p[0];
+    best[1] = p[1];
+    for (j = 0; j < 4; j++) {
+        SCE_TVector3 u;
+        q[0] = MAX (-m, MIN (floor (p[0] * m) + (j & 1), m)) / m;
+        q[1] = MAX (-m, MIN (floor (p[1] * m) + (j >> 1), m)) / m;
+        SCE_Geometry_DecodeOctahedral (q, u);
+        d = SCE_Vector3_Dot (u, v);
+        if (d > max) {
+            max = d;
+            best[0] = q[0];
+            best[1] = q[1];
+        }
+    }
+    SCE_Geometry_PutNormalized (type, data, i * 2, best[0]);
+    SCE_Geometry_PutNormalized (type, data, i * 2 + 1, best[1]);
+}
+
+static const char* SCE_Geometry_CheckConversion (SCE_SGeometryArray *array,
+                                                 SCE_EType type,
+                                                 SCE_EArrayEncoding encoding)
+{
+    SCE_SGeometryArrayData *data = &array->data;
+
+    if (data->type != SCE_FLOAT || data->encoding != SCE_ARRAY_RAW)
+        return "only raw float arrays can be converted";
+    if (array->root || array->child)
+        return "interleaved arrays cannot be converted";
+    if (!array->geom)
+        return "the array must belong to a geometry";
+    if (data->size > 4)
+        return "cannot convert vectors of more than 4 components";
+    switch (encoding) {
+    case SCE_ARRAY_NORMALIZED:
+        if (SCE_Geometry_NormalizedMax (type) == 0.0f)
+            return "normalized data must be 8 or 16 bits integers";
+        break;
+    case SCE_ARRAY_OCTAHEDRAL:
+        if (data->size < 3)
+            return "octahedral encoding needs 3 components vectors";
+        if (!SCE_Geometry_IsSignedType (type))
+            return "octahedral data must be SCE_BYTE or SCE_SHORT";
+        break;
+    case SCE_ARRAY_HALF_FLOAT:
+        if (type != SCE_UNSIGNED_SHORT)
+            return "half floats must be stored as SCE_UNSIGNED_SHORT";
+        break;
+    default:
+        return "unknown encoding";
+    }
+    return NULL;
+}
+/**
+ * \brief Converts the float data of an array into a compact format
+ * \param array the array to convert, must belong to a geometry and must not
+ * be interleaved
+ * \param type the new type of the data
+ * \param encoding how to encode the data:
+ * - SCE_ARRAY_NORMALIZED: \p type is any 8 or 16 bits integer type, the
+ *   vectors are normalized relative to their bounding box and can be decoded
+ *   by the \c offset and \c scale fields of the array data (typically
+ *   positions);
+ * - SCE_ARRAY_OCTAHEDRAL: \p type is SCE_BYTE or SCE_SHORT, the 3 first
+ *   components are encoded as a unit vector in 2 components (normals,
+ *   tangents);
+ * - SCE_ARRAY_HALF_FLOAT: \p type must be SCE_UNSIGNED_SHORT, each component is
+ *   stored as a 16 bits float (texture coordinates).
+ *
+ * The stride of the new data is rounded up to 4 bytes to keep the vertices
+ * aligned. Once positions, normals or texture coordinates are converted, the
+ * matching pointer returned by SCE_Geometry_GetPositions() and friends is NULL
+ * since these functions return floats: bounding volumes are generated before
+ * the conversion, and SCE_Geometry_DecodeArray() gives back floats to the
+ * CPU side consumers. The array is marked as modified, since its size
+ * changes it should be converted before being used by a renderer.
+ * \returns SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_Geometry_DecodeArray(), SCE_EArrayEncoding
+ */
+int SCE_Geometry_ConvertArray (SCE_SGeometryArray *array, SCE_EType type,
+                               SCE_EArrayEncoding encoding)
+{
+    SCE_SGeometryArrayData *data = &array->data;
+    SCE_SGeometry *geom = array->geom;
+    size_t i, stride, n_vertices;
+    int j, size = data->size;
+    float min[4], max[4];
+    const char *src = data->data, *msg = NULL;
+    void *dst = NULL;
+
+    if ((msg = SCE_Geometry_CheckConversion (array, type, encoding))) {
+        SCEE_Log (SCE_INVALID_ARG);
+        SCEE_LogMsg ("%s", msg);
+        return SCE_ERROR;
+    }
+
+    n_vertices = geom->n_vertices;
+    if (encoding == SCE_ARRAY_OCTAHEDRAL)
+        size = 2;
+    stride = (size * SCE_Type_Sizeof (type) + 3) & ~(size_t)3;
+    if (!(dst = SCE_malloc (n_vertices * stride + 1))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    /* keep the bounding volumes valid */
+    if (array == geom->pos_array)
+        SCE_Geometry_GenerateBoundingVolumes (geom);
+
+    data->offset[0] = data->offset[1] = data->offset[2] = data->offset[3] = 0.0;
+    data->scale[0] = data->scale[1] = data->scale[2] = data->scale[3] = 1.0;
+    switch (encoding) {
+    case SCE_ARRAY_NORMALIZED:
+        for (j = 0; j < size; j++) {
+            min[j] = max[j] = n_vertices ? ((const float*)src)[j] : 0.0f;
+            for (i = 1; i < n_vertices; i++) {
+                float x = ((const float*)&src[i * data->stride])[j];
+                min[j] = MIN (min[j], x);
+                max[j] = MAX (max[j], x);
+            }
+            if (SCE_Geometry_IsSignedType (type)) {
+                data->offset[j] = (min[j] + max[j]) * 0.5f;
+                data->scale[j] = (max[j] - min[j]) * 0.5f;
+            } else {
+                data->offset[j] = min[j];
+                data->scale[j] = max[j] - min[j];
+            }
+            if (data->scale[j] == 0.0f)
+                data->scale[j] = 1.0f;
+        }
+        for (i = 0; i < n_vertices; i++) {
+            const float *v = (const float*)&src[i * data->stride];
+            char *d = (char*)dst + i * stride;
+            for (j = 0; j < size; j++)
+                SCE_Geometry_PutNormalized (type, d, j, (v[j] - data->offset[j])
+                                            / data->scale[j]);
+        }
+        break;
+    case SCE_ARRAY_OCTAHEDRAL:
+        for (i = 0; i < n_vertices; i++)
+            SCE_Geometry_PutOctahedral (type, (char*)dst + i * stride, 0,
+                                        (const float*)&src[i * data->stride]);
+        break;
+    case SCE_ARRAY_HALF_FLOAT:
+        for (i = 0; i < n_vertices; i++) {
+            const float *v = (const float*)&src[i * data->stride];
+            SCEushort *d = (SCEushort*)((char*)dst + i * stride);
+            for (j = 0; j < size; j++)
+                d[j] = SCE_Geometry_FloatToHalf (v[j]);
+        }
+        break;
+    default:;
+    }
+
+    if (array->canfree_data)
+        SCE_free (data->data);
+    data->type = type;
+    data->size = size;
+    data->stride = stride;
+    data->data = dst;
+    data->encoding = encoding;
+    array->canfree_data = SCE_TRUE;
+
+    /* these pointers are floats for the CPU side */
+    if (array == geom->pos_array)
+        geom->pos_data = NULL;
+    if (array == geom->nor_array)
+        geom->nor_data = NULL;
+    if (array == geom->tex_array)
+        geom->tex_data = NULL;
+    SCE_Geometry_Modified (array, NULL);
+    return SCE_OK;
+}
+/**
+ * \brief Gets the number of components SCE_Geometry_DecodeArray() writes per
+ * vertex
+ */
+int SCE_Geometry_GetDecodedSize (const SCE_SGeometryArray *array)
+{
+    if (array->data.encoding == SCE_ARRAY_OCTAHEDRAL)
+        return 3;
+    return array->data.size;
+}
+/**
+ * \brief Decodes vertices of an array into floats
+ * \param first first vertex to decode
+ * \param n number of vertices to decode
+ * \param out the decoded vectors, SCE_Geometry_GetDecodedSize() components
+ * per vertex
+ *
+ * Works for any encoding, raw arrays must be of type SCE_FLOAT.
+ * \sa SCE_Geometry_ConvertArray()
+ */
+void SCE_Geometry_DecodeArray (const SCE_SGeometryArray *array, size_t first,
+                               size_t n, SCEvertices *out)
+{
+    const SCE_SGeometryArrayData *data = &array->data;
+    const SCE_SGeometryArray *a = array->root ? array->root : array;
+    const char *src = NULL;
+    size_t i, stride = 0;
+    int j, size = data->size;
+
+    /* the array may be interleaved */
+    for (; a; a = a->child)
+        stride += a->data.stride;
+    src = (const char*)data->data + first * stride;
+    for (i = 0; i < n; i++, src += stride) {
+        switch (data->encoding) {
+        case SCE_ARRAY_RAW:
+            memcpy (out, src, size * sizeof *out);
+            out += size;
+            break;
+        case SCE_ARRAY_NORMALIZED:
+            for (j = 0; j < size; j++)
+                *out++ = data->offset[j] + data->scale[j] *
+                    SCE_Geometry_GetNormalized (data->type, src, j);
+            break;
+        case SCE_ARRAY_OCTAHEDRAL:
+            {
+                float p[2];
+                p[0] = SCE_Geometry_GetNormalized (data->type, src, 0);
+                p[1] = SCE_Geometry_GetNormalized (data->type, src, 1);
+                SCE_Geometry_DecodeOctahedral (p, out);
+                out += 3;
+            }
+            break;
+        case SCE_ARRAY_HALF_FLOAT:
+            for (j = 0; j < size; j++)
+                *out++ = SCE_Geometry_HalfToFloat (((const SCEushort*)src)[j]);
+        }
+    }
+}
+
 /**
  * \brief Compute the tangent, binormal and normal for a triangle
  * \param vertex the vertices' positions of the triangle
@@ -1487,8 +2662,8 @@ int SCE_Geometry_ComputeTBN (SCE_EPrimitiveType prim, SCEvertices *vertex,
 {
     size_t i;
     size_t t_indices[3];
-    SCEindices *index = NULL;
-    size_t count;
+    SCEubyte *index = NULL;
+    size_t count, size;
 
 #if 0
     if (normals)
@@ -1504,30 +2679,33 @@ int SCE_Geometry_ComputeTBN (SCE_EPrimitiveType prim, SCEvertices *vertex,
 
     if (!indices) {
         count = vcount;
-        itype = SCE_INDICES_TYPE;
-        index = SCE_malloc (sizeof *index * count);
+        itype = SCE_Geometry_GetIndicesTypeFor (count);
+        index = SCE_malloc (SCE_Type_Sizeof (itype) * count);
         if (!index) {
             SCEE_LogSrc ();
             return SCE_ERROR;
         }
         for (i = 0; i < count; i++)
-            index[i] = i;
+            SCE_Geometry_SetIndex (itype, index, i, i);
     } else {
         index = indices;
         count = icount;
     }
+    size = SCE_Type_Sizeof (itype);
 
     switch (prim) {
     case SCE_TRIANGLES:
         for (i = 0; i < count; i += 3) {
-            SCE_Type_Convert (SCE_SIZE_T, t_indices, itype, &index[i], 3);
+            SCE_Type_Convert (SCE_SIZE_T, t_indices, itype, &index[i * size],
+                              3);
             SCE_Mesh_ComputeTriangleTBN (vertex, texcoord, t_indices,
                                          tangents, binormals, normals);
         }
         break;
     case SCE_TRIANGLE_STRIP:
         for (i = 0; i < count - 2; i++) {
-            SCE_Type_Convert (SCE_SIZE_T, t_indices, itype, &index[i], 3);
+            SCE_Type_Convert (SCE_SIZE_T, t_indices, itype, &index[i * size],
+                              3);
             SCE_Mesh_ComputeTriangleTBN (vertex, texcoord, t_indices,
                                          tangents, binormals, normals);
         }
@@ -1535,7 +2713,8 @@ int SCE_Geometry_ComputeTBN (SCE_EPrimitiveType prim, SCEvertices *vertex,
     case SCE_TRIANGLE_FAN:
         SCE_Type_Convert (SCE_SIZE_T, t_indices, itype, index, 1);
         for (i = 1; i < count - 1; i++) {
-            SCE_Type_Convert (SCE_SIZE_T, &t_indices[1], itype, &index[i], 2);
+            SCE_Type_Convert (SCE_SIZE_T, &t_indices[1], itype,
+                              &index[i * size], 2);
             SCE_Mesh_ComputeTriangleTBN (vertex, texcoord, t_indices,
                                          tangents, binormals, normals);
         }
@@ -1679,12 +2858,12 @@ fail:
  * \param normals here is written the computed normals, can be NULL
  */
 static void SCE_Mesh_ComputeTriangleNormals (SCEvertices *vertex,
-                                             SCEindices *index,
+                                             SCEuint *index,
                                              SCEvertices *normals)
 {
     SCE_TVector3 side0, side1;
     SCE_TVector3 tmp;
-    SCEindices default_indices[3] = {0, 1, 2};
+    SCEuint default_indices[3] = {0, 1, 2};
 
     if (!index)
         index = default_indices;
@@ -1707,28 +2886,31 @@ static void SCE_Mesh_ComputeTriangleNormals (SCEvertices *vertex,
 
 /**
  * \brief Compute the normals of a polygon soup
+ * \param itype type of \p indices
  * \param icount number of indices
  * \param vcount number of vertices
  * \returns SCE_ERROR on error, SCE_OK otherwise
  */
-int SCE_Geometry_ComputeNormals (SCEvertices *vertex, SCEindices *indices,
-                                 size_t vcount, size_t icount,
+int SCE_Geometry_ComputeNormals (SCEvertices *vertex, SCE_EType itype,
+                                 void *indices, size_t vcount, size_t icount,
                                  SCEvertices *normals)
 {
     size_t i;
-    SCEindices *index = NULL;
+    SCEuint ind[3];
     size_t count;
 
     for (i = 0; i < vcount; i++)
         SCE_Vector3_Set (&normals[i*3], 0.0f, 0.0f, 0.0f);
 
     if (indices) {
-        index = indices;
         count = icount;
-        for (i = 0; i < count; i += 3)
-            SCE_Mesh_ComputeTriangleNormals (vertex, &index[i], normals);
+        for (i = 0; i < count; i += 3) {
+            ind[0] = SCE_Geometry_GetIndex (itype, indices, i);
+            ind[1] = SCE_Geometry_GetIndex (itype, indices, i + 1);
+            ind[2] = SCE_Geometry_GetIndex (itype, indices, i + 2);
+            SCE_Mesh_ComputeTriangleNormals (vertex, ind, normals);
+        }
     } else {
-        SCEindices ind[3];
         count = vcount;
         for (i = 0; i < count; i += 3) {
             ind[0] = i;
@@ -1738,10 +2920,6 @@ int SCE_Geometry_ComputeNormals (SCEvertices *vertex, SCEindices *indices,
         }
     }
 
-
-    if (!indices)
-        SCE_free (index);
-
     for (i = 0; i < vcount; i++) {
         if (!SCE_Vector3_IsNull (&normals[i*3]))
             SCE_Vector3_Normalize (&normals[i*3]);
@@ -1762,7 +2940,7 @@ int SCE_Geometry_GenerateNormals (SCE_SGeometry *geom, SCEvertices **n)
         goto fail;
 
     data = SCE_Geometry_GetArrayData (geom->index_array);
-    if (SCE_Geometry_ComputeNormals (geom->pos_data, data->data,
+    if (SCE_Geometry_ComputeNormals (geom->pos_data, data->type, data->data,
                                      geom->n_vertices, geom->n_indices,
                                      normal) < 0)
         goto fail;
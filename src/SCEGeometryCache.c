@@ -0,0 +1,535 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#define SCE_GCACHE_USE_MMAP
+#endif
+#include <SCE/utils/SCEUtils.h>
+
+#include "SCE/core/SCEGeometryCache.h"
+
+/* file format, the numbers are stored on 8 bytes, little endian:
+
+   header:  magic, version, byte order mark, primitive type, number of
+            vertices, number of indices, type of the indices, offset of the
+            indices, number of arrays, flags of the bounding volumes
+   volumes: origin and dimensions of the bounding box, center and radius
+            of the bounding sphere
+   arrays:  attribute, type, size, stride, encoding, interleaved with the
+            previous array?, offset of the data, padding, then the decoding
+            offset and scale (4 floats each)
+   data:    vertex arrays then indices, each block aligned on 16 bytes
+
+   Floats and vertex data are stored as they are in memory so the arrays can
+   point directly into the mapped file; the byte order mark tells whether
+   they can be read on this machine. */
+
+#define SCE_GCACHE_MAGIC "SCEGEOMC"
+#define SCE_GCACHE_VERSION 1
+#define SCE_GCACHE_BYTE_ORDER 0x01020304
+#define SCE_GCACHE_NUMBER_SIZE 8
+#define SCE_GCACHE_ALIGN 16
+#define SCE_GCACHE_HEADER_SIZE (10 * SCE_GCACHE_NUMBER_SIZE)
+#define SCE_GCACHE_VOLUMES_SIZE 48 /* 10 floats, padded */
+#define SCE_GCACHE_ARRAYS_OFFSET (SCE_GCACHE_HEADER_SIZE + \
+                                  SCE_GCACHE_VOLUMES_SIZE)
+#define SCE_GCACHE_ARRAY_SIZE (8 * SCE_GCACHE_NUMBER_SIZE + 8 * sizeof (float))
+
+#define SCE_GCACHE_HAS_BOX 1
+#define SCE_GCACHE_HAS_SPHERE 2
+
+/* storage of a loaded geometry, see SCE_Geometry_SetStorage() */
+typedef struct sce_sgcachemap SCE_SGCacheMap;
+struct sce_sgcachemap {
+    SCEubyte *data;
+    size_t size;
+    int mapped;                 /* is \c data a memory mapping? */
+};
+
+static int is_init = SCE_FALSE;
+
+static void* SCE_GCache_Load (FILE*, const char*, void*);
+
+int SCE_Init_GCache (void)
+{
+    if (is_init)
+        return SCE_OK;
+    if (SCE_Media_Register (SCE_Geometry_GetResourceType (),
+                            "."SCE_GCACHE_FILE_EXTENSION, SCE_GCache_Load,
+                            NULL) < 0)
+        goto fail;
+    is_init = SCE_TRUE;
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    SCEE_LogSrcMsg ("failed to initialize the geometry cache loader");
+    return SCE_ERROR;
+}
+void SCE_Quit_GCache (void)
+{
+    is_init = SCE_FALSE;
+}
+
+
+static void SCE_GCache_PutNumber (SCEulong n, SCEubyte *data)
+{
+    size_t i;
+    for (i = 0; i < SCE_GCACHE_NUMBER_SIZE; i++) {
+        data[i] = n & 0xff;
+        n >>= 8;
+    }
+}
+static SCEulong SCE_GCache_GetNumber (const SCEubyte *data)
+{
+    SCEulong n = 0;
+    size_t i;
+    for (i = SCE_GCACHE_NUMBER_SIZE; i > 0; i--)
+        n = (n << 8) | data[i - 1];
+    return n;
+}
+static size_t SCE_GCache_Align (size_t n)
+{
+    return (n + SCE_GCACHE_ALIGN - 1) & ~(size_t)(SCE_GCACHE_ALIGN - 1);
+}
+
+
+static void SCE_GCache_Unmap (void *p)
+{
+    SCE_SGCacheMap *map = p;
+    if (!map)
+        return;
+#ifdef SCE_GCACHE_USE_MMAP
+    if (map->mapped)
+        munmap (map->data, map->size);
+#endif
+    if (!map->mapped)
+        SCE_free (map->data);
+    SCE_free (map);
+}
+static SCE_SGCacheMap* SCE_GCache_Map (FILE *fp, const char *fname)
+{
+    SCE_SGCacheMap *map = NULL;
+    long size;
+
+    if (!(map = SCE_malloc (sizeof *map))) {
+        SCEE_LogSrc ();
+        return NULL;
+    }
+    map->data = NULL;
+    map->size = 0;
+    map->mapped = SCE_FALSE;
+
+    if (fseek (fp, 0, SEEK_END) || (size = ftell (fp)) <= 0)
+        goto fail;
+    map->size = size;
+
+#ifdef SCE_GCACHE_USE_MMAP
+    /* private mapping: the arrays can be modified in place (sorting,
+       vertex cache optimization...), touched pages are then copied */
+    map->data = mmap (NULL, map->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                      fileno (fp), 0);
+    if (map->data != MAP_FAILED) {
+        map->mapped = SCE_TRUE;
+        return map;
+    }
+    map->data = NULL;
+#endif
+    /* fallback: read the whole file */
+    if (!(map->data = SCE_malloc (map->size)))
+        goto fail;
+    if (fseek (fp, 0, SEEK_SET) ||
+        fread (map->data, 1, map->size, fp) != map->size)
+        goto fail;
+
+    return map;
+fail:
+    SCE_GCache_Unmap (map);
+    SCEE_Log (SCE_INVALID_OPERATION);
+    SCEE_LogMsg ("failed to map geometry cache %s", fname);
+    return NULL;
+}
+
+/* checks that every array of the table lies within the file */
+static int SCE_GCache_CheckArrays (const SCEubyte *data, size_t size,
+                                   size_t n_arrays, size_t n_vertices)
+{
+    const SCEubyte *table = &data[SCE_GCACHE_ARRAYS_OFFSET];
+    size_t i, j, k;
+
+    for (i = 0; i < n_arrays; i = j) {
+        size_t total = 0;
+        /* an array and the ones interleaved with it */
+        for (j = i; j < n_arrays; j++) {
+            const SCEubyte *a = &table[j * SCE_GCACHE_ARRAY_SIZE];
+            if (j > i && !SCE_GCache_GetNumber (&a[40]))
+                break;
+            total += SCE_GCache_GetNumber (&a[24]);
+        }
+        for (k = i; k < j; k++) {
+            const SCEubyte *a = &table[k * SCE_GCACHE_ARRAY_SIZE];
+            size_t stride = SCE_GCache_GetNumber (&a[24]);
+            size_t offset = SCE_GCache_GetNumber (&a[48]);
+            if (stride == 0 || offset > size || stride > size - offset)
+                return SCE_FALSE;
+            if (n_vertices > 1 &&
+                (size - offset - stride) / total < n_vertices - 1)
+                return SCE_FALSE;
+        }
+    }
+    return SCE_TRUE;
+}
+
+static void* SCE_GCache_Load (FILE *fp, const char *fname, void *unused)
+{
+    SCE_SGCacheMap *map = NULL;
+    SCE_SGeometry *geom = NULL;
+    SCE_SGeometryArray *array = NULL, *prev = NULL;
+    const SCEubyte *data = NULL;
+    SCEubyte *base = NULL;
+    size_t i, size, n_vertices, n_indices, n_arrays, offset, flags;
+    SCE_EPrimitiveType prim;
+    SCE_EType itype;
+    SCEuint byte_order;
+
+    (void)unused;
+
+    if (!(map = SCE_GCache_Map (fp, fname)))
+        goto fail;
+    base = map->data;
+    data = base;
+    size = map->size;
+
+    if (size < SCE_GCACHE_ARRAYS_OFFSET ||
+        memcmp (data, SCE_GCACHE_MAGIC, SCE_GCACHE_NUMBER_SIZE) ||
+        SCE_GCache_GetNumber (&data[8]) != SCE_GCACHE_VERSION)
+        goto corrupted;
+    memcpy (&byte_order, &data[16], sizeof byte_order);
+    if (byte_order != SCE_GCACHE_BYTE_ORDER) {
+        SCEE_Log (SCE_INVALID_OPERATION);
+        SCEE_LogMsg ("geometry cache %s was built for another byte order, "
+                     "it must be converted again", fname);
+        goto fail;
+    }
+    prim = SCE_GCache_GetNumber (&data[24]);
+    n_vertices = SCE_GCache_GetNumber (&data[32]);
+    n_indices = SCE_GCache_GetNumber (&data[40]);
+    itype = SCE_GCache_GetNumber (&data[48]);
+    offset = SCE_GCache_GetNumber (&data[56]);
+    n_arrays = SCE_GCache_GetNumber (&data[64]);
+    flags = SCE_GCache_GetNumber (&data[72]);
+
+    if (prim >= SCE_NUM_PRIMITIVE_TYPES ||
+        n_arrays > (size - SCE_GCACHE_ARRAYS_OFFSET) / SCE_GCACHE_ARRAY_SIZE ||
+        !SCE_GCache_CheckArrays (data, size, n_arrays, n_vertices))
+        goto corrupted;
+    if (n_indices > 0 &&
+        ((itype != SCE_UNSIGNED_BYTE && itype != SCE_UNSIGNED_SHORT &&
+          itype != SCE_UNSIGNED_INT) || offset > size ||
+         n_indices > (size - offset) / SCE_Type_Sizeof (itype)))
+        goto corrupted;
+
+    if (!(geom = SCE_Geometry_Create ()))
+        goto fail;
+    /* the geometry now owns the mapping */
+    SCE_Geometry_SetStorage (geom, map, SCE_GCache_Unmap);
+    map = NULL;
+
+    SCE_Geometry_SetPrimitiveType (geom, prim);
+    SCE_Geometry_SetNumVertices (geom, n_vertices);
+    SCE_Geometry_SetNumIndices (geom, n_indices);
+
+    for (i = 0; i < n_arrays; i++) {
+        const SCEubyte *a = &data[SCE_GCACHE_ARRAYS_OFFSET +
+                                  i * SCE_GCACHE_ARRAY_SIZE];
+        SCE_SGeometryArrayData *ad = NULL;
+
+        if (!(array = SCE_Geometry_CreateArray ()))
+            goto fail;
+        SCE_Geometry_SetArrayData (array, SCE_GCache_GetNumber (&a[0]),
+                                   SCE_GCache_GetNumber (&a[8]),
+                                   SCE_GCache_GetNumber (&a[24]),
+                                   SCE_GCache_GetNumber (&a[16]),
+                                   &base[SCE_GCache_GetNumber (&a[48])],
+                                   SCE_FALSE);
+        ad = SCE_Geometry_GetArrayData (array);
+        ad->encoding = SCE_GCache_GetNumber (&a[32]);
+        memcpy (ad->offset, &a[64], sizeof ad->offset);
+        memcpy (ad->scale, &a[80], sizeof ad->scale);
+        if (prev && SCE_GCache_GetNumber (&a[40]))
+            SCE_Geometry_AttachArray (prev, array);
+        SCE_Geometry_AddArray (geom, array);
+        /* encoded arrays can't be read as floats */
+        if (ad->encoding != SCE_ARRAY_RAW) {
+            if (array == geom->pos_array)
+                geom->pos_data = NULL;
+            if (array == geom->nor_array)
+                geom->nor_data = NULL;
+            if (array == geom->tex_array)
+                geom->tex_data = NULL;
+        }
+        prev = array;
+    }
+    if (n_indices > 0) {
+        if (!(array = SCE_Geometry_CreateArray ()))
+            goto fail;
+        SCE_Geometry_SetArrayIndices (array, itype, &base[offset], SCE_FALSE);
+        SCE_Geometry_SetIndexArray (geom, array, SCE_TRUE);
+    }
+
+    data = &data[SCE_GCACHE_HEADER_SIZE];
+    if (flags & SCE_GCACHE_HAS_BOX) {
+        float v[6];
+        memcpy (v, data, sizeof v);
+        SCE_Box_Setv (SCE_Geometry_GetBox (geom), v, &v[3]);
+        SCE_Geometry_BoxUpToDate (geom);
+    }
+    if (flags & SCE_GCACHE_HAS_SPHERE) {
+        float v[4];
+        memcpy (v, &data[6 * sizeof (float)], sizeof v);
+        SCE_Sphere_SetCenterv (SCE_Geometry_GetSphere (geom), v);
+        SCE_Sphere_SetRadius (SCE_Geometry_GetSphere (geom), v[3]);
+        SCE_Geometry_SphereUpToDate (geom);
+    }
+
+    return geom;
+corrupted:
+    SCEE_Log (SCE_BAD_FORMAT);
+    SCEE_LogMsg ("corrupted geometry cache %s", fname);
+fail:
+    SCE_GCache_Unmap (map);
+    SCE_Geometry_Delete (geom);
+    SCEE_LogSrc ();
+    return NULL;
+}
+
+
+/* returns the vertex arrays of \p geom, each root array followed by the
+   arrays interleaved with it */
+static SCE_SGeometryArray** SCE_GCache_GatherArrays (SCE_SGeometry *geom,
+                                                     size_t *n)
+{
+    SCE_SList *lists[2];
+    SCE_SListIterator *it = NULL;
+    SCE_SGeometryArray **arrays = NULL, *a = NULL;
+    size_t i, count = 0;
+
+    lists[0] = SCE_Geometry_GetArrays (geom);
+    lists[1] = SCE_Geometry_GetModifiedArrays (geom);
+    for (i = 0; i < 2; i++) {
+        SCE_List_ForEach (it, lists[i]) {
+            a = SCE_List_GetData (it);
+            if (a != SCE_Geometry_GetIndexArray (geom) &&
+                !SCE_Geometry_GetRoot (a)) {
+                for (; a; a = SCE_Geometry_GetChild (a))
+                    count++;
+            }
+        }
+    }
+    if (!(arrays = SCE_malloc ((count + 1) * sizeof *arrays))) {
+        SCEE_LogSrc ();
+        return NULL;
+    }
+    count = 0;
+    for (i = 0; i < 2; i++) {
+        SCE_List_ForEach (it, lists[i]) {
+            a = SCE_List_GetData (it);
+            if (a != SCE_Geometry_GetIndexArray (geom) &&
+                !SCE_Geometry_GetRoot (a)) {
+                for (; a; a = SCE_Geometry_GetChild (a))
+                    arrays[count++] = a;
+            }
+        }
+    }
+    *n = count;
+    return arrays;
+}
+
+/* writes \p size bytes of \p data then pads the file to the alignment */
+static int SCE_GCache_WriteBlock (FILE *fp, const void *data, size_t size)
+{
+    static const SCEubyte zeros[SCE_GCACHE_ALIGN] = {0};
+    size_t padding = SCE_GCache_Align (size) - size;
+
+    if ((size && fwrite (data, 1, size, fp) != size) ||
+        (padding && fwrite (zeros, 1, padding, fp) != padding))
+        return SCE_ERROR;
+    return SCE_OK;
+}
+
+/**
+ * \brief Writes a geometry into a cache file
+ * \param geom the geometry to save, its bounding volumes are generated
+ * \param fname name of the file to create
+ *
+ * The file holds the arrays of \p geom exactly as they are in memory,
+ * interleaved, converted or not, see SCE_Geometry_Interleave() and
+ * SCE_Geometry_ConvertArray(). Loading it with SCE_Geometry_Load() maps
+ * the file and makes the arrays point into it, no data is parsed nor
+ * copied. The file can only be loaded on machines of the same byte order.
+ * \sa SCE_GCache_Convert()
+ */
+int SCE_GCache_Save (SCE_SGeometry *geom, const char *fname)
+{
+    SCE_SGeometryArray **arrays = NULL;
+    SCEubyte *header = NULL;
+    FILE *fp = NULL;
+    size_t i, n_arrays = 0, header_size, offset, root_offset = 0;
+    size_t n_vertices, n_indices, flags = 0;
+    SCEuint byte_order = SCE_GCACHE_BYTE_ORDER;
+    float volumes[10];
+
+    n_vertices = SCE_Geometry_GetNumVertices (geom);
+    n_indices = SCE_Geometry_GetIndices (geom) ?
+        SCE_Geometry_GetNumIndices (geom) : 0;
+
+    if (!(arrays = SCE_GCache_GatherArrays (geom, &n_arrays)))
+        goto fail;
+    header_size = SCE_GCache_Align (SCE_GCACHE_ARRAYS_OFFSET +
+                                    n_arrays * SCE_GCACHE_ARRAY_SIZE);
+    if (!(header = SCE_malloc (header_size)))
+        goto fail;
+    memset (header, 0, header_size);
+
+    SCE_Geometry_GenerateBoundingVolumes (geom);
+    memset (volumes, 0, sizeof volumes);
+    if (geom->box_uptodate) {
+        SCE_Box_GetOriginv (SCE_Geometry_GetBox (geom), volumes);
+        SCE_Box_GetDimensionsv (SCE_Geometry_GetBox (geom), &volumes[3]);
+        flags |= SCE_GCACHE_HAS_BOX;
+    }
+    if (geom->sphere_uptodate) {
+        SCE_Sphere_GetCenterv (SCE_Geometry_GetSphere (geom), &volumes[6]);
+        volumes[9] = SCE_Sphere_GetRadius (SCE_Geometry_GetSphere (geom));
+        flags |= SCE_GCACHE_HAS_SPHERE;
+    }
+    memcpy (&header[SCE_GCACHE_HEADER_SIZE], volumes, sizeof volumes);
+
+    offset = header_size;
+    for (i = 0; i < n_arrays; i++) {
+        SCE_SGeometryArray *root = SCE_Geometry_GetRoot (arrays[i]);
+        SCE_SGeometryArrayData *ad = SCE_Geometry_GetArrayData (arrays[i]);
+        SCEubyte *a = &header[SCE_GCACHE_ARRAYS_OFFSET +
+                              i * SCE_GCACHE_ARRAY_SIZE];
+        size_t data_offset;
+
+        if (!ad->data) {
+            SCEE_Log (SCE_INVALID_ARG);
+            SCEE_LogMsg ("an array of the geometry has no data");
+            goto fail;
+        }
+        if (root) {
+            data_offset = root_offset + ((SCEubyte*)ad->data -
+                                         (SCEubyte*)SCE_Geometry_GetData (root));
+        } else {
+            data_offset = root_offset = offset;
+            offset += SCE_GCache_Align (n_vertices *
+                                        SCE_Geometry_GetTotalStride (arrays[i]));
+        }
+        SCE_GCache_PutNumber (ad->attrib, &a[0]);
+        SCE_GCache_PutNumber (ad->type, &a[8]);
+        SCE_GCache_PutNumber (ad->size, &a[16]);
+        SCE_GCache_PutNumber (ad->stride, &a[24]);
+        SCE_GCache_PutNumber (ad->encoding, &a[32]);
+        SCE_GCache_PutNumber (root != NULL, &a[40]);
+        SCE_GCache_PutNumber (data_offset, &a[48]);
+        memcpy (&a[64], ad->offset, sizeof ad->offset);
+        memcpy (&a[80], ad->scale, sizeof ad->scale);
+    }
+
+    memcpy (header, SCE_GCACHE_MAGIC, SCE_GCACHE_NUMBER_SIZE);
+    SCE_GCache_PutNumber (SCE_GCACHE_VERSION, &header[8]);
+    memcpy (&header[16], &byte_order, sizeof byte_order);
+    SCE_GCache_PutNumber (SCE_Geometry_GetPrimitiveType (geom), &header[24]);
+    SCE_GCache_PutNumber (n_vertices, &header[32]);
+    SCE_GCache_PutNumber (n_indices, &header[40]);
+    SCE_GCache_PutNumber (n_indices ? SCE_Geometry_GetIndicesType (geom) : 0,
+                          &header[48]);
+    SCE_GCache_PutNumber (n_indices ? offset : 0, &header[56]);
+    SCE_GCache_PutNumber (n_arrays, &header[64]);
+    SCE_GCache_PutNumber (flags, &header[72]);
+
+    if (!(fp = fopen (fname, "wb")))
+        goto write_error;
+    if (SCE_GCache_WriteBlock (fp, header, header_size) < 0)
+        goto write_error;
+    for (i = 0; i < n_arrays; i++) {
+        if (!SCE_Geometry_GetRoot (arrays[i]) &&
+            SCE_GCache_WriteBlock (fp, SCE_Geometry_GetData (arrays[i]),
+                                   n_vertices * SCE_Geometry_GetTotalStride
+                                   (arrays[i])) < 0)
+            goto write_error;
+    }
+    if (n_indices > 0 &&
+        SCE_GCache_WriteBlock (fp, SCE_Geometry_GetIndices (geom), n_indices *
+                               SCE_Type_Sizeof (SCE_Geometry_GetIndicesType
+                                                (geom))) < 0)
+        goto write_error;
+    if (fclose (fp)) {
+        fp = NULL;
+        goto write_error;
+    }
+
+    SCE_free (header);
+    SCE_free (arrays);
+    return SCE_OK;
+write_error:
+    SCEE_Log (SCE_INVALID_OPERATION);
+    SCEE_LogMsg ("failed to write geometry cache %s", fname);
+fail:
+    if (fp)
+        fclose (fp);
+    SCE_free (header);
+    SCE_free (arrays);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/**
+ * \brief Converts a mesh file into a geometry cache file
+ * \param src file to convert, in any format known by SCE_Geometry_Load()
+ * \param dst name of the cache file to create
+ *
+ * Meant to be run offline, the resulting file is then loaded by
+ * SCE_Geometry_Load() like any other mesh.
+ * \sa SCE_GCache_Save()
+ */
+int SCE_GCache_Convert (const char *src, const char *dst)
+{
+    SCE_SGeometry *geom = NULL;
+
+    if (!(geom = SCE_Geometry_Load (src, SCE_TRUE)))
+        goto fail;
+    if (SCE_GCache_Save (geom, dst) < 0)
+        goto fail;
+    SCE_Geometry_Delete (geom);
+    return SCE_OK;
+fail:
+    SCE_Geometry_Delete (geom);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
@@ -61,7 +61,8 @@ void* SCE_idTechMD5_LoadMesh (FILE *fp, const char *fname, void *unused)
     int n_joints = 0, n_meshes = 0;
     int n_verts = 0, n_weights = 0, n_tris = 0;
     int max_tris = 0, max_verts = 0;
-    SCEindices *indices = NULL;
+    SCE_EType itype = SCE_INDICES_TYPE;
+    void *indices = NULL;
 
     (void)unused;
     if (!(baseskel = SCE_Skeleton_Create ()))
@@ -119,10 +120,15 @@ void* SCE_idTechMD5_LoadMesh (FILE *fp, const char *fname, void *unused)
                             goto failure;
                     }
                 } else if (sscanf (buff, " numtris %d", &n_tris) == 1) {
-                    if (n_tris > max_tris) {
-                        max_tris = n_tris;
+                    /* numverts comes first, the indices must address all
+                       the vertices of this mesh */
+                    SCE_EType type = SCE_Geometry_GetIndicesTypeFor (n_verts);
+                    if (n_tris > max_tris || type != itype) {
+                        max_tris = MAX (max_tris, n_tris);
+                        itype = type;
                         SCE_free (indices);
-                        if (!(indices = SCE_malloc(max_tris*3*sizeof *indices)))
+                        if (!(indices = SCE_malloc (max_tris * 3 *
+                                                    SCE_Type_Sizeof (itype))))
                             goto failure;
                     }
                 } else if (sscanf (buff, " numweights %d", &n_weights) == 1) {
@@ -145,9 +151,9 @@ void* SCE_idTechMD5_LoadMesh (FILE *fp, const char *fname, void *unused)
                 } else if (sscanf (buff, " tri %d %d %d %d", &tri_index,
                                    &idata[0], &idata[1], &idata[2]) == 4) {
                     /* copy triangle data */
-                    indices[tri_index * 3 + 0] = idata[0];
-                    indices[tri_index * 3 + 1] = idata[1];
-                    indices[tri_index * 3 + 2] = idata[2];
+                    for (i = 0; i < 3; i++)
+                        SCE_Geometry_SetIndex (itype, indices,
+                                               tri_index * 3 + i, idata[i]);
                 } else if (sscanf (buff, " weight %d %d %f ( %f %f %f )",
                                    &w_index, &idata[0], &fdata[3],
                                    &fdata[0], &fdata[1], &fdata[2]) == 6) {
@@ -166,7 +172,7 @@ void* SCE_idTechMD5_LoadMesh (FILE *fp, const char *fname, void *unused)
         }
     }
 
-    SCE_AnimGeom_SetIndices (ageom, n_tris * 3, indices, SCE_TRUE);
+    SCE_AnimGeom_SetIndices (ageom, itype, n_tris * 3, indices, SCE_TRUE);
 
     SCE_Skeleton_ComputeMatrices (baseskel, 0);
     SCE_AnimGeom_SetBaseSkeleton (ageom, baseskel, SCE_TRUE);
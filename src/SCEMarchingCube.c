@@ -22,6 +22,8 @@
 #include <SCE/utils/SCEUtils.h>
 #include "SCE/core/SCEGeometry.h"
 #include "SCE/core/SCEGrid.h"
+#include "SCE/core/SCEVoxelGrid.h"
+#include "SCE/core/SCEThreadPool.h"
 
 #include "SCE/core/SCEMarchingCube.h"
 
@@ -324,11 +326,18 @@ void SCE_MC_Init (SCE_SMCGenerator *mc)
 
     mc->last_x = mc->last_y = mc->last_z = 0;
     mc->finished = SCE_TRUE;
+
+    mc->slices = NULL;
+    mc->slices_size = 0;
+
+    mc->itype = SCE_INDICES_TYPE;
+    mc->summary = NULL;
 }
 void SCE_MC_Clear (SCE_SMCGenerator *mc)
 {
     SCE_free (mc->cells);
     SCE_free (mc->cell_indices);
+    SCE_free (mc->slices);
 }
 
 /* you definetely need to call SCE_MC_Build() after that */
@@ -366,6 +375,56 @@ int SCE_MC_Build (SCE_SMCGenerator *mc)
     return SCE_OK;
 }
 
+/**
+ * \brief Sets the type of the indices generated by SCE_MC_GenerateIndices()
+ * \param mc a mc generator
+ * \param type SCE_INDICES_TYPE (the default) or SCE_INDICES32_TYPE
+ */
+void SCE_MC_SetIndicesType (SCE_SMCGenerator *mc, SCE_EType type)
+{
+    mc->itype = type;
+}
+SCE_EType SCE_MC_GetIndicesType (const SCE_SMCGenerator *mc)
+{
+    return mc->itype;
+}
+
+/**
+ * \brief Sets the min/max summary of the grids given to a generator
+ * \param mc a mc generator
+ * \param vg voxel grid whose voxels are the points of the grids given to
+ * \p mc, with a summary (see SCE_VGrid_AllocBricks()), NULL to disable
+ *
+ * SCE_MC_Count(), SCE_MC_GenerateParallel() and SCE_MC_GenerateArrays()
+ * skip the regions that the summary of \p vg tells empty or full without
+ * reading their points. \p vg must not be modified during a generation.
+ */
+void SCE_MC_SetSummary (SCE_SMCGenerator *mc, const SCE_SVoxelGrid *vg)
+{
+    mc->summary = vg;
+}
+
+/* tells from the summary whether no cell of the region of mc can be
+   crossed by the surface */
+static int SCE_MC_IsUniform (const SCE_SMCGenerator *mc)
+{
+    SCE_SLongRect3 r;
+    SCEubyte min, max;
+
+    if (!mc->summary || !SCE_VGrid_HasBricks (mc->summary))
+        return SCE_FALSE;
+    /* the cells read the points up to x + w included */
+    if (mc->x + mc->w + 1 > SCE_VGrid_GetWidth (mc->summary) ||
+        mc->y + mc->h + 1 > SCE_VGrid_GetHeight (mc->summary) ||
+        mc->z + mc->d + 1 > SCE_VGrid_GetDepth (mc->summary))
+        return SCE_FALSE;
+    SCE_Rectangle3_Setl (&r, mc->x, mc->y, mc->z, mc->x + mc->w + 1,
+                         mc->y + mc->h + 1, mc->z + mc->d + 1);
+    if (!SCE_VGrid_GetRange (mc->summary, &r, &min, &max))
+        return SCE_FALSE;
+    return max < 128 || min >= 128;
+}
+
 
 /*
  *  4________4________5
@@ -462,83 +521,242 @@ static size_t SCE_MC_MakeCellVertices (SCE_SMCCell *cell, SCEubyte corners[8],
 
     return n;
 }
+static void SCE_MC_SetRegion (SCE_SMCGenerator *mc, const SCE_SIntRect3 *region)
+{
+    int p1[3], p2[3];
 
-/**
- * \brief Generates vertices according to the marching cube algorithm
- * \param mc a mc generator
- * \param region a region
- * \param grid voxel grid
- * \param vertices output vertices
- *
- * Make sure to leave additionnal slices in grid filled with 0
- * to properly generate vertices in the borders, otherwise unused vertices
- * will be generated.
- *
- * \return the number of vertices generated
- * \sa SCE_MC_GenerateVerticesRange()
- */
-size_t SCE_MC_GenerateVertices (SCE_SMCGenerator *mc,
-                                const SCE_SIntRect3 *region,
-                                const SCE_SGrid *grid, SCEvertices *vertices)
+    mc->w = SCE_Rectangle3_GetWidth (region);
+    mc->h = SCE_Rectangle3_GetHeight (region);
+    mc->d = SCE_Rectangle3_GetDepth (region);
+    SCE_Rectangle3_GetPointsv (region, p1, p2);
+    mc->x = p1[0];
+    mc->y = p1[1];
+    mc->z = p1[2];
+}
+
+/* the fused generator keeps 4 padded z-slices of the grid: planes z - 1 to
+   z + 2 around the current slice of cells, with one voxel of padding before
+   the region and two after it along x and y, as required by the normals */
+#define SCE_MC_SLICE_PAD 3
+#define SCE_MC_NUM_SLICES 4
+
+static int SCE_MC_AllocSlices (SCE_SMCGenerator *mc)
 {
-    return SCE_MC_GenerateVerticesRange (mc, region, grid, vertices, 0);
+    size_t size = SCE_MC_NUM_SLICES * (mc->w + SCE_MC_SLICE_PAD) *
+        (mc->h + SCE_MC_SLICE_PAD);
+
+    if (size > mc->slices_size) {
+        SCE_free (mc->slices);
+        mc->slices_size = 0;
+        if (!(mc->slices = SCE_malloc (size))) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+        mc->slices_size = size;
+    }
+    return SCE_OK;
 }
 
-/**
- * \brief Generates vertices according to the marching cube algorithm
- * \param mc a mc generator
- * \param region a region
- * \param grid voxel grid
- * \param vertices output vertices
- * \param num number of cells to process
- *
- * Make sure to leave additionnal slices in grid filled with 0
- * to properly generate vertices in the borders, otherwise unused vertices
- * will be generated.
- *
- * \return the number of vertices generated
- * \sa SCE_MC_GenerateVertices()
- */
-size_t SCE_MC_GenerateVerticesRange (SCE_SMCGenerator *mc,
-                                     const SCE_SIntRect3 *region,
-                                     const SCE_SGrid *grid,
-                                     SCEvertices *vertices, size_t num)
+static void SCE_MC_FetchRow (const SCE_SGrid *grid, int x, int y, int z,
+                             SCEuint n, SCEubyte *dst)
+{
+    const SCEubyte *src = grid->data;
+    SCEuint i;
+    int inside;
+
+    /* rows inside a non-wrapping grid are copied directly, everything
+       else goes through the wrapping rules of SCE_Grid_GetPoint() */
+    inside = !grid->wrap_x && !grid->wrap_y && !grid->wrap_z &&
+        y >= 0 && y < grid->height && z >= 0 && z < grid->depth;
+
+    for (i = 0; i < n; i++) {
+        int x_ = x + i;
+        if (inside && x_ >= 0 && x_ < grid->width) {
+            SCEuint end = MIN (x + (int)n, grid->width) - x;
+            memcpy (&dst[i], &src[grid->width * (grid->height * z + y) + x_],
+                    end - i);
+            i = end - 1;
+        } else
+            SCE_Grid_GetPoint (grid, x_, y, z, &dst[i]);
+    }
+}
+
+static void SCE_MC_FetchSlice (const SCE_SGrid *grid, int x, int y, int z,
+                               SCEuint pw, SCEuint ph, SCEubyte *dst)
+{
+    SCEuint j;
+    for (j = 0; j < ph; j++)
+        SCE_MC_FetchRow (grid, x, y + j, z, pw, &dst[j * pw]);
+}
+
+/* sign bits of the corners (x, y, z), (x, y + 1, z), (x, y, z + 1) and
+   (x, y + 1, z + 1) of a slice, shifted as the corners 2, 1, 6 and 5 */
+#define SCE_MC_SliceBits(s1, s2, o, pw)                                \
+    ((((s1)[o] & 0x80) >> 5) | (((s1)[(o) + (pw)] & 0x80) >> 6) |      \
+     (((s2)[o] & 0x80) >> 1) | (((s2)[(o) + (pw)] & 0x80) >> 2))
+
+static void SCE_MC_SliceNormal (const SCEubyte *prev, const SCEubyte *cur,
+                                const SCEubyte *next, size_t o, size_t pw,
+                                SCE_TVector3 normal)
+{
+    normal[0] = (float)cur[o - 1] - (float)cur[o + 1];
+    normal[1] = (float)cur[o - pw] - (float)cur[o + pw];
+    normal[2] = (float)prev[o] - (float)next[o];
+    SCE_Vector3_Normalize (normal);
+}
+
+/* same as SCE_MC_MakeCellNormals() but from the slices */
+static void SCE_MC_MakeSliceNormals (SCEuint conf, SCEubyte corners[8],
+                                     SCEubyte *s[SCE_MC_NUM_SLICES],
+                                     size_t o, size_t pw, SCEvertices *normals)
+{
+    SCEuint corner3;
+    SCE_TVector3 normal0, normal1;
+
+    SCE_MC_SliceNormal (s[0], s[1], s[2], o, pw, normal0);
+
+    corner3 = (conf >> 3) & 1;
+
+    /* corners 3 and 0 */
+    if (corner3 != (conf & 1)) {
+        SCE_MC_SliceNormal (s[0], s[1], s[2], o + pw, pw, normal1);
+        SCE_MC_Interp (normals, corners[3], corners[0], normal0, normal1);
+        SCE_Vector3_Normalize (normals);
+        normals = &normals[3];
+    }
+    /* corners 3 and 2 */
+    if (corner3 != ((conf >> 2) & 1)) {
+        SCE_MC_SliceNormal (s[0], s[1], s[2], o + 1, pw, normal1);
+        SCE_MC_Interp (normals, corners[3], corners[2], normal0, normal1);
+        SCE_Vector3_Normalize (normals);
+        normals = &normals[3];
+    }
+    /* corners 3 and 7 */
+    if (corner3 != ((conf >> 7) & 1)) {
+        SCE_MC_SliceNormal (s[1], s[2], s[3], o, pw, normal1);
+        SCE_MC_Interp (normals, corners[3], corners[7], normal0, normal1);
+        SCE_Vector3_Normalize (normals);
+        normals = &normals[3];
+    }
+}
+
+/* fast path for grids of bytes: each voxel is fetched once into the slices,
+   case indices are updated incrementally along x */
+static int SCE_MC_GenerateFused (SCE_SMCGenerator *mc, const SCE_SGrid *grid,
+                                 SCEvertices *vertices, SCEvertices *normals,
+                                 size_t num)
 {
     SCE_SMCCell *cell = NULL;
-    SCEuint x, y, z, x_, y_, z_, w, h, d;
+    SCEuint x, y, z, w, h, d, i, conf;
+    size_t pw, ph, slice, n;
     float a, b, c;
     SCEubyte corners[8];
-    size_t n;
-    int p1[3], p2[3];
+    SCEubyte *s[SCE_MC_NUM_SLICES];
 
-    w = mc->w = SCE_Rectangle3_GetWidth (region);
-    h = mc->h = SCE_Rectangle3_GetHeight (region);
-    d = mc->d = SCE_Rectangle3_GetDepth (region);
+    w = mc->w; h = mc->h; d = mc->d;
+    pw = w + SCE_MC_SLICE_PAD;
+    ph = h + SCE_MC_SLICE_PAD;
+    slice = pw * ph;
     a = 1.0 / SCE_Grid_GetWidth (grid);
     b = 1.0 / SCE_Grid_GetHeight (grid);
     c = 1.0 / SCE_Grid_GetDepth (grid);
 
-    SCE_Rectangle3_GetPointsv (region, p1, p2);
-    /* memorize the origin for generatenormals() below */
-    mc->x = p1[0];
-    mc->y = p1[1];
-    mc->z = p1[2];
+    /* plane z + k - 1 is stored in slice (z + k) % 4; (re)load the planes
+       around the current slice of cells, we may be resuming */
+    z = mc->last_z;
+    mc->last_z = 0;
+    if (z < d) {
+        for (i = 0; i < SCE_MC_NUM_SLICES; i++)
+            SCE_MC_FetchSlice (grid, (int)mc->x - 1, (int)mc->y - 1,
+                               (int)(mc->z + z + i) - 1, pw, ph, &mc->slices[((z + i) & 3) * slice]);
+    }
 
-    /* ignore num if null */
-    if (num == 0)
-        num = 2 * SCE_Grid_GetNumPoints (grid); /* times two, because. */
+    for (; z < d; z++) {
+        for (i = 0; i < SCE_MC_NUM_SLICES; i++)
+            s[i] = &mc->slices[((z + i) & 3) * slice];
 
-    mc->finished = SCE_FALSE;
+        y = mc->last_y;
+        mc->last_y = 0;
+        for (; y < h; y++) {
+            size_t o;
+
+            x = mc->last_x;
+            mc->last_x = 0;
+            o = (y + 1) * pw + x + 1;
+            conf = SCE_MC_SliceBits (s[1], s[2], o, pw);
+
+            for (; x < w; x++, o++) {
+                size_t offset = w * (z * h + y) + x;
+
+                if (num == 0) {
+                    /* save up and quit */
+                    mc->last_x = x;
+                    mc->last_y = y;
+                    mc->last_z = z;
+                    return SCE_FALSE;
+                }
+                num--;
+
+                /* corners 2, 1, 6, 5 become 3, 0, 7, 4 */
+                conf = ((conf & 0x44) << 1) | ((conf & 0x22) >> 1);
+                conf |= SCE_MC_SliceBits (s[1], s[2], o + 1, pw);
+
+                cell = &mc->cells[offset];
+                cell->x = x;
+                cell->y = y;
+                cell->z = z;
+                cell->conf = conf;
+
+                if (conf != 0 && conf != 255) {
+                    corners[3] = s[1][o];
+                    corners[2] = s[1][o + 1];
+                    corners[0] = s[1][o + pw];
+                    corners[7] = s[2][o];
+                    n = SCE_MC_MakeCellVertices (cell, corners, mc->n_vertices,
+                                                 vertices, a, b, c);
+                    if (normals)
+                        SCE_MC_MakeSliceNormals (conf, corners, s, o, pw,
+                                                 &normals[mc->n_vertices * 3]);
+                    mc->n_vertices += n;
+                    mc->cell_indices[mc->n_indices] = offset;
+                    mc->n_indices++;
+                }
+            }
+        }
+
+        /* slide: the oldest plane is replaced by plane z + 3 */
+        if (z + 1 < d)
+            SCE_MC_FetchSlice (grid, (int)mc->x - 1, (int)mc->y - 1,
+                               mc->z + z + 3, pw, ph, s[0]);
+    }
+
+    return SCE_TRUE;
+}
+
+static int SCE_MC_GenerateGeneric (SCE_SMCGenerator *mc,
+                                   const SCE_SGrid *grid,
+                                   SCEvertices *vertices, size_t num)
+{
+    SCE_SMCCell *cell = NULL;
+    SCEuint x, y, z, x_, y_, z_, w, h, d;
+    float a, b, c;
+    SCEubyte corners[8];
+    size_t n;
+
+    w = mc->w; h = mc->h; d = mc->d;
+    a = 1.0 / SCE_Grid_GetWidth (grid);
+    b = 1.0 / SCE_Grid_GetHeight (grid);
+    c = 1.0 / SCE_Grid_GetDepth (grid);
 
     z = mc->last_z;
     mc->last_z = 0;
-    for (z_ = p1[2] + z; z < d; z++, z_++) {
+    for (z_ = mc->z + z; z < d; z++, z_++) {
         y = mc->last_y;
         mc->last_y = 0;
-        for (y_ = p1[1] + y; y < h; y++, y_++) {
+        for (y_ = mc->y + y; y < h; y++, y_++) {
             x = mc->last_x;
             mc->last_x = 0;
-            for (x_ = p1[0] + x; x < w; x++, x_++) {
+            for (x_ = mc->x + x; x < w; x++, x_++) {
                 size_t offset = w * (z * h + y) + x;
 
                 if (num == 0) {
@@ -546,7 +764,7 @@ size_t SCE_MC_GenerateVerticesRange (SCE_SMCGenerator *mc,
                     mc->last_x = x;
                     mc->last_y = y;
                     mc->last_z = z;
-                    return 0;
+                    return SCE_FALSE;
                 }
                 num--;
 
@@ -577,6 +795,103 @@ size_t SCE_MC_GenerateVerticesRange (SCE_SMCGenerator *mc,
         }
     }
 
+    return SCE_TRUE;
+}
+
+/**
+ * \brief Generates vertices according to the marching cube algorithm
+ * \param mc a mc generator
+ * \param region a region
+ * \param grid voxel grid
+ * \param vertices output vertices
+ *
+ * Make sure to leave additionnal slices in grid filled with 0
+ * to properly generate vertices in the borders, otherwise unused vertices
+ * will be generated.
+ *
+ * \return the number of vertices generated
+ * \sa SCE_MC_GenerateVerticesRange()
+ */
+size_t SCE_MC_GenerateVertices (SCE_SMCGenerator *mc,
+                                const SCE_SIntRect3 *region,
+                                const SCE_SGrid *grid, SCEvertices *vertices)
+{
+    return SCE_MC_GenerateVerticesRange (mc, region, grid, vertices, 0);
+}
+
+/**
+ * \brief Generates vertices according to the marching cube algorithm
+ * \param mc a mc generator
+ * \param region a region
+ * \param grid voxel grid
+ * \param vertices output vertices
+ * \param num number of cells to process
+ *
+ * Make sure to leave additionnal slices in grid filled with 0
+ * to properly generate vertices in the borders, otherwise unused vertices
+ * will be generated.
+ *
+ * \return the number of vertices generated
+ * \sa SCE_MC_GenerateVertices(), SCE_MC_GenerateVerticesNormalsRange()
+ */
+size_t SCE_MC_GenerateVerticesRange (SCE_SMCGenerator *mc,
+                                     const SCE_SIntRect3 *region,
+                                     const SCE_SGrid *grid,
+                                     SCEvertices *vertices, size_t num)
+{
+    return SCE_MC_GenerateVerticesNormalsRange (mc, region, grid, vertices,
+                                                NULL, num);
+}
+
+/**
+ * \brief Generates vertices and normals according to the marching cube
+ * algorithm
+ * \param mc a mc generator
+ * \param region a region
+ * \param grid voxel grid
+ * \param vertices output vertices
+ * \param normals output normals, can be NULL
+ * \param num number of cells to process, 0 means all of them
+ *
+ * Grids of 1 byte points are read only once, through a rolling buffer of
+ * z-slices, and the normals are generated in the same pass. Other grids
+ * fall back to SCE_MC_GenerateNormals() once all the cells are processed.
+ * \p normals is indexed like \p vertices, so when generating in several
+ * calls the same arrays must be given each time.
+ *
+ * \return the number of vertices generated
+ * \sa SCE_MC_GenerateVerticesRange(), SCE_MC_GenerateNormals()
+ */
+size_t SCE_MC_GenerateVerticesNormalsRange (SCE_SMCGenerator *mc,
+                                            const SCE_SIntRect3 *region,
+                                            const SCE_SGrid *grid,
+                                            SCEvertices *vertices,
+                                            SCEvertices *normals, size_t num)
+{
+    size_t n;
+    int done;
+
+    /* memorize the origin for generatenormals() below */
+    SCE_MC_SetRegion (mc, region);
+
+    /* ignore num if null */
+    if (num == 0)
+        num = 2 * SCE_Grid_GetNumPoints (grid); /* times two, because. */
+
+    mc->finished = SCE_FALSE;
+
+    /* if the slices cannot be allocated, the slow path still works */
+    if (SCE_Grid_GetPointSize (grid) == 1 && SCE_MC_AllocSlices (mc) == SCE_OK)
+        done = SCE_MC_GenerateFused (mc, grid, vertices, normals, num);
+    else {
+        done = SCE_MC_GenerateGeneric (mc, grid, vertices, num);
+        if (done && normals)
+            SCE_MC_GenerateNormals (mc, grid, normals);
+    }
+
+    if (!done)
+        return 0;
+
     mc->last_x = mc->last_y = mc->last_z = 0;
     mc->finished = SCE_TRUE;
     n = mc->n_vertices;
@@ -662,8 +977,8 @@ void SCE_MC_GenerateNormals (SCE_SMCGenerator *mc, const SCE_SGrid *grid,
         y = cell->y + mc->y;
         z = cell->z + mc->z;
 
-        /* NOTE: grid fetch overhead: vertices and normal generation could
-                 be merged */
+        /* NOTE: grid fetch overhead, for grids of bytes prefer
+                 SCE_MC_GenerateVerticesNormalsRange() */
         SCE_Grid_GetPoint (grid, x,     y,     z,     &corners[3]);
         SCE_Grid_GetPoint (grid, x + 1, y,     z,     &corners[2]);
         SCE_Grid_GetPoint (grid, x,     y + 1, z,     &corners[0]);
@@ -683,8 +998,10 @@ static SCE_SMCCell* fetch_cell (const SCE_SMCGenerator *mc, SCEuint x,
     return &mc->cells[offset];
 }
 
+/* writes the indices of a cell from indices[first] */
 static size_t SCE_MC_MakeCellIndices (const SCE_SMCGenerator *mc,
-                                      SCE_SMCCell *cell, SCEindices *indices)
+                                      SCE_SMCCell *cell, SCE_EType itype,
+                                      void *indices, size_t first)
 {
     SCEuint i, n_tri;
     SCEuint edges[12];
@@ -714,13 +1031,21 @@ static size_t SCE_MC_MakeCellIndices (const SCE_SMCGenerator *mc,
     /* make triangles */
     n_tri = lt_num_tri[cell->conf];
 
-    for (i = 0; i < n_tri * 3; i++)
-        indices[i] = edges[lt_edges[cell->conf * 15 + i]];
+    if (itype == SCE_INDICES32_TYPE) {
+        SCEindices32 *out = &((SCEindices32*)indices)[first];
+        for (i = 0; i < n_tri * 3; i++)
+            out[i] = edges[lt_edges[cell->conf * 15 + i]];
+    } else {
+        SCEindices *out = &((SCEindices*)indices)[first];
+        for (i = 0; i < n_tri * 3; i++)
+            out[i] = edges[lt_edges[cell->conf * 15 + i]];
+    }
 
     return n_tri * 3;
 }
 
-size_t SCE_MC_GenerateIndices (SCE_SMCGenerator *mc, SCEindices *indices)
+static size_t SCE_MC_GenerateIndicesType (SCE_SMCGenerator *mc,
+                                          SCE_EType itype, void *indices)
 {
     SCE_SMCCell *cell = NULL;
     SCEuint i;
@@ -732,7 +1057,8 @@ size_t SCE_MC_GenerateIndices (SCE_SMCGenerator *mc, SCEindices *indices)
            we could have removed those cells at vertices generation,
            but we actually need them for normal generation */
         if (cell->x < mc->w - 1 && cell->y < mc->h - 1 && cell->z < mc->d - 1)
-            n_indices += SCE_MC_MakeCellIndices (mc, cell, &indices[n_indices]);
+            n_indices += SCE_MC_MakeCellIndices (mc, cell, itype, indices,
+                                                 n_indices);
     }
 
     /* kinda important for split generation */
@@ -740,3 +1066,1149 @@ size_t SCE_MC_GenerateIndices (SCE_SMCGenerator *mc, SCEindices *indices)
 
     return n_indices;
 }
+/**
+ * \brief Generates the indices of the cells generated so far
+ * \param mc a mc generator
+ * \param indices output indices, of the type given to
+ * SCE_MC_SetIndicesType()
+ * \return the number of indices generated
+ */
+size_t SCE_MC_GenerateIndices (SCE_SMCGenerator *mc, void *indices)
+{
+    return SCE_MC_GenerateIndicesType (mc, mc->itype, indices);
+}
+
+
+/* parallel generation: the region is split into slabs along z */
+typedef struct sce_smcslab SCE_SMCSlab;
+struct sce_smcslab {
+    SCE_SThreadPoolJob job;
+    SCE_SMCGenerator *mc;
+    const SCE_SGrid *grid;
+    SCEuint z1, z2;             /* cells of the slab */
+    SCEubyte *slices;
+    int pass;
+    size_t n_vertices, n_cells, n_indices;
+    size_t first_vertex, first_cell, first_index;
+    SCEvertices *vertices;
+    SCEvertices *normals;
+    SCE_EType itype;
+    void *indices;
+};
+
+#define SCE_MC_SLAB_COUNT 0
+#define SCE_MC_SLAB_VERTICES 1
+#define SCE_MC_SLAB_INDICES 2
+
+static void SCE_MC_FetchPlane (SCE_SMCSlab *slab, SCEuint z)
+{
+    SCE_SMCGenerator *mc = slab->mc;
+    size_t pw = mc->w + SCE_MC_SLICE_PAD, ph = mc->h + SCE_MC_SLICE_PAD;
+
+    /* plane z is stored in slice (z + 1) % 4, z may be -1 */
+    SCE_MC_FetchSlice (slab->grid, (int)mc->x - 1, (int)mc->y - 1,
+                       (int)(mc->z + z), pw, ph,
+                       &slab->slices[((z + 1) & 3) * pw * ph]);
+}
+
+/* edges crossed by the isosurface, as indexed by SCE_SMCCell::indices */
+static SCEuint SCE_MC_GetNumCellVertices (SCEuint conf)
+{
+    SCEuint corner3 = (conf >> 3) & 1;
+    return (corner3 != (conf & 1)) + (corner3 != ((conf >> 2) & 1)) +
+        (corner3 != ((conf >> 7) & 1));
+}
+
+static void SCE_MC_CountCell (const SCE_SMCGenerator *mc,
+                              const SCE_SMCCell *cell, SCE_SMCSlab *slab)
+{
+    if (cell->conf != 0 && cell->conf != 255) {
+        slab->n_cells++;
+        slab->n_vertices += SCE_MC_GetNumCellVertices (cell->conf);
+        if (cell->x < mc->w - 1 && cell->y < mc->h - 1 && cell->z < mc->d - 1)
+            slab->n_indices += 3 * lt_num_tri[cell->conf];
+    }
+}
+
+static void SCE_MC_CountSlab (SCE_SMCSlab *slab)
+{
+    SCE_SMCGenerator *mc = slab->mc;
+    SCE_SMCCell *cell = NULL;
+    SCEuint x, y, z, w = mc->w, h = mc->h, conf;
+    size_t pw = w + SCE_MC_SLICE_PAD, slice = pw * (h + SCE_MC_SLICE_PAD);
+    SCEubyte *s1, *s2;
+
+    slab->n_vertices = slab->n_cells = slab->n_indices = 0;
+
+    SCE_MC_FetchPlane (slab, slab->z1);
+    for (z = slab->z1; z < slab->z2; z++) {
+        SCE_MC_FetchPlane (slab, z + 1);
+        s1 = &slab->slices[((z + 1) & 3) * slice];
+        s2 = &slab->slices[((z + 2) & 3) * slice];
+
+        for (y = 0; y < h; y++) {
+            size_t o = (y + 1) * pw + 1;
+            cell = &mc->cells[w * (z * h + y)];
+            conf = SCE_MC_SliceBits (s1, s2, o, pw);
+
+            for (x = 0; x < w; x++, o++, cell++) {
+                conf = ((conf & 0x44) << 1) | ((conf & 0x22) >> 1);
+                conf |= SCE_MC_SliceBits (s1, s2, o + 1, pw);
+
+                cell->x = x;
+                cell->y = y;
+                cell->z = z;
+                cell->conf = conf;
+                SCE_MC_CountCell (mc, cell, slab);
+            }
+        }
+    }
+}
+
+static void SCE_MC_MakeSlabVertices (SCE_SMCSlab *slab)
+{
+    SCE_SMCGenerator *mc = slab->mc;
+    SCE_SMCCell *cell = NULL;
+    SCEuint x, y, z, i, w = mc->w, h = mc->h;
+    size_t pw = w + SCE_MC_SLICE_PAD, slice = pw * (h + SCE_MC_SLICE_PAD);
+    size_t n_vertices = slab->first_vertex, n_cells = slab->first_cell;
+    float a, b, c;
+    SCEubyte corners[8];
+    SCEubyte *s[SCE_MC_NUM_SLICES];
+
+    a = 1.0 / SCE_Grid_GetWidth (slab->grid);
+    b = 1.0 / SCE_Grid_GetHeight (slab->grid);
+    c = 1.0 / SCE_Grid_GetDepth (slab->grid);
+
+    for (i = 0; i < SCE_MC_NUM_SLICES; i++)
+        SCE_MC_FetchPlane (slab, slab->z1 + i - 1);
+
+    for (z = slab->z1; z < slab->z2; z++) {
+        for (i = 0; i < SCE_MC_NUM_SLICES; i++)
+            s[i] = &slab->slices[((z + i) & 3) * slice];
+
+        for (y = 0; y < h; y++) {
+            size_t o = (y + 1) * pw + 1;
+            size_t offset = w * (z * h + y);
+
+            for (x = 0; x < w; x++, o++, offset++) {
+                cell = &mc->cells[offset];
+                if (cell->conf != 0 && cell->conf != 255) {
+                    corners[3] = s[1][o];
+                    corners[2] = s[1][o + 1];
+                    corners[0] = s[1][o + pw];
+                    corners[7] = s[2][o];
+                    if (slab->normals)
+                        SCE_MC_MakeSliceNormals (cell->conf, corners, s, o, pw,
+                                                 &slab->normals[n_vertices*3]);
+                    n_vertices += SCE_MC_MakeCellVertices (cell, corners,
+                                                           n_vertices,
+                                                           slab->vertices,
+                                                           a, b, c);
+                    mc->cell_indices[n_cells++] = offset;
+                }
+            }
+        }
+
+        if (z + 1 < slab->z2)
+            SCE_MC_FetchPlane (slab, z + 3);
+    }
+}
+
+static void SCE_MC_MakeSlabIndices (SCE_SMCSlab *slab)
+{
+    SCE_SMCGenerator *mc = slab->mc;
+    SCE_SMCCell *cell = NULL;
+    size_t i, n_indices = slab->first_index;
+
+    for (i = 0; i < slab->n_cells; i++) {
+        cell = &mc->cells[mc->cell_indices[slab->first_cell + i]];
+        if (cell->x < mc->w - 1 && cell->y < mc->h - 1 && cell->z < mc->d - 1)
+            n_indices += SCE_MC_MakeCellIndices (mc, cell, slab->itype,
+                                                 slab->indices, n_indices);
+    }
+}
+
+static void SCE_MC_RunSlab (void *data)
+{
+    SCE_SMCSlab *slab = data;
+    switch (slab->pass) {
+    case SCE_MC_SLAB_COUNT: SCE_MC_CountSlab (slab); break;
+    case SCE_MC_SLAB_VERTICES: SCE_MC_MakeSlabVertices (slab); break;
+    case SCE_MC_SLAB_INDICES: SCE_MC_MakeSlabIndices (slab);
+    }
+}
+
+static void SCE_MC_RunSlabs (SCE_SThreadPool *pool, SCE_SMCSlab *slabs,
+                             size_t n_slabs, int pass)
+{
+    size_t i;
+
+    for (i = 0; i < n_slabs; i++) {
+        slabs[i].pass = pass;
+        SCE_TPool_Push (pool, &slabs[i].job);
+    }
+    /* slabs of a pass depend on the cells of the previous one */
+    for (i = 0; i < n_slabs; i++)
+        SCE_TPool_WaitJob (pool, &slabs[i].job);
+}
+
+static void SCE_MC_CountGeneric (SCE_SMCGenerator *mc, const SCE_SGrid *grid,
+                                 SCE_SMCSlab *slab)
+{
+    SCE_SMCCell *cell = mc->cells;
+    SCEuint x, y, z;
+    int x_, y_, z_;
+    SCEubyte corners[8];
+
+    slab->n_vertices = slab->n_cells = slab->n_indices = 0;
+
+    for (z = 0; z < mc->d; z++) {
+        z_ = mc->z + z;
+        for (y = 0; y < mc->h; y++) {
+            y_ = mc->y + y;
+            for (x = 0; x < mc->w; x++, cell++) {
+                x_ = mc->x + x;
+                SCE_Grid_GetPoint (grid, x_,     y_,     z_,     &corners[3]);
+                SCE_Grid_GetPoint (grid, x_ + 1, y_,     z_,     &corners[2]);
+                SCE_Grid_GetPoint (grid, x_,     y_ + 1, z_,     &corners[0]);
+                SCE_Grid_GetPoint (grid, x_ + 1, y_ + 1, z_,     &corners[1]);
+                SCE_Grid_GetPoint (grid, x_,     y_,     z_ + 1, &corners[7]);
+                SCE_Grid_GetPoint (grid, x_ + 1, y_,     z_ + 1, &corners[6]);
+                SCE_Grid_GetPoint (grid, x_,     y_ + 1, z_ + 1, &corners[4]);
+                SCE_Grid_GetPoint (grid, x_ + 1, y_ + 1, z_ + 1, &corners[5]);
+                cell->x = x;
+                cell->y = y;
+                cell->z = z;
+                cell->conf = SCE_MC_GetConfig (corners);
+                SCE_MC_CountCell (mc, cell, slab);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Counts the vertices and indices of a region
+ * \param mc a mc generator
+ * \param region a region
+ * \param grid voxel grid
+ * \param n_vertices number of vertices SCE_MC_GenerateVertices() would
+ * generate
+ * \param n_indices number of indices SCE_MC_GenerateIndices() would generate
+ *
+ * Only the case tables are used, no vertex is computed.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MC_GenerateArrays()
+ */
+int SCE_MC_Count (SCE_SMCGenerator *mc, const SCE_SIntRect3 *region,
+                  const SCE_SGrid *grid, size_t *n_vertices, size_t *n_indices)
+{
+    SCE_SMCSlab slab;
+
+    SCE_MC_SetRegion (mc, region);
+    if (SCE_MC_IsUniform (mc)) {
+        *n_vertices = *n_indices = 0;
+        return SCE_OK;
+    }
+    slab.mc = mc;
+    slab.grid = grid;
+    slab.z1 = 0;
+    slab.z2 = mc->d;
+
+    if (SCE_Grid_GetPointSize (grid) != 1)
+        SCE_MC_CountGeneric (mc, grid, &slab);
+    else {
+        if (SCE_MC_AllocSlices (mc) < 0) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+        slab.slices = mc->slices;
+        SCE_MC_CountSlab (&slab);
+    }
+
+    *n_vertices = slab.n_vertices;
+    *n_indices = slab.n_indices;
+    return SCE_OK;
+}
+
+/* sizes the arrays for the given counts, indices are widened to 32 bits if
+   there are too many vertices for itype */
+static int SCE_MC_AllocArrays (SCE_SGeometryArray *pos,
+                               SCE_SGeometryArray *nor,
+                               SCE_SGeometryArray *idx,
+                               size_t n_vertices, size_t n_indices,
+                               SCEvertices **vertices, SCEvertices **normals,
+                               SCE_EType *itype, void **indices)
+{
+    if (SCE_Geometry_GetIndicesTypeFor (n_vertices) == SCE_INDICES32_TYPE)
+        *itype = SCE_INDICES32_TYPE;
+
+    /* never allocate 0 bytes */
+    n_vertices = MAX (n_vertices, 1);
+    n_indices = MAX (n_indices, 1);
+
+    if (!(*vertices = SCE_Geometry_AllocArrayData (pos, 3 * n_vertices *
+                                                   sizeof **vertices)))
+        goto fail;
+    SCE_Geometry_SetArrayPosition (pos, 0, 3, *vertices, SCE_TRUE);
+    *normals = NULL;
+    if (nor) {
+        if (!(*normals = SCE_Geometry_AllocArrayData (nor, 3 * n_vertices *
+                                                      sizeof **normals)))
+            goto fail;
+        SCE_Geometry_SetArrayNormal (nor, 0, *normals, SCE_TRUE);
+    }
+    if (!(*indices = SCE_Geometry_AllocArrayData (idx, n_indices *
+                                                  SCE_Type_Sizeof (*itype))))
+        goto fail;
+    SCE_Geometry_SetArrayIndices (idx, *itype, *indices, SCE_TRUE);
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/* arrays, if not NULL, are sized once the cells are counted and override
+   vertices, normals and indices */
+static int SCE_MC_GenerateSlabs (SCE_SMCGenerator *mc,
+                                 const SCE_SIntRect3 *region,
+                                 const SCE_SGrid *grid, SCE_SThreadPool *pool,
+                                 SCEvertices *vertices, SCEvertices *normals,
+                                 void *indices,
+                                 SCE_SGeometryArray *arrays[3],
+                                 size_t *n_vertices, size_t *n_indices)
+{
+    SCE_SMCSlab *slabs = NULL;
+    SCEubyte *slices = NULL;
+    size_t i, n_slabs, slices_size;
+    size_t first_vertex = 0, first_cell = 0, first_index = 0;
+    SCE_EType itype = mc->itype;
+
+    if (!pool)
+        pool = SCE_TPool_GetDefault ();
+
+    SCE_MC_SetRegion (mc, region);
+    mc->last_x = mc->last_y = mc->last_z = 0;
+    mc->n_vertices = mc->n_indices = 0;
+    *n_vertices = *n_indices = 0;
+
+    if (SCE_MC_IsUniform (mc)) {
+        /* no surface, the arrays are only resized */
+        if (arrays && SCE_MC_AllocArrays (arrays[0], arrays[1], arrays[2],
+                                          0, 0, &vertices, &normals, &itype,
+                                          &indices) < 0)
+            goto fail;
+        mc->finished = SCE_TRUE;
+        return SCE_OK;
+    }
+
+    /* a few slabs per thread to balance the load */
+    n_slabs = 1;
+    if (SCE_TPool_IsRunning (pool))
+        n_slabs = MIN (mc->d, 2 * SCE_TPool_GetNumThreads (pool));
+    n_slabs = MAX (n_slabs, 1);
+    slices_size = SCE_MC_NUM_SLICES * (mc->w + SCE_MC_SLICE_PAD) *
+        (mc->h + SCE_MC_SLICE_PAD);
+
+    if (!(slabs = SCE_malloc (n_slabs * sizeof *slabs)))
+        goto fail;
+    if (!(slices = SCE_malloc (n_slabs * slices_size)))
+        goto fail;
+
+    for (i = 0; i < n_slabs; i++) {
+        SCE_SMCSlab *slab = &slabs[i];
+        SCE_TPool_InitJob (&slab->job);
+        SCE_TPool_SetJobFunc (&slab->job, SCE_MC_RunSlab);
+        SCE_TPool_SetJobData (&slab->job, slab);
+        slab->mc = mc;
+        slab->grid = grid;
+        slab->z1 = i * mc->d / n_slabs;
+        slab->z2 = (i + 1) * mc->d / n_slabs;
+        slab->slices = &slices[i * slices_size];
+    }
+
+    SCE_MC_RunSlabs (pool, slabs, n_slabs, SCE_MC_SLAB_COUNT);
+    for (i = 0; i < n_slabs; i++) {
+        slabs[i].first_vertex = first_vertex;
+        slabs[i].first_cell = first_cell;
+        slabs[i].first_index = first_index;
+        first_vertex += slabs[i].n_vertices;
+        first_cell += slabs[i].n_cells;
+        first_index += slabs[i].n_indices;
+    }
+
+    if (arrays && SCE_MC_AllocArrays (arrays[0], arrays[1], arrays[2],
+                                      first_vertex, first_index, &vertices,
+                                      &normals, &itype, &indices) < 0)
+        goto fail;
+
+    for (i = 0; i < n_slabs; i++) {
+        slabs[i].vertices = vertices;
+        slabs[i].normals = normals;
+        slabs[i].itype = itype;
+        slabs[i].indices = indices;
+    }
+    SCE_MC_RunSlabs (pool, slabs, n_slabs, SCE_MC_SLAB_VERTICES);
+    SCE_MC_RunSlabs (pool, slabs, n_slabs, SCE_MC_SLAB_INDICES);
+
+    SCE_free (slices);
+    SCE_free (slabs);
+
+    /* mc->n_indices counts the entries of cell_indices, keep them so that
+       SCE_MC_GenerateNormals() can walk the generated cells */
+    mc->n_vertices = first_vertex;
+    mc->n_indices = first_cell;
+    mc->finished = SCE_TRUE;
+    *n_vertices = first_vertex;
+    *n_indices = first_index;
+
+    return SCE_OK;
+fail:
+    SCE_free (slices);
+    SCE_free (slabs);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/**
+ * \brief Generates vertices, normals and indices using several threads
+ * \param mc a mc generator
+ * \param region a region
+ * \param grid voxel grid, of 1 byte points
+ * \param pool thread pool to use, if NULL SCE_TPool_GetDefault() is used
+ * \param vertices output vertices
+ * \param normals output normals, can be NULL
+ * \param indices output indices, of the type given to SCE_MC_SetIndicesType()
+ * \param n_vertices number of vertices generated
+ * \param n_indices number of indices generated
+ *
+ * The region is split into slabs along z. The cells of each slab are first
+ * counted, then vertices and indices are written at offsets given by a
+ * prefix sum over the slabs. The output is the same as the one of
+ * SCE_MC_GenerateVerticesNormalsRange() followed by
+ * SCE_MC_GenerateIndices(), which are used if \p grid does not have
+ * 1 byte points. Do not call this function from a job of \p pool.
+ *
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MC_GenerateArrays()
+ */
+int SCE_MC_GenerateParallel (SCE_SMCGenerator *mc,
+                             const SCE_SIntRect3 *region,
+                             const SCE_SGrid *grid, SCE_SThreadPool *pool,
+                             SCEvertices *vertices, SCEvertices *normals,
+                             void *indices, size_t *n_vertices,
+                             size_t *n_indices)
+{
+    if (SCE_Grid_GetPointSize (grid) != 1) {
+        *n_vertices = SCE_MC_GenerateVerticesNormalsRange (mc, region, grid,
+                                                           vertices, normals,
+                                                           0);
+        *n_indices = SCE_MC_GenerateIndices (mc, indices);
+        return SCE_OK;
+    }
+    if (SCE_MC_GenerateSlabs (mc, region, grid, pool, vertices, normals,
+                              indices, NULL, n_vertices, n_indices) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
+
+/**
+ * \brief Generates a region into geometry arrays of the exact size
+ * \param mc a mc generator
+ * \param region a region
+ * \param grid voxel grid
+ * \param pool thread pool to use, if NULL SCE_TPool_GetDefault() is used
+ * \param pos array receiving the positions
+ * \param nor array receiving the normals, can be NULL
+ * \param idx array receiving the indices
+ * \param n_vertices number of vertices generated
+ * \param n_indices number of indices generated
+ *
+ * The cells are counted first, then the data of the arrays is replaced by
+ * buffers of the exact size (see SCE_Geometry_AllocArrayData()) and
+ * filled, no worst case buffer is ever allocated. The indices are of the
+ * type of \p mc, widened to SCE_INDICES32_TYPE if there are more vertices
+ * than it can address. Grids of 1 byte points
+ * are processed as in SCE_MC_GenerateParallel().
+ *
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MC_Count(), SCE_MC_GenerateParallel()
+ */
+int SCE_MC_GenerateArrays (SCE_SMCGenerator *mc, const SCE_SIntRect3 *region,
+                           const SCE_SGrid *grid, SCE_SThreadPool *pool,
+                           SCE_SGeometryArray *pos, SCE_SGeometryArray *nor,
+                           SCE_SGeometryArray *idx, size_t *n_vertices,
+                           size_t *n_indices)
+{
+    SCE_SGeometryArray *arrays[3];
+    SCEvertices *vertices = NULL, *normals = NULL;
+    void *indices = NULL;
+    SCE_EType itype = mc->itype;
+    size_t n_v, n_i;
+
+    if (SCE_Grid_GetPointSize (grid) == 1) {
+        arrays[0] = pos;
+        arrays[1] = nor;
+        arrays[2] = idx;
+        if (SCE_MC_GenerateSlabs (mc, region, grid, pool, NULL, NULL, NULL,
+                                  arrays, n_vertices, n_indices) < 0)
+            goto fail;
+        return SCE_OK;
+    }
+
+    if (SCE_MC_Count (mc, region, grid, &n_v, &n_i) < 0)
+        goto fail;
+    if (SCE_MC_AllocArrays (pos, nor, idx, n_v, n_i, &vertices, &normals,
+                            &itype, &indices) < 0)
+        goto fail;
+    mc->last_x = mc->last_y = mc->last_z = 0;
+    mc->n_vertices = mc->n_indices = 0;
+    *n_vertices = SCE_MC_GenerateVerticesNormalsRange (mc, region, grid,
+                                                       vertices, normals, 0);
+    *n_indices = SCE_MC_GenerateIndicesType (mc, itype, indices);
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+
+/* incremental meshes */
+
+#define SCE_MCMESH_NO_BLOCK ((SCEuint)-1)
+
+/* corner at the end of each edge of SCE_SMCCell::indices, and its bit in
+   the case index */
+static const SCEuint lt_edge_corners[3] = {0, 2, 7};
+
+void SCE_MCMesh_Init (SCE_SMCMesh *mesh)
+{
+    size_t i;
+
+    SCE_MC_Init (&mesh->mc);
+    mesh->origin[0] = mesh->origin[1] = mesh->origin[2] = 0;
+    mesh->blocks = NULL;
+    mesh->vertices = mesh->normals = NULL;
+    mesh->n_vertices = mesh->max_vertices = 0;
+    mesh->free_vertices = NULL;
+    mesh->n_free_vertices = 0;
+    mesh->indices = NULL;
+    mesh->n_indices = mesh->max_indices = 0;
+    for (i = 0; i < SCE_MCMESH_MAX_TRIANGLES; i++) {
+        mesh->free_blocks[i] = NULL;
+        mesh->n_free_blocks[i] = mesh->max_free_blocks[i] = 0;
+    }
+    mesh->vrange[0] = mesh->vrange[1] = 0;
+    mesh->irange[0] = mesh->irange[1] = 0;
+    mesh->resized = SCE_FALSE;
+    mesh->pos = mesh->nor = mesh->idx = NULL;
+}
+void SCE_MCMesh_Clear (SCE_SMCMesh *mesh)
+{
+    size_t i;
+
+    SCE_MC_Clear (&mesh->mc);
+    SCE_free (mesh->blocks);
+    SCE_free (mesh->vertices);
+    SCE_free (mesh->normals);
+    SCE_free (mesh->free_vertices);
+    SCE_free (mesh->indices);
+    for (i = 0; i < SCE_MCMESH_MAX_TRIANGLES; i++)
+        SCE_free (mesh->free_blocks[i]);
+}
+SCE_SMCMesh* SCE_MCMesh_Create (void)
+{
+    SCE_SMCMesh *mesh = NULL;
+    if (!(mesh = SCE_malloc (sizeof *mesh)))
+        SCEE_LogSrc ();
+    else
+        SCE_MCMesh_Init (mesh);
+    return mesh;
+}
+void SCE_MCMesh_Delete (SCE_SMCMesh *mesh)
+{
+    if (mesh) {
+        SCE_MCMesh_Clear (mesh);
+        SCE_free (mesh);
+    }
+}
+
+/**
+ * \brief Sets the cells of a mesh
+ * \param mesh a mesh
+ * \param region the cells, in grid coordinates
+ *
+ * You need to call SCE_MCMesh_Build() after that.
+ */
+void SCE_MCMesh_SetRegion (SCE_SMCMesh *mesh, const SCE_SIntRect3 *region)
+{
+    SCE_MC_SetRegion (&mesh->mc, region);
+}
+/**
+ * \brief Sets the world coordinates of the first point of the grid
+ * \sa SCE_MCMesh_UpdateZone()
+ */
+void SCE_MCMesh_SetOrigin (SCE_SMCMesh *mesh, long x, long y, long z)
+{
+    mesh->origin[0] = x;
+    mesh->origin[1] = y;
+    mesh->origin[2] = z;
+}
+
+/**
+ * \brief Sets the type of the indices of a mesh
+ * \param mesh a mesh
+ * \param type SCE_INDICES_TYPE (the default) or SCE_INDICES32_TYPE
+ *
+ * Must be called before SCE_MCMesh_Build(). Meshes of 16 bits indices are
+ * widened to SCE_INDICES32_TYPE when they get more vertices than
+ * SCE_INDICES_MAX_VERTICES.
+ */
+void SCE_MCMesh_SetIndicesType (SCE_SMCMesh *mesh, SCE_EType type)
+{
+    if (type != mesh->mc.itype) {
+        SCE_free (mesh->indices);
+        mesh->indices = NULL;
+        mesh->n_indices = mesh->max_indices = 0;
+        SCE_MC_SetIndicesType (&mesh->mc, type);
+    }
+}
+
+/**
+ * \brief Allocates the cells of a mesh, the mesh is emptied
+ * \param mesh a mesh
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MCMesh_SetRegion()
+ */
+int SCE_MCMesh_Build (SCE_SMCMesh *mesh)
+{
+    SCE_SMCGenerator *mc = &mesh->mc;
+    SCE_SMCCell *cell = NULL;
+    SCEuint x, y, z;
+    size_t i, n;
+
+    n = mc->w * mc->h * mc->d;
+    SCE_MC_SetNumCells (mc, n);
+    if (SCE_MC_Build (mc) < 0)
+        goto fail;
+    SCE_free (mesh->blocks);
+    if (!(mesh->blocks = SCE_malloc (n * sizeof *mesh->blocks)))
+        goto fail;
+
+    cell = mc->cells;
+    for (z = 0; z < mc->d; z++) {
+        for (y = 0; y < mc->h; y++) {
+            for (x = 0; x < mc->w; x++, cell++) {
+                cell->x = x;
+                cell->y = y;
+                cell->z = z;
+                cell->conf = 0;
+            }
+        }
+    }
+    for (i = 0; i < n; i++)
+        mesh->blocks[i] = SCE_MCMESH_NO_BLOCK;
+
+    mesh->n_vertices = mesh->n_free_vertices = 0;
+    mesh->n_indices = 0;
+    for (i = 0; i < SCE_MCMESH_MAX_TRIANGLES; i++)
+        mesh->n_free_blocks[i] = 0;
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/**
+ * \brief Sets the arrays updated by a mesh
+ * \param mesh a mesh
+ * \param pos positions array
+ * \param nor normals array, can be NULL
+ * \param idx indices array
+ *
+ * The arrays are given the buffers of \p mesh, which keeps ownership of
+ * them. After each update, the modified ranges of the arrays are reported
+ * with SCE_Geometry_Modified() if they belong to a geometry, along with its
+ * new number of vertices and indices.
+ */
+void SCE_MCMesh_SetArrays (SCE_SMCMesh *mesh, SCE_SGeometryArray *pos,
+                           SCE_SGeometryArray *nor, SCE_SGeometryArray *idx)
+{
+    mesh->pos = pos;
+    mesh->nor = nor;
+    mesh->idx = idx;
+    if (pos)
+        SCE_Geometry_SetArrayPosition (pos, 0, 3, mesh->vertices, SCE_FALSE);
+    if (nor)
+        SCE_Geometry_SetArrayNormal (nor, 0, mesh->normals, SCE_FALSE);
+    if (idx)
+        SCE_Geometry_SetArrayIndices (idx, mesh->mc.itype, mesh->indices,
+                                      SCE_FALSE);
+}
+
+
+static int SCE_MCMesh_Grow (void **data, size_t old, size_t n, size_t size)
+{
+    void *p = NULL;
+
+    if (!(p = SCE_malloc (n * size))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    if (*data)
+        memcpy (p, *data, old * size);
+    SCE_free (*data);
+    *data = p;
+    return SCE_OK;
+}
+
+static void SCE_MCMesh_Extend (size_t range[2], size_t first, size_t end)
+{
+    range[0] = MIN (range[0], first);
+    range[1] = MAX (range[1], end);
+}
+
+static int SCE_MCMesh_WidenIndices (SCE_SMCMesh *mesh)
+{
+    SCEindices32 *indices = NULL;
+    size_t i;
+
+    if (!(indices = SCE_malloc (MAX (mesh->max_indices, 1) *
+                                sizeof *indices))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    for (i = 0; i < mesh->n_indices; i++)
+        indices[i] = ((SCEindices*)mesh->indices)[i];
+    SCE_free (mesh->indices);
+    mesh->indices = indices;
+    SCE_MC_SetIndicesType (&mesh->mc, SCE_INDICES32_TYPE);
+    mesh->resized = SCE_TRUE;
+    return SCE_OK;
+}
+
+static int SCE_MCMesh_AllocVertex (SCE_SMCMesh *mesh, SCEuint *slot)
+{
+    if (mesh->n_free_vertices > 0) {
+        mesh->n_free_vertices--;
+        *slot = mesh->free_vertices[mesh->n_free_vertices];
+        return SCE_OK;
+    }
+
+    if (mesh->n_vertices == mesh->max_vertices) {
+        size_t old = mesh->max_vertices, n = MAX (2 * old, 256);
+        if (SCE_MCMesh_Grow ((void**)&mesh->vertices, 3 * old, 3 * n,
+                             sizeof *mesh->vertices) < 0 ||
+            SCE_MCMesh_Grow ((void**)&mesh->normals, 3 * old, 3 * n,
+                             sizeof *mesh->normals) < 0 ||
+            SCE_MCMesh_Grow ((void**)&mesh->free_vertices, 0, n,
+                             sizeof *mesh->free_vertices) < 0) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+        mesh->max_vertices = n;
+        mesh->resized = SCE_TRUE;
+    }
+    if (mesh->n_vertices == SCE_INDICES_MAX_VERTICES &&
+        mesh->mc.itype != SCE_INDICES32_TYPE) {
+        if (SCE_MCMesh_WidenIndices (mesh) < 0) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+    }
+    *slot = mesh->n_vertices++;
+    return SCE_OK;
+}
+static void SCE_MCMesh_FreeVertex (SCE_SMCMesh *mesh, SCEuint slot)
+{
+    /* free slots never outnumber the vertices */
+    mesh->free_vertices[mesh->n_free_vertices++] = slot;
+}
+
+static int SCE_MCMesh_AllocBlock (SCE_SMCMesh *mesh, SCEuint n_tri,
+                                  SCEuint *block)
+{
+    size_t size = 3 * n_tri, k = n_tri - 1;
+
+    if (mesh->n_free_blocks[k] > 0) {
+        mesh->n_free_blocks[k]--;
+        *block = mesh->free_blocks[k][mesh->n_free_blocks[k]];
+        return SCE_OK;
+    }
+
+    if (mesh->n_indices + size > mesh->max_indices) {
+        size_t n = MAX (2 * mesh->max_indices, 1024);
+        if (SCE_MCMesh_Grow (&mesh->indices, mesh->n_indices, n,
+                             SCE_Type_Sizeof (mesh->mc.itype)) < 0) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+        mesh->max_indices = n;
+        mesh->resized = SCE_TRUE;
+    }
+    *block = mesh->n_indices;
+    mesh->n_indices += size;
+    return SCE_OK;
+}
+static int SCE_MCMesh_FreeBlock (SCE_SMCMesh *mesh, SCEuint n_tri,
+                                 SCEuint block)
+{
+    size_t k = n_tri - 1, size = SCE_Type_Sizeof (mesh->mc.itype);
+
+    if (mesh->n_free_blocks[k] == mesh->max_free_blocks[k]) {
+        size_t n = MAX (2 * mesh->max_free_blocks[k], 64);
+        if (SCE_MCMesh_Grow ((void**)&mesh->free_blocks[k],
+                             mesh->n_free_blocks[k], n,
+                             sizeof *mesh->free_blocks[k]) < 0) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+        mesh->max_free_blocks[k] = n;
+    }
+    mesh->free_blocks[k][mesh->n_free_blocks[k]++] = block;
+
+    /* degenerate triangles */
+    memset ((SCEubyte*)mesh->indices + block * size, 0, 3 * n_tri * size);
+    SCE_MCMesh_Extend (mesh->irange, block, block + 3 * n_tri);
+    return SCE_OK;
+}
+
+/* same as SCE_MC_MakeCellVertices() and SCE_MC_MakeCellNormals(), for a
+   single edge written into its slot */
+static void SCE_MCMesh_MakeVertex (SCE_SMCMesh *mesh, const SCE_SGrid *grid,
+                                   const SCE_SMCCell *cell, SCEuint edge,
+                                   SCEubyte corners[8], const SCE_TVector3 div)
+{
+    SCE_SMCGenerator *mc = &mesh->mc;
+    SCEuint slot = cell->indices[edge];
+    SCE_TVector3 v0, v1;
+    int x, y, z, o[3] = {0, 0, 0};
+
+    o[edge == 0 ? 1 : (edge == 1 ? 0 : 2)] = 1;
+
+    SCE_Vector3_Set (v0, (float)cell->x, (float)cell->y, (float)cell->z);
+    SCE_Vector3_Operator1v (v0, *=, div);
+    SCE_Vector3_Copy (v1, v0);
+    v1[0] += o[0] * div[0];
+    v1[1] += o[1] * div[1];
+    v1[2] += o[2] * div[2];
+    SCE_MC_Interp (&mesh->vertices[slot * 3], corners[3],
+                   corners[lt_edge_corners[edge]], v0, v1);
+
+    x = mc->x + cell->x;
+    y = mc->y + cell->y;
+    z = mc->z + cell->z;
+    SCE_MC_MakeNormal (grid, x, y, z, v0);
+    SCE_MC_MakeNormal (grid, x + o[0], y + o[1], z + o[2], v1);
+    SCE_MC_Interp (&mesh->normals[slot * 3], corners[3],
+                   corners[lt_edge_corners[edge]], v0, v1);
+    SCE_Vector3_Normalize (&mesh->normals[slot * 3]);
+
+    SCE_MCMesh_Extend (mesh->vrange, slot, slot + 1);
+}
+
+static void SCE_MCMesh_Report (SCE_SMCMesh *mesh)
+{
+    size_t range[2];
+
+    if (mesh->vrange[0] >= mesh->vrange[1])
+        mesh->vrange[0] = mesh->vrange[1] = 0;
+    if (mesh->irange[0] >= mesh->irange[1])
+        mesh->irange[0] = mesh->irange[1] = 0;
+
+    if (mesh->resized)
+        SCE_MCMesh_SetArrays (mesh, mesh->pos, mesh->nor, mesh->idx);
+
+    if (mesh->pos && mesh->pos->geom) {
+        /* the geometry keeps its own pointers to the buffers and the type
+           of the indices */
+        if (mesh->resized)
+            SCE_Geometry_UpdatePointers (mesh->pos->geom);
+        SCE_Geometry_SetNumVertices (mesh->pos->geom, mesh->n_vertices);
+        SCE_Geometry_SetNumIndices (mesh->pos->geom, mesh->n_indices);
+    }
+
+    range[0] = 0;
+    range[1] = mesh->n_vertices;
+    if (!mesh->resized) {
+        range[0] = mesh->vrange[0];
+        range[1] = mesh->vrange[1];
+    }
+    if (range[0] < range[1]) {
+        if (mesh->pos && mesh->pos->geom)
+            SCE_Geometry_Modified (mesh->pos, range);
+        if (mesh->nor && mesh->nor->geom)
+            SCE_Geometry_Modified (mesh->nor, range);
+    }
+
+    range[0] = 0;
+    range[1] = mesh->n_indices;
+    if (!mesh->resized) {
+        range[0] = mesh->irange[0];
+        range[1] = mesh->irange[1];
+    }
+    if (range[0] < range[1] && mesh->idx && mesh->idx->geom)
+        SCE_Geometry_Modified (mesh->idx, range);
+}
+
+/* lo and hi are the cells to update */
+static int SCE_MCMesh_UpdateCells (SCE_SMCMesh *mesh, const SCE_SGrid *grid,
+                                   const long lo[3], const long hi[3])
+{
+    SCE_SMCGenerator *mc = &mesh->mc;
+    SCE_SMCCell *cell = NULL;
+    SCEuint x, y, z, k, old, n_tri;
+    SCEubyte corners[8];
+    SCE_TVector3 div;
+    size_t offset;
+
+    mesh->vrange[0] = mesh->irange[0] = (size_t)-1;
+    mesh->vrange[1] = mesh->irange[1] = 0;
+    mesh->resized = SCE_FALSE;
+
+    SCE_Vector3_Set (div, 1.0 / SCE_Grid_GetWidth (grid),
+                     1.0 / SCE_Grid_GetHeight (grid),
+                     1.0 / SCE_Grid_GetDepth (grid));
+
+    /* cases and vertices first: triangles refer to the vertices of the
+       neighboring cells */
+    for (z = lo[2]; z < hi[2]; z++) {
+        for (y = lo[1]; y < hi[1]; y++) {
+            for (x = lo[0]; x < hi[0]; x++) {
+                int x_ = mc->x + x, y_ = mc->y + y, z_ = mc->z + z;
+
+                offset = mc->w * (z * mc->h + y) + x;
+                cell = &mc->cells[offset];
+
+                SCE_Grid_GetPoint (grid, x_,     y_,     z_,     &corners[3]);
+                SCE_Grid_GetPoint (grid, x_ + 1, y_,     z_,     &corners[2]);
+                SCE_Grid_GetPoint (grid, x_,     y_ + 1, z_,     &corners[0]);
+                SCE_Grid_GetPoint (grid, x_ + 1, y_ + 1, z_,     &corners[1]);
+                SCE_Grid_GetPoint (grid, x_,     y_,     z_ + 1, &corners[7]);
+                SCE_Grid_GetPoint (grid, x_ + 1, y_,     z_ + 1, &corners[6]);
+                SCE_Grid_GetPoint (grid, x_,     y_ + 1, z_ + 1, &corners[4]);
+                SCE_Grid_GetPoint (grid, x_ + 1, y_ + 1, z_ + 1, &corners[5]);
+
+                old = cell->conf;
+                cell->conf = SCE_MC_GetConfig (corners);
+
+                if (mesh->blocks[offset] != SCE_MCMESH_NO_BLOCK &&
+                    lt_num_tri[old] != lt_num_tri[cell->conf]) {
+                    if (SCE_MCMesh_FreeBlock (mesh, lt_num_tri[old],
+                                              mesh->blocks[offset]) < 0)
+                        goto fail;
+                    mesh->blocks[offset] = SCE_MCMESH_NO_BLOCK;
+                }
+
+                for (k = 0; k < 3; k++) {
+                    SCEuint bit = lt_edge_corners[k];
+                    int was = ((old >> 3) ^ (old >> bit)) & 1;
+                    int now = ((cell->conf >> 3) ^ (cell->conf >> bit)) & 1;
+
+                    if (was && !now)
+                        SCE_MCMesh_FreeVertex (mesh, cell->indices[k]);
+                    else if (now && !was) {
+                        if (SCE_MCMesh_AllocVertex (mesh,
+                                                    &cell->indices[k]) < 0)
+                            goto fail;
+                    }
+                    if (now)
+                        SCE_MCMesh_MakeVertex (mesh, grid, cell, k, corners,
+                                               div);
+                }
+            }
+        }
+    }
+
+    /* triangles of the cells that are not across a border */
+    for (z = lo[2]; z < hi[2] && z < mc->d - 1; z++) {
+        for (y = lo[1]; y < hi[1] && y < mc->h - 1; y++) {
+            for (x = lo[0]; x < hi[0] && x < mc->w - 1; x++) {
+                offset = mc->w * (z * mc->h + y) + x;
+                cell = &mc->cells[offset];
+                if (!(n_tri = lt_num_tri[cell->conf]))
+                    continue;
+                if (mesh->blocks[offset] == SCE_MCMESH_NO_BLOCK &&
+                    SCE_MCMesh_AllocBlock (mesh, n_tri,
+                                           &mesh->blocks[offset]) < 0)
+                    goto fail;
+                SCE_MC_MakeCellIndices (mc, cell, mc->itype, mesh->indices,
+                                        mesh->blocks[offset]);
+                SCE_MCMesh_Extend (mesh->irange, mesh->blocks[offset],
+                                   mesh->blocks[offset] + 3 * n_tri);
+            }
+        }
+    }
+
+    SCE_MCMesh_Report (mesh);
+    return SCE_OK;
+fail:
+    /* the mesh is left consistent but partially updated */
+    SCE_MCMesh_Report (mesh);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/* p1 and p2 are the modified points of the grid */
+static int SCE_MCMesh_UpdatePoints (SCE_SMCMesh *mesh, const SCE_SGrid *grid,
+                                    const long p1[3], const long p2[3])
+{
+    SCE_SMCGenerator *mc = &mesh->mc;
+    long lo[3], hi[3], origin[3], size[3];
+    int i;
+
+    origin[0] = mc->x; size[0] = mc->w;
+    origin[1] = mc->y; size[1] = mc->h;
+    origin[2] = mc->z; size[2] = mc->d;
+
+    /* a cell reads the points from 1 before to 2 after its origin for its
+       normals */
+    for (i = 0; i < 3; i++) {
+        lo[i] = MAX (p1[i] - origin[i] - 2, 0);
+        hi[i] = MIN (p2[i] - origin[i] + 1, size[i]);
+        if (lo[i] >= hi[i]) {
+            /* nothing to do */
+            mesh->vrange[0] = mesh->vrange[1] = 0;
+            mesh->irange[0] = mesh->irange[1] = 0;
+            mesh->resized = SCE_FALSE;
+            return SCE_OK;
+        }
+    }
+
+    return SCE_MCMesh_UpdateCells (mesh, grid, lo, hi);
+}
+
+/**
+ * \brief Generates all the cells of a mesh
+ * \param mesh a mesh
+ * \param grid voxel grid
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MCMesh_Update()
+ */
+int SCE_MCMesh_Generate (SCE_SMCMesh *mesh, const SCE_SGrid *grid)
+{
+    long lo[3], hi[3];
+
+    lo[0] = lo[1] = lo[2] = 0;
+    hi[0] = mesh->mc.w;
+    hi[1] = mesh->mc.h;
+    hi[2] = mesh->mc.d;
+    if (SCE_MCMesh_UpdateCells (mesh, grid, lo, hi) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
+
+/**
+ * \brief Updates the cells of a mesh affected by modified points
+ * \param mesh a mesh
+ * \param grid voxel grid
+ * \param region modified points of \p grid
+ *
+ * Only the cells reading the points of \p region are regenerated, that is
+ * \p region extended by 2 cells before and 1 after since normals are
+ * computed from central differences. The modified vertices and indices
+ * are given by SCE_MCMesh_GetVerticesRange() and
+ * SCE_MCMesh_GetIndicesRange().
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MCMesh_UpdateZone(), SCE_MCMesh_SetArrays()
+ */
+int SCE_MCMesh_Update (SCE_SMCMesh *mesh, const SCE_SGrid *grid,
+                       const SCE_SIntRect3 *region)
+{
+    long p1[3], p2[3];
+    int q1[3], q2[3];
+
+    SCE_Rectangle3_GetPointsv (region, q1, q2);
+    p1[0] = q1[0]; p1[1] = q1[1]; p1[2] = q1[2];
+    p2[0] = q2[0]; p2[1] = q2[1]; p2[2] = q2[2];
+    if (SCE_MCMesh_UpdatePoints (mesh, grid, p1, p2) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
+/**
+ * \brief Updates a mesh from a region of the world
+ * \param mesh a mesh
+ * \param grid voxel grid
+ * \param zone modified region, in world coordinates, as returned by
+ * SCE_VWorld_GetNextUpdatedRegion()
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MCMesh_SetOrigin(), SCE_MCMesh_Update()
+ */
+int SCE_MCMesh_UpdateZone (SCE_SMCMesh *mesh, const SCE_SGrid *grid,
+                           const SCE_SLongRect3 *zone)
+{
+    long p1[3], p2[3];
+    int i;
+
+    SCE_Rectangle3_GetPointslv (zone, p1, p2);
+    for (i = 0; i < 3; i++) {
+        p1[i] -= mesh->origin[i];
+        p2[i] -= mesh->origin[i];
+    }
+    if (SCE_MCMesh_UpdatePoints (mesh, grid, p1, p2) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
+
+SCEvertices* SCE_MCMesh_GetVertices (SCE_SMCMesh *mesh)
+{
+    return mesh->vertices;
+}
+SCEvertices* SCE_MCMesh_GetNormals (SCE_SMCMesh *mesh)
+{
+    return mesh->normals;
+}
+void* SCE_MCMesh_GetIndices (SCE_SMCMesh *mesh)
+{
+    return mesh->indices;
+}
+SCE_EType SCE_MCMesh_GetIndicesType (const SCE_SMCMesh *mesh)
+{
+    return mesh->mc.itype;
+}
+size_t SCE_MCMesh_GetNumVertices (const SCE_SMCMesh *mesh)
+{
+    return mesh->n_vertices;
+}
+size_t SCE_MCMesh_GetNumIndices (const SCE_SMCMesh *mesh)
+{
+    return mesh->n_indices;
+}
+/**
+ * \brief Gets the vertices modified by the last update
+ * \return first and last + 1 modified vertices
+ */
+const size_t* SCE_MCMesh_GetVerticesRange (const SCE_SMCMesh *mesh)
+{
+    return mesh->vrange;
+}
+/**
+ * \brief Gets the indices modified by the last update
+ * \return first and last + 1 modified indices
+ */
+const size_t* SCE_MCMesh_GetIndicesRange (const SCE_SMCMesh *mesh)
+{
+    return mesh->irange;
+}
+/**
+ * \brief Have the buffers of a mesh been reallocated by the last update?
+ *
+ * If so, the pointers to the buffers need to be fetched again, the arrays
+ * given to SCE_MCMesh_SetArrays() are updated and entirely reported as
+ * modified.
+ */
+int SCE_MCMesh_IsResized (const SCE_SMCMesh *mesh)
+{
+    return mesh->resized;
+}
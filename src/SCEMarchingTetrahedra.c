@@ -34,6 +34,92 @@ static void vlerp (SCE_TVector3 v, const SCE_TVector3 a, const SCE_TVector3 b,
     SCE_Vector3_Operator2 (v, +=, b, *, w);
 }
 
+#define N_CASES (16)
+
+/* number of polygons of a tetrahedron, 0 indicates one and 1 indicates two */
+static const unsigned char lt_triangles_count[N_CASES] = {
+    0, 0, 0, 1, 0, 1, 1, 0, 0, 1,
+    1, 0, 1, 0, 0, 0
+};
+
+/* frontfacing triangles are clockwise */
+static const int lt_triangles[N_CASES * 4] = {
+                                // 3210 vertex index
+    0, 0, 0, 0,                 // 0000
+    0, 1, 2, 0,                 // 0001
+    0, 3, 4, 0,                 // 0010
+    1, 2, 3, 4,                 // 0011
+    2, 5, 3, 0,                 // 0100
+    0, 1, 5, 3,                 // 0101
+    0, 2, 5, 4,                 // 0110
+    1, 5, 4, 0,                 // 0111
+    1, 4, 5, 0,                 // 1000
+    0, 4, 5, 2,                 // 1001
+    0, 3, 5, 1,                 // 1010
+    2, 3, 5, 0,                 // 1011
+    1, 4, 3, 2,                 // 1100
+    0, 4, 3, 0,                 // 1101
+    0, 2, 1, 0,                 // 1110
+    0, 0, 0, 0                  // 1111
+};
+
+/* given the ID of an edge, returns the two corresponding vertices */
+static const int lt_edges[6 * 2] = {
+    0, 1,
+    0, 3,
+    0, 2,
+    1, 2,
+    1, 3,
+    2, 3
+};
+
+/* TODO: same table as in interface/SCEVoxelRenderer */
+/* vertices of the tetrahedra of a cell */
+static const int lt_vertices[6 * 4] = {
+    3, 6, 7, 0,
+    3, 4, 7, 6,
+    3, 5, 4, 6,
+    3, 2, 5, 6,
+    3, 1, 2, 6,
+    3, 0, 1, 6
+};
+
+/* lattice edges used by the tetrahedra, from a lattice point */
+#define SCE_MT_NUM_DIRS 7
+static const int lt_dirs[SCE_MT_NUM_DIRS * 3] = {
+    1, 0, 0,
+    0, 1, 0,
+    0, 0, 1,
+   -1, 1, 0,
+    1, 0, 1,
+    0,-1, 1,
+    1,-1, 1
+};
+
+/* for each edge of each tetrahedron of a cell: the cell corners it starts
+   and ends at, and its direction in lt_dirs; edges shared by neighboring
+   cells are always oriented the same way */
+static const int lt_tetra_edges[6 * 6 * 3] = {
+    3, 6, 6,  0, 3, 1,  3, 7, 5,  7, 6, 0,  0, 6, 4,  0, 7, 2,
+    3, 4, 2,  3, 6, 6,  3, 7, 5,  7, 4, 1,  6, 4, 3,  7, 6, 0,
+    3, 5, 4,  3, 6, 6,  3, 4, 2,  4, 5, 0,  6, 5, 1,  6, 4, 3,
+    3, 2, 0,  3, 6, 6,  3, 5, 4,  2, 5, 2,  2, 6, 5,  6, 5, 1,
+    1, 3, 3,  3, 6, 6,  3, 2, 0,  1, 2, 1,  1, 6, 2,  2, 6, 5,
+    0, 3, 1,  3, 6, 6,  1, 3, 3,  0, 1, 0,  0, 6, 4,  1, 6, 2
+};
+
+/* coordinates of the corners of a cell */
+static const int lt_corners[8 * 3] = {
+    0, 0, 0,
+    1, 0, 0,
+    1, 1, 0,
+    0, 1, 0,
+    0, 1, 1,
+    1, 1, 1,
+    1, 0, 1,
+    0, 0, 1
+};
+
 /*                + 0
                  /|\
                 / | \
@@ -56,47 +142,6 @@ static void vlerp (SCE_TVector3 v, const SCE_TVector3 a, const SCE_TVector3 b,
 static size_t SCE_MT_Tetrahedron (SCEvertices *v, const int code,
                                   const float d[4], const SCE_TVector3 p[4])
 {
-#define N_CASES (16)
-
-    /* TODO: same table as in interface/SCEVoxelRenderer */
-
-    /* number of polygons, 0 indicates one and 1 indicates two */
-    const unsigned char lt_triangles_count[N_CASES] = {
-        0, 0, 0, 1, 0, 1, 1, 0, 0, 1,
-        1, 0, 1, 0, 0, 0
-    };
-
-    /* frontfacing triangles are clockwise */
-    const int lt_triangles[N_CASES * 4] = {
-                                    // 3210 vertex index
-        0, 0, 0, 0,                 // 0000
-        0, 1, 2, 0,                 // 0001
-        0, 3, 4, 0,                 // 0010
-        1, 2, 3, 4,                 // 0011
-        2, 5, 3, 0,                 // 0100
-        0, 1, 5, 3,                 // 0101
-        0, 2, 5, 4,                 // 0110
-        1, 5, 4, 0,                 // 0111
-        1, 4, 5, 0,                 // 1000
-        0, 4, 5, 2,                 // 1001
-        0, 3, 5, 1,                 // 1010
-        2, 3, 5, 0,                 // 1011
-        1, 4, 3, 2,                 // 1100
-        0, 4, 3, 0,                 // 1101
-        0, 2, 1, 0,                 // 1110
-        0, 0, 0, 0                  // 1111
-    };
-
-    /* given the ID of an edge, returns the two corresponding vertices */
-    const int lt_edges[6 * 2] = {
-        0, 1,
-        0, 3,
-        0, 2,
-        1, 2,
-        1, 3,
-        2, 3
-    };
-
     int i, index, v1, v2;
     size_t offset = 0;
 
@@ -161,16 +206,6 @@ static size_t SCE_MT_Tetrahedron (SCEvertices *v, const int code,
 size_t SCE_MT_GenerateCell (SCEvertices v[3 * 36], const float densities[8],
                             const SCE_TVector3 origin)
 {
-    /* TODO: same table as in interface/SCEVoxelRenderer */
-    const int lt_vertices[6 * 4] = {
-        3, 6, 7, 0,
-        3, 4, 7, 6,
-        3, 5, 4, 6,
-        3, 2, 5, 6,
-        3, 1, 2, 6,
-        3, 0, 1, 6
-    };
-
     unsigned int in;
     size_t offset = 0;
     int code;
@@ -232,6 +267,71 @@ size_t SCE_MT_GenerateCell (SCEvertices v[3 * 36], const float densities[8],
 
 
 
+/* number of vertices generated by a cell, as a function of its case */
+static size_t SCE_MT_CountCell (unsigned int in)
+{
+    size_t n = 0;
+    int i, code;
+
+    for (i = 0; i < 6; i++) {
+        code  = (1 & (in >> lt_vertices[i * 4 + 0]));
+        code |= (1 & (in >> lt_vertices[i * 4 + 1])) << 1;
+        code |= (1 & (in >> lt_vertices[i * 4 + 2])) << 2;
+        code |= (1 & (in >> lt_vertices[i * 4 + 3])) << 3;
+        if (code > 0 && code < 15)
+            n += 3 + 3 * lt_triangles_count[code];
+    }
+    return n;
+}
+
+/**
+ * \brief Counts the vertices SCE_MT_Generate() would generate
+ * \param voxels voxels
+ * \param region region of the cells
+ * \param w width of \p voxels
+ * \param h height of \p voxels
+ * \param d depth of \p voxels
+ *
+ * Only the case tables are used, no vertex is computed.
+ * \return the number of vertices
+ * \sa SCE_MT_Generate(), SCE_MT_GenerateArrays()
+ */
+size_t SCE_MT_Count (const unsigned char *voxels, const SCE_SIntRect3 *region,
+                     SCEuint w, SCEuint h, SCEuint d)
+{
+    SCEuint x, y, z;
+    unsigned int in;
+    size_t n = 0;
+    int p1[3], p2[3];
+
+#define getoffset(x_, y_, z_) ((w) * ((h) * (z_) + (y_)) + (x_))
+#define inside(x_, y_, z_) (voxels[getoffset (x_, y_, z_)] > 128)
+
+    SCE_Rectangle3_GetPointsv (region, p1, p2);
+
+    /* densities are positive above 128, see SCE_MT_Generate() */
+    for (z = p1[2]; z < p2[2]; z++) {
+        for (y = p1[1]; y < p2[1]; y++) {
+            for (x = p1[0]; x < p2[0]; x++) {
+                in  = inside (x,     y,     z    );
+                in |= inside (x + 1, y,     z    ) << 1;
+                in |= inside (x + 1, y + 1, z    ) << 2;
+                in |= inside (x,     y + 1, z    ) << 3;
+                in |= inside (x,     y + 1, z + 1) << 4;
+                in |= inside (x + 1, y + 1, z + 1) << 5;
+                in |= inside (x + 1, y,     z + 1) << 6;
+                in |= inside (x,     y,     z + 1) << 7;
+                if (in != 0 && in != 255)
+                    n += SCE_MT_CountCell (in);
+            }
+        }
+    }
+
+#undef inside
+#undef getoffset
+    return n;
+}
+
 /**
  * \brief 
  * 
@@ -362,3 +462,343 @@ void SCE_MT_GenerateNormals (SCEvertices *normals, const SCEvertices *vertices,
         SCE_Vector3_Copy (&normals[i * 3], grad);
     }
 }
+
+/**
+ * \brief Generates a region into geometry arrays of the exact size
+ * \param pos array receiving the positions
+ * \param nor array receiving the normals, can be NULL
+ * \param voxels voxels
+ * \param region region of the cells
+ * \param w width of \p voxels
+ * \param h height of \p voxels
+ * \param d depth of \p voxels
+ * \param n_vertices number of vertices generated
+ *
+ * The data of the arrays is replaced by buffers of the size given by
+ * SCE_MT_Count(), see SCE_Geometry_AllocArrayData().
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MT_Generate(), SCE_MT_GenerateNormals()
+ */
+int SCE_MT_GenerateArrays (SCE_SGeometryArray *pos, SCE_SGeometryArray *nor,
+                           const unsigned char *voxels,
+                           const SCE_SIntRect3 *region,
+                           SCEuint w, SCEuint h, SCEuint d, size_t *n_vertices)
+{
+    SCEvertices *vertices = NULL, *normals = NULL;
+    size_t n;
+
+    /* never allocate 0 bytes */
+    n = MAX (SCE_MT_Count (voxels, region, w, h, d), 1);
+
+    if (!(vertices = SCE_Geometry_AllocArrayData (pos, 3 * n *
+                                                  sizeof *vertices)))
+        goto fail;
+    SCE_Geometry_SetArrayPosition (pos, 0, 3, vertices, SCE_TRUE);
+    if (nor) {
+        if (!(normals = SCE_Geometry_AllocArrayData (nor, 3 * n *
+                                                     sizeof *normals)))
+            goto fail;
+        SCE_Geometry_SetArrayNormal (nor, 0, normals, SCE_TRUE);
+    }
+
+    *n_vertices = SCE_MT_Generate (vertices, voxels, region, w, h, d);
+    if (nor)
+        SCE_MT_GenerateNormals (normals, vertices, *n_vertices, voxels,
+                                w, h, d);
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+
+/* indexed generation: vertices of the lattice edges are cached for the two
+   planes of lattice points of the current slice of cells */
+typedef struct sce_smtedgecache SCE_SMTEdgeCache;
+struct sce_smtedgecache {
+    SCEuint *slots;             /* 2 planes * points * SCE_MT_NUM_DIRS */
+    SCEuint pw, ph;             /* number of lattice points of a plane */
+};
+
+#define SCE_MT_NO_VERTEX ((SCEuint)-1)
+
+static void SCE_MT_ResetPlane (SCE_SMTEdgeCache *cache, SCEuint z)
+{
+    size_t i, n = cache->pw * cache->ph * SCE_MT_NUM_DIRS;
+    SCEuint *slots = &cache->slots[(z & 1) * n];
+    for (i = 0; i < n; i++)
+        slots[i] = SCE_MT_NO_VERTEX;
+}
+
+static SCEuint SCE_MT_GetEdgeVertex (SCE_SMTEdgeCache *cache,
+                                     SCEuint x, SCEuint y, SCEuint z,
+                                     const int *edge, const float d[8],
+                                     const SCE_TVector3 origin,
+                                     SCEvertices *vertices, size_t *n_vertices)
+{
+    const int *c = &lt_corners[edge[0] * 3];
+    SCEuint *slot;
+    SCE_TVector3 a, b;
+
+    x += c[0];
+    y += c[1];
+    z += c[2];
+    slot = &cache->slots[(((z & 1) * cache->ph + y) * cache->pw + x) *
+                         SCE_MT_NUM_DIRS + edge[2]];
+
+    if (*slot == SCE_MT_NO_VERTEX) {
+        const int *c2 = &lt_corners[edge[1] * 3];
+        SCE_Vector3_Set (a, origin[0] + c[0], origin[1] + c[1],
+                         origin[2] + c[2]);
+        SCE_Vector3_Set (b, origin[0] + c2[0], origin[1] + c2[1],
+                         origin[2] + c2[2]);
+        vlerp (&vertices[*n_vertices * 3], a, b, d[edge[0]], d[edge[1]]);
+        *slot = *n_vertices;
+        (*n_vertices)++;
+    }
+    return *slot;
+}
+
+static size_t SCE_MT_IndexCell (SCE_SMTEdgeCache *cache,
+                                SCEuint x, SCEuint y, SCEuint z,
+                                unsigned int in, const float d[8],
+                                const SCE_TVector3 origin,
+                                SCEvertices *vertices, size_t *n_vertices,
+                                SCE_EType itype, void *indices, size_t first)
+{
+    SCEuint e[4];
+    size_t n = first;
+    int i, j, code;
+
+    for (i = 0; i < 6; i++) {
+        code  = (1 & (in >> lt_vertices[i * 4 + 0]));
+        code |= (1 & (in >> lt_vertices[i * 4 + 1])) << 1;
+        code |= (1 & (in >> lt_vertices[i * 4 + 2])) << 2;
+        code |= (1 & (in >> lt_vertices[i * 4 + 3])) << 3;
+        if (code == 0 || code == 15)
+            continue;
+
+        for (j = 0; j < 3 + lt_triangles_count[code]; j++) {
+            int edge = lt_triangles[code * 4 + j];
+            e[j] = SCE_MT_GetEdgeVertex (cache, x, y, z,
+                                         &lt_tetra_edges[(i * 6 + edge) * 3],
+                                         d, origin, vertices, n_vertices);
+        }
+        /* same winding as SCE_MT_Tetrahedron() */
+        SCE_Geometry_SetIndex (itype, indices, n++, e[2]);
+        SCE_Geometry_SetIndex (itype, indices, n++, e[1]);
+        SCE_Geometry_SetIndex (itype, indices, n++, e[0]);
+        if (lt_triangles_count[code]) {
+            SCE_Geometry_SetIndex (itype, indices, n++, e[0]);
+            SCE_Geometry_SetIndex (itype, indices, n++, e[3]);
+            SCE_Geometry_SetIndex (itype, indices, n++, e[2]);
+        }
+    }
+    return n - first;
+}
+
+/**
+ * \brief Indexed version of SCE_MT_Generate()
+ * \param vertices output vertices
+ * \param itype type of \p indices, SCE_INDICES_TYPE or SCE_INDICES32_TYPE
+ * \param indices output indices
+ * \param voxels voxels
+ * \param region region of the cells
+ * \param w width of \p voxels
+ * \param h height of \p voxels
+ * \param d depth of \p voxels
+ * \param n_vertices number of vertices generated
+ * \param n_indices number of indices generated
+ *
+ * Triangles are the same as the ones of SCE_MT_Generate(), but vertices
+ * are shared between the tetrahedra of a cell and between neighboring
+ * cells: a single vertex is generated per lattice edge crossed by the
+ * surface.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MT_CountIndexed(), SCE_MT_GenerateNormals()
+ */
+int SCE_MT_GenerateIndexed (SCEvertices *vertices, SCE_EType itype,
+                            void *indices, const unsigned char *voxels,
+                            const SCE_SIntRect3 *region,
+                            SCEuint w, SCEuint h, SCEuint d,
+                            size_t *n_vertices, size_t *n_indices)
+{
+    SCE_SMTEdgeCache cache;
+    SCE_TVector3 origin;
+    float densities[8];
+    SCEuint x, y, z, i;
+    unsigned int in;
+    int p1[3], p2[3];
+
+#define getoffset(x_, y_, z_) ((w) * ((h) * (z_) + (y_)) + (x_))
+
+    SCE_Rectangle3_GetPointsv (region, p1, p2);
+    *n_vertices = *n_indices = 0;
+    if (p2[0] <= p1[0] || p2[1] <= p1[1] || p2[2] <= p1[2])
+        return SCE_OK;
+
+    cache.pw = p2[0] - p1[0] + 1;
+    cache.ph = p2[1] - p1[1] + 1;
+    if (!(cache.slots = SCE_malloc (2 * cache.pw * cache.ph *
+                                    SCE_MT_NUM_DIRS * sizeof *cache.slots))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    SCE_MT_ResetPlane (&cache, 0);
+    SCE_MT_ResetPlane (&cache, 1);
+
+    for (z = p1[2]; z < p2[2]; z++) {
+        /* the plane of the previous slice is not used anymore */
+        if (z > p1[2])
+            SCE_MT_ResetPlane (&cache, z - p1[2] + 1);
+        origin[2] = z;
+        for (y = p1[1]; y < p2[1]; y++) {
+            origin[1] = y;
+            for (x = p1[0]; x < p2[0]; x++) {
+                origin[0] = x;
+
+                densities[0] = voxels[getoffset(x,     y,     z    )];
+                densities[1] = voxels[getoffset(x + 1, y,     z    )];
+                densities[2] = voxels[getoffset(x + 1, y + 1, z    )];
+                densities[3] = voxels[getoffset(x,     y + 1, z    )];
+                densities[4] = voxels[getoffset(x,     y + 1, z + 1)];
+                densities[5] = voxels[getoffset(x + 1, y + 1, z + 1)];
+                densities[6] = voxels[getoffset(x + 1, y,     z + 1)];
+                densities[7] = voxels[getoffset(x,     y,     z + 1)];
+
+                in = 0;
+                for (i = 0; i < 8; i++) {
+                    densities[i] = densities[i] / 128.0 - 1.0;
+                    in |= (densities[i] > 0.0) << i;
+                }
+                if (in == 0 || in == 255)
+                    continue;
+
+                *n_indices += SCE_MT_IndexCell (&cache, x - p1[0], y - p1[1],
+                                                z - p1[2], in, densities,
+                                                origin, vertices, n_vertices,
+                                                itype, indices, *n_indices);
+            }
+        }
+    }
+
+#undef getoffset
+    SCE_free (cache.slots);
+    return SCE_OK;
+}
+
+/**
+ * \brief Counts the vertices and indices SCE_MT_GenerateIndexed() would
+ * generate
+ * \param voxels voxels
+ * \param region region of the cells
+ * \param w width of \p voxels
+ * \param h height of \p voxels
+ * \param d depth of \p voxels
+ * \param n_vertices number of vertices
+ * \param n_indices number of indices
+ */
+void SCE_MT_CountIndexed (const unsigned char *voxels,
+                          const SCE_SIntRect3 *region,
+                          SCEuint w, SCEuint h, SCEuint d,
+                          size_t *n_vertices, size_t *n_indices)
+{
+    SCEuint x, y, z, i;
+    size_t n = 0;
+    int p1[3], p2[3];
+
+#define getoffset(x_, y_, z_) ((w) * ((h) * (z_) + (y_)) + (x_))
+
+    SCE_Rectangle3_GetPointsv (region, p1, p2);
+    *n_indices = SCE_MT_Count (voxels, region, w, h, d);
+    *n_vertices = 0;
+    if (p2[0] <= p1[0] || p2[1] <= p1[1] || p2[2] <= p1[2])
+        return;
+
+    /* every lattice edge of the closed region is used by a tetrahedron,
+       one vertex is generated for each edge the surface crosses */
+    for (z = p1[2]; z <= p2[2]; z++) {
+        for (y = p1[1]; y <= p2[1]; y++) {
+            for (x = p1[0]; x <= p2[0]; x++) {
+                int in = voxels[getoffset (x, y, z)] > 128;
+                for (i = 0; i < SCE_MT_NUM_DIRS; i++) {
+                    const int *dir = &lt_dirs[i * 3];
+                    int x2 = x + dir[0], y2 = y + dir[1], z2 = z + dir[2];
+                    if (x2 < p1[0] || x2 > p2[0] || y2 < p1[1] ||
+                        y2 > p2[1] || z2 > p2[2])
+                        continue;
+                    if (in != (voxels[getoffset (x2, y2, z2)] > 128))
+                        n++;
+                }
+            }
+        }
+    }
+
+#undef getoffset
+    *n_vertices = n;
+}
+
+/**
+ * \brief Indexed version of SCE_MT_GenerateArrays()
+ * \param pos array receiving the positions
+ * \param nor array receiving the normals, can be NULL
+ * \param idx array receiving the indices
+ * \param voxels voxels
+ * \param region region of the cells
+ * \param w width of \p voxels
+ * \param h height of \p voxels
+ * \param d depth of \p voxels
+ * \param n_vertices number of vertices generated
+ * \param n_indices number of indices generated
+ *
+ * The type of the indices is given by SCE_Geometry_GetIndicesTypeFor().
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_MT_GenerateIndexed(), SCE_MT_CountIndexed()
+ */
+int SCE_MT_GenerateIndexedArrays (SCE_SGeometryArray *pos,
+                                  SCE_SGeometryArray *nor,
+                                  SCE_SGeometryArray *idx,
+                                  const unsigned char *voxels,
+                                  const SCE_SIntRect3 *region,
+                                  SCEuint w, SCEuint h, SCEuint d,
+                                  size_t *n_vertices, size_t *n_indices)
+{
+    SCEvertices *vertices = NULL, *normals = NULL;
+    void *indices = NULL;
+    SCE_EType itype;
+    size_t n_v, n_i;
+
+    SCE_MT_CountIndexed (voxels, region, w, h, d, &n_v, &n_i);
+    itype = SCE_Geometry_GetIndicesTypeFor (n_v);
+    /* never allocate 0 bytes */
+    n_v = MAX (n_v, 1);
+    n_i = MAX (n_i, 1);
+
+    if (!(vertices = SCE_Geometry_AllocArrayData (pos, 3 * n_v *
+                                                  sizeof *vertices)))
+        goto fail;
+    SCE_Geometry_SetArrayPosition (pos, 0, 3, vertices, SCE_TRUE);
+    if (nor) {
+        if (!(normals = SCE_Geometry_AllocArrayData (nor, 3 * n_v *
+                                                     sizeof *normals)))
+            goto fail;
+        SCE_Geometry_SetArrayNormal (nor, 0, normals, SCE_TRUE);
+    }
+    if (!(indices = SCE_Geometry_AllocArrayData (idx, n_i *
+                                                 SCE_Type_Sizeof (itype))))
+        goto fail;
+    SCE_Geometry_SetArrayIndices (idx, itype, indices, SCE_TRUE);
+
+    if (SCE_MT_GenerateIndexed (vertices, itype, indices, voxels, region,
+                                w, h, d, n_vertices, n_indices) < 0)
+        goto fail;
+    if (nor)
+        SCE_MT_GenerateNormals (normals, vertices, *n_vertices, voxels,
+                                w, h, d);
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
@@ -86,8 +86,9 @@ static void* SCE_OBJ_Load (FILE *fp, const char *fname, void *unused)
 
     SCE_Geometry_SetPrimitiveType (geom, SCE_TRIANGLES);
 
-    if (SCE_Geometry_SetData (geom, me->pos, me->nor, me->tex, NULL,
-                              me->vcount, me->icount) < 0)
+    if (SCE_Geometry_SetData (geom, me->pos, me->nor, me->tex,
+                              SCE_INDICES32_TYPE, NULL, me->vcount,
+                              me->icount) < 0)
         goto fail;
     me->pos = me->nor = me->tex = NULL;
     if (me->indices) {
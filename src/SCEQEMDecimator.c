@@ -17,8 +17,12 @@
  -----------------------------------------------------------------------------*/
 
 /* created: 09/03/2013
-   updated: 11/03/2013 */
+   updated: 17/10/2026 */
 
+#include <string.h>             /* memset() */
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 #include <SCE/utils/SCEUtils.h>
 #include "SCE/core/SCEGeometry.h"
 
@@ -31,12 +35,21 @@ void SCE_QEMD_Init (SCE_SQEMMesh *mesh)
     mesh->original_vertices = NULL;
     mesh->vertices = NULL;
     mesh->indices = NULL;
+    mesh->n_faces = 0;
+    mesh->offsets = NULL;
+    mesh->faces = NULL;
+    mesh->heap = NULL;
+    mesh->heap_size = mesh->max_heap = 0;
+    mesh->mark = 0;
     mesh->interleaved = SCE_FALSE;
 }
 void SCE_QEMD_Clear (SCE_SQEMMesh *mesh)
 {
     SCE_free (mesh->vertices);
     SCE_free (mesh->indices);
+    SCE_free (mesh->offsets);
+    SCE_free (mesh->faces);
+    SCE_free (mesh->heap);
 }
 
 /* you'd better not give this function 0 */
@@ -51,8 +64,13 @@ void SCE_QEMD_SetMaxIndices (SCE_SQEMMesh *mesh, SCEuint n)
 
 int SCE_QEMD_Build (SCE_SQEMMesh *mesh)
 {
-    SCE_free (mesh->vertices);
-    SCE_free (mesh->indices);
+    SCE_QEMD_Clear (mesh);
+    mesh->vertices = NULL;
+    mesh->indices = NULL;
+    mesh->offsets = NULL;
+    mesh->faces = NULL;
+    mesh->heap = NULL;
+    mesh->heap_size = mesh->max_heap = 0;
 
     if (!(mesh->vertices = SCE_malloc (mesh->max_vertices *
                                        sizeof *mesh->vertices)))
@@ -60,6 +78,16 @@ int SCE_QEMD_Build (SCE_SQEMMesh *mesh)
     if (!(mesh->indices = SCE_malloc (mesh->max_indices *
                                       sizeof *mesh->indices)))
         goto fail;
+    if (!(mesh->offsets = SCE_malloc ((mesh->max_vertices + 1) *
+                                      sizeof *mesh->offsets)))
+        goto fail;
+    if (!(mesh->faces = SCE_malloc (mesh->max_indices *
+                                    sizeof *mesh->faces)))
+        goto fail;
+    /* grown by SCE_QEMD_PushEdge() if needed */
+    mesh->max_heap = MAX (mesh->max_indices, 1);
+    if (!(mesh->heap = SCE_malloc (mesh->max_heap * sizeof *mesh->heap)))
+        goto fail;
 
     return SCE_OK;
 fail:
@@ -68,7 +96,7 @@ fail:
 }
 
 
-static void SCE_QEMD_MakeMatrix (SCE_SPlane *p, SCE_TMatrix4 m)
+static void SCE_QEMD_MakeQuadric (SCE_SPlane *p, SCE_TQEMQuadric q)
 {
     float a, b, c, d;
     SCE_TVector3 n;
@@ -76,11 +104,81 @@ static void SCE_QEMD_MakeMatrix (SCE_SPlane *p, SCE_TMatrix4 m)
     SCE_Plane_GetNormalv (p, n);
     d = SCE_Plane_GetDistance (p);
     a = n[0]; b = n[1]; c = n[2];
-    SCE_Matrix4_Set (m,
-                     a*a, a*b, a*c, a*d,
-                     b*a, b*b, b*c, b*d,
-                     c*a, c*b, c*c, c*d,
-                     d*a, d*b, d*c, d*d);
+    q[0] = a*a; q[1] = a*b; q[2] = a*c; q[3] = a*d;
+    q[4] = b*b; q[5] = b*c; q[6] = b*d;
+    q[7] = c*c; q[8] = c*d;
+    q[9] = d*d;
+}
+
+/* r = a + b, r can be a */
+static void SCE_QEMD_AddQuadric (const SCE_TQEMQuadric a,
+                                 const SCE_TQEMQuadric b, SCE_TQEMQuadric r)
+{
+#ifdef __SSE__
+    _mm_storeu_ps (&r[0], _mm_add_ps (_mm_loadu_ps (&a[0]),
+                                      _mm_loadu_ps (&b[0])));
+    _mm_storeu_ps (&r[4], _mm_add_ps (_mm_loadu_ps (&a[4]),
+                                      _mm_loadu_ps (&b[4])));
+    r[8] = a[8] + b[8];
+    r[9] = a[9] + b[9];
+#else
+    int i;
+    for (i = 0; i < 10; i++)
+        r[i] = a[i] + b[i];
+#endif
+}
+
+/* v^T Q v with v = (x, y, z, 1) */
+static float SCE_QEMD_QuadricError (const SCE_TQEMQuadric q,
+                                    const SCE_TVector3 v)
+{
+    float x = v[0], y = v[1], z = v[2];
+#ifdef __SSE__
+    /* terms matching q[0..3] and q[4..7] */
+    __m128 t0 = _mm_set_ps (2.0 * x, 2.0 * x * z, 2.0 * x * y, x * x);
+    __m128 t1 = _mm_set_ps (z * z, 2.0 * y, 2.0 * y * z, y * y);
+    float e[4];
+
+    t0 = _mm_add_ps (_mm_mul_ps (t0, _mm_loadu_ps (&q[0])),
+                     _mm_mul_ps (t1, _mm_loadu_ps (&q[4])));
+    _mm_storeu_ps (e, t0);
+    return SCE_Math_Fabsf (e[0] + e[1] + e[2] + e[3] + 2.0 * z * q[8] + q[9]);
+#else
+    return SCE_Math_Fabsf (q[0] * x * x + 2.0 * q[1] * x * y +
+                           2.0 * q[2] * x * z + 2.0 * q[3] * x +
+                           q[4] * y * y + 2.0 * q[5] * y * z +
+                           2.0 * q[6] * y + q[7] * z * z +
+                           2.0 * q[8] * z + q[9]);
+#endif
+}
+
+#define SCE_QEMD_MIN_DET 1e-8
+
+/* position minimizing the error: solves the 3x3 system A v = -b of the
+   upper left block A and the last column b, in double precision since
+   A is often close to singular */
+static int SCE_QEMD_QuadricOptimum (const SCE_TQEMQuadric q, SCE_TVector3 v)
+{
+    double a = q[0], b = q[1], c = q[2], e = q[4], f = q[5], h = q[7];
+    double c0, c1, c2, c4, c5, c7, det, tr;
+
+    /* cofactors, A being symmetric so is its inverse */
+    c0 = e * h - f * f;
+    c1 = f * c - b * h;
+    c2 = b * f - e * c;
+    c4 = a * h - c * c;
+    c5 = c * b - a * f;
+    c7 = a * e - b * b;
+    det = a * c0 + b * c1 + c * c2;
+    /* relative to the scale of the quadric */
+    tr = a + e + h;
+    if ((det < 0.0 ? -det : det) <= SCE_QEMD_MIN_DET * tr * tr * tr)
+        return SCE_FALSE;
+
+    v[0] = -(c0 * q[3] + c1 * q[6] + c2 * q[8]) / det;
+    v[1] = -(c1 * q[3] + c4 * q[6] + c5 * q[8]) / det;
+    v[2] = -(c2 * q[3] + c5 * q[6] + c7 * q[8]) / det;
+    return SCE_TRUE;
 }
 
 static void SCE_QEMD_InitQuadrics (SCE_SQEMMesh *mesh)
@@ -88,11 +186,11 @@ static void SCE_QEMD_InitQuadrics (SCE_SQEMMesh *mesh)
     size_t i;
     SCE_SPlane p;
     SCE_SQEMVertex *a, *b, *c;
-    SCE_TMatrix4 q;
+    SCE_TQEMQuadric q;
     SCE_TVector3 v;
 
     for (i = 0; i < mesh->n_vertices; i++)
-        SCE_Matrix4_Null (mesh->vertices[i].q);
+        memset (mesh->vertices[i].q, 0, sizeof mesh->vertices[i].q);
 
     /* for each plane */
     for (i = 0; i < mesh->n_indices; i += 3) {
@@ -106,19 +204,24 @@ static void SCE_QEMD_InitQuadrics (SCE_SQEMMesh *mesh)
         if (SCE_Vector3_IsNull (v))
             continue;
         SCE_Plane_Normalize (&p, SCE_TRUE);
-        SCE_QEMD_MakeMatrix (&p, q);
+        SCE_QEMD_MakeQuadric (&p, q);
 
         /* add it to every vertex */
-        SCE_Matrix4_AddCopy (a->q, q);
-        SCE_Matrix4_AddCopy (b->q, q);
-        SCE_Matrix4_AddCopy (c->q, q);
+        SCE_QEMD_AddQuadric (a->q, q, a->q);
+        SCE_QEMD_AddQuadric (b->q, q, b->q);
+        SCE_QEMD_AddQuadric (c->q, q, c->q);
     }
 }
 
+/**
+ * \brief Sets the mesh to decimate
+ * \param itype type of \p indices, SCE_INDICES_TYPE or SCE_INDICES32_TYPE
+ * \sa SCE_QEMD_Get()
+ */
 void SCE_QEMD_Set (SCE_SQEMMesh *mesh, const SCEvertices *vertices,
                    const SCEvertices *normals, const SCEubyte *colors,
-                   const SCEubyte *anchors, const SCEindices *indices,
-                   SCEuint n_vertices, SCEuint n_indices)
+                   const SCEubyte *anchors, SCE_EType itype,
+                   const void *indices, SCEuint n_vertices, SCEuint n_indices)
 {
     size_t i;
 
@@ -127,14 +230,17 @@ void SCE_QEMD_Set (SCE_SQEMMesh *mesh, const SCEvertices *vertices,
     mesh->original_vertices = vertices;
     mesh->interleaved = SCE_FALSE;
 
-    memcpy (mesh->indices, indices, n_indices * sizeof *indices);
+    for (i = 0; i < n_indices; i++)
+        mesh->indices[i] = SCE_Geometry_GetIndex (itype, indices, i);
     for (i = 0; i < n_vertices; i++) {
         SCE_Vector3_Copy (mesh->vertices[i].v, &vertices[i * 3]);
         if (normals)
             SCE_Vector3_Copy (mesh->vertices[i].n, &normals[i * 3]);
         if (colors)
             mesh->vertices[i].color = colors[i];
-        mesh->vertices[i].index = -1;
+        mesh->vertices[i].parent = mesh->vertices[i].next = i;
+        mesh->vertices[i].stamp = 0;
+        mesh->vertices[i].mark = 0;
         mesh->vertices[i].final = 0;
         if (anchors)
             mesh->vertices[i].anchor = anchors[i];
@@ -145,8 +251,8 @@ void SCE_QEMD_Set (SCE_SQEMMesh *mesh, const SCEvertices *vertices,
     SCE_QEMD_InitQuadrics (mesh);
 }
 void SCE_QEMD_SetInterleaved (SCE_SQEMMesh *mesh, const SCEvertices *vertices,
-                              const SCEindices *indices, SCEuint n_vertices,
-                              SCEuint n_indices)
+                              SCE_EType itype, const void *indices,
+                              SCEuint n_vertices, SCEuint n_indices)
 {
     size_t i;
 
@@ -155,11 +261,14 @@ void SCE_QEMD_SetInterleaved (SCE_SQEMMesh *mesh, const SCEvertices *vertices,
     mesh->original_vertices = vertices;
     mesh->interleaved = SCE_TRUE;
 
-    memcpy (mesh->indices, indices, n_indices * sizeof *indices);
+    for (i = 0; i < n_indices; i++)
+        mesh->indices[i] = SCE_Geometry_GetIndex (itype, indices, i);
     for (i = 0; i < n_vertices; i++) {
         SCE_Vector3_Copy (mesh->vertices[i].v, &vertices[i * 6]);
         SCE_Vector3_Copy (mesh->vertices[i].n, &vertices[i * 6 + 3]);
-        mesh->vertices[i].index = -1;
+        mesh->vertices[i].parent = mesh->vertices[i].next = i;
+        mesh->vertices[i].stamp = 0;
+        mesh->vertices[i].mark = 0;
         mesh->vertices[i].final = 0;
         mesh->vertices[i].anchor = SCE_FALSE;
     }
@@ -167,45 +276,41 @@ void SCE_QEMD_SetInterleaved (SCE_SQEMMesh *mesh, const SCEvertices *vertices,
     SCE_QEMD_InitQuadrics (mesh);
 }
 
-void SCE_QEMD_AnchorVertices (SCE_SQEMMesh *mesh, const SCEindices *indices,
-                              SCEuint n)
+void SCE_QEMD_AnchorVertices (SCE_SQEMMesh *mesh, SCE_EType itype,
+                              const void *indices, SCEuint n)
 {
     SCEuint i;
 
     for (i = 0; i < n; i++)
-        mesh->vertices[indices[i]].anchor = SCE_TRUE;
+        mesh->vertices[SCE_Geometry_GetIndex (itype, indices, i)].anchor =
+            SCE_TRUE;
 }
 
 
-static SCEuint SCE_QEMD_SolveVertexList (SCE_SQEMMesh *mesh, SCEuint v)
+/* union-find with path compression */
+static SCEuint SCE_QEMD_Find (SCE_SQEMMesh *mesh, SCEuint v)
 {
-    SCE_SQEMVertex *vertex = NULL;
-    SCEuint last = v;
-
-    vertex = &mesh->vertices[v];
-    if (vertex->index > -1) {
-
-        /* get last index */
-        do {
-            last = vertex->index;
-            vertex = &mesh->vertices[last];
-        } while (vertex->index > -1);
-
-        /* replace indices of the vertices with last index */
-        vertex = &mesh->vertices[v];
-        while (vertex->index > -1) {
-            long next = vertex->index;
-            vertex->index = last;
-            vertex = &mesh->vertices[next];
-        }
+    SCEuint root = v, next;
+
+    while (mesh->vertices[root].parent != root)
+        root = mesh->vertices[root].parent;
+    while (v != root) {
+        next = mesh->vertices[v].parent;
+        mesh->vertices[v].parent = root;
+        v = next;
     }
-
-    return last;
+    return root;
 }
 
+/**
+ * \brief Gets the decimated mesh
+ * \param itype type of \p indices, SCE_Geometry_GetIndicesTypeFor() of the
+ * number of vertices given to SCE_QEMD_Set() is always large enough
+ * \sa SCE_QEMD_Set()
+ */
 void SCE_QEMD_Get (SCE_SQEMMesh *mesh, SCEvertices *vertices,
-                   SCEvertices *normals, SCEubyte *colors, SCEindices *indices,
-                   SCEuint *n_vertices, SCEuint *n_indices)
+                   SCEvertices *normals, SCEubyte *colors, SCE_EType itype,
+                   void *indices, SCEuint *n_vertices, SCEuint *n_indices)
 {
     size_t i, index;
     SCE_SQEMVertex *v = NULL;
@@ -213,7 +318,7 @@ void SCE_QEMD_Get (SCE_SQEMMesh *mesh, SCEvertices *vertices,
 
     /* mark used vertices */
     for (i = 0; i < mesh->n_indices; i++) {
-        index = SCE_QEMD_SolveVertexList (mesh, mesh->indices[i]);
+        index = SCE_QEMD_Find (mesh, mesh->indices[i]);
         mesh->vertices[index].final = 1;
     }
 
@@ -223,7 +328,7 @@ void SCE_QEMD_Get (SCE_SQEMMesh *mesh, SCEvertices *vertices,
     if (mesh->interleaved) {
         for (i = 0; i < mesh->n_vertices; i++) {
             v = &mesh->vertices[i];
-            if (v->index == -1 && v->final) {
+            if (v->parent == i && v->final) {
                 SCE_Vector3_Copy (&vertices[index * 6], v->v);
                 SCE_Vector3_Copy (&vertices[index * 6 + 3], v->n);
                 v->final = index;
@@ -233,7 +338,7 @@ void SCE_QEMD_Get (SCE_SQEMMesh *mesh, SCEvertices *vertices,
     } else {
         for (i = 0; i < mesh->n_vertices; i++) {
             v = &mesh->vertices[i];
-            if (v->index == -1 && v->final) {
+            if (v->parent == i && v->final) {
                 SCE_Vector3_Copy (&vertices[index * 3], v->v);
                 if (normals)
                     SCE_Vector3_Copy (&normals[index * 3], v->n);
@@ -246,307 +351,573 @@ void SCE_QEMD_Get (SCE_SQEMMesh *mesh, SCEvertices *vertices,
     }
     *n_vertices = index;
 
-    /* solve vertex lists */
-    for (i = 0; i < mesh->n_indices; i++) {
-        v = &mesh->vertices[mesh->indices[i]];
-        if (v->index > -1)
-            v->final = mesh->vertices[v->index].final;
-    }
-
     for (i = 0; i < mesh->n_indices; i += 3) {
-        i1 = mesh->vertices[mesh->indices[i]].final;
-        i2 = mesh->vertices[mesh->indices[i + 1]].final;
-        i3 = mesh->vertices[mesh->indices[i + 2]].final;
-        /* invalid triangles have been removed by FixInversion() */
-        indices[i + 0] = i1;
-        indices[i + 1] = i2;
-        indices[i + 2] = i3;
+        i1 = mesh->vertices[SCE_QEMD_Find (mesh, mesh->indices[i])].final;
+        i2 = mesh->vertices[SCE_QEMD_Find (mesh, mesh->indices[i + 1])].final;
+        i3 = mesh->vertices[SCE_QEMD_Find (mesh, mesh->indices[i + 2])].final;
+        /* degenerate triangles have been removed by SCE_QEMD_Compact() */
+        SCE_Geometry_SetIndex (itype, indices, i + 0, i1);
+        SCE_Geometry_SetIndex (itype, indices, i + 1, i2);
+        SCE_Geometry_SetIndex (itype, indices, i + 2, i3);
     }
     *n_indices = mesh->n_indices;
 }
 
 
-/* TODO: wtf there's still no function to do that in the sce? */
-static SCEuint myrand (SCEuint inf, SCEuint sup)
-{
-    float n = random ();
-    n /= RAND_MAX;
-    n = n * (sup - inf) + inf;
-    return (SCEuint)(n + 0.5);
-}
-
-typedef struct edge Edge;
-struct edge {
-    SCEuint index;
-    SCEindices v1, v2;
-    float error;
-    int anchored;
-    SCE_TVector3 v, n;
-    SCE_TMatrix4 q;
-};
-
-static void SCE_QEMD_PickCandidates (SCE_SQEMMesh *mesh, SCEuint n,
-                                     Edge *candidates)
-{
-    SCEuint step = mesh->n_indices / (3 * n);
-    SCEuint m = n, i;
-
-    /* NOTE: hopefully, step > 0 */
-    while (n--) {
-        /* TODO: stupid trick to avoid duplicates */
-        SCEuint r = myrand (step * n, step * (n + 1) - 1);
-
-        candidates[n].index = r * 3;
-        /* NOTE: this switch is awful */
-        switch (myrand (0, 2)) {
-        case 0:
-            candidates[n].v1 = mesh->indices[r * 3];
-            candidates[n].v2 = mesh->indices[r * 3 + 1];
-            break;
-        case 1:
-            candidates[n].v1 = mesh->indices[r * 3 + 1];
-            candidates[n].v2 = mesh->indices[r * 3 + 2];
-            break;
-        case 2:
-            candidates[n].v1 = mesh->indices[r * 3];
-            candidates[n].v2 = mesh->indices[r * 3 + 2];
-            break;
-        default:;
-        }
-    }
-}
-
-static float SCE_QEMD_VertexError (const SCE_TMatrix4 m, const SCE_TVector3 v)
-{
-    SCE_TVector4 a, b;
-    SCE_Vector4_Set (a, v[0], v[1], v[2], 1.0);
-    SCE_Matrix4_MulV4 (m, a, b);
-    return SCE_Math_Fabsf (SCE_Vector4_Dot (a, b));
-}
-
-static void SCE_QEMD_ComputeError (SCE_SQEMMesh *mesh, Edge *edge)
+static void SCE_QEMD_ComputeError (SCE_SQEMMesh *mesh, SCE_SQEMEdge *edge)
 {
+    SCE_SQEMVertex *v1 = &mesh->vertices[edge->v1];
+    SCE_SQEMVertex *v2 = &mesh->vertices[edge->v2];
     SCE_TVector3 d;
-    SCE_TMatrix4 m;
+    SCE_TQEMQuadric q;
     float coef = 0.0;
 
-    SCE_Matrix4_Add (mesh->vertices[edge->v1].q, mesh->vertices[edge->v2].q,
-                     edge->q);
+    SCE_QEMD_AddQuadric (v1->q, v2->q, q);
 
-    edge->anchored = SCE_FALSE;
     /* check for anchors */
-    if (mesh->vertices[edge->v1].anchor) {
-        SCE_Vector3_Copy (edge->v, mesh->vertices[edge->v1].v);
-        SCE_Vector3_Copy (edge->n, mesh->vertices[edge->v1].n);
-        if (mesh->vertices[edge->v2].anchor)
-            edge->anchored = SCE_TRUE;
+    if (v1->anchor) {
+        SCE_Vector3_Copy (edge->v, v1->v);
+        SCE_Vector3_Copy (edge->n, v1->n);
+        edge->error = SCE_QEMD_QuadricError (q, edge->v);
         coef = 1000.0;
-    } else if (mesh->vertices[edge->v2].anchor) {
-        SCE_Vector3_Copy (edge->v, mesh->vertices[edge->v2].v);
-        SCE_Vector3_Copy (edge->n, mesh->vertices[edge->v2].n);
+    } else if (v2->anchor) {
+        SCE_Vector3_Copy (edge->v, v2->v);
+        SCE_Vector3_Copy (edge->n, v2->n);
+        edge->error = SCE_QEMD_QuadricError (q, edge->v);
         coef = 1000.0;
-    } else
-    /* compute least error vertex position */
-    if (SCE_Matrix4_Inverse (edge->q, m) && m[15] > SCE_EPSILONF) {
-        SCE_Matrix4_GetTranslation (m, edge->v);
-        SCE_Vector3_Operator1 (edge->v, /=, m[15]);
-        SCE_Vector3_Operator2v (edge->n, = 0.5 *, mesh->vertices[edge->v1].n,
-                                + 0.5 *, mesh->vertices[edge->v2].n);
-        /* NOTE: renormalize edge->n ? */
     } else {
-        SCE_Vector3_Operator2v (edge->v, = 0.5 *, mesh->vertices[edge->v1].v,
-                                + 0.5 *, mesh->vertices[edge->v2].v);
-        SCE_Vector3_Operator2v (edge->n, = 0.5 *, mesh->vertices[edge->v1].n,
-                                + 0.5 *, mesh->vertices[edge->v2].n);
-        /* TODO: choose between v1, v2 and (v1 + v2) / 2 */
+        SCE_Vector3_Operator2v (edge->n, = 0.5 *, v1->n, + 0.5 *, v2->n);
+        /* NOTE: renormalize edge->n ? */
+        /* compute least error vertex position */
+        if (SCE_QEMD_QuadricOptimum (q, edge->v))
+            edge->error = SCE_QEMD_QuadricError (q, edge->v);
+        else {
+            /* choose between v1, v2 and (v1 + v2) / 2 */
+            float e1, e2;
+            SCE_Vector3_Operator2v (d, = 0.5 *, v1->v, + 0.5 *, v2->v);
+            edge->error = SCE_QEMD_QuadricError (q, d);
+            SCE_Vector3_Copy (edge->v, d);
+            e1 = SCE_QEMD_QuadricError (q, v1->v);
+            e2 = SCE_QEMD_QuadricError (q, v2->v);
+            if (e1 < edge->error) {
+                edge->error = e1;
+                SCE_Vector3_Copy (edge->v, v1->v);
+            }
+            if (e2 < edge->error) {
+                edge->error = e2;
+                SCE_Vector3_Copy (edge->v, v2->v);
+            }
+        }
     }
 
-    edge->error = SCE_QEMD_VertexError (edge->q, edge->v);
-    SCE_Vector3_Operator2v (d, =, mesh->vertices[edge->v1].v, -,
-                            mesh->vertices[edge->v2].v);
+    SCE_Vector3_Operator2v (d, =, v1->v, -, v2->v);
     edge->error += 0.001 * SCE_Vector3_Dot (d, d);
     edge->error += coef;
 }
 
-static void SCE_QEMD_RemoveTriangle (SCE_SQEMMesh *mesh, SCEuint index)
+
+/* returns SCE_FALSE if the face has been collapsed */
+static int SCE_QEMD_GetFace (SCE_SQEMMesh *mesh, SCEuint face, SCEuint f[3])
 {
-    mesh->indices[index]     = mesh->indices[mesh->n_indices - 3];
-    mesh->indices[index + 1] = mesh->indices[mesh->n_indices - 2];
-    mesh->indices[index + 2] = mesh->indices[mesh->n_indices - 1];
-    mesh->n_indices -= 3;
+    f[0] = SCE_QEMD_Find (mesh, mesh->indices[face * 3]);
+    f[1] = SCE_QEMD_Find (mesh, mesh->indices[face * 3 + 1]);
+    f[2] = SCE_QEMD_Find (mesh, mesh->indices[face * 3 + 2]);
+    return f[0] != f[1] && f[1] != f[2] && f[0] != f[2];
 }
 
-static void SCE_QEMD_CollapseEdge (SCE_SQEMMesh *mesh, Edge *edge)
+/* vertex -> faces adjacency of the current triangles, in CSR form */
+static void SCE_QEMD_BuildAdjacency (SCE_SQEMMesh *mesh)
 {
-    /* merge vertices by linking them */
-    mesh->vertices[edge->v2].index = edge->v1;
-    /* copy data */
-    SCE_Vector3_Copy (mesh->vertices[edge->v1].v, edge->v);
-    SCE_Matrix4_Copy (mesh->vertices[edge->v1].q, edge->q);
-    mesh->vertices[edge->v1].anchor = mesh->vertices[edge->v2].anchor ||
-        mesh->vertices[edge->v1].anchor;
+    SCEuint i, f[3];
 
-    /* invalidate triangle in the index list */
-    SCE_QEMD_RemoveTriangle (mesh, edge->index);
+    memset (mesh->offsets, 0, (mesh->n_vertices + 1) * sizeof *mesh->offsets);
+    mesh->n_faces = 0;
+    for (i = 0; i < mesh->n_indices / 3; i++) {
+        if (!SCE_QEMD_GetFace (mesh, i, f))
+            continue;
+        mesh->offsets[f[0] + 1]++;
+        mesh->offsets[f[1] + 1]++;
+        mesh->offsets[f[2] + 1]++;
+        mesh->n_faces++;
+    }
+    for (i = 0; i < mesh->n_vertices; i++) {
+        mesh->offsets[i + 1] += mesh->offsets[i];
+        /* every vertex is alone in its set of faces */
+        mesh->vertices[i].next = i;
+        mesh->vertices[i].mark = 0;
+    }
+    mesh->mark = 0;
+    /* offsets[v] is used as a cursor and ends up at offsets[v + 1] */
+    for (i = 0; i < mesh->n_indices / 3; i++) {
+        if (!SCE_QEMD_GetFace (mesh, i, f))
+            continue;
+        mesh->faces[mesh->offsets[f[0]]++] = i;
+        mesh->faces[mesh->offsets[f[1]]++] = i;
+        mesh->faces[mesh->offsets[f[2]]++] = i;
+    }
+    for (i = mesh->n_vertices; i > 0; i--)
+        mesh->offsets[i] = mesh->offsets[i - 1];
+    mesh->offsets[0] = 0;
 }
 
+#define SCE_QEMD_FOR_EACH_FACE(mesh, root, m, k)                        \
+    m = root; do {                                                      \
+        for (k = (mesh)->offsets[m]; k < (mesh)->offsets[m + 1]; k++)
 
-static int SCE_QEMD_CollapseLeastErrorEdge (SCE_SQEMMesh *mesh, SCEuint n,
-                                             Edge *edges)
+#define SCE_QEMD_END_FOR_EACH_FACE(mesh, root, m)                       \
+        m = (mesh)->vertices[m].next;                                   \
+    } while (m != root)
+
+
+static void SCE_QEMD_SiftUp (SCE_SQEMMesh *mesh, size_t i)
 {
-    SCEuint i;
-    Edge *best = NULL;
-    float error;
-
-    /* get the least error edge */
-    best = &edges[0];
-    error = best->error;
-    for (i = 1; i < n; i++) {
-        if (edges[i].error < error && !edges[i].anchored) {
-            best = &edges[i];
-            error = best->error;
-        }
+    SCE_SQEMEdge edge = mesh->heap[i];
+
+    while (i > 0 && mesh->heap[(i - 1) / 2].error > edge.error) {
+        mesh->heap[i] = mesh->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
     }
+    mesh->heap[i] = edge;
+}
 
-    /* collapse the edge */
-    if (best->anchored)
-        return SCE_FALSE;
-    else {
-        SCE_QEMD_CollapseEdge (mesh, best);
-        return SCE_TRUE;
+static void SCE_QEMD_SiftDown (SCE_SQEMMesh *mesh, size_t i)
+{
+    SCE_SQEMEdge edge = mesh->heap[i];
+    size_t child;
+
+    while ((child = 2 * i + 1) < mesh->heap_size) {
+        if (child + 1 < mesh->heap_size &&
+            mesh->heap[child + 1].error < mesh->heap[child].error)
+            child++;
+        if (mesh->heap[child].error >= edge.error)
+            break;
+        mesh->heap[i] = mesh->heap[child];
+        i = child;
     }
+    mesh->heap[i] = edge;
 }
 
+static int SCE_QEMD_PushEdge (SCE_SQEMMesh *mesh, SCEuint v1, SCEuint v2)
+{
+    SCE_SQEMEdge *edge = NULL;
+
+    /* anchored edges are never collapsed */
+    if (mesh->vertices[v1].anchor && mesh->vertices[v2].anchor)
+        return SCE_OK;
+
+    if (mesh->heap_size == mesh->max_heap) {
+        size_t n = mesh->max_heap * 2;
+        if (!(edge = SCE_realloc (mesh->heap, n * sizeof *edge))) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+        mesh->heap = edge;
+        mesh->max_heap = n;
+    }
 
-static void SCE_QEMD_FixInversion (SCE_SQEMMesh *mesh)
+    edge = &mesh->heap[mesh->heap_size];
+    edge->v1 = v1;
+    edge->v2 = v2;
+    edge->stamp1 = mesh->vertices[v1].stamp;
+    edge->stamp2 = mesh->vertices[v2].stamp;
+    SCE_QEMD_ComputeError (mesh, edge);
+    SCE_QEMD_SiftUp (mesh, mesh->heap_size++);
+    return SCE_OK;
+}
+
+static void SCE_QEMD_PopEdge (SCE_SQEMMesh *mesh, SCE_SQEMEdge *edge)
 {
-    long i, j;
-    SCEuint i1, i2, i3;
-    SCE_TVector3 n1, n2, s1, s2;
-    const SCEvertices *vertices = mesh->original_vertices;
+    *edge = mesh->heap[0];
+    mesh->heap[0] = mesh->heap[--mesh->heap_size];
+    if (mesh->heap_size)
+        SCE_QEMD_SiftDown (mesh, 0);
+}
 
-    /* for each face */
-    for (i = 0; i < mesh->n_indices; i += 3) {
-        /* fetch modified indices */
-        i1 = SCE_QEMD_SolveVertexList (mesh, mesh->indices[i]);
-        i2 = SCE_QEMD_SolveVertexList (mesh, mesh->indices[i + 1]);
-        i3 = SCE_QEMD_SolveVertexList (mesh, mesh->indices[i + 2]);
-        /* ignore removed trianles */
-        if (i1 == i2 || i2 == i3 || i1 == i3) {
-            SCE_QEMD_RemoveTriangle (mesh, i);
-            i -= 3;
+
+/* queues the edges from v to each of its neighbors once, only to the
+   neighbors of greater index if \p greater is true */
+static int SCE_QEMD_QueueEdges (SCE_SQEMMesh *mesh, SCEuint v, int greater)
+{
+    SCEuint m, k, j, f[3];
+
+    mesh->mark++;
+    mesh->vertices[v].mark = mesh->mark;
+    SCE_QEMD_FOR_EACH_FACE (mesh, v, m, k) {
+        if (!SCE_QEMD_GetFace (mesh, mesh->faces[k], f))
             continue;
+        for (j = 0; j < 3; j++) {
+            if (mesh->vertices[f[j]].mark == mesh->mark ||
+                (greater && f[j] < v))
+                continue;
+            mesh->vertices[f[j]].mark = mesh->mark;
+            if (SCE_QEMD_PushEdge (mesh, v, f[j]) < 0) {
+                SCEE_LogSrc ();
+                return SCE_ERROR;
+            }
         }
+    } SCE_QEMD_END_FOR_EACH_FACE (mesh, v, m);
+
+    return SCE_OK;
+}
+
+#define SCE_QEMD_MIN_COS 0.6
+
+/* does moving \p v to \p pos flip one of its faces that do not contain
+   \p other? */
+static int SCE_QEMD_Flips (SCE_SQEMMesh *mesh, SCEuint v, SCEuint other,
+                           const SCE_TVector3 pos)
+{
+    SCEuint m, k, j, f[3];
+    SCE_TVector3 n1, n2, s1, s2;
+    float *p[3];
 
-        /* get original normal */
-        SCE_Vector3_Operator2v (s1, =, &vertices[3 * mesh->indices[i + 1]],
-                                    -, &vertices[3 * mesh->indices[i]]);
-        SCE_Vector3_Operator2v (s2, =, &vertices[3 * mesh->indices[i + 2]],
-                                    -, &vertices[3 * mesh->indices[i]]);
+    SCE_QEMD_FOR_EACH_FACE (mesh, v, m, k) {
+        if (!SCE_QEMD_GetFace (mesh, mesh->faces[k], f))
+            continue;
+        if (f[0] == other || f[1] == other || f[2] == other)
+            continue;
+
+        for (j = 0; j < 3; j++)
+            p[j] = mesh->vertices[f[j]].v;
+        SCE_Vector3_Operator2v (s1, =, p[1], -, p[0]);
+        SCE_Vector3_Operator2v (s2, =, p[2], -, p[0]);
         SCE_Vector3_Cross (n1, s1, s2);
-        if (!SCE_Vector3_IsNull (n1))
-            SCE_Vector3_Normalize (n1);
-
-        /* get modified normal */
-        SCE_Vector3_Operator2v (s1, =, mesh->vertices[i2].v,
-                                    -, mesh->vertices[i1].v);
-        SCE_Vector3_Operator2v (s2, =, mesh->vertices[i3].v,
-                                    -, mesh->vertices[i1].v);
+        if (SCE_Vector3_IsNull (n1))
+            continue;
+
+        for (j = 0; j < 3; j++) {
+            if (f[j] == v)
+                p[j] = (float*)pos;
+        }
+        SCE_Vector3_Operator2v (s1, =, p[1], -, p[0]);
+        SCE_Vector3_Operator2v (s2, =, p[2], -, p[0]);
         SCE_Vector3_Cross (n2, s1, s2);
-        if (!SCE_Vector3_IsNull (n2))
-            SCE_Vector3_Normalize (n2);
-
-        /* compare */
-        if (SCE_Vector3_Dot (n1, n2) < 0.6 || SCE_Vector3_IsNull (n2) ||
-            SCE_Vector3_IsNull (n1)) {
-
-            /* normal has been flipped, remove triangle */
-            Edge edges[3];
-
-            /* make 3 edges of the triangle */
-            edges[0].v1 = i1;
-            edges[0].v2 = i2;
-            edges[0].index = i;
-            edges[1].v1 = i2;
-            edges[1].v2 = i3;
-            edges[1].index = i;
-            edges[2].v1 = i1;
-            edges[2].v2 = i3;
-            edges[2].index = i;
-
-            /* compute their cost */
-            for (j = 0; j < 3; j++)
-                SCE_QEMD_ComputeError (mesh, &edges[j]);
-
-            /* collapse one of them */
-            if (SCE_QEMD_CollapseLeastErrorEdge (mesh, 3, edges)) {
-                /* triangle has been replaced */
-                i -= 3;
-                /* NOTE: it's funny because an anchored triangle is not
-                   likely to be flipped */
-            }
+        if (SCE_Vector3_IsNull (n2))
+            return SCE_TRUE;
+
+        SCE_Vector3_Normalize (n1);
+        SCE_Vector3_Normalize (n2);
+        if (SCE_Vector3_Dot (n1, n2) < SCE_QEMD_MIN_COS)
+            return SCE_TRUE;
+    } SCE_QEMD_END_FOR_EACH_FACE (mesh, v, m);
+
+    return SCE_FALSE;
+}
+
+static int SCE_QEMD_CollapseEdge (SCE_SQEMMesh *mesh, SCE_SQEMEdge *edge)
+{
+    SCE_SQEMVertex *v1 = &mesh->vertices[edge->v1];
+    SCE_SQEMVertex *v2 = &mesh->vertices[edge->v2];
+    SCEuint m, k, f[3], next;
+
+    /* faces around both vertices disappear */
+    SCE_QEMD_FOR_EACH_FACE (mesh, edge->v2, m, k) {
+        if (!SCE_QEMD_GetFace (mesh, mesh->faces[k], f))
+            continue;
+        if (f[0] == edge->v1 || f[1] == edge->v1 || f[2] == edge->v1)
+            mesh->n_faces--;
+    } SCE_QEMD_END_FOR_EACH_FACE (mesh, edge->v2, m);
+
+    /* merge v2 into v1, splicing their lists of vertices */
+    v2->parent = edge->v1;
+    next = v1->next;
+    v1->next = v2->next;
+    v2->next = next;
+    v1->stamp++;
+    v2->stamp++;
+
+    SCE_Vector3_Copy (v1->v, edge->v);
+    SCE_Vector3_Copy (v1->n, edge->n);
+    SCE_QEMD_AddQuadric (v1->q, v2->q, v1->q);
+    v1->anchor = v1->anchor || v2->anchor;
+
+    if (SCE_QEMD_QueueEdges (mesh, edge->v1, SCE_FALSE) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
+
+/* removes collapsed faces and makes the indices point to the roots */
+static void SCE_QEMD_Compact (SCE_SQEMMesh *mesh)
+{
+    SCEuint i, n = 0, f[3];
+
+    for (i = 0; i < mesh->n_indices / 3; i++) {
+        if (SCE_QEMD_GetFace (mesh, i, f)) {
+            mesh->indices[n++] = f[0];
+            mesh->indices[n++] = f[1];
+            mesh->indices[n++] = f[2];
         }
     }
+    mesh->n_indices = n;
 }
 
+static int SCE_QEMD_Run (SCE_SQEMMesh *mesh, SCEuint n, SCEuint n_faces,
+                         float max_error)
+{
+    SCE_SQEMEdge edge;
+    SCEuint i;
+
+    SCE_QEMD_BuildAdjacency (mesh);
+
+    mesh->heap_size = 0;
+    for (i = 0; i < mesh->n_vertices; i++) {
+        if (SCE_QEMD_QueueEdges (mesh, i, SCE_TRUE) < 0)
+            goto fail;
+    }
+
+    while (n && mesh->n_faces > n_faces && mesh->heap_size) {
+        SCE_QEMD_PopEdge (mesh, &edge);
+        /* lazy invalidation */
+        if (edge.stamp1 != mesh->vertices[edge.v1].stamp ||
+            edge.stamp2 != mesh->vertices[edge.v2].stamp)
+            continue;
+        /* the heap is sorted, every other edge is worse */
+        if (max_error >= 0.0 && edge.error > max_error)
+            break;
+        if (SCE_QEMD_Flips (mesh, edge.v1, edge.v2, edge.v) ||
+            SCE_QEMD_Flips (mesh, edge.v2, edge.v1, edge.v))
+            continue;
+        if (SCE_QEMD_CollapseEdge (mesh, &edge) < 0)
+            goto fail;
+        n--;
+    }
 
-#define SCE_QEMD_NUM_CANDIDATES 10
+    SCE_QEMD_Compact (mesh);
+    return SCE_OK;
+fail:
+    SCE_QEMD_Compact (mesh);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
 
 /**
  * \brief Decimate the mesh
  * \param mesh a QEM mesh
  * \param n number of edge contractions to perform
+ *
+ * Edges are contracted by increasing error, contractions that would flip
+ * a triangle are skipped. Stops early when no edge can be contracted.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_QEMD_Decimate()
  */
-void SCE_QEMD_Process (SCE_SQEMMesh *mesh, SCEuint n)
+int SCE_QEMD_Process (SCE_SQEMMesh *mesh, SCEuint n)
 {
-    int i, n_candidates;
-    Edge candidates[SCE_QEMD_NUM_CANDIDATES];
-    SCEuint num = n, infinite = 0;
+    if (SCE_QEMD_Run (mesh, n, 0, SCE_QEMD_NO_MAX_ERROR) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
 
-    while (n) {
-        /* TODO: some stupid checks */
-        if (mesh->n_indices < 42 || infinite >= 10)
-            break;
+/**
+ * \brief Decimate the mesh down to a number of triangles
+ * \param mesh a QEM mesh
+ * \param n_triangles number of triangles to reach
+ * \param max_error stops before contracting an edge whose error is greater
+ * than \p max_error, or SCE_QEMD_NO_MAX_ERROR
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_QEMD_Process()
+ */
+int SCE_QEMD_Decimate (SCE_SQEMMesh *mesh, SCEuint n_triangles,
+                       float max_error)
+{
+    if (SCE_QEMD_Run (mesh, mesh->n_indices, n_triangles, max_error) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
 
-        /* pick random edges */
-        n_candidates = SCE_QEMD_NUM_CANDIDATES;
-        SCE_QEMD_PickCandidates (mesh, n_candidates, candidates);
-
-        /* solve vertex list */
-        for (i = 0; i < n_candidates; i++) {
-            candidates[i].v1 = SCE_QEMD_SolveVertexList (mesh,candidates[i].v1);
-            candidates[i].v2 = SCE_QEMD_SolveVertexList (mesh,candidates[i].v2);
-            if (candidates[i].v1 == candidates[i].v2) {
-                /* edge was already merged, remove triangle */
-                SCE_QEMD_RemoveTriangle (mesh, candidates[i].index);
-                n_candidates--;
-                candidates[i].v1 = candidates[n_candidates].v1;
-                candidates[i].v2 = candidates[n_candidates].v2;
-                candidates[i].index = candidates[n_candidates].index;
-                i--;
-            }
-        }
 
-#define THRESHOLD (SCE_QEMD_NUM_CANDIDATES / 2)
-        if (n_candidates < THRESHOLD) {
-            infinite++;
-            continue;
-        }
+/* batches */
 
-        /* compute their cost */
-        for (i = 0; i < n_candidates; i++)
-            SCE_QEMD_ComputeError (mesh, &candidates[i]);
+struct sce_sqemworker {
+    SCE_SThreadPoolJob job;
+    SCE_SQEMBatch *batch;
+    SCE_SQEMMesh mesh;          /* scratch */
+};
 
-        if (SCE_QEMD_CollapseLeastErrorEdge (mesh, n_candidates, candidates)) {
-            infinite = 0;
-            n--;
-        } else
-            infinite++;
+/**
+ * \brief Initializes a job with no error bound and no target
+ */
+void SCE_QEMD_InitJob (SCE_SQEMJob *job)
+{
+    job->vertices = job->normals = NULL;
+    job->colors = job->anchors = NULL;
+    job->itype = SCE_INDICES_TYPE;
+    job->indices = NULL;
+    job->n_vertices = job->n_indices = 0;
+    job->n_triangles = 0;
+    job->max_error = SCE_QEMD_NO_MAX_ERROR;
+    job->out_vertices = job->out_normals = NULL;
+    job->out_colors = NULL;
+    job->out_indices = NULL;
+    job->out_n_vertices = job->out_n_indices = 0;
+    job->error = SCE_OK;
+}
 
+void SCE_QEMBatch_Init (SCE_SQEMBatch *batch)
+{
+    pthread_mutex_init (&batch->mutex, NULL);
+    batch->workers = NULL;
+    batch->n_workers = 0;
+    batch->jobs = NULL;
+    batch->n_jobs = batch->next = 0;
+}
+void SCE_QEMBatch_Clear (SCE_SQEMBatch *batch)
+{
+    size_t i;
+
+    for (i = 0; i < batch->n_workers; i++)
+        SCE_QEMD_Clear (&batch->workers[i].mesh);
+    SCE_free (batch->workers);
+    pthread_mutex_destroy (&batch->mutex);
+}
+SCE_SQEMBatch* SCE_QEMBatch_Create (void)
+{
+    SCE_SQEMBatch *batch = NULL;
+    if (!(batch = SCE_malloc (sizeof *batch)))
+        SCEE_LogSrc ();
+    else
+        SCE_QEMBatch_Init (batch);
+    return batch;
+}
+void SCE_QEMBatch_Delete (SCE_SQEMBatch *batch)
+{
+    if (batch) {
+        SCE_QEMBatch_Clear (batch);
+        SCE_free (batch);
     }
+}
+
+static int SCE_QEMBatch_AllocWorkers (SCE_SQEMBatch *batch, size_t n)
+{
+    SCE_SQEMWorker *workers = NULL;
+    size_t i;
 
-    if (num) {
-        /* remove flipped and merged triangles */
-        SCE_QEMD_FixInversion (mesh);
+    if (n <= batch->n_workers)
+        return SCE_OK;
+    /* workers are idle, their meshes only hold pointers */
+    if (!(workers = SCE_malloc (n * sizeof *workers))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
     }
+    for (i = 0; i < n; i++) {
+        if (i < batch->n_workers)
+            workers[i].mesh = batch->workers[i].mesh;
+        else
+            SCE_QEMD_Init (&workers[i].mesh);
+        workers[i].batch = batch;
+    }
+    SCE_free (batch->workers);
+    batch->workers = workers;
+    batch->n_workers = n;
+    return SCE_OK;
+}
+
+static int SCE_QEMBatch_RunJob (SCE_SQEMMesh *mesh, SCE_SQEMJob *job)
+{
+    /* grow the scratch mesh only if needed */
+    if (job->n_vertices > mesh->max_vertices ||
+        job->n_indices > mesh->max_indices || !mesh->vertices) {
+        SCE_QEMD_SetMaxVertices (mesh, MAX (job->n_vertices,
+                                            mesh->max_vertices));
+        SCE_QEMD_SetMaxIndices (mesh, MAX (job->n_indices,
+                                           mesh->max_indices));
+        if (SCE_QEMD_Build (mesh) < 0)
+            goto fail;
+    }
+
+    SCE_QEMD_Set (mesh, job->vertices, job->normals, job->colors,
+                  job->anchors, job->itype, job->indices, job->n_vertices,
+                  job->n_indices);
+    if (SCE_QEMD_Decimate (mesh, job->n_triangles, job->max_error) < 0)
+        goto fail;
+    SCE_QEMD_Get (mesh, job->out_vertices, job->out_normals, job->out_colors,
+                  job->itype, job->out_indices, &job->out_n_vertices,
+                  &job->out_n_indices);
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/* each worker takes the next job until there is none left */
+static void SCE_QEMBatch_Run (void *data)
+{
+    SCE_SQEMWorker *worker = data;
+    SCE_SQEMBatch *batch = worker->batch;
+    SCE_SQEMJob *job = NULL;
+
+    for (;;) {
+        pthread_mutex_lock (&batch->mutex);
+        job = NULL;
+        if (batch->next < batch->n_jobs)
+            job = &batch->jobs[batch->next++];
+        pthread_mutex_unlock (&batch->mutex);
+        if (!job)
+            break;
+        job->error = SCE_QEMBatch_RunJob (&worker->mesh, job);
+    }
+}
+
+/**
+ * \brief Decimates a batch of meshes
+ * \param batch a batch
+ * \param pool thread pool to use, if NULL SCE_TPool_GetDefault() is used
+ * \param jobs meshes to decimate
+ * \param n_jobs number of jobs
+ *
+ * One worker is queued on \p pool per thread, workers take the jobs in
+ * order and write the results into the output arrays of each job. If
+ * \p pool is not running, the jobs are processed by the calling thread.
+ * Do not call this function from a job of \p pool.
+ * \return SCE_ERROR if a job failed (see SCE_SQEMJob::error), SCE_OK
+ * otherwise
+ */
+int SCE_QEMBatch_Process (SCE_SQEMBatch *batch, SCE_SThreadPool *pool,
+                          SCE_SQEMJob *jobs, size_t n_jobs)
+{
+    size_t i, n_workers = 1;
+
+    if (!pool)
+        pool = SCE_TPool_GetDefault ();
+    if (SCE_TPool_IsRunning (pool))
+        n_workers = MIN (SCE_TPool_GetNumThreads (pool), n_jobs);
+    n_workers = MAX (n_workers, 1);
+    if (SCE_QEMBatch_AllocWorkers (batch, n_workers) < 0)
+        goto fail;
+
+    batch->jobs = jobs;
+    batch->n_jobs = n_jobs;
+    batch->next = 0;
+
+    if (!SCE_TPool_IsRunning (pool))
+        SCE_QEMBatch_Run (&batch->workers[0]);
+    else {
+        for (i = 0; i < n_workers; i++) {
+            SCE_SQEMWorker *worker = &batch->workers[i];
+            SCE_TPool_InitJob (&worker->job);
+            SCE_TPool_SetJobFunc (&worker->job, SCE_QEMBatch_Run);
+            SCE_TPool_SetJobData (&worker->job, worker);
+            SCE_TPool_Push (pool, &worker->job);
+        }
+        for (i = 0; i < n_workers; i++)
+            SCE_TPool_WaitJob (pool, &batch->workers[i].job);
+    }
+
+    batch->jobs = NULL;
+    batch->n_jobs = batch->next = 0;
+
+    for (i = 0; i < n_jobs; i++) {
+        if (jobs[i].error < 0)
+            goto fail;
+    }
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
 }
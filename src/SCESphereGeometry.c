@@ -144,8 +144,8 @@ int SCE_SphereGeom_GenerateUV (const SCE_SSphere *sphere, SCEuint segments,
     if ((n_indices = SCE_SphereGeom_GetUV (sphere, segments, rings,
                                            &pos, &n_vertices, &indices)) < 0)
         goto fail;
-    if (SCE_Geometry_SetData (geom, pos, NULL, NULL, indices, n_vertices,
-                              n_indices) < 0)
+    if (SCE_Geometry_SetData (geom, pos, NULL, NULL, SCE_INDICES_TYPE,
+                              indices, n_vertices, n_indices) < 0)
         goto fail;
     return SCE_OK;
 fail:
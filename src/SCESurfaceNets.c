@@ -0,0 +1,449 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#include <SCE/utils/SCEUtils.h>
+#include "SCE/core/SCEGeometry.h"
+#include "SCE/core/SCEGrid.h"
+#include "SCE/core/SCEVoxelGrid.h"
+
+#include "SCE/core/SCESurfaceNets.h"
+
+#define SCE_SN_NO_VERTEX ((SCEuint)-1)
+
+void SCE_SN_Init (SCE_SSNGenerator *sn)
+{
+    sn->x = sn->y = sn->z = 0;
+    sn->w = sn->h = sn->d = 0;
+    sn->points = NULL;
+    sn->confs = NULL;
+    sn->slots = NULL;
+    sn->planes_size = 0;
+    sn->itype = SCE_INDICES_TYPE;
+    sn->summary = NULL;
+}
+void SCE_SN_Clear (SCE_SSNGenerator *sn)
+{
+    SCE_free (sn->points);
+    SCE_free (sn->confs);
+    SCE_free (sn->slots);
+}
+SCE_SSNGenerator* SCE_SN_Create (void)
+{
+    SCE_SSNGenerator *sn = NULL;
+    if (!(sn = SCE_malloc (sizeof *sn)))
+        SCEE_LogSrc ();
+    else
+        SCE_SN_Init (sn);
+    return sn;
+}
+void SCE_SN_Delete (SCE_SSNGenerator *sn)
+{
+    if (sn) {
+        SCE_SN_Clear (sn);
+        SCE_free (sn);
+    }
+}
+
+/**
+ * \brief Sets the type of the indices generated by SCE_SN_Generate()
+ * \param sn a surface nets generator
+ * \param type SCE_INDICES_TYPE (the default) or SCE_INDICES32_TYPE
+ */
+void SCE_SN_SetIndicesType (SCE_SSNGenerator *sn, SCE_EType type)
+{
+    sn->itype = type;
+}
+SCE_EType SCE_SN_GetIndicesType (const SCE_SSNGenerator *sn)
+{
+    return sn->itype;
+}
+/**
+ * \brief Sets the min/max summary of the grids given to a generator
+ * \param sn a surface nets generator
+ * \param vg voxel grid whose voxels are the points of the grids given to
+ * \p sn, with a summary (see SCE_VGrid_AllocBricks()), NULL to disable
+ *
+ * Regions that the summary of \p vg tells empty or full are skipped
+ * without reading their points. \p vg must not be modified during a
+ * generation.
+ * \sa SCE_MC_SetSummary()
+ */
+void SCE_SN_SetSummary (SCE_SSNGenerator *sn, const SCE_SVoxelGrid *vg)
+{
+    sn->summary = vg;
+}
+
+
+static void SCE_SN_SetRegion (SCE_SSNGenerator *sn, const SCE_SIntRect3 *region)
+{
+    int p1[3], p2[3];
+
+    sn->w = SCE_Rectangle3_GetWidth (region);
+    sn->h = SCE_Rectangle3_GetHeight (region);
+    sn->d = SCE_Rectangle3_GetDepth (region);
+    SCE_Rectangle3_GetPointsv (region, p1, p2);
+    sn->x = p1[0];
+    sn->y = p1[1];
+    sn->z = p1[2];
+}
+
+/* tells from the summary whether no cell of the region of sn can be
+   crossed by the surface */
+static int SCE_SN_IsUniform (const SCE_SSNGenerator *sn)
+{
+    SCE_SLongRect3 r;
+    SCEubyte min, max;
+
+    if (!sn->summary || !SCE_VGrid_HasBricks (sn->summary))
+        return SCE_FALSE;
+    /* the cells read the points up to x + w included */
+    if (sn->x + sn->w + 1 > SCE_VGrid_GetWidth (sn->summary) ||
+        sn->y + sn->h + 1 > SCE_VGrid_GetHeight (sn->summary) ||
+        sn->z + sn->d + 1 > SCE_VGrid_GetDepth (sn->summary))
+        return SCE_FALSE;
+    SCE_Rectangle3_Setl (&r, sn->x, sn->y, sn->z, sn->x + sn->w + 1,
+                         sn->y + sn->h + 1, sn->z + sn->d + 1);
+    if (!SCE_VGrid_GetRange (sn->summary, &r, &min, &max))
+        return SCE_FALSE;
+    return max < 128 || min >= 128;
+}
+
+static int SCE_SN_AllocPlanes (SCE_SSNGenerator *sn)
+{
+    /* a plane of points is larger than a plane of cells */
+    size_t size = (sn->w + 1) * (sn->h + 1);
+
+    if (size > sn->planes_size) {
+        SCE_SN_Clear (sn);
+        sn->points = NULL;
+        sn->confs = NULL;
+        sn->slots = NULL;
+        sn->planes_size = 0;
+        if (!(sn->points = SCE_malloc (2 * size)) ||
+            !(sn->confs = SCE_malloc (2 * size)) ||
+            !(sn->slots = SCE_malloc (2 * size * sizeof *sn->slots))) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+        sn->planes_size = size;
+    }
+    return SCE_OK;
+}
+
+static void SCE_SN_FetchPoints (SCE_SSNGenerator *sn, const SCE_SGrid *grid,
+                                SCEuint z, SCEubyte *points)
+{
+    SCEuint x, y;
+
+    for (y = 0; y <= sn->h; y++) {
+        for (x = 0; x <= sn->w; x++, points++)
+            SCE_Grid_GetPoint (grid, sn->x + x, sn->y + y, sn->z + z, points);
+    }
+}
+
+/* corner i of a cell is at (i & 1, (i >> 1) & 1, (i >> 2) & 1) */
+static void SCE_SN_MakeVertex (const SCEubyte c[8], SCEuint conf,
+                               SCEuint x, SCEuint y, SCEuint z,
+                               const SCE_TVector3 div, SCEvertices *vertex,
+                               SCEvertices *normal)
+{
+    SCE_TVector3 p;
+    float a, b, t, u, v, w;
+    SCEuint i, j, bit, n = 0;
+
+    /* mean of the crossings of the 12 edges of the cell */
+    SCE_Vector3_Set (p, 0.0, 0.0, 0.0);
+    for (i = 0; i < 8; i++) {
+        for (bit = 1; bit < 8; bit <<= 1) {
+            if (i & bit)
+                continue;
+            j = i | bit;
+            if (!(((conf >> i) ^ (conf >> j)) & 1))
+                continue;
+            a = c[i];
+            b = c[j];
+            t = (128.0 - a) / (b - a);
+            p[0] += (i & 1) + (bit == 1 ? t : 0.0);
+            p[1] += ((i >> 1) & 1) + (bit == 2 ? t : 0.0);
+            p[2] += ((i >> 2) & 1) + (bit == 4 ? t : 0.0);
+            n++;
+        }
+    }
+    SCE_Vector3_Operator1 (p, /=, n);
+    u = p[0]; v = p[1]; w = p[2];
+
+    vertex[0] = (x + u) * div[0];
+    vertex[1] = (y + v) * div[1];
+    vertex[2] = (z + w) * div[2];
+
+    if (normal) {
+#define lerp(a_, b_, t_) ((a_) + ((b_) - (a_)) * (t_))
+        /* the densities grow inside, normals point outside */
+        normal[0] = -lerp (lerp ((float)c[1] - c[0], (float)c[3] - c[2], v),
+                           lerp ((float)c[5] - c[4], (float)c[7] - c[6], v), w);
+        normal[1] = -lerp (lerp ((float)c[2] - c[0], (float)c[3] - c[1], u),
+                           lerp ((float)c[6] - c[4], (float)c[7] - c[5], u), w);
+        normal[2] = -lerp (lerp ((float)c[4] - c[0], (float)c[5] - c[1], u),
+                           lerp ((float)c[6] - c[2], (float)c[7] - c[3], u), v);
+#undef lerp
+        if (!SCE_Vector3_IsNull (normal))
+            SCE_Vector3_Normalize (normal);
+    }
+}
+
+/* a, b, c and d are counterclockwise around the axis of the edge, the quad
+   faces the outside end of the edge */
+static size_t SCE_SN_Quad (SCE_EType itype, void *indices, size_t n,
+                           SCEuint a, SCEuint b, SCEuint c, SCEuint d,
+                           int flip)
+{
+    if (indices) {
+        if (flip) {
+            SCEuint tmp = b;
+            b = d;
+            d = tmp;
+        }
+        SCE_Geometry_SetIndex (itype, indices, n + 0, a);
+        SCE_Geometry_SetIndex (itype, indices, n + 1, b);
+        SCE_Geometry_SetIndex (itype, indices, n + 2, c);
+        SCE_Geometry_SetIndex (itype, indices, n + 3, a);
+        SCE_Geometry_SetIndex (itype, indices, n + 4, c);
+        SCE_Geometry_SetIndex (itype, indices, n + 5, d);
+    }
+    return 6;
+}
+
+/* quads of the edges starting from the points of the plane z, using the
+   cells of the planes z - 1 and z */
+static size_t SCE_SN_MakeQuads (SCE_SSNGenerator *sn, SCEuint z,
+                                SCE_EType itype, void *indices, size_t n)
+{
+    const SCEubyte *confs = &sn->confs[(z & 1) * sn->planes_size];
+    const SCEuint *s0 = &sn->slots[((z + 1) & 1) * sn->planes_size];
+    const SCEuint *s1 = &sn->slots[(z & 1) * sn->planes_size];
+    SCEuint x, y, w = sn->w, conf, in;
+    size_t first = n;
+
+    /* the last cell along each axis belongs to the next region */
+    for (y = 0; y < sn->h; y++) {
+        for (x = 0; x < w; x++) {
+            size_t o = w * y + x;
+
+            conf = confs[o];
+            in = conf & 1;
+            if (conf == 0 || conf == 255)
+                continue;
+
+            if (z < sn->d - 1 && x > 0 && y > 0 && in != ((conf >> 4) & 1))
+                n += SCE_SN_Quad (itype, indices, n, s1[o - w - 1],
+                                  s1[o - w], s1[o], s1[o - 1], !in);
+            if (z == 0)
+                continue;
+            if (x < w - 1 && y > 0 && in != ((conf >> 1) & 1))
+                n += SCE_SN_Quad (itype, indices, n, s0[o - w], s0[o],
+                                  s1[o], s1[o - w], !in);
+            if (y < sn->h - 1 && x > 0 && in != ((conf >> 2) & 1))
+                n += SCE_SN_Quad (itype, indices, n, s0[o - 1], s1[o - 1],
+                                  s1[o], s0[o], !in);
+        }
+    }
+    return n - first;
+}
+
+/* counts only if vertices is NULL */
+static int SCE_SN_Process (SCE_SSNGenerator *sn, const SCE_SGrid *grid,
+                           SCEvertices *vertices, SCEvertices *normals,
+                           SCE_EType itype, void *indices,
+                           size_t *n_vertices, size_t *n_indices)
+{
+    SCEubyte *p0 = NULL, *p1 = NULL, c[8];
+    SCEubyte *confs = NULL;
+    SCEuint *slots = NULL;
+    SCEuint x, y, z, i, conf;
+    size_t pw = sn->w + 1, n_v = 0, n_i = 0;
+    SCE_TVector3 div;
+
+    *n_vertices = *n_indices = 0;
+    if (!sn->w || !sn->h || !sn->d || SCE_SN_IsUniform (sn))
+        return SCE_OK;
+    if (SCE_SN_AllocPlanes (sn) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+
+    SCE_Vector3_Set (div, 1.0 / SCE_Grid_GetWidth (grid),
+                     1.0 / SCE_Grid_GetHeight (grid),
+                     1.0 / SCE_Grid_GetDepth (grid));
+
+    SCE_SN_FetchPoints (sn, grid, 0, sn->points);
+    for (z = 0; z < sn->d; z++) {
+        p0 = &sn->points[(z & 1) * sn->planes_size];
+        p1 = &sn->points[((z + 1) & 1) * sn->planes_size];
+        confs = &sn->confs[(z & 1) * sn->planes_size];
+        slots = &sn->slots[(z & 1) * sn->planes_size];
+        SCE_SN_FetchPoints (sn, grid, z + 1, p1);
+
+        for (y = 0; y < sn->h; y++) {
+            for (x = 0; x < sn->w; x++, confs++, slots++) {
+                size_t o = pw * y + x;
+                c[0] = p0[o];      c[1] = p0[o + 1];
+                c[2] = p0[o + pw]; c[3] = p0[o + pw + 1];
+                c[4] = p1[o];      c[5] = p1[o + 1];
+                c[6] = p1[o + pw]; c[7] = p1[o + pw + 1];
+
+                conf = 0;
+                for (i = 0; i < 8; i++)
+                    conf |= (c[i] >> 7) << i;
+                *confs = conf;
+                *slots = SCE_SN_NO_VERTEX;
+                if (conf == 0 || conf == 255)
+                    continue;
+
+                *slots = n_v;
+                if (vertices)
+                    SCE_SN_MakeVertex (c, conf, x, y, z, div,
+                                       &vertices[n_v * 3],
+                                       normals ? &normals[n_v * 3] : NULL);
+                n_v++;
+            }
+        }
+
+        n_i += SCE_SN_MakeQuads (sn, z, itype, indices, n_i);
+    }
+
+    *n_vertices = n_v;
+    *n_indices = n_i;
+    return SCE_OK;
+}
+
+/**
+ * \brief Counts the vertices and indices of a region
+ * \param sn a surface nets generator
+ * \param region a region of cells
+ * \param grid voxel grid
+ * \param n_vertices number of vertices SCE_SN_Generate() would generate
+ * \param n_indices number of indices SCE_SN_Generate() would generate
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_SN_Count (SCE_SSNGenerator *sn, const SCE_SIntRect3 *region,
+                  const SCE_SGrid *grid, size_t *n_vertices, size_t *n_indices)
+{
+    SCE_SN_SetRegion (sn, region);
+    if (SCE_SN_Process (sn, grid, NULL, NULL, sn->itype, NULL, n_vertices,
+                        n_indices) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
+
+/**
+ * \brief Generates the surface of a region
+ * \param sn a surface nets generator
+ * \param region a region of cells
+ * \param grid voxel grid
+ * \param vertices output vertices
+ * \param normals output normals, can be NULL
+ * \param indices output triangles, of the type given to
+ * SCE_SN_SetIndicesType()
+ * \param n_vertices number of vertices generated
+ * \param n_indices number of indices generated
+ *
+ * Vertices are placed at the mean of the crossings of the edges of their
+ * cell, in the same space as the ones of SCE_MC_GenerateVertices(). Each
+ * edge crossing the surface gives a quad made of two triangles, which
+ * are better shaped than the slivers of marching cubes.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_SN_Count(), SCE_SN_GenerateArrays()
+ */
+int SCE_SN_Generate (SCE_SSNGenerator *sn, const SCE_SIntRect3 *region,
+                     const SCE_SGrid *grid, SCEvertices *vertices,
+                     SCEvertices *normals, void *indices,
+                     size_t *n_vertices, size_t *n_indices)
+{
+    SCE_SN_SetRegion (sn, region);
+    if (SCE_SN_Process (sn, grid, vertices, normals, sn->itype, indices,
+                        n_vertices, n_indices) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
+
+/**
+ * \brief Generates a region into geometry arrays of the exact size
+ * \param sn a surface nets generator
+ * \param region a region of cells
+ * \param grid voxel grid
+ * \param pos array receiving the positions
+ * \param nor array receiving the normals, can be NULL
+ * \param idx array receiving the indices
+ * \param n_vertices number of vertices generated
+ * \param n_indices number of indices generated
+ *
+ * The indices are of the type of \p sn, widened to SCE_INDICES32_TYPE if
+ * there are more vertices than it can address.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_SN_Generate(), SCE_MC_GenerateArrays()
+ */
+int SCE_SN_GenerateArrays (SCE_SSNGenerator *sn, const SCE_SIntRect3 *region,
+                           const SCE_SGrid *grid, SCE_SGeometryArray *pos,
+                           SCE_SGeometryArray *nor, SCE_SGeometryArray *idx,
+                           size_t *n_vertices, size_t *n_indices)
+{
+    SCEvertices *vertices = NULL, *normals = NULL;
+    void *indices = NULL;
+    SCE_EType itype = sn->itype;
+    size_t n_v, n_i;
+
+    if (SCE_SN_Count (sn, region, grid, &n_v, &n_i) < 0)
+        goto fail;
+    if (SCE_Geometry_GetIndicesTypeFor (n_v) == SCE_INDICES32_TYPE)
+        itype = SCE_INDICES32_TYPE;
+    /* never allocate 0 bytes */
+    n_v = MAX (n_v, 1);
+    n_i = MAX (n_i, 1);
+
+    if (!(vertices = SCE_Geometry_AllocArrayData (pos, 3 * n_v *
+                                                  sizeof *vertices)))
+        goto fail;
+    SCE_Geometry_SetArrayPosition (pos, 0, 3, vertices, SCE_TRUE);
+    if (nor) {
+        if (!(normals = SCE_Geometry_AllocArrayData (nor, 3 * n_v *
+                                                     sizeof *normals)))
+            goto fail;
+        SCE_Geometry_SetArrayNormal (nor, 0, normals, SCE_TRUE);
+    }
+    if (!(indices = SCE_Geometry_AllocArrayData (idx, n_i *
+                                                 SCE_Type_Sizeof (itype))))
+        goto fail;
+    SCE_Geometry_SetArrayIndices (idx, itype, indices, SCE_TRUE);
+
+    if (SCE_SN_Process (sn, grid, vertices, normals, itype, indices,
+                        n_vertices, n_indices) < 0)
+        goto fail;
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
@@ -0,0 +1,389 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#include <unistd.h>
+#include <pthread.h>
+#include <SCE/utils/SCEUtils.h>
+
+#include "SCE/core/SCEThreadPool.h"
+
+void SCE_TPool_InitJob (SCE_SThreadPoolJob *job)
+{
+    job->fun = NULL;
+    job->del = NULL;
+    job->data = NULL;
+    job->priority = 0;
+    job->state = SCE_TPOOL_JOB_IDLE;
+    SCE_List_InitIt (&job->it);
+    SCE_List_SetData (&job->it, job);
+}
+void SCE_TPool_SetJobFunc (SCE_SThreadPoolJob *job, SCE_FThreadPoolJobFunc f)
+{
+    job->fun = f;
+}
+/**
+ * \brief Sets the function called when a job is over or cancelled
+ * \param job a job
+ * \param f function called with the data of \p job, it may free \p job
+ *
+ * When this function is set, the pool never touches \p job after calling
+ * it, thus the state of \p job is never set to SCE_TPOOL_JOB_DONE and
+ * SCE_TPool_WaitJob() must not be used on it.
+ */
+void SCE_TPool_SetJobFreeFunc (SCE_SThreadPoolJob *job,
+                               SCE_FThreadPoolJobFunc f)
+{
+    job->del = f;
+}
+void SCE_TPool_SetJobData (SCE_SThreadPoolJob *job, void *data)
+{
+    job->data = data;
+}
+void SCE_TPool_SetJobPriority (SCE_SThreadPoolJob *job, int priority)
+{
+    job->priority = priority;
+}
+SCE_EThreadPoolJobState SCE_TPool_GetJobState (SCE_SThreadPoolJob *job)
+{
+    return job->state;
+}
+
+
+void SCE_TPool_Init (SCE_SThreadPool *tp)
+{
+    pthread_mutex_init (&tp->mutex, NULL);
+    pthread_cond_init (&tp->cond, NULL);
+    pthread_cond_init (&tp->done_cond, NULL);
+    tp->threads = NULL;
+    tp->n_threads = 0;
+    tp->running = SCE_FALSE;
+    tp->quit = SCE_FALSE;
+    SCE_List_Init (&tp->jobs);
+    tp->n_busy = 0;
+}
+void SCE_TPool_Clear (SCE_SThreadPool *tp)
+{
+    SCE_SListIterator *it = NULL, *pro = NULL;
+
+    SCE_TPool_Stop (tp);
+    /* the jobs belong to the user, but the ones that will never run are
+       cancelled so that their free function is called */
+    SCE_List_ForEachProtected (pro, it, &tp->jobs) {
+        SCE_SThreadPoolJob *job = SCE_List_GetData (it);
+        SCE_List_Removel (it);
+        job->state = SCE_TPOOL_JOB_IDLE;
+        if (job->del)
+            job->del (job->data);
+    }
+    pthread_mutex_destroy (&tp->mutex);
+    pthread_cond_destroy (&tp->cond);
+    pthread_cond_destroy (&tp->done_cond);
+}
+SCE_SThreadPool* SCE_TPool_Create (void)
+{
+    SCE_SThreadPool *tp = NULL;
+    if (!(tp = SCE_malloc (sizeof *tp)))
+        SCEE_LogSrc ();
+    else
+        SCE_TPool_Init (tp);
+    return tp;
+}
+void SCE_TPool_Delete (SCE_SThreadPool *tp)
+{
+    if (tp) {
+        SCE_TPool_Clear (tp);
+        SCE_free (tp);
+    }
+}
+
+/**
+ * \brief Sets the number of threads of a pool
+ * \param tp a thread pool
+ * \param n number of threads, 0 runs the jobs in the thread that pushes them
+ *
+ * Must be called before SCE_TPool_Start().
+ */
+void SCE_TPool_SetNumThreads (SCE_SThreadPool *tp, size_t n)
+{
+    tp->n_threads = n;
+}
+size_t SCE_TPool_GetNumThreads (const SCE_SThreadPool *tp)
+{
+    return tp->n_threads;
+}
+
+
+/* mutex must be locked */
+static SCE_SThreadPoolJob* SCE_TPool_PopJob (SCE_SThreadPool *tp)
+{
+    SCE_SListIterator *it = NULL;
+    SCE_SThreadPoolJob *job = NULL;
+
+    SCE_List_ForEach (it, &tp->jobs) {
+        SCE_SThreadPoolJob *j = SCE_List_GetData (it);
+        if (!job || j->priority > job->priority)
+            job = j;
+    }
+    if (job)
+        SCE_List_Removel (&job->it);
+    return job;
+}
+
+static void SCE_TPool_Run (SCE_SThreadPool *tp, SCE_SThreadPoolJob *job)
+{
+    SCE_FThreadPoolJobFunc del = job->del;
+
+    job->fun (job->data);
+
+    pthread_mutex_lock (&tp->mutex);
+    if (!del)
+        job->state = SCE_TPOOL_JOB_DONE;
+    pthread_mutex_unlock (&tp->mutex);
+
+    if (del)
+        del (job->data);
+}
+
+static void* SCE_TPool_Worker (void *data)
+{
+    SCE_SThreadPool *tp = data;
+    SCE_SThreadPoolJob *job = NULL;
+
+    pthread_mutex_lock (&tp->mutex);
+    while (!tp->quit) {
+        if (!(job = SCE_TPool_PopJob (tp))) {
+            pthread_cond_wait (&tp->cond, &tp->mutex);
+            continue;
+        }
+        job->state = SCE_TPOOL_JOB_RUNNING;
+        tp->n_busy++;
+        pthread_mutex_unlock (&tp->mutex);
+
+        SCE_TPool_Run (tp, job);
+
+        pthread_mutex_lock (&tp->mutex);
+        tp->n_busy--;
+        pthread_cond_broadcast (&tp->done_cond);
+    }
+    pthread_mutex_unlock (&tp->mutex);
+
+    return NULL;
+}
+
+/* stops and waits for the first \p n threads of \p tp */
+static void SCE_TPool_Join (SCE_SThreadPool *tp, size_t n)
+{
+    size_t i;
+
+    pthread_mutex_lock (&tp->mutex);
+    tp->quit = SCE_TRUE;
+    pthread_cond_broadcast (&tp->cond);
+    pthread_mutex_unlock (&tp->mutex);
+
+    for (i = 0; i < n; i++)
+        pthread_join (tp->threads[i], NULL);
+    SCE_free (tp->threads);
+    tp->threads = NULL;
+    tp->running = SCE_FALSE;
+}
+
+/**
+ * \brief Starts the threads of a pool
+ * \param tp a thread pool
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_TPool_Stop(), SCE_TPool_SetNumThreads()
+ */
+int SCE_TPool_Start (SCE_SThreadPool *tp)
+{
+    size_t i;
+
+    if (tp->running || tp->n_threads == 0)
+        return SCE_OK;
+
+    if (!(tp->threads = SCE_malloc (tp->n_threads * sizeof *tp->threads)))
+        goto fail;
+
+    tp->quit = SCE_FALSE;
+    for (i = 0; i < tp->n_threads; i++) {
+        if (pthread_create (&tp->threads[i], NULL, SCE_TPool_Worker, tp)) {
+            SCEE_Log (SCE_INVALID_OPERATION);
+            SCEE_LogMsg ("failed to create thread %u of thread pool",
+                         (SCEuint)i);
+            SCE_TPool_Join (tp, i);
+            goto fail;
+        }
+    }
+    tp->running = SCE_TRUE;
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+/**
+ * \brief Stops the threads of a pool
+ * \param tp a thread pool
+ *
+ * Running jobs are completed, queued jobs stay queued and will run on the
+ * next call to SCE_TPool_Start().
+ */
+void SCE_TPool_Stop (SCE_SThreadPool *tp)
+{
+    if (tp->running)
+        SCE_TPool_Join (tp, tp->n_threads);
+}
+int SCE_TPool_IsRunning (SCE_SThreadPool *tp)
+{
+    return tp->running;
+}
+
+/**
+ * \brief Queues a job
+ * \param tp a thread pool
+ * \param job the job to run, must not be already queued
+ *
+ * If \p tp has no running thread, \p job is run immediately by the calling
+ * thread.
+ */
+void SCE_TPool_Push (SCE_SThreadPool *tp, SCE_SThreadPoolJob *job)
+{
+    if (!tp->running) {
+        job->state = SCE_TPOOL_JOB_RUNNING;
+        SCE_TPool_Run (tp, job);
+        return;
+    }
+
+    pthread_mutex_lock (&tp->mutex);
+    job->state = SCE_TPOOL_JOB_QUEUED;
+    SCE_List_Appendl (&tp->jobs, &job->it);
+    pthread_cond_signal (&tp->cond);
+    pthread_mutex_unlock (&tp->mutex);
+}
+/**
+ * \brief Removes a job from the queue of a pool
+ * \param tp a thread pool
+ * \param job a job
+ *
+ * The free function of \p job is called if it has been cancelled.
+ * \return SCE_TRUE if \p job was cancelled, SCE_FALSE if it was not queued
+ * (already running or done)
+ */
+int SCE_TPool_Cancel (SCE_SThreadPool *tp, SCE_SThreadPoolJob *job)
+{
+    int cancelled = SCE_FALSE;
+
+    pthread_mutex_lock (&tp->mutex);
+    if (job->state == SCE_TPOOL_JOB_QUEUED) {
+        SCE_List_Removel (&job->it);
+        job->state = SCE_TPOOL_JOB_IDLE;
+        cancelled = SCE_TRUE;
+    }
+    pthread_mutex_unlock (&tp->mutex);
+
+    if (cancelled && job->del)
+        job->del (job->data);
+
+    return cancelled;
+}
+/**
+ * \brief Waits for a job to be over
+ * \param tp a thread pool
+ * \param job a queued job that has no free function
+ * \sa SCE_TPool_SetJobFreeFunc()
+ */
+void SCE_TPool_WaitJob (SCE_SThreadPool *tp, SCE_SThreadPoolJob *job)
+{
+    pthread_mutex_lock (&tp->mutex);
+    while (job->state == SCE_TPOOL_JOB_QUEUED ||
+           job->state == SCE_TPOOL_JOB_RUNNING)
+        pthread_cond_wait (&tp->done_cond, &tp->mutex);
+    pthread_mutex_unlock (&tp->mutex);
+}
+/**
+ * \brief Waits for every queued job of a pool to be over
+ * \param tp a thread pool
+ */
+void SCE_TPool_Wait (SCE_SThreadPool *tp)
+{
+    if (!tp->running)
+        return;
+    pthread_mutex_lock (&tp->mutex);
+    while (SCE_List_HasElements (&tp->jobs) || tp->n_busy > 0)
+        pthread_cond_wait (&tp->done_cond, &tp->mutex);
+    pthread_mutex_unlock (&tp->mutex);
+}
+
+
+static pthread_mutex_t default_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SCE_SThreadPool default_pool;
+static int default_init = SCE_FALSE;
+
+/* default_mutex must be locked */
+static void SCE_TPool_InitDefault (void)
+{
+    long n;
+
+    if (default_init)
+        return;
+    SCE_TPool_Init (&default_pool);
+    n = sysconf (_SC_NPROCESSORS_ONLN);
+    SCE_TPool_SetNumThreads (&default_pool, n > 1 ? n : 0);
+    default_init = SCE_TRUE;
+}
+
+int SCE_Init_TPool (void)
+{
+    pthread_mutex_lock (&default_mutex);
+    SCE_TPool_InitDefault ();
+    pthread_mutex_unlock (&default_mutex);
+    return SCE_OK;
+}
+void SCE_Quit_TPool (void)
+{
+    pthread_mutex_lock (&default_mutex);
+    if (default_init) {
+        SCE_TPool_Stop (&default_pool);
+        SCE_TPool_Clear (&default_pool);
+        default_init = SCE_FALSE;
+    }
+    pthread_mutex_unlock (&default_mutex);
+}
+
+/**
+ * \brief Gets the thread pool of the core
+ *
+ * The pool has one thread per online processor and is started on the first
+ * call. If its threads cannot be created, jobs pushed to it are run by the
+ * calling thread.
+ * \return the default thread pool
+ */
+SCE_SThreadPool* SCE_TPool_GetDefault (void)
+{
+    pthread_mutex_lock (&default_mutex);
+    SCE_TPool_InitDefault ();
+    if (!default_pool.running && SCE_TPool_Start (&default_pool) < 0) {
+        SCEE_LogSrc ();
+        SCEE_LogSrcMsg ("the default thread pool will run jobs serially");
+        SCE_TPool_SetNumThreads (&default_pool, 0);
+    }
+    pthread_mutex_unlock (&default_mutex);
+    return &default_pool;
+}
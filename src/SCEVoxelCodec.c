@@ -0,0 +1,384 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#include <SCE/utils/SCEUtils.h>
+
+#include "SCE/core/SCEVoxelCodec.h"
+
+static int SCE_VCodec_CompressRaw (const SCE_SVoxelCodec*, const SCEubyte*,
+                                   size_t, SCEubyte**, size_t*);
+static int SCE_VCodec_DecompressRaw (const SCE_SVoxelCodec*, const SCEubyte*,
+                                     size_t, SCEubyte*, size_t);
+static int SCE_VCodec_CompressZlib (const SCE_SVoxelCodec*, const SCEubyte*,
+                                    size_t, SCEubyte**, size_t*);
+static int SCE_VCodec_DecompressZlib (const SCE_SVoxelCodec*, const SCEubyte*,
+                                      size_t, SCEubyte*, size_t);
+static int SCE_VCodec_CompressRLE (const SCE_SVoxelCodec*, const SCEubyte*,
+                                   size_t, SCEubyte**, size_t*);
+static int SCE_VCodec_DecompressRLE (const SCE_SVoxelCodec*, const SCEubyte*,
+                                     size_t, SCEubyte*, size_t);
+
+static SCE_SVoxelCodec builtin_codecs[SCE_VCODEC_NUM_BUILTIN] = {
+    {SCE_VCODEC_RAW, "raw", 0,
+     SCE_VCodec_CompressRaw, SCE_VCodec_DecompressRaw},
+    /* 9: maximum compression level hehe */
+    {SCE_VCODEC_ZLIB, "zlib", 9,
+     SCE_VCodec_CompressZlib, SCE_VCodec_DecompressZlib},
+    {SCE_VCODEC_RLE, "rle", 0,
+     SCE_VCodec_CompressRLE, SCE_VCodec_DecompressRLE}
+};
+static SCE_SVoxelCodec *user_codecs[SCE_VCODEC_MAX] = {NULL};
+
+
+static int SCE_VCodec_SizeError (const SCE_SVoxelCodec *codec)
+{
+    SCEE_Log (SCE_BAD_FORMAT);
+    SCEE_LogMsg ("corrupted %s voxel data: size does not match", codec->name);
+    return SCE_ERROR;
+}
+
+
+static int
+SCE_VCodec_CompressRaw (const SCE_SVoxelCodec *codec, const SCEubyte *in,
+                        size_t size, SCEubyte **out, size_t *out_size)
+{
+    (void)codec;
+    if (!(*out = SCE_malloc (size))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    memcpy (*out, in, size);
+    *out_size = size;
+    return SCE_OK;
+}
+static int
+SCE_VCodec_DecompressRaw (const SCE_SVoxelCodec *codec, const SCEubyte *in,
+                          size_t size, SCEubyte *out, size_t out_size)
+{
+    if (size != out_size)
+        return SCE_VCodec_SizeError (codec);
+    memcpy (out, in, size);
+    return SCE_OK;
+}
+
+
+static int
+SCE_VCodec_CompressZlib (const SCE_SVoxelCodec *codec, const SCEubyte *in,
+                         size_t size, SCEubyte **out, size_t *out_size)
+{
+    SCE_SArray data;
+
+    SCE_Array_Init (&data);
+    if (SCE_Zlib_Compress ((void*)in, size, codec->level, &data) < 0)
+        goto fail;
+    *out_size = SCE_Array_GetSize (&data);
+    if (!(*out = SCE_malloc (*out_size)))
+        goto fail;
+    memcpy (*out, SCE_Array_Get (&data), *out_size);
+    SCE_Array_Clear (&data);
+
+    return SCE_OK;
+fail:
+    SCE_Array_Clear (&data);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+static int
+SCE_VCodec_DecompressZlib (const SCE_SVoxelCodec *codec, const SCEubyte *in,
+                           size_t size, SCEubyte *out, size_t out_size)
+{
+    SCE_SArray data;
+
+    SCE_Array_Init (&data);
+    if (SCE_Zlib_Decompress ((void*)in, size, &data) < 0) {
+        SCE_Array_Clear (&data);
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    if (SCE_Array_GetSize (&data) != out_size) {
+        SCE_Array_Clear (&data);
+        return SCE_VCodec_SizeError (codec);
+    }
+    memcpy (out, SCE_Array_Get (&data), out_size);
+    SCE_Array_Clear (&data);
+
+    return SCE_OK;
+}
+
+
+/* run-length/palette codec
+
+   The data starts with the palette: its number of entries minus one, then
+   the entries. Runs follow, each run is made of the palette index of its
+   value and its length. With 16 entries or less, index and length are packed
+   in one byte (index in the high nibble), a length nibble of 0 means the
+   length follows as a variable length integer. With more entries the index
+   takes one byte and the length is always a variable length integer.
+   Variable length integers store 7 bits per byte, least significant first,
+   the high bit tells whether another byte follows. */
+
+#define SCE_VCODEC_RLE_SMALL_PALETTE 16
+
+static size_t SCE_VCodec_PutVarint (SCEubyte *out, size_t n)
+{
+    size_t i = 0;
+    while (n >= 0x80) {
+        out[i++] = (n & 0x7f) | 0x80;
+        n >>= 7;
+    }
+    out[i++] = n;
+    return i;
+}
+static int SCE_VCodec_GetVarint (const SCEubyte **in, const SCEubyte *end,
+                                 size_t *n)
+{
+    const SCEubyte *p = *in;
+    size_t shift = 0;
+
+    *n = 0;
+    while (p < end && shift < 8 * sizeof *n) {
+        *n |= (size_t)(*p & 0x7f) << shift;
+        shift += 7;
+        if (!(*p++ & 0x80)) {
+            *in = p;
+            return SCE_OK;
+        }
+    }
+    return SCE_ERROR;
+}
+
+static int
+SCE_VCodec_CompressRLE (const SCE_SVoxelCodec *codec, const SCEubyte *in,
+                        size_t size, SCEubyte **out, size_t *out_size)
+{
+    SCEubyte index[256];
+    SCEubyte palette[256];
+    int used[256] = {0};
+    size_t n_palette = 0, i, n;
+    SCEubyte *ptr = NULL;
+    int small;
+
+    (void)codec;
+
+    for (i = 0; i < size; i++)
+        used[in[i]] = SCE_TRUE;
+    for (i = 0; i < 256; i++) {
+        if (used[i]) {
+            index[i] = n_palette;
+            palette[n_palette++] = i;
+        }
+    }
+    if (n_palette == 0) {
+        /* empty input: palette of one entry and no run */
+        palette[0] = 0;
+        n_palette = 1;
+    }
+    small = n_palette <= SCE_VCODEC_RLE_SMALL_PALETTE;
+
+    /* worst case: one run per byte, each of them taking 2 bytes plus the
+       palette */
+    if (!(ptr = SCE_malloc (1 + n_palette + 2 * size))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    *out = ptr;
+
+    *ptr++ = n_palette - 1;
+    memcpy (ptr, palette, n_palette);
+    ptr += n_palette;
+
+    i = 0;
+    while (i < size) {
+        SCEubyte value = in[i];
+        size_t len = 1;
+        while (i + len < size && in[i + len] == value)
+            len++;
+        i += len;
+
+        n = index[value];
+        if (small) {
+            if (len < 16) {
+                *ptr++ = (n << 4) | len;
+            } else {
+                *ptr++ = n << 4;
+                ptr += SCE_VCodec_PutVarint (ptr, len);
+            }
+        } else {
+            *ptr++ = n;
+            ptr += SCE_VCodec_PutVarint (ptr, len);
+        }
+    }
+    *out_size = ptr - *out;
+
+    return SCE_OK;
+}
+static int
+SCE_VCodec_DecompressRLE (const SCE_SVoxelCodec *codec, const SCEubyte *in,
+                          size_t size, SCEubyte *out, size_t out_size)
+{
+    const SCEubyte *end = &in[size];
+    const SCEubyte *palette = NULL;
+    size_t n_palette, offset = 0;
+    int small;
+
+    if (size < 1)
+        return SCE_VCodec_SizeError (codec);
+    n_palette = (size_t)in[0] + 1;
+    if (size < 1 + n_palette)
+        return SCE_VCodec_SizeError (codec);
+    palette = &in[1];
+    in = &in[1 + n_palette];
+    small = n_palette <= SCE_VCODEC_RLE_SMALL_PALETTE;
+
+    while (in < end) {
+        size_t n, len;
+        if (small) {
+            n = *in >> 4;
+            len = *in++ & 0x0f;
+            if (len == 0 && SCE_VCodec_GetVarint (&in, end, &len) < 0)
+                return SCE_VCodec_SizeError (codec);
+        } else {
+            n = *in++;
+            if (SCE_VCodec_GetVarint (&in, end, &len) < 0)
+                return SCE_VCodec_SizeError (codec);
+        }
+        if (n >= n_palette || len > out_size - offset)
+            return SCE_VCodec_SizeError (codec);
+        memset (&out[offset], palette[n], len);
+        offset += len;
+    }
+
+    if (offset != out_size)
+        return SCE_VCodec_SizeError (codec);
+
+    return SCE_OK;
+}
+
+
+/**
+ * \brief Initializes a codec that copies the data
+ * \param codec a codec
+ */
+void SCE_VCodec_Init (SCE_SVoxelCodec *codec)
+{
+    *codec = builtin_codecs[SCE_VCODEC_RAW];
+}
+/**
+ * \brief Initializes a zlib codec
+ * \param codec a codec
+ * \param level zlib compression level, from 1 (fast) to 9 (small)
+ */
+void SCE_VCodec_InitZlib (SCE_SVoxelCodec *codec, int level)
+{
+    *codec = builtin_codecs[SCE_VCODEC_ZLIB];
+    codec->level = level;
+}
+/**
+ * \brief Initializes a run-length/palette codec
+ * \param codec a codec
+ *
+ * This codec is meant for density fields and material grids, which are made
+ * of long runs of a few distinct values. It is much faster than zlib.
+ */
+void SCE_VCodec_InitRLE (SCE_SVoxelCodec *codec)
+{
+    *codec = builtin_codecs[SCE_VCODEC_RLE];
+}
+
+/**
+ * \brief Registers a codec so that data compressed with it can be read
+ * \param codec a codec, its ID must not be used by another codec
+ *
+ * Built-in codecs are always registered. Only one codec is registered per
+ * ID, its compression level does not matter for decompression.
+ * \return SCE_ERROR if the ID is invalid or taken, SCE_OK otherwise
+ */
+int SCE_VCodec_Register (SCE_SVoxelCodec *codec)
+{
+    if (codec->id >= SCE_VCODEC_MAX || codec->id < SCE_VCODEC_NUM_BUILTIN ||
+        (user_codecs[codec->id] && user_codecs[codec->id] != codec)) {
+        SCEE_Log (SCE_INVALID_ARG);
+        SCEE_LogMsg ("voxel codec ID %u is invalid or already in use",
+                     codec->id);
+        return SCE_ERROR;
+    }
+    user_codecs[codec->id] = codec;
+    return SCE_OK;
+}
+/**
+ * \brief Gets the registered codec of a given ID
+ * \param id codec ID
+ * \return the codec, NULL if none is registered with \p id
+ */
+SCE_SVoxelCodec* SCE_VCodec_Get (SCEuint id)
+{
+    if (id < SCE_VCODEC_NUM_BUILTIN)
+        return &builtin_codecs[id];
+    if (id < SCE_VCODEC_MAX)
+        return user_codecs[id];
+    return NULL;
+}
+
+SCEuint SCE_VCodec_GetID (const SCE_SVoxelCodec *codec)
+{
+    return codec->id;
+}
+const char* SCE_VCodec_GetName (const SCE_SVoxelCodec *codec)
+{
+    return codec->name;
+}
+
+/**
+ * \brief Compresses voxels
+ * \param codec a codec
+ * \param in voxels
+ * \param size size of \p in, in bytes
+ * \param out returned compressed data, free it with SCE_free()
+ * \param out_size returned size of \p out
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VCodec_Compress (const SCE_SVoxelCodec *codec, const SCEubyte *in,
+                         size_t size, SCEubyte **out, size_t *out_size)
+{
+    if (codec->compress (codec, in, size, out, out_size) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
+/**
+ * \brief Decompresses voxels
+ * \param codec a codec
+ * \param in compressed data
+ * \param size size of \p in, in bytes
+ * \param out decompressed voxels
+ * \param out_size exact size of the decompressed voxels
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VCodec_Decompress (const SCE_SVoxelCodec *codec, const SCEubyte *in,
+                           size_t size, SCEubyte *out, size_t out_size)
+{
+    if (codec->decompress (codec, in, size, out, out_size) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
@@ -0,0 +1,287 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#include <SCE/utils/SCEUtils.h>
+
+#include "SCE/core/SCEVoxelEdit.h"
+
+void SCE_VEdit_Init (SCE_SVoxelEditBatch *eb)
+{
+    eb->brushes = NULL;
+    eb->n_brushes = 0;
+    eb->max_brushes = 0;
+    SCE_Rectangle3_Initl (&eb->bounds);
+}
+void SCE_VEdit_Clear (SCE_SVoxelEditBatch *eb)
+{
+    SCE_free (eb->brushes);
+}
+SCE_SVoxelEditBatch* SCE_VEdit_Create (void)
+{
+    SCE_SVoxelEditBatch *eb = NULL;
+    if (!(eb = SCE_malloc (sizeof *eb)))
+        SCEE_LogSrc ();
+    else
+        SCE_VEdit_Init (eb);
+    return eb;
+}
+void SCE_VEdit_Delete (SCE_SVoxelEditBatch *eb)
+{
+    if (eb) {
+        SCE_VEdit_Clear (eb);
+        SCE_free (eb);
+    }
+}
+
+/**
+ * \brief Removes every brush of a batch, keeps the allocated memory
+ */
+void SCE_VEdit_Flush (SCE_SVoxelEditBatch *eb)
+{
+    eb->n_brushes = 0;
+    SCE_Rectangle3_Initl (&eb->bounds);
+}
+
+
+static SCE_SVoxelBrush* SCE_VEdit_NewBrush (SCE_SVoxelEditBatch *eb)
+{
+    if (eb->n_brushes == eb->max_brushes) {
+        SCE_SVoxelBrush *brushes = NULL;
+        size_t n = MAX (2 * eb->max_brushes, 16);
+
+        if (!(brushes = SCE_malloc (n * sizeof *brushes))) {
+            SCEE_LogSrc ();
+            return NULL;
+        }
+        if (eb->brushes)
+            memcpy (brushes, eb->brushes, eb->n_brushes * sizeof *brushes);
+        SCE_free (eb->brushes);
+        eb->brushes = brushes;
+        eb->max_brushes = n;
+    }
+    return &eb->brushes[eb->n_brushes];
+}
+
+static int SCE_VEdit_Add (SCE_SVoxelEditBatch *eb, SCE_EVoxelBrushShape shape,
+                          SCE_EVoxelBrushOperation op, const float *center,
+                          const float *size, SCEubyte value)
+{
+    SCE_SVoxelBrush *brush = NULL;
+    long p1[3], p2[3];
+    size_t i;
+
+    if (!(brush = SCE_VEdit_NewBrush (eb))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+
+    brush->shape = shape;
+    brush->op = op;
+    brush->value = value;
+    for (i = 0; i < 3; i++) {
+        brush->center[i] = center[i];
+        brush->size[i] = size[i];
+        /* one more voxel for the smooth border of density brushes */
+        p1[i] = floor (center[i] - size[i]) - 1;
+        p2[i] = ceil (center[i] + size[i]) + 2;
+    }
+    SCE_Rectangle3_Setlv (&brush->bounds, p1, p2);
+
+    if (eb->n_brushes == 0)
+        eb->bounds = brush->bounds;
+    else
+        SCE_Rectangle3_Unionl (&eb->bounds, &brush->bounds, &eb->bounds);
+    eb->n_brushes++;
+
+    return SCE_OK;
+}
+
+/**
+ * \brief Adds a sphere brush to a batch
+ * \param eb an edit batch
+ * \param op brush operation
+ * \param x,y,z center of the sphere, in level 0's space
+ * \param r radius of the sphere
+ * \param value density or material of the brush
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VEdit_AddSphere (SCE_SVoxelEditBatch *eb, SCE_EVoxelBrushOperation op,
+                         float x, float y, float z, float r, SCEubyte value)
+{
+    float center[3], size[3];
+    center[0] = x; center[1] = y; center[2] = z;
+    size[0] = size[1] = size[2] = r;
+    return SCE_VEdit_Add (eb, SCE_VEDIT_SPHERE, op, center, size, value);
+}
+/**
+ * \brief Adds a box brush to a batch
+ * \param w,h,d half dimensions of the box
+ * \sa SCE_VEdit_AddSphere()
+ */
+int SCE_VEdit_AddBox (SCE_SVoxelEditBatch *eb, SCE_EVoxelBrushOperation op,
+                      float x, float y, float z, float w, float h, float d,
+                      SCEubyte value)
+{
+    float center[3], size[3];
+    center[0] = x; center[1] = y; center[2] = z;
+    size[0] = w; size[1] = h; size[2] = d;
+    return SCE_VEdit_Add (eb, SCE_VEDIT_BOX, op, center, size, value);
+}
+/**
+ * \brief Adds a cylinder brush aligned on the z axis to a batch
+ * \param r radius of the cylinder
+ * \param h half height of the cylinder
+ * \sa SCE_VEdit_AddSphere()
+ */
+int SCE_VEdit_AddCylinder (SCE_SVoxelEditBatch *eb,
+                           SCE_EVoxelBrushOperation op, float x, float y,
+                           float z, float r, float h, SCEubyte value)
+{
+    float center[3], size[3];
+    center[0] = x; center[1] = y; center[2] = z;
+    size[0] = size[1] = r;
+    size[2] = h;
+    return SCE_VEdit_Add (eb, SCE_VEDIT_CYLINDER, op, center, size, value);
+}
+
+size_t SCE_VEdit_GetNumBrushes (const SCE_SVoxelEditBatch *eb)
+{
+    return eb->n_brushes;
+}
+SCE_SVoxelBrush* SCE_VEdit_GetBrush (SCE_SVoxelEditBatch *eb, size_t i)
+{
+    return &eb->brushes[i];
+}
+/**
+ * \brief Gets the region modified by a batch, in level 0's space
+ */
+void SCE_VEdit_GetBounds (const SCE_SVoxelEditBatch *eb, SCE_SLongRect3 *r)
+{
+    *r = eb->bounds;
+}
+
+
+/* signed distance from a point to the surface of a brush */
+static float SCE_VEdit_Distance (const SCE_SVoxelBrush *brush, const float *p)
+{
+    float q[3], d, e;
+    size_t i;
+
+    for (i = 0; i < 3; i++) {
+        q[i] = p[i] - brush->center[i];
+        if (q[i] < 0.0)
+            q[i] = -q[i];
+    }
+
+    switch (brush->shape) {
+    case SCE_VEDIT_SPHERE:
+        return sqrt (q[0] * q[0] + q[1] * q[1] + q[2] * q[2]) - brush->size[0];
+    case SCE_VEDIT_BOX:
+        d = e = 0.0;
+        for (i = 0; i < 3; i++) {
+            q[i] -= brush->size[i];
+            if (q[i] > 0.0)
+                d += q[i] * q[i];
+        }
+        e = MAX (MAX (q[0], q[1]), q[2]);
+        return sqrt (d) + MIN (e, 0.0);
+    case SCE_VEDIT_CYLINDER:
+        q[0] = sqrt (q[0] * q[0] + q[1] * q[1]) - brush->size[0];
+        q[1] = q[2] - brush->size[2];
+        d = MAX (q[0], 0.0) * MAX (q[0], 0.0) + MAX (q[1], 0.0) * MAX (q[1], 0.0);
+        return sqrt (d) + MIN (MAX (q[0], q[1]), 0.0);
+    }
+    return 0.0;
+}
+
+static SCEubyte SCE_VEdit_ApplyDensity (const SCE_SVoxelBrush *brush,
+                                        float dist, SCEubyte v)
+{
+    /* the surface is at the middle of a one voxel wide gradient */
+    float t = 0.5 - dist;
+    SCEubyte f;
+
+    t = MAX (MIN (t, 1.0), 0.0);
+    f = t * brush->value + 0.5;
+
+    switch (brush->op) {
+    case SCE_VEDIT_ADD: return MAX (v, f);
+    case SCE_VEDIT_SUBTRACT: return MIN (v, 255 - f);
+    case SCE_VEDIT_PAINT: return dist <= 0.0 ? brush->value : v;
+    }
+    return v;
+}
+static SCEubyte SCE_VEdit_ApplyMaterial (const SCE_SVoxelBrush *brush,
+                                         float dist, SCEubyte v)
+{
+    if (dist > 0.0)
+        return v;
+
+    switch (brush->op) {
+    case SCE_VEDIT_ADD: return brush->value;
+    case SCE_VEDIT_SUBTRACT: return 0;
+    case SCE_VEDIT_PAINT: return v ? brush->value : v; /* only matter */
+    }
+    return v;
+}
+
+/**
+ * \brief Applies a brush on a set of voxels
+ * \param brush a brush
+ * \param usage kind of voxels of \p data
+ * \param region region covered by \p data, in level 0's space
+ * \param data voxels to modify
+ */
+void SCE_VEdit_ApplyBrush (const SCE_SVoxelBrush *brush,
+                           SCE_EVoxelOctreeUsage usage,
+                           const SCE_SLongRect3 *region, SCEubyte *data)
+{
+    SCE_SLongRect3 r;
+    long p1[3], p2[3], o[3], w, h, x, y, z;
+    float p[3];
+
+    if (!SCE_Rectangle3_Intersectionl (&brush->bounds, region, &r))
+        return;
+
+    SCE_Rectangle3_GetPointslv (&r, p1, p2);
+    SCE_Rectangle3_GetOriginlv (region, &o[0], &o[1], &o[2]);
+    w = SCE_Rectangle3_GetWidthl (region);
+    h = SCE_Rectangle3_GetHeightl (region);
+
+    for (z = p1[2]; z < p2[2]; z++) {
+        p[2] = z;
+        for (y = p1[1]; y < p2[1]; y++) {
+            SCEubyte *row = &data[w * (h * (z - o[2]) + y - o[1])];
+            p[1] = y;
+            for (x = p1[0]; x < p2[0]; x++) {
+                SCEubyte *v = &row[x - o[0]];
+                float dist;
+                p[0] = x;
+                dist = SCE_VEdit_Distance (brush, p);
+                if (usage == SCE_VOCTREE_DENSITY_FIELD)
+                    *v = SCE_VEdit_ApplyDensity (brush, dist, *v);
+                else
+                    *v = SCE_VEdit_ApplyMaterial (brush, dist, *v);
+            }
+        }
+    }
+}
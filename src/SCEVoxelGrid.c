@@ -19,6 +19,9 @@
 /* created: 27/04/2012
    updated: 15/03/2013 */
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <SCE/utils/SCEUtils.h>
 
 #include "SCE/core/SCEVoxelGrid.h"
@@ -31,10 +34,16 @@ void SCE_VGrid_Init (SCE_SVoxelGrid *vg)
 
     vg->full_checked = vg->empty_checked = SCE_FALSE;
     vg->full = vg->empty = SCE_FALSE;
+
+    vg->bmin = vg->bmax = NULL;
+    vg->bw = vg->bh = vg->bd = 0;
+    vg->n_blevels = 0;
 }
 void SCE_VGrid_Clear (SCE_SVoxelGrid *vg)
 {
     SCE_free (vg->data);
+    SCE_free (vg->bmin);
+    SCE_free (vg->bmax);
 }
 SCE_SVoxelGrid* SCE_VGrid_Create (void)
 {
@@ -110,6 +119,461 @@ int SCE_VGrid_Build (SCE_SVoxelGrid *vg)
 
 #define GOFFSET(g, x, y, z) ((g)->w * ((g)->h * (z) + (y)) + (x))
 #define VOFFSET(g, x, y, z) ((g)->n_cmp * GOFFSET (g, x, y, z))
+#define BOFFSET(g, x, y, z) ((g)->bw * ((g)->bh * (z) + (y)) + (x))
+#define LOFFSET(dims, x, y, z) ((dims)[0] * ((dims)[1] * (z) + (y)) + (x))
+
+
+/* min/max summary: bricks of SCE_VGRID_BRICK_SIZE^3 voxels store the
+   extremes of the first component of their voxels, so that most region
+   queries only look at the bricks. Each coarser level merges 2x2x2 bricks
+   of the previous one, down to a single brick, so large regions are
+   answered from a few coarse bricks. Every function writing voxels keeps
+   the bricks up to date. */
+
+/* number of bricks of a level along each axis, returns the offset of the
+   level in bmin and bmax */
+static size_t SCE_VGrid_GetLevel (const SCE_SVoxelGrid *vg, SCEuint level,
+                                  long *dims)
+{
+    size_t offset = 0;
+    SCEuint l;
+
+    for (l = 0; l <= level; l++) {
+        if (l > 0)
+            offset += dims[0] * dims[1] * dims[2];
+        dims[0] = (vg->bw + (1 << l) - 1) >> l;
+        dims[1] = (vg->bh + (1 << l) - 1) >> l;
+        dims[2] = (vg->bd + (1 << l) - 1) >> l;
+    }
+    return offset;
+}
+
+/* recomputes the bricks of the coarser levels above the bricks [b1, b2]
+   of the finest level */
+static void SCE_VGrid_UpdateLevels (SCE_SVoxelGrid *vg, const long *b1,
+                                    const long *b2)
+{
+    long p1[3], p2[3], p[3], c[3], dims[3], cdims[3];
+    size_t offset, coffset, i;
+    SCEuint l;
+
+    for (i = 0; i < 3; i++) {
+        p1[i] = b1[i];
+        p2[i] = b2[i];
+    }
+    coffset = SCE_VGrid_GetLevel (vg, 0, cdims);
+
+    for (l = 1; l < vg->n_blevels; l++) {
+        offset = SCE_VGrid_GetLevel (vg, l, dims);
+        for (i = 0; i < 3; i++) {
+            p1[i] >>= 1;
+            p2[i] >>= 1;
+        }
+        for (p[2] = p1[2]; p[2] <= p2[2]; p[2]++) {
+            for (p[1] = p1[1]; p[1] <= p2[1]; p[1]++) {
+                for (p[0] = p1[0]; p[0] <= p2[0]; p[0]++) {
+                    SCEubyte a = 255, b = 0;
+                    size_t o;
+                    /* children, the last ones of each axis may be missing */
+                    for (c[2] = 2 * p[2];
+                         c[2] <= MIN (2 * p[2] + 1, cdims[2] - 1); c[2]++) {
+                        for (c[1] = 2 * p[1];
+                             c[1] <= MIN (2 * p[1] + 1, cdims[1] - 1); c[1]++) {
+                            for (c[0] = 2 * p[0];
+                                 c[0] <= MIN (2 * p[0] + 1, cdims[0] - 1);
+                                 c[0]++) {
+                                o = coffset + LOFFSET (cdims, c[0], c[1], c[2]);
+                                a = MIN (a, vg->bmin[o]);
+                                b = MAX (b, vg->bmax[o]);
+                            }
+                        }
+                    }
+                    o = offset + LOFFSET (dims, p[0], p[1], p[2]);
+                    vg->bmin[o] = a;
+                    vg->bmax[o] = b;
+                }
+            }
+        }
+        coffset = offset;
+        for (i = 0; i < 3; i++)
+            cdims[i] = dims[i];
+    }
+}
+
+/* minimum and maximum of [p1, p2[ */
+static void SCE_VGrid_ScanRange (const SCE_SVoxelGrid *vg, const long *p1,
+                                 const long *p2, SCEubyte *min, SCEubyte *max)
+{
+    long x, y, z;
+    SCEubyte a = 255, b = 0;
+
+    for (z = p1[2]; z < p2[2]; z++) {
+        for (y = p1[1]; y < p2[1]; y++) {
+            const SCEubyte *ptr = &vg->data[VOFFSET (vg, p1[0], y, z)];
+            for (x = p1[0]; x < p2[0]; x++) {
+                a = MIN (a, *ptr);
+                b = MAX (b, *ptr);
+                ptr += vg->n_cmp;
+            }
+        }
+    }
+    *min = a;
+    *max = b;
+}
+
+/* voxels of a brick */
+static void SCE_VGrid_GetBrick (const SCE_SVoxelGrid *vg, const long *b,
+                                long *p1, long *p2)
+{
+    p1[0] = b[0] << SCE_VGRID_BRICK_SHIFT;
+    p1[1] = b[1] << SCE_VGRID_BRICK_SHIFT;
+    p1[2] = b[2] << SCE_VGRID_BRICK_SHIFT;
+    p2[0] = MIN (p1[0] + SCE_VGRID_BRICK_SIZE, (long)vg->w);
+    p2[1] = MIN (p1[1] + SCE_VGRID_BRICK_SIZE, (long)vg->h);
+    p2[2] = MIN (p1[2] + SCE_VGRID_BRICK_SIZE, (long)vg->d);
+}
+
+/* bricks overlapping [p1, p2[, clipped to the grid, returns SCE_FALSE if
+   there is none */
+static int SCE_VGrid_GetBrickRange (const SCE_SVoxelGrid *vg, const long *p1,
+                                    const long *p2, long *b1, long *b2)
+{
+    long dim[3];
+    size_t i;
+
+    dim[0] = vg->w; dim[1] = vg->h; dim[2] = vg->d;
+    for (i = 0; i < 3; i++) {
+        long a = MAX (p1[i], 0), b = MIN (p2[i], dim[i]);
+        if (a >= b)
+            return SCE_FALSE;
+        b1[i] = a >> SCE_VGRID_BRICK_SHIFT;
+        b2[i] = (b - 1) >> SCE_VGRID_BRICK_SHIFT;
+    }
+    return SCE_TRUE;
+}
+
+static void SCE_VGrid_UpdateBricksv (SCE_SVoxelGrid *vg, const long *p1,
+                                     const long *p2)
+{
+    long b[3], b1[3], b2[3], q1[3], q2[3];
+
+    if (!vg->bmin || !vg->data || !SCE_VGrid_GetBrickRange (vg, p1, p2, b1, b2))
+        return;
+
+    for (b[2] = b1[2]; b[2] <= b2[2]; b[2]++) {
+        for (b[1] = b1[1]; b[1] <= b2[1]; b[1]++) {
+            for (b[0] = b1[0]; b[0] <= b2[0]; b[0]++) {
+                size_t offset = BOFFSET (vg, b[0], b[1], b[2]);
+                SCE_VGrid_GetBrick (vg, b, q1, q2);
+                SCE_VGrid_ScanRange (vg, q1, q2, &vg->bmin[offset],
+                                     &vg->bmax[offset]);
+            }
+        }
+    }
+    SCE_VGrid_UpdateLevels (vg, b1, b2);
+}
+
+/* [p1, p2[ was filled with pattern */
+static void SCE_VGrid_FillBricksv (SCE_SVoxelGrid *vg, const long *p1,
+                                   const long *p2, SCEubyte pattern)
+{
+    long b[3], b1[3], b2[3], q1[3], q2[3];
+
+    if (!vg->bmin || !SCE_VGrid_GetBrickRange (vg, p1, p2, b1, b2))
+        return;
+
+    for (b[2] = b1[2]; b[2] <= b2[2]; b[2]++) {
+        for (b[1] = b1[1]; b[1] <= b2[1]; b[1]++) {
+            for (b[0] = b1[0]; b[0] <= b2[0]; b[0]++) {
+                size_t offset = BOFFSET (vg, b[0], b[1], b[2]);
+                SCE_VGrid_GetBrick (vg, b, q1, q2);
+                if (q1[0] >= p1[0] && q1[1] >= p1[1] && q1[2] >= p1[2] &&
+                    q2[0] <= p2[0] && q2[1] <= p2[1] && q2[2] <= p2[2]) {
+                    vg->bmin[offset] = vg->bmax[offset] = pattern;
+                } else {
+                    SCE_VGrid_ScanRange (vg, q1, q2, &vg->bmin[offset],
+                                         &vg->bmax[offset]);
+                }
+            }
+        }
+    }
+    SCE_VGrid_UpdateLevels (vg, b1, b2);
+}
+
+/**
+ * \brief Enables the min/max summary of a grid
+ * \param vg a voxel grid
+ *
+ * The summary is unknown until the next call to SCE_VGrid_UpdateBricks()
+ * or until the voxels are written, it is kept by SCE_VGrid_SetRaw().
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VGrid_AllocBricks (SCE_SVoxelGrid *vg)
+{
+    SCEubyte *bmin = NULL, *bmax = NULL;
+    long dims[3];
+    size_t n;
+
+    if (vg->bmin)
+        return SCE_OK;
+
+    vg->bw = (vg->w + SCE_VGRID_BRICK_SIZE - 1) >> SCE_VGRID_BRICK_SHIFT;
+    vg->bh = (vg->h + SCE_VGRID_BRICK_SIZE - 1) >> SCE_VGRID_BRICK_SHIFT;
+    vg->bd = (vg->d + SCE_VGRID_BRICK_SIZE - 1) >> SCE_VGRID_BRICK_SHIFT;
+    vg->n_blevels = 1;
+    while (vg->bw > (1UL << (vg->n_blevels - 1)) ||
+           vg->bh > (1UL << (vg->n_blevels - 1)) ||
+           vg->bd > (1UL << (vg->n_blevels - 1)))
+        vg->n_blevels++;
+    n = SCE_VGrid_GetLevel (vg, vg->n_blevels - 1, dims);
+    n += dims[0] * dims[1] * dims[2];
+
+    if (!(bmin = SCE_malloc (n)) || !(bmax = SCE_malloc (n))) {
+        SCE_free (bmin);
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    /* unknown content */
+    memset (bmin, 0, n);
+    memset (bmax, 255, n);
+    /* the summary is used as soon as bmin is set */
+    vg->bmax = bmax;
+    vg->bmin = bmin;
+
+    return SCE_OK;
+}
+/**
+ * \brief Recomputes the min/max summary of a region of a grid
+ * \param vg a voxel grid
+ * \param region modified region, NULL means the whole grid
+ */
+void SCE_VGrid_UpdateBricks (SCE_SVoxelGrid *vg, const SCE_SLongRect3 *region)
+{
+    long p1[3], p2[3];
+
+    if (region)
+        SCE_Rectangle3_GetPointslv (region, p1, p2);
+    else {
+        p1[0] =        p1[1] =        p1[2] = 0;
+        p2[0] = vg->w; p2[1] = vg->h; p2[2] = vg->d;
+    }
+    SCE_VGrid_UpdateBricksv (vg, p1, p2);
+}
+/**
+ * \brief Exchanges the min/max summaries of two grids of same dimensions
+ * \param a,b voxel grids
+ *
+ * Useful to build a summary aside and publish it at once.
+ */
+void SCE_VGrid_SwapBricks (SCE_SVoxelGrid *a, SCE_SVoxelGrid *b)
+{
+    SCE_SVoxelGrid tmp;
+
+    tmp.bmin = a->bmin; tmp.bmax = a->bmax;
+    tmp.bw = a->bw; tmp.bh = a->bh; tmp.bd = a->bd;
+    a->bmin = b->bmin; a->bmax = b->bmax;
+    a->bw = b->bw; a->bh = b->bh; a->bd = b->bd;
+    b->bmin = tmp.bmin; b->bmax = tmp.bmax;
+    b->bw = tmp.bw; b->bh = tmp.bh; b->bd = tmp.bd;
+    tmp.n_blevels = a->n_blevels;
+    a->n_blevels = b->n_blevels;
+    b->n_blevels = tmp.n_blevels;
+}
+int SCE_VGrid_HasBricks (const SCE_SVoxelGrid *vg)
+{
+    return vg->bmin != NULL;
+}
+/**
+ * \brief Gets the size of the min/max summary of a grid
+ * \param vg a voxel grid
+ * \return the number of bytes used by SCE_VGrid_GetBricks(), 0 if \p vg
+ * has no summary
+ */
+size_t SCE_VGrid_GetBricksSize (const SCE_SVoxelGrid *vg)
+{
+    long dims[3];
+    size_t offset;
+
+    if (!vg->bmin)
+        return 0;
+    offset = SCE_VGrid_GetLevel (vg, vg->n_blevels - 1, dims);
+    return 2 * (offset + dims[0] * dims[1] * dims[2]);
+}
+/**
+ * \brief Copies the min/max summary of a grid
+ * \param vg a voxel grid with a summary
+ * \param out SCE_VGrid_GetBricksSize() bytes
+ * \sa SCE_VGrid_SetBricks()
+ */
+void SCE_VGrid_GetBricks (const SCE_SVoxelGrid *vg, SCEubyte *out)
+{
+    size_t n = SCE_VGrid_GetBricksSize (vg) / 2;
+    memcpy (out, vg->bmin, n);
+    memcpy (&out[n], vg->bmax, n);
+}
+/**
+ * \brief Sets the min/max summary of a grid
+ * \param vg a voxel grid with a summary
+ * \param in SCE_VGrid_GetBricksSize() bytes given by SCE_VGrid_GetBricks()
+ * for a grid of the same dimensions
+ *
+ * The voxels of \p vg are neither read nor written.
+ */
+void SCE_VGrid_SetBricks (SCE_SVoxelGrid *vg, const SCEubyte *in)
+{
+    size_t n = SCE_VGrid_GetBricksSize (vg) / 2;
+    memcpy (vg->bmin, in, n);
+    memcpy (vg->bmax, &in[n], n);
+}
+/* merges into *min and *max the bricks of the finest level in [b1, b2]
+   under brick b of the given level, descending only where it is not
+   entirely inside [b1, b2] */
+static void SCE_VGrid_RangeLevel (const SCE_SVoxelGrid *vg, SCEuint level,
+                                  const long *b, const long *b1,
+                                  const long *b2, SCEubyte *min,
+                                  SCEubyte *max)
+{
+    long dims[3], c[3], c1[3], c2[3], last[3];
+    size_t offset, i;
+    int inside = SCE_TRUE;
+
+    if (*min == 0 && *max == 255)
+        return;                 /* cannot get any looser */
+
+    last[0] = vg->bw - 1; last[1] = vg->bh - 1; last[2] = vg->bd - 1;
+    for (i = 0; i < 3; i++) {
+        long lo = b[i] << level, hi = MIN (((b[i] + 1) << level) - 1, last[i]);
+        if (lo < b1[i] || hi > b2[i])
+            inside = SCE_FALSE;
+    }
+
+    offset = SCE_VGrid_GetLevel (vg, level, dims);
+    if (inside || level == 0) {
+        offset += LOFFSET (dims, b[0], b[1], b[2]);
+        *min = MIN (*min, vg->bmin[offset]);
+        *max = MAX (*max, vg->bmax[offset]);
+        return;
+    }
+
+    /* children overlapping [b1, b2] */
+    for (i = 0; i < 3; i++) {
+        c1[i] = MAX (b[i] << 1, b1[i] >> (level - 1));
+        c2[i] = MIN ((b[i] << 1) + 1, b2[i] >> (level - 1));
+    }
+    for (c[2] = c1[2]; c[2] <= c2[2]; c[2]++) {
+        for (c[1] = c1[1]; c[1] <= c2[1]; c[1]++) {
+            for (c[0] = c1[0]; c[0] <= c2[0]; c[0]++)
+                SCE_VGrid_RangeLevel (vg, level - 1, c, b1, b2, min, max);
+        }
+    }
+}
+
+static int SCE_VGrid_GetRangev (const SCE_SVoxelGrid *vg, const long *p1,
+                                const long *p2, SCEubyte *min, SCEubyte *max)
+{
+    long b[3], b1[3], b2[3];
+    SCEuint top;
+    SCEubyte a = 255, c = 0;
+
+    if (!vg->bmin || !SCE_VGrid_GetBrickRange (vg, p1, p2, b1, b2))
+        return SCE_FALSE;
+
+    /* the top level is a single brick */
+    top = vg->n_blevels - 1;
+    b[0] = b[1] = b[2] = 0;
+    SCE_VGrid_RangeLevel (vg, top, b, b1, b2, &a, &c);
+    *min = a;
+    *max = c;
+    return SCE_TRUE;
+}
+
+/**
+ * \brief Gets bounds of the densities of a region from the min/max summary
+ * \param vg a voxel grid
+ * \param region a region, NULL means the whole grid
+ * \param min,max bounds of the densities of \p region
+ *
+ * The voxels are not read, the bounds are those of the bricks overlapping
+ * \p region hence they might be loose. Works even if the voxels are not in
+ * memory.
+ * \return SCE_FALSE if \p vg has no summary or \p region is outside of
+ * \p vg, SCE_TRUE otherwise
+ */
+int SCE_VGrid_GetRange (const SCE_SVoxelGrid *vg, const SCE_SLongRect3 *region,
+                        SCEubyte *min, SCEubyte *max)
+{
+    long p1[3], p2[3];
+
+    if (region)
+        SCE_Rectangle3_GetPointslv (region, p1, p2);
+    else {
+        p1[0] =        p1[1] =        p1[2] = 0;
+        p2[0] = vg->w; p2[1] = vg->h; p2[2] = vg->d;
+    }
+    return SCE_VGrid_GetRangev (vg, p1, p2, min, max);
+}
+
+static int SCE_VGrid_ScanInRange (const SCE_SVoxelGrid *vg, const long *p1,
+                                  const long *p2, SCEubyte min, SCEubyte max)
+{
+    long x, y, z;
+
+    for (z = p1[2]; z < p2[2]; z++) {
+        for (y = p1[1]; y < p2[1]; y++) {
+            const SCEubyte *ptr = &vg->data[VOFFSET (vg, p1[0], y, z)];
+            for (x = p1[0]; x < p2[0]; x++) {
+                if (*ptr < min || *ptr > max)
+                    return SCE_FALSE;
+                ptr += vg->n_cmp;
+            }
+        }
+    }
+    return SCE_TRUE;
+}
+
+/* is every voxel of [p1, p2[ in [min, max]? uses the bricks if any */
+static int SCE_VGrid_IsInRange (const SCE_SVoxelGrid *vg, const long *p1,
+                                const long *p2, SCEubyte min, SCEubyte max)
+{
+    long b[3], b1[3], b2[3], q1[3], q2[3];
+    size_t i;
+    SCEubyte a, c;
+
+    if (!vg->bmin)
+        return SCE_VGrid_ScanInRange (vg, p1, p2, min, max);
+
+    if (!SCE_VGrid_GetBrickRange (vg, p1, p2, b1, b2))
+        return SCE_TRUE;
+
+    /* most regions are settled by the coarse bricks */
+    if (SCE_VGrid_GetRangev (vg, p1, p2, &a, &c)) {
+        if (a >= min && c <= max)
+            return SCE_TRUE;
+        if (c < min || a > max)
+            return SCE_FALSE;
+    }
+
+    for (b[2] = b1[2]; b[2] <= b2[2]; b[2]++) {
+        for (b[1] = b1[1]; b[1] <= b2[1]; b[1]++) {
+            for (b[0] = b1[0]; b[0] <= b2[0]; b[0]++) {
+                size_t offset = BOFFSET (vg, b[0], b[1], b[2]);
+                if (vg->bmin[offset] >= min && vg->bmax[offset] <= max)
+                    continue;
+                if (vg->bmax[offset] < min || vg->bmin[offset] > max)
+                    return SCE_FALSE;
+                /* mixed brick: look at the voxels of the region */
+                SCE_VGrid_GetBrick (vg, b, q1, q2);
+                for (i = 0; i < 3; i++) {
+                    q1[i] = MAX (q1[i], p1[i]);
+                    q2[i] = MIN (q2[i], p2[i]);
+                }
+                if (!SCE_VGrid_ScanInRange (vg, q1, q2, min, max))
+                    return SCE_FALSE;
+            }
+        }
+    }
+    return SCE_TRUE;
+}
 
 void SCE_VGrid_Fill (SCE_SVoxelGrid *vg, const SCE_SLongRect3 *region,
                      const SCEubyte *pattern)
@@ -129,6 +593,7 @@ void SCE_VGrid_Fill (SCE_SVoxelGrid *vg, const SCE_SLongRect3 *region,
         }
     }
 
+    SCE_VGrid_FillBricksv (vg, p1, p2, pattern[0]);
     vg->full_checked = vg->empty_checked = SCE_FALSE;
 }
 
@@ -161,6 +626,7 @@ void SCE_VGrid_Copy (const SCE_SLongRect3 *dst_region, SCE_SVoxelGrid *dst,
         }
     }
 
+    SCE_VGrid_UpdateBricksv (dst, dst_p1, dst_p2);
     dst->full_checked = dst->empty_checked = SCE_FALSE;
 }
 
@@ -199,6 +665,7 @@ long SCE_VGrid_CopyStats (const SCE_SLongRect3 *dst_region, SCE_SVoxelGrid *dst,
         }
     }
 
+    SCE_VGrid_UpdateBricksv (dst, dst_p1, dst_p2);
     dst->full_checked = dst->empty_checked = SCE_FALSE;
 
     return diff;
@@ -233,6 +700,7 @@ void SCE_VGrid_CopyStats2 (const SCE_SLongRect3 *dst_region,SCE_SVoxelGrid *dst,
         }
     }
 
+    SCE_VGrid_UpdateBricksv (dst, dst_p1, dst_p2);
     dst->full_checked = dst->empty_checked = SCE_FALSE;
 }
 
@@ -264,6 +732,7 @@ long SCE_VGrid_FillStats (const SCE_SLongRect3 *dst_region, SCE_SVoxelGrid *dst,
         }
     }
 
+    SCE_VGrid_FillBricksv (dst, dst_p1, dst_p2, pattern);
     dst->full_checked = dst->empty_checked = SCE_FALSE;
 
     return diff;
@@ -292,6 +761,7 @@ void SCE_VGrid_FillStats2 (const SCE_SLongRect3 *dst_region, SCE_SVoxelGrid *dst
         }
     }
 
+    SCE_VGrid_FillBricksv (dst, dst_p1, dst_p2, pattern);
     dst->full_checked = dst->empty_checked = SCE_FALSE;
 }
 
@@ -308,7 +778,6 @@ int SCE_VGrid_IsEmpty (SCE_SVoxelGrid *vg, const SCE_SLongRect3 *region)
         return SCE_TRUE;
     else {
         long p1[3], p2[3];
-        long x, y, z;
 
         if (!vg->empty_checked) {
             vg->empty_checked = SCE_TRUE;
@@ -325,17 +794,8 @@ int SCE_VGrid_IsEmpty (SCE_SVoxelGrid *vg, const SCE_SLongRect3 *region)
             p2[0] = vg->w; p2[1] = vg->h; p2[2] = vg->d;
         }
 
-        for (z = p1[2]; z < p2[2]; z++) {
-            for (y = p1[1]; y < p2[1]; y++) {
-                for (x = p1[0]; x < p2[0]; x++) {
-                    /* assuming the first byte is the density */
-                    SCEubyte density = vg->data[VOFFSET (vg, x, y, z)];
-                    if (density > 127)
-                        return SCE_FALSE;
-                }
-            }
-        }
-        return SCE_TRUE;
+        /* assuming the first byte is the density */
+        return SCE_VGrid_IsInRange (vg, p1, p2, 0, 127);
     }
 }
 
@@ -345,7 +805,6 @@ int SCE_VGrid_IsFull (SCE_SVoxelGrid *vg, const SCE_SLongRect3 *region)
         return SCE_TRUE;
     else {
         long p1[3], p2[3];
-        long x, y, z;
 
         if (!vg->full_checked) {
             vg->full_checked = SCE_TRUE;
@@ -362,16 +821,153 @@ int SCE_VGrid_IsFull (SCE_SVoxelGrid *vg, const SCE_SLongRect3 *region)
             p2[0] = vg->w; p2[1] = vg->h; p2[2] = vg->d;
         }
 
-        for (z = p1[2]; z < p2[2]; z++) {
-            for (y = p1[1]; y < p2[1]; y++) {
-                for (x = p1[0]; x < p2[0]; x++) {
-                    /* assuming the first byte is the density */
-                    SCEubyte density = vg->data[VOFFSET (vg, x, y, z)];
-                    if (density < 128)
-                        return SCE_FALSE;
-                }
-            }
+        /* assuming the first byte is the density */
+        return SCE_VGrid_IsInRange (vg, p1, p2, 128, 255);
+    }
+}
+
+
+/* density LOD: separable [1 2 1]^3 filter evaluated on integers, the sum of
+   the weights is 64 thus the result is exactly the one of the float kernel
+   truncated to a byte */
+
+/* dst = a + 2b + c */
+static void SCE_VGrid_FilterRows8 (const SCEubyte *a, const SCEubyte *b,
+                                   const SCEubyte *c, SCEushort *dst,
+                                   size_t n)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128 ();
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128 ((const __m128i*)&a[i]);
+        __m128i vb = _mm_loadu_si128 ((const __m128i*)&b[i]);
+        __m128i vc = _mm_loadu_si128 ((const __m128i*)&c[i]);
+        __m128i lo, hi;
+        lo = _mm_add_epi16 (_mm_unpacklo_epi8 (va, zero),
+                            _mm_unpacklo_epi8 (vc, zero));
+        hi = _mm_add_epi16 (_mm_unpackhi_epi8 (va, zero),
+                            _mm_unpackhi_epi8 (vc, zero));
+        lo = _mm_add_epi16 (lo, _mm_slli_epi16 (_mm_unpacklo_epi8 (vb, zero),
+                                                1));
+        hi = _mm_add_epi16 (hi, _mm_slli_epi16 (_mm_unpackhi_epi8 (vb, zero),
+                                                1));
+        _mm_storeu_si128 ((__m128i*)&dst[i], lo);
+        _mm_storeu_si128 ((__m128i*)&dst[i + 8], hi);
+    }
+#endif
+    for (; i < n; i++)
+        dst[i] = a[i] + 2 * b[i] + c[i];
+}
+static void SCE_VGrid_FilterRows16 (const SCEushort *a, const SCEushort *b,
+                                    const SCEushort *c, SCEushort *dst,
+                                    size_t n)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 8 <= n; i += 8) {
+        __m128i va = _mm_loadu_si128 ((const __m128i*)&a[i]);
+        __m128i vb = _mm_loadu_si128 ((const __m128i*)&b[i]);
+        __m128i vc = _mm_loadu_si128 ((const __m128i*)&c[i]);
+        va = _mm_add_epi16 (_mm_add_epi16 (va, vc), _mm_slli_epi16 (vb, 1));
+        _mm_storeu_si128 ((__m128i*)&dst[i], va);
+    }
+#endif
+    for (; i < n; i++)
+        dst[i] = a[i] + 2 * b[i] + c[i];
+}
+/* dst[i] = (src[2i] + 2 src[2i + 1] + src[2i + 2]) / 64 */
+static void SCE_VGrid_FilterRow (const SCEushort *src, SCEubyte *dst,
+                                 size_t n, size_t w)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i mask = _mm_set1_epi32 (0xffff);
+    /* reads src[2i] to src[2i + 17] */
+    for (; i + 8 <= n && 2 * i + 18 <= w; i += 8) {
+        __m128i a = _mm_loadu_si128 ((const __m128i*)&src[2 * i]);
+        __m128i b = _mm_loadu_si128 ((const __m128i*)&src[2 * i + 8]);
+        __m128i c = _mm_loadu_si128 ((const __m128i*)&src[2 * i + 2]);
+        __m128i d = _mm_loadu_si128 ((const __m128i*)&src[2 * i + 10]);
+        __m128i even, odd, next;
+        /* values are below 2^15, signed saturation is harmless */
+        even = _mm_packs_epi32 (_mm_and_si128 (a, mask),
+                                _mm_and_si128 (b, mask));
+        odd = _mm_packs_epi32 (_mm_srli_epi32 (a, 16), _mm_srli_epi32 (b, 16));
+        next = _mm_packs_epi32 (_mm_and_si128 (c, mask),
+                                _mm_and_si128 (d, mask));
+        a = _mm_add_epi16 (_mm_add_epi16 (even, next),
+                           _mm_slli_epi16 (odd, 1));
+        a = _mm_srli_epi16 (a, 6);
+        _mm_storel_epi64 ((__m128i*)&dst[i],
+                          _mm_packus_epi16 (a, _mm_setzero_si128 ()));
+    }
+#else
+    (void)w;
+#endif
+    for (; i < n; i++)
+        dst[i] = (src[2 * i] + 2 * src[2 * i + 1] + src[2 * i + 2]) >> 6;
+}
+
+/**
+ * \brief Computes the lower level of details of a density grid
+ * \param in source grid
+ * \param out destination grid, at least half the size of \p in minus one
+ *
+ * Each voxel of \p out is the [1 2 1]^3 weighted mean of the 27 voxels of
+ * \p in around (2x + 1, 2y + 1, 2z + 1). The filter is applied in three
+ * separable passes over whole rows. Both grids must have one component.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VGrid_ComputeDensityLOD (const SCE_SVoxelGrid *in,
+                                 SCE_SVoxelGrid *out)
+{
+    SCEulong y, z, nx, ny, nz;
+    size_t w = in->w, slice = in->w * in->h;
+    SCEushort *rows = NULL, *t1[3], *t2 = NULL;
+
+    if (in->w < 3 || in->h < 3 || in->d < 3)
+        return SCE_OK;
+    nx = (in->w - 1) / 2;
+    ny = (in->h - 1) / 2;
+    nz = (in->d - 1) / 2;
+
+    if (!(rows = SCE_malloc (4 * w * sizeof *rows))) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    t1[0] = rows;
+    t1[1] = &rows[w];
+    t1[2] = &rows[2 * w];
+    t2 = &rows[3 * w];
+
+    for (z = 0; z < nz; z++) {
+        /* slices 2z, 2z + 1 and 2z + 2 */
+        const SCEubyte *s0 = &in->data[2 * z * slice];
+        const SCEubyte *s1 = &s0[slice];
+        const SCEubyte *s2 = &s1[slice];
+
+        SCE_VGrid_FilterRows8 (s0, s1, s2, t1[0], w);
+        for (y = 0; y < ny; y++) {
+            SCEushort *tmp = NULL;
+            size_t o = (2 * y + 1) * w;
+
+            SCE_VGrid_FilterRows8 (&s0[o], &s1[o], &s2[o], t1[1], w);
+            o += w;
+            SCE_VGrid_FilterRows8 (&s0[o], &s1[o], &s2[o], t1[2], w);
+            SCE_VGrid_FilterRows16 (t1[0], t1[1], t1[2], t2, w);
+            SCE_VGrid_FilterRow (t2, &out->data[VOFFSET (out, 0, y, z)],
+                                 nx, w);
+            /* row 2y + 2 is the first row of the next output row */
+            tmp = t1[0];
+            t1[0] = t1[2];
+            t1[2] = tmp;
         }
-        return SCE_TRUE;
     }
+
+    SCE_free (rows);
+    SCE_VGrid_UpdateBricks (out, NULL);
+    out->full_checked = out->empty_checked = SCE_FALSE;
+
+    return SCE_OK;
 }
@@ -20,6 +20,7 @@
    updated: 05/03/2013 */
 
 #include <time.h>
+#include <pthread.h>
 #include <SCE/utils/SCEUtils.h>
 
 #include "SCE/core/SCEVoxelOctree.h"
@@ -33,6 +34,7 @@ static void SCE_VOctree_InitNode (SCE_SVoxelOctreeNode *node)
     node->level = 0;
     node->x = node->y = node->z = 0;
     memset (node->fname, 0, SCE_VOCTREE_NODE_FNAME_LENGTH);
+    node->key[0] = node->key[1] = node->key[2] = node->key[3] = 0;
     SCE_VGrid_Init (&node->grid);
     SCE_File_Init (&node->file);
     node->is_open = SCE_FALSE;
@@ -41,6 +43,9 @@ static void SCE_VOctree_InitNode (SCE_SVoxelOctreeNode *node)
     node->in_volume = 0;
     node->in = NULL;
     node->material = 255;
+    node->pending = 0;
+    node->loading = SCE_FALSE;
+    node->pinned = 0;
     node->udata = node->udata2 = NULL;
     node->fun = node->fun2 = NULL;
     SCE_List_InitIt (&node->it);
@@ -49,7 +54,20 @@ static void SCE_VOctree_InitNode (SCE_SVoxelOctreeNode *node)
     SCE_List_SetData (&node->it2, node);
     node->vo = NULL;
 }
+static void SCE_VOctree_LockFiles (SCE_SVoxelOctree *vo)
+{
+    if (vo && vo->file_mutex)
+        pthread_mutex_lock (vo->file_mutex);
+}
+static void SCE_VOctree_UnlockFiles (SCE_SVoxelOctree *vo)
+{
+    if (vo && vo->file_mutex)
+        pthread_mutex_unlock (vo->file_mutex);
+}
+
 static void SCE_VOctree_DeleteNode (SCE_SVoxelOctreeNode*);
+static void SCE_VOctree_UncacheNode (SCE_SVoxelOctree*, SCE_SVoxelOctreeNode*);
+static void SCE_VOctree_LoadSummary (SCE_SVoxelOctree*, SCE_SVoxelOctreeNode*);
 static void SCE_VOctree_ClearNode (SCE_SVoxelOctreeNode *node)
 {
     size_t i;
@@ -59,8 +77,14 @@ static void SCE_VOctree_ClearNode (SCE_SVoxelOctreeNode *node)
         node->fun2 (node->udata2);
     for (i = 0; i < 8; i++)
         SCE_VOctree_DeleteNode (node->children[i]);
-    if (node->is_open)
+    /* keep the cache accounting right */
+    if (node->cached && node->vo)
+        SCE_VOctree_UncacheNode (node->vo, node);
+    if (node->is_open) {
+        SCE_VOctree_LockFiles (node->vo);
         SCE_File_Close (&node->file);
+        SCE_VOctree_UnlockFiles (node->vo);
+    }
     SCE_VGrid_Clear (&node->grid);
     SCE_free (node->in);
     SCE_List_Remove (&node->it);
@@ -104,10 +128,19 @@ void SCE_VOctree_Init (SCE_SVoxelOctree *vo)
     memset (vo->prefix, 0, sizeof vo->prefix);
     vo->fs = NULL;
     vo->fcache = NULL;
+    vo->codec = SCE_VCodec_Get (SCE_VCODEC_ZLIB);
+    vo->pack = NULL;
 
+    pthread_mutex_init (&vo->cache_mutex, NULL);
+    pthread_cond_init (&vo->cache_cond, NULL);
+    pthread_mutex_init (&vo->sync_mutex, NULL);
+    vo->file_mutex = NULL;
     vo->n_cached = 0;
     vo->max_cached = 16;        /* seems legit. */
+    vo->cached_size = 0;
+    vo->max_cached_size = 0;
     SCE_List_Init (&vo->cached);
+    vo->cache_hits = vo->cache_misses = vo->cache_evictions = 0;
 
     vo->udata = NULL;
     vo->fun = NULL;
@@ -118,6 +151,9 @@ void SCE_VOctree_Clear (SCE_SVoxelOctree *vo)
         vo->fun (vo->udata);
     SCE_VOctree_ClearNode (&vo->root);
     SCE_List_Clear (&vo->cached);
+    pthread_mutex_destroy (&vo->cache_mutex);
+    pthread_cond_destroy (&vo->cache_cond);
+    pthread_mutex_destroy (&vo->sync_mutex);
 }
 SCE_SVoxelOctree* SCE_VOctree_Create (void)
 {
@@ -180,10 +216,92 @@ void SCE_VOctree_SetFileCache (SCE_SVoxelOctree *vo, SCE_SFileCache *cache)
 {
     vo->fcache = cache;
 }
+/**
+ * \brief Sets a mutex locked around every access to the file system
+ * \param vo a voxel octree
+ * \param mutex a mutex shared by every user of the file system and file
+ * cache of \p vo, NULL if \p vo is only used by one thread at a time
+ *
+ * Compression and decompression of the nodes are done outside of this lock.
+ * \sa SCE_VOctree_SetFileSystem(), SCE_VOctree_SetFileCache()
+ */
+void SCE_VOctree_SetFileMutex (SCE_SVoxelOctree *vo, pthread_mutex_t *mutex)
+{
+    vo->file_mutex = mutex;
+}
+/**
+ * \brief Stores the nodes in a pack instead of one file per node
+ * \param vo a voxel octree
+ * \param pack an open voxel pack, can be shared by several octrees with
+ * distinct origins, NULL to use separate files
+ *
+ * The file system, the file cache and the file mutex of \p vo are not used
+ * for the nodes when a pack is set. Must be called before any node is
+ * cached.
+ * \sa SCE_VPack_Open()
+ */
+void SCE_VOctree_SetPack (SCE_SVoxelOctree *vo, SCE_SVoxelPack *pack)
+{
+    vo->pack = pack;
+}
+SCE_SVoxelPack* SCE_VOctree_GetPack (SCE_SVoxelOctree *vo)
+{
+    return vo->pack;
+}
+/**
+ * \brief Sets the codec used to compress the node files
+ * \param vo a voxel octree
+ * \param codec a codec, it must be registered if it is not a built-in one
+ *
+ * The default codec is zlib with maximum compression. Nodes written with
+ * another codec can still be read, the codec being stored in each file.
+ * \sa SCE_VCodec_Register()
+ */
+void SCE_VOctree_SetCodec (SCE_SVoxelOctree *vo, const SCE_SVoxelCodec *codec)
+{
+    vo->codec = codec;
+}
+const SCE_SVoxelCodec* SCE_VOctree_GetCodec (const SCE_SVoxelOctree *vo)
+{
+    return vo->codec;
+}
+/**
+ * \brief Sets the maximum number of nodes kept decompressed in memory
+ * \param vo a voxel octree
+ * \param max_cached number of nodes
+ *
+ * Only used when no memory budget has been set with
+ * SCE_VOctree_SetMaxCachedSize(), the budget is then \p max_cached times the
+ * size of a node's grid.
+ * \sa SCE_VOctree_SetMaxCachedSize(), SCE_VOctree_UpdateCache()
+ */
 void SCE_VOctree_SetMaxCachedNodes (SCE_SVoxelOctree *vo, SCEulong max_cached)
 {
     vo->max_cached = max_cached;
 }
+/**
+ * \brief Sets the memory budget of the node cache
+ * \param vo a voxel octree
+ * \param size maximum number of bytes of decompressed voxels kept in memory,
+ * 0 to use the number of nodes given to SCE_VOctree_SetMaxCachedNodes()
+ * \sa SCE_VOctree_SetMaxCachedNodes(), SCE_VOctree_UpdateCache()
+ */
+void SCE_VOctree_SetMaxCachedSize (SCE_SVoxelOctree *vo, size_t size)
+{
+    vo->max_cached_size = size;
+}
+/**
+ * \brief Gets the effective memory budget of the node cache
+ * \param vo a voxel octree
+ * \return budget in bytes
+ * \sa SCE_VOctree_SetMaxCachedSize()
+ */
+size_t SCE_VOctree_GetMaxCachedSize (const SCE_SVoxelOctree *vo)
+{
+    if (vo->max_cached_size > 0)
+        return vo->max_cached_size;
+    return vo->max_cached * vo->w * vo->h * vo->d * SCE_VOCTREE_VOXEL_ELEMENTS;
+}
 
 
 void SCE_VOctree_SetData (SCE_SVoxelOctree *vo, void *data)
@@ -239,6 +357,77 @@ SCE_VOctree_GetNodeStatus (const SCE_SVoxelOctreeNode *node)
 {
     return node->status;
 }
+/**
+ * \brief Gets the status of a region of a node
+ * \param vo the octree of \p node
+ * \param node a node
+ * \param r a region in the space of the level of \p node
+ *
+ * For nodes holding voxels, the min/max summary of the node is used to
+ * tell whether the part of \p r inside \p node is empty or full, thus the
+ * voxels do not need to be in memory: the summary of a node that has never
+ * been loaded is read from its compressed data, which are not
+ * decompressed. Density fields only.
+ * \return SCE_VOCTREE_NODE_EMPTY or SCE_VOCTREE_NODE_FULL if the region is
+ * known to be empty or full, the status of \p node otherwise
+ */
+SCE_EVoxelOctreeStatus
+SCE_VOctree_GetNodeRegionStatus (SCE_SVoxelOctree *vo,
+                                 SCE_SVoxelOctreeNode *node,
+                                 const SCE_SLongRect3 *r)
+{
+    SCE_SLongRect3 local;
+    SCEubyte min, max;
+    int known;
+
+    if (node->status != SCE_VOCTREE_NODE_LEAF &&
+        node->status != SCE_VOCTREE_NODE_NODE)
+        return node->status;
+    if (vo->usage != SCE_VOCTREE_DENSITY_FIELD)
+        return node->status;
+
+    local = *r;
+    SCE_Rectangle3_Movel (&local, -node->x, -node->y, -node->z);
+    /* the summary is written by loads and edits under the cache mutex, the
+       caller may not hold the tree lock */
+    pthread_mutex_lock (&vo->cache_mutex);
+    SCE_VOctree_LoadSummary (vo, node);
+    known = SCE_VGrid_GetRange (&node->grid, &local, &min, &max);
+    pthread_mutex_unlock (&vo->cache_mutex);
+    if (!known)
+        return node->status;
+
+    if (max <= 127)
+        return SCE_VOCTREE_NODE_EMPTY;
+    else if (min > 127)
+        return SCE_VOCTREE_NODE_FULL;
+    return node->status;
+}
+/**
+ * \brief Tells whether a node is about to be loaded
+ * \param node a node
+ *
+ * Unlike the status of \p node, this is a transient state.
+ * \return SCE_TRUE if a background job has been queued for \p node and is
+ * not over yet or if a thread is decompressing \p node, SCE_FALSE otherwise
+ * \sa SCE_VOctree_GetNodeStatus(), SCE_VWorld_QueueLoadNode()
+ */
+int SCE_VOctree_IsNodeLoading (const SCE_SVoxelOctreeNode *node)
+{
+    return node->pending > 0 || node->loading;
+}
+/**
+ * \brief Updates the number of background jobs queued for a node
+ * \param node a node
+ * \param n number of jobs added (or removed if negative)
+ */
+void SCE_VOctree_AddNodePending (SCE_SVoxelOctreeNode *node, int n)
+{
+    pthread_mutex_lock (&node->vo->cache_mutex);
+    /* the node might have been recreated since the job was queued */
+    node->pending = MAX (node->pending + n, 0);
+    pthread_mutex_unlock (&node->vo->cache_mutex);
+}
 SCEuint SCE_VOctree_GetNodeLevel (const SCE_SVoxelOctreeNode *node)
 {
     return node->level;
@@ -337,13 +526,17 @@ static void SCE_VOctree_SetNodeGrid (SCE_SVoxelOctreeNode *node, SCEulong w,
 static void
 SCE_VOctree_MakeNodeFilename (const SCE_SVoxelOctree *vo,
                               const SCE_SLongRect3 *node_rect, SCEuint level,
-                              char *fname)
+                              SCE_SVoxelOctreeNode *node)
 {
     long p1[3], p2[3];
     /* TODO: file names use absolute coordinates, which sucks */
     SCE_Rectangle3_GetPointslv (node_rect, p1, p2);
-    sprintf (fname, "%s/lod%u/%ld_%ld_%ld", vo->prefix, level,
+    sprintf (node->fname, "%s/lod%u/%ld_%ld_%ld", vo->prefix, level,
              p1[0], p1[1], p1[2]);
+    node->key[0] = level;
+    node->key[1] = p1[0];
+    node->key[2] = p1[1];
+    node->key[3] = p1[2];
 }
 
 static void SCE_VOctree_ConstructRect (const SCE_SLongRect3 *parent,
@@ -380,7 +573,7 @@ SCE_VOctree_LoadNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
     rect = *node_rect;
     SCE_Rectangle3_Pow2l (&rect, -level);
     SCE_Rectangle3_GetOriginlv (&rect, &x, &y, &z);
-    SCE_VOctree_MakeNodeFilename (vo, &rect, level, node->fname);
+    SCE_VOctree_MakeNodeFilename (vo, &rect, level, node);
     SCE_VOctree_SetNodeGrid (node, vo->w, vo->h, vo->d, 1);
     SCE_VOctree_SetNodeOrigin (node, x, y, z);
 
@@ -522,58 +715,173 @@ int SCE_VOctree_Save (SCE_SVoxelOctree *vo, const char *fname)
 }
 
 
-static void SCE_VOctree_Get256 (long *in, SCEubyte *data)
+/* node files: the 256 array, the codec marker and ID, then the compressed
+   grid. With the summary marker, the size and the bytes of the min/max
+   summary of the grid come before the compressed grid. Files written
+   before codecs existed have no marker and are zlib compressed, a zlib
+   stream never starts with one of the markers. */
+#define SCE_VOCTREE_NODE_HEADER_SIZE (256 * SCE_ENCODE_LONG_SIZE)
+#define SCE_VOCTREE_CODEC_MARKER 0x00
+#define SCE_VOCTREE_SUMMARY_MARKER 0x01
+
+static void SCE_VOctree_Get256 (long *in, const SCEubyte *data)
 {
     size_t i;
     for (i = 0; i < 256; i++) {
-        in[i] = SCE_Decode_Long (data);
+        in[i] = SCE_Decode_Long ((SCEubyte*)data);
         data = &data[SCE_ENCODE_LONG_SIZE];
     }
 }
 
-static int SCE_VOctree_DecompressNode (SCE_SVoxelOctreeNode *node)
+/* locates the parts of the data of a node file after the 256 array,
+   *summary is NULL if there is no summary, returns SCE_FALSE if the data
+   are truncated */
+static int
+SCE_VOctree_SplitNode (const SCEubyte *filedata, size_t size, int *codec,
+                       const SCEubyte **summary, size_t *summary_size,
+                       const SCEubyte **payload, size_t *payload_size)
 {
-    void *grid = NULL;
-    size_t size, i;
+    const SCEubyte *p = NULL;
+    long n = 0;
 
-    if (!(grid = SCE_malloc (SCE_VGrid_GetSize (&node->grid))))
-        goto fail;
-    if (!(node->in = SCE_malloc (256 * sizeof * node->in)))
+    if (size < SCE_VOCTREE_NODE_HEADER_SIZE + 2)
+        return SCE_FALSE;
+    p = &filedata[SCE_VOCTREE_NODE_HEADER_SIZE];
+    size -= SCE_VOCTREE_NODE_HEADER_SIZE;
+    *summary = NULL;
+    *summary_size = 0;
+
+    if (p[0] == SCE_VOCTREE_SUMMARY_MARKER) {
+        if (size < 2 + SCE_ENCODE_LONG_SIZE)
+            return SCE_FALSE;
+        *codec = p[1];
+        n = SCE_Decode_Long ((SCEubyte*)&p[2]);
+        p = &p[2 + SCE_ENCODE_LONG_SIZE];
+        size -= 2 + SCE_ENCODE_LONG_SIZE;
+        if (n < 0 || (size_t)n > size)
+            return SCE_FALSE;
+        *summary = p;
+        *summary_size = n;
+        p = &p[n];
+        size -= n;
+    } else if (p[0] == SCE_VOCTREE_CODEC_MARKER) {
+        *codec = p[1];
+        p = &p[2];
+        size -= 2;
+    } else {
+        /* files written before codecs were introduced: raw zlib stream */
+        *codec = SCE_VCODEC_ZLIB;
+    }
+    *payload = p;
+    *payload_size = size;
+    return SCE_TRUE;
+}
+
+/* fills the summary of grid from the stored one, returns SCE_FALSE if
+   there is none or if it does not match the dimensions of grid */
+static int
+SCE_VOctree_SetSummary (SCE_SVoxelGrid *grid, const SCEubyte *summary,
+                        size_t size)
+{
+    if (!summary || !SCE_VGrid_HasBricks (grid) ||
+        size != SCE_VGrid_GetBricksSize (grid))
+        return SCE_FALSE;
+    SCE_VGrid_SetBricks (grid, summary);
+    return SCE_TRUE;
+}
+
+static int
+SCE_VOctree_DecodeNode (const SCE_SVoxelOctreeNode *node, SCE_SVoxelGrid *grid,
+                        long *in, const SCEubyte *filedata, size_t size)
+{
+    const SCE_SVoxelCodec *codec = NULL;
+    const SCEubyte *payload = NULL, *summary = NULL;
+    size_t summary_size;
+    int id;
+
+    if (!SCE_VOctree_SplitNode (filedata, size, &id, &summary, &summary_size,
+                                &payload, &size))
+        goto corrupted;
+    /* get the 256 array */
+    SCE_VOctree_Get256 (in, filedata);
+    if (!(codec = SCE_VCodec_Get (id))) {
+        SCEE_Log (SCE_BAD_FORMAT);
+        SCEE_LogMsg ("voxel archive %s: unknown codec %d", node->fname, id);
         goto fail;
+    }
+    if (SCE_VCodec_Decompress (codec, payload, size, SCE_VGrid_GetRaw (grid),
+                               SCE_VGrid_GetSize (grid)) < 0)
+        goto corrupted;
+    if (!SCE_VOctree_SetSummary (grid, summary, summary_size))
+        SCE_VGrid_UpdateBricks (grid, NULL);
+
+    return SCE_OK;
+corrupted:
+    SCEE_Log (SCE_BAD_FORMAT);
+    SCEE_LogMsg ("corrupted voxel archive %s", node->fname);
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/* decompresses the data of a node into grid and in, which are not those of
+   the node so that cache_mutex need not be locked, *sync is set to SCE_TRUE
+   if the node had compressed data */
+static int
+SCE_VOctree_DecompressNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
+                            SCE_SVoxelGrid *grid, long *in, int *sync)
+{
+    SCEubyte *filedata = NULL;
+    size_t size, i;
+
     for (i = 0; i < 256; i++)
-        node->in[i] = 0;
-    node->in[0] = SCE_VGrid_GetNumVoxels (&node->grid);
-    SCE_VGrid_SetRaw (&node->grid, grid);
+        in[i] = 0;
+    in[0] = SCE_VGrid_GetNumVoxels (grid);
+    *sync = SCE_FALSE;
+
+    if (vo->pack) {
+        /* decompress straight from the pack mapping, the read lock allows
+           concurrent decompressions */
+        const SCEubyte *raw = NULL;
+        int r = SCE_OK;
+
+        SCE_VPack_Lock (vo->pack);
+        raw = SCE_VPack_Get (vo->pack, node->key[0], node->key[1],
+                             node->key[2], node->key[3], &size);
+        if (raw)
+            r = SCE_VOctree_DecodeNode (node, grid, in, raw, size);
+        SCE_VPack_Unlock (vo->pack);
+        if (r < 0)
+            goto fail;
+        *sync = (raw != NULL);
+        return SCE_OK;
+    }
 
+    /* copy the compressed data so that the file system is not locked
+       during decompression */
+    SCE_VOctree_LockFiles (vo);
     size = SCE_File_Length (&node->file);
+    if (size > 0) {
+        /* we must be sure that the file is a FileCache file */
+        SCEubyte *raw = SCE_FileCache_GetRaw (&node->file);
+        if (raw && (filedata = SCE_malloc (size)))
+            memcpy (filedata, raw, size);
+    }
+    SCE_VOctree_UnlockFiles (vo);
+
     /* TODO: dont do dat, go see CacheNode() */
     if (size > 0) {
-        SCE_SArray data;
-        SCEubyte *filedata = NULL;
-        SCE_Array_Init (&data);
-        /* TODO: use 'grid' pointer for 'data' and dont forget the
-                 memcpy() below */
-        if (!(filedata = SCE_FileCache_GetRaw (&node->file)))
+        if (!filedata)
             goto fail;
-        /* get the 256 array */
-        SCE_VOctree_Get256 (node->in, filedata);
-        filedata = &filedata[256 * SCE_ENCODE_LONG_SIZE];
-        /* we must be sure that the file is a FileCache file */
-        if (SCE_Zlib_Decompress (filedata, size, &data) < 0)
+        if (SCE_VOctree_DecodeNode (node, grid, in, filedata, size) < 0)
             goto fail;
-        if (SCE_Array_GetSize (&data) != SCE_VGrid_GetSize (&node->grid)) {
-            SCEE_Log (76);
-            SCEE_LogMsg ("corrupted voxel archive %s: size does not match",
-                         node->fname);
-            return SCE_ERROR;
-        }
-        memcpy (grid, SCE_Array_Get (&data), SCE_Array_GetSize (&data));
-        SCE_Array_Clear (&data);
-        node->is_sync = SCE_TRUE;
+        SCE_free (filedata);
+        *sync = SCE_TRUE;
     }
 
     return SCE_OK;
 fail:
+    SCE_free (filedata);
     SCEE_LogSrc ();
     return SCE_ERROR;
 }
@@ -586,29 +894,65 @@ static void SCE_VOctree_Set256 (long *in, SCEubyte *data)
         data = &data[SCE_ENCODE_LONG_SIZE];
     }
 }
-static int SCE_VOctree_CompressNode (SCE_SVoxelOctreeNode *node)
+static int
+SCE_VOctree_CompressNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
 {
-    SCE_SArray data;
-    SCEubyte in[256 * SCE_ENCODE_LONG_SIZE] = {0};
+    SCEubyte *data = NULL, *in = NULL;
+    size_t size = 0, in_size, summary_size;
 
-    SCE_Array_Init (&data);
-    /* 9: maximum compression level hehe */
-    if (SCE_Zlib_Compress (SCE_VGrid_GetRaw (&node->grid),
-                           SCE_VGrid_GetSize (&node->grid), 9, &data) < 0)
+    if (SCE_VCodec_Compress (vo->codec, SCE_VGrid_GetRaw (&node->grid),
+                             SCE_VGrid_GetSize (&node->grid),
+                             &data, &size) < 0)
         goto fail;
 
-    SCE_File_Rewind (&node->file);
-    SCE_File_Truncate (&node->file, SCE_Array_GetSize (&data));
-    SCE_VOctree_Set256 (node->in, in);
-    if (SCE_File_Write (in, 1, sizeof in, &node->file) != sizeof in)
+    /* the summary is stored so that the regions of the node can be
+       classified before decompressing it */
+    summary_size = SCE_VGrid_GetBricksSize (&node->grid);
+    in_size = SCE_VOCTREE_NODE_HEADER_SIZE + 2;
+    if (summary_size > 0)
+        in_size += SCE_ENCODE_LONG_SIZE + summary_size;
+    if (!(in = SCE_malloc (in_size + (vo->pack ? size : 0))))
         goto fail;
-    if (SCE_File_Write (SCE_Array_Get (&data), 1, SCE_Array_GetSize (&data),
-                        &node->file) != SCE_Array_GetSize (&data))
+    SCE_VOctree_Set256 (node->in, in);
+    in[SCE_VOCTREE_NODE_HEADER_SIZE + 1] = SCE_VCodec_GetID (vo->codec);
+    if (summary_size > 0) {
+        SCEubyte *p = &in[SCE_VOCTREE_NODE_HEADER_SIZE + 2];
+        in[SCE_VOCTREE_NODE_HEADER_SIZE] = SCE_VOCTREE_SUMMARY_MARKER;
+        SCE_Encode_Long (summary_size, p);
+        SCE_VGrid_GetBricks (&node->grid, &p[SCE_ENCODE_LONG_SIZE]);
+    } else
+        in[SCE_VOCTREE_NODE_HEADER_SIZE] = SCE_VOCTREE_CODEC_MARKER;
+
+    if (vo->pack) {
+        /* in has room for the compressed grid */
+        memcpy (&in[in_size], data, size);
+        SCE_free (data);
+        data = NULL;
+        if (SCE_VPack_Put (vo->pack, node->key[0], node->key[1],
+                           node->key[2], node->key[3], in,
+                           in_size + size) < 0) {
+            in = NULL;
+            goto fail;
+        }
+        return SCE_OK;
+    }
+
+    SCE_VOctree_LockFiles (vo);
+    SCE_File_Rewind (&node->file);
+    SCE_File_Truncate (&node->file, in_size + size);
+    if (SCE_File_Write (in, 1, in_size, &node->file) != in_size ||
+        SCE_File_Write (data, 1, size, &node->file) != size) {
+        SCE_VOctree_UnlockFiles (vo);
         goto fail;
-    SCE_Array_Clear (&data);
+    }
+    SCE_VOctree_UnlockFiles (vo);
+    SCE_free (data);
+    SCE_free (in);
 
     return SCE_OK;
 fail:
+    SCE_free (data);
+    SCE_free (in);
     SCEE_LogSrc ();
     return SCE_ERROR;
 }
@@ -617,9 +961,13 @@ fail:
 static int
 SCE_VOctree_CacheFile (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
 {
-    if (!node->is_open) {
-        if (SCE_File_Open (&node->file, vo->fs, node->fname, SCE_FILE_READ |
-                           SCE_FILE_WRITE | SCE_FILE_CREATE) < 0)
+    if (!vo->pack && !node->is_open) {
+        int r;
+        SCE_VOctree_LockFiles (vo);
+        r = SCE_File_Open (&node->file, vo->fs, node->fname, SCE_FILE_READ |
+                           SCE_FILE_WRITE | SCE_FILE_CREATE);
+        SCE_VOctree_UnlockFiles (vo);
+        if (r < 0)
             goto fail;
         node->is_open = SCE_TRUE;
     }
@@ -629,13 +977,21 @@ fail:
     return SCE_ERROR;
 }
 
-/* update compressed data */
-int SCE_VOctree_SyncNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
+/* update compressed data, sync_mutex must be locked */
+static int SCE_VOctree_Sync (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
 {
-    if (SCE_VOctree_CacheFile (vo, node) < 0)
+    int r;
+
+    pthread_mutex_lock (&vo->cache_mutex);
+    /* the loading thread opens the file without holding cache_mutex */
+    while (node->loading)
+        pthread_cond_wait (&vo->cache_cond, &vo->cache_mutex);
+    r = SCE_VOctree_CacheFile (vo, node);
+    pthread_mutex_unlock (&vo->cache_mutex);
+    if (r < 0)
         goto fail;
     if (!node->is_sync) {
-        if (SCE_VOctree_CompressNode (node) < 0)
+        if (SCE_VOctree_CompressNode (vo, node) < 0)
             goto fail;
         node->is_sync = SCE_TRUE;
 #if 0
@@ -654,32 +1010,232 @@ fail:
     SCEE_LogSrc ();
     return SCE_ERROR;
 }
+/**
+ * \brief Writes the grid of a node into its file if it has been modified
+ * \param vo a voxel octree
+ * \param node a cached node of \p vo
+ *
+ * The grid of \p node must not be modified during this call, which is
+ * guaranteed by holding the read lock of the world tree of \p vo.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VOctree_SyncNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
+{
+    int r;
+    pthread_mutex_lock (&vo->sync_mutex);
+    r = SCE_VOctree_Sync (vo, node);
+    pthread_mutex_unlock (&vo->sync_mutex);
+    if (r < 0)
+        SCEE_LogSrc ();
+    return r;
+}
 
 
-/* makes sure the node grid data are in memory */
-int SCE_VOctree_CacheNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
+/* makes sure the node grid data are in memory, cache_mutex must be locked,
+   it is released while the node is being decompressed so that other nodes
+   can be loaded and queried meanwhile */
+static int
+SCE_VOctree_Cache (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
 {
-    if (!node->cached) {
-        /* TODO: dont cache the file if it dont exist, see DecompressNode() */
-        if (SCE_VOctree_CacheFile (vo, node) < 0)
-            goto fail;
-        if (SCE_VOctree_DecompressNode (node) < 0)
-            goto fail;
-        node->cached = SCE_TRUE;
+    SCE_SVoxelGrid grid;
+    long *in = NULL;
+    int sync = SCE_FALSE, r = SCE_ERROR;
+
+    /* another thread is loading it, wait for the outcome */
+    while (node->loading)
+        pthread_cond_wait (&vo->cache_cond, &vo->cache_mutex);
+
+    if (node->cached) {
+        /* move the node at the most recently used end of the list */
+        SCE_List_Removel (&node->it);
         SCE_List_Appendl (&vo->cached, &node->it);
-        vo->n_cached++;
+        vo->cache_hits++;
+        return SCE_OK;
+    }
+
+    node->loading = SCE_TRUE;
+    pthread_mutex_unlock (&vo->cache_mutex);
+
+    /* private grid, published once complete */
+    SCE_VGrid_Init (&grid);
+    grid.w = node->grid.w;
+    grid.h = node->grid.h;
+    grid.d = node->grid.d;
+    grid.n_cmp = node->grid.n_cmp;
+    /* TODO: dont cache the file if it dont exist, see DecompressNode() */
+    if (SCE_VOctree_CacheFile (vo, node) >= 0 &&
+        SCE_VGrid_Build (&grid) >= 0 &&
+        SCE_VGrid_AllocBricks (&grid) >= 0 &&
+        (in = SCE_malloc (256 * sizeof *in)) &&
+        SCE_VOctree_DecompressNode (vo, node, &grid, in, &sync) >= 0)
+        r = SCE_OK;
+
+    pthread_mutex_lock (&vo->cache_mutex);
+    node->loading = SCE_FALSE;
+    pthread_cond_broadcast (&vo->cache_cond);
+    if (r < 0) {
+        SCE_VGrid_Clear (&grid);
+        SCE_free (in);
+        goto fail;
     }
+
+    /* the summary outlives the voxels, see
+       SCE_VOctree_GetNodeRegionStatus() */
+    SCE_VGrid_SwapBricks (&node->grid, &grid);
+    SCE_VGrid_SetRaw (&node->grid, grid.data);
+    grid.data = NULL;
+    SCE_VGrid_Clear (&grid);
+    node->in = in;
+    if (sync)
+        node->is_sync = SCE_TRUE;
+    node->cached = SCE_TRUE;
+    SCE_List_Appendl (&vo->cached, &node->it);
+    vo->n_cached++;
+    vo->cached_size += SCE_VGrid_GetSize (&node->grid);
+    vo->cache_misses++;
+
     return SCE_OK;
 fail:
     SCEE_LogSrc ();
     return SCE_ERROR;
 }
+/* reads the min/max summary stored with the compressed data of a node
+   into grid, returns SCE_FALSE if there is none */
+static int
+SCE_VOctree_ReadSummary (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
+                         SCE_SVoxelGrid *grid)
+{
+    const SCEubyte *data = NULL, *summary = NULL, *payload = NULL;
+    size_t size = 0, summary_size, payload_size;
+    int codec, r = SCE_FALSE;
+
+    if (vo->pack) {
+        SCE_VPack_Lock (vo->pack);
+        data = SCE_VPack_Get (vo->pack, node->key[0], node->key[1],
+                              node->key[2], node->key[3], &size);
+        if (data && SCE_VOctree_SplitNode (data, size, &codec, &summary,
+                                           &summary_size, &payload,
+                                           &payload_size))
+            r = SCE_VOctree_SetSummary (grid, summary, summary_size);
+        SCE_VPack_Unlock (vo->pack);
+        return r;
+    }
 
-/* removes a node's grid from memory */
+    if (SCE_VOctree_CacheFile (vo, node) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    SCE_VOctree_LockFiles (vo);
+    size = SCE_File_Length (&node->file);
+    if (size > 0 && (data = SCE_FileCache_GetRaw (&node->file)) &&
+        SCE_VOctree_SplitNode (data, size, &codec, &summary, &summary_size,
+                               &payload, &payload_size))
+        r = SCE_VOctree_SetSummary (grid, summary, summary_size);
+    SCE_VOctree_UnlockFiles (vo);
+    return r;
+}
+
+/* gives a node that has never been loaded the summary stored with its
+   compressed data, cache_mutex must be locked, it is released during the
+   read like in SCE_VOctree_Cache(). Nodes without stored summary (written
+   by older versions) get one when they are decompressed. */
 static void
-SCE_VOctree_UncacheNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
+SCE_VOctree_LoadSummary (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
+{
+    SCE_SVoxelGrid grid;
+    int r = SCE_FALSE;
+
+    if (node->loading || SCE_VGrid_HasBricks (&node->grid) ||
+        !SCE_VGrid_GetNumVoxels (&node->grid))
+        return;
+
+    node->loading = SCE_TRUE;
+    pthread_mutex_unlock (&vo->cache_mutex);
+
+    SCE_VGrid_Init (&grid);
+    grid.w = node->grid.w;
+    grid.h = node->grid.h;
+    grid.d = node->grid.d;
+    if (SCE_VGrid_AllocBricks (&grid) >= 0)
+        r = SCE_VOctree_ReadSummary (vo, node, &grid);
+
+    pthread_mutex_lock (&vo->cache_mutex);
+    node->loading = SCE_FALSE;
+    pthread_cond_broadcast (&vo->cache_cond);
+    if (r == SCE_TRUE && !SCE_VGrid_HasBricks (&node->grid))
+        SCE_VGrid_SwapBricks (&node->grid, &grid);
+    SCE_VGrid_Clear (&grid);
+}
+
+/**
+ * \brief Makes sure the grid of a node is in memory
+ * \param vo a voxel octree
+ * \param node a node of \p vo
+ *
+ * The node becomes the most recently used node of the cache of \p vo.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VOctree_UpdateCache()
+ */
+int SCE_VOctree_CacheNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
+{
+    int r;
+    pthread_mutex_lock (&vo->cache_mutex);
+    r = SCE_VOctree_Cache (vo, node);
+    pthread_mutex_unlock (&vo->cache_mutex);
+    if (r < 0)
+        SCEE_LogSrc ();
+    return r;
+}
+
+/**
+ * \brief Marks a cached node as the most recently used one
+ * \param vo a voxel octree
+ * \param node a node of \p vo
+ *
+ * Unlike SCE_VOctree_CacheNode(), the node is not loaded if it is not in
+ * memory and the cache statistics are not updated.
+ * \return SCE_TRUE if \p node is cached, SCE_FALSE otherwise
+ */
+int SCE_VOctree_TouchNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
+{
+    int cached;
+    pthread_mutex_lock (&vo->cache_mutex);
+    if ((cached = node->cached)) {
+        SCE_List_Removel (&node->it);
+        SCE_List_Appendl (&vo->cached, &node->it);
+    }
+    pthread_mutex_unlock (&vo->cache_mutex);
+    return cached;
+}
+
+/* loads a node and keeps it from being evicted until
+   SCE_VOctree_UnpinNode(), for readers that only hold the tree read lock */
+static int SCE_VOctree_PinNode (SCE_SVoxelOctree *vo,
+                                SCE_SVoxelOctreeNode *node)
+{
+    int r;
+    pthread_mutex_lock (&vo->cache_mutex);
+    if ((r = SCE_VOctree_Cache (vo, node)) == SCE_OK)
+        node->pinned++;
+    pthread_mutex_unlock (&vo->cache_mutex);
+    if (r < 0)
+        SCEE_LogSrc ();
+    return r;
+}
+static void SCE_VOctree_UnpinNode (SCE_SVoxelOctree *vo,
+                                   SCE_SVoxelOctreeNode *node)
+{
+    pthread_mutex_lock (&vo->cache_mutex);
+    node->pinned--;
+    pthread_mutex_unlock (&vo->cache_mutex);
+}
+
+/* removes a node's grid from memory, cache_mutex must be locked */
+static void
+SCE_VOctree_Uncache (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
 {
     if (node->cached) {
+        vo->cached_size -= SCE_VGrid_GetSize (&node->grid);
         SCE_VGrid_SetRaw (&node->grid, NULL);
         SCE_free (node->in);
         node->in = NULL;
@@ -688,6 +1244,13 @@ SCE_VOctree_UncacheNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
         vo->n_cached--;
     }
 }
+static void
+SCE_VOctree_UncacheNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
+{
+    pthread_mutex_lock (&vo->cache_mutex);
+    SCE_VOctree_Uncache (vo, node);
+    pthread_mutex_unlock (&vo->cache_mutex);
+}
 
 
 static int
@@ -697,7 +1260,8 @@ SCE_VOctree_CopyFromNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
 {
     SCE_SLongRect3 src_region, dst_region;
 
-    if (SCE_VOctree_CacheNode (vo, node) < 0) {
+    /* background eviction may run concurrently */
+    if (SCE_VOctree_PinNode (vo, node) < 0) {
         SCEE_LogSrc ();
         return SCE_ERROR;
     }
@@ -707,6 +1271,7 @@ SCE_VOctree_CopyFromNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
     SCE_Rectangle3_SubOriginl (&dst_region, area);
     SCE_Rectangle3_SubOriginl (&src_region, node_rect);
     SCE_VGrid_Copy (&dst_region, grid, &src_region, &node->grid);
+    SCE_VOctree_UnpinNode (vo, node);
 
     return SCE_OK;
 }
@@ -817,6 +1382,8 @@ SCE_VOctree_CopyToNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
     src_region = dst_region;
     SCE_Rectangle3_SubOriginl (&src_region, area);
     SCE_Rectangle3_SubOriginl (&dst_region, node_rect);
+    /* the min/max summary is read under this mutex */
+    pthread_mutex_lock (&vo->cache_mutex);
     if (vo->usage == SCE_VOCTREE_DENSITY_FIELD) {
         diff = SCE_VGrid_CopyStats (&dst_region, &node->grid, &src_region,grid);
         node->in_volume += diff;
@@ -824,6 +1391,7 @@ SCE_VOctree_CopyToNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
         SCE_VGrid_CopyStats2 (&dst_region, &node->grid, &src_region, grid,
                               node->in);
     }
+    pthread_mutex_unlock (&vo->cache_mutex);
 
     node->is_sync = SCE_FALSE;
 
@@ -844,26 +1412,61 @@ SCE_VOctree_FillToNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
 
     SCE_Rectangle3_Intersectionl (node_rect, area, &dst_region);
     SCE_Rectangle3_SubOriginl (&dst_region, node_rect);
+    pthread_mutex_lock (&vo->cache_mutex);
     if (vo->usage == SCE_VOCTREE_DENSITY_FIELD) {
         diff = SCE_VGrid_FillStats (&dst_region, &node->grid, pattern);
         node->in_volume += diff;
     } else {
         SCE_VGrid_FillStats2 (&dst_region, &node->grid, pattern, node->in);
     }
+    pthread_mutex_unlock (&vo->cache_mutex);
 
     node->is_sync = SCE_FALSE;
 
     return SCE_OK;
 }
 
+/* gives a node created by an edit its voxels, filled with \p pattern, and
+   their min/max summary */
+static int
+SCE_VOctree_MakeNodeGrid (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
+                          const SCE_SLongRect3 *node_rect,
+                          const SCEubyte *pattern)
+{
+    int r;
+
+    SCE_VOctree_SetNodeGrid (node, SCE_Rectangle3_GetWidthl (node_rect),
+                             SCE_Rectangle3_GetHeightl (node_rect),
+                             SCE_Rectangle3_GetDepthl (node_rect), 1);
+    if (SCE_VOctree_CacheNode (vo, node) < 0)
+        goto fail;
+    pthread_mutex_lock (&vo->cache_mutex);
+    if ((r = SCE_VGrid_AllocBricks (&node->grid)) == SCE_OK)
+        SCE_VGrid_Fill (&node->grid, NULL, pattern);
+    pthread_mutex_unlock (&vo->cache_mutex);
+    if (r < 0)
+        goto fail;
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
 static void
 SCE_VOctree_EraseNode (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node)
 {
     SCE_VOctree_UncacheNode (vo, node);
     SCE_VGrid_Clear (&node->grid);
     SCE_VGrid_Init (&node->grid);
-    SCE_File_Close (&node->file);
-    remove (node->fname);
+    if (vo->pack) {
+        SCE_VPack_Remove (vo->pack, node->key[0], node->key[1], node->key[2],
+                          node->key[3]);
+    } else {
+        SCE_VOctree_LockFiles (vo);
+        SCE_File_Close (&node->file);
+        remove (node->fname);
+        SCE_VOctree_UnlockFiles (vo);
+    }
     node->is_open = SCE_FALSE;
     node->is_sync = SCE_FALSE;
     node->cached = SCE_FALSE;   /* redundant */
@@ -913,9 +1516,10 @@ SCE_VOctree_Set (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
 
     clevel = level + depth;
     local_rect = *node_rect;
+    SCE_Rectangle3_Pow2l (&local_rect, -depth);
+    /* origin in the node's level space */
     SCE_Rectangle3_GetOriginlv (&local_rect, &x, &y, &z);
     SCE_VOctree_SetNodeOrigin (node, x, y, z);
-    SCE_Rectangle3_Pow2l (&local_rect, -depth);
 
     switch (node->status) {
     case SCE_VOCTREE_NODE_EMPTY:
@@ -928,15 +1532,10 @@ SCE_VOctree_Set (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
             break;
 
         /* create this node */
-        SCE_VOctree_MakeNodeFilename (vo, &local_rect, clevel, node->fname);
+        SCE_VOctree_MakeNodeFilename (vo, &local_rect, clevel, node);
         node->level = clevel;
-        SCE_VOctree_SetNodeGrid (node,
-                                 SCE_Rectangle3_GetWidthl (&local_rect),
-                                 SCE_Rectangle3_GetHeightl (&local_rect),
-                                 SCE_Rectangle3_GetDepthl (&local_rect), 1);
-        if (SCE_VOctree_CacheNode (vo, node) < 0)
+        if (SCE_VOctree_MakeNodeGrid (vo, node, &local_rect, empty_pattern) < 0)
             goto fail;
-        SCE_VGrid_Fill (&node->grid, NULL, empty_pattern);
 
         if (depth == 0) {
             /* simple copy */
@@ -975,15 +1574,10 @@ SCE_VOctree_Set (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
             break;
 
         /* create this node */
-        SCE_VOctree_MakeNodeFilename (vo, &local_rect, clevel, node->fname);
+        SCE_VOctree_MakeNodeFilename (vo, &local_rect, clevel, node);
         node->level = clevel;
-        SCE_VOctree_SetNodeGrid (node,
-                                 SCE_Rectangle3_GetWidthl (&local_rect),
-                                 SCE_Rectangle3_GetHeightl (&local_rect),
-                                 SCE_Rectangle3_GetDepthl (&local_rect), 1);
-        if (SCE_VOctree_CacheNode (vo, node) < 0)
+        if (SCE_VOctree_MakeNodeGrid (vo, node, &local_rect, full_pattern) < 0)
             goto fail;
-        SCE_VGrid_Fill (&node->grid, NULL, full_pattern);
 
         if (depth == 0) {
             /* simple copy */
@@ -1116,6 +1710,88 @@ int SCE_VOctree_SetRegion (SCE_SVoxelOctree *vo, SCEuint level,
                             area, &grid);
 }
 
+/**
+ * \brief Copies the voxels of a leaf node
+ * \param vo a voxel octree
+ * \param node a node of \p vo of status SCE_VOCTREE_NODE_LEAF, see
+ * SCE_VOctree_FindNode()
+ * \param data written with the voxels of \p node, same layout as the grid
+ * of \p node
+ *
+ * Unlike SCE_VOctree_GetRegion(), the tree is not walked from its root.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VOctree_SetNodeVoxels()
+ */
+int SCE_VOctree_GetNodeVoxels (SCE_SVoxelOctree *vo,
+                               SCE_SVoxelOctreeNode *node, SCEubyte *data)
+{
+    if (SCE_VOctree_PinNode (vo, node) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    memcpy (data, SCE_VGrid_GetRaw (&node->grid),
+            SCE_VGrid_GetSize (&node->grid));
+    SCE_VOctree_UnpinNode (vo, node);
+    return SCE_OK;
+}
+/**
+ * \brief Writes a region of the voxels of a leaf node
+ * \param vo a voxel octree
+ * \param node a node of \p vo of status SCE_VOCTREE_NODE_LEAF
+ * \param region modified region, relative to the origin of \p node
+ * \param data voxels of the whole node, only \p region is read
+ *
+ * The statistics and the min/max summary of \p node are updated, \p node
+ * becomes empty or full if all its voxels are. Its parent is not merged
+ * though, unlike with SCE_VOctree_SetRegion().
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VOctree_GetNodeVoxels()
+ */
+int SCE_VOctree_SetNodeVoxels (SCE_SVoxelOctree *vo,
+                               SCE_SVoxelOctreeNode *node,
+                               const SCE_SLongRect3 *region,
+                               const SCEubyte *data)
+{
+    SCE_SLongRect3 local, node_rect;
+    SCE_SVoxelGrid grid;
+
+    if (SCE_VOctree_CacheNode (vo, node) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+
+    SCE_VGrid_Init (&grid);
+    grid.w = node->grid.w;
+    grid.h = node->grid.h;
+    grid.d = node->grid.d;
+    grid.data = (SCEubyte*)data;
+    grid.n_cmp = node->grid.n_cmp;
+    SCE_Rectangle3_Setl (&node_rect, 0, 0, 0, grid.w, grid.h, grid.d);
+    if (!SCE_Rectangle3_Intersectionl (&node_rect, region, &local))
+        return SCE_OK;
+
+    /* the min/max summary is read under this mutex */
+    pthread_mutex_lock (&vo->cache_mutex);
+    if (vo->usage == SCE_VOCTREE_DENSITY_FIELD)
+        node->in_volume += SCE_VGrid_CopyStats (&local, &node->grid, &local,
+                                                &grid);
+    else
+        SCE_VGrid_CopyStats2 (&local, &node->grid, &local, &grid, node->in);
+    pthread_mutex_unlock (&vo->cache_mutex);
+
+    node->is_sync = SCE_FALSE;
+
+    if (SCE_isempty (vo, node)) {
+        SCE_VOctree_EraseNode (vo, node);
+        node->status = SCE_VOCTREE_NODE_EMPTY;
+    } else if (SCE_isfull (vo, node)) {
+        SCE_VOctree_EraseNode (vo, node);
+        node->status = SCE_VOCTREE_NODE_FULL;
+    }
+
+    return SCE_OK;
+}
+
 static int
 SCE_VOctree_Fill (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
                   const SCE_SLongRect3 *node_rect, SCEuint level, SCEuint depth,
@@ -1136,9 +1812,10 @@ SCE_VOctree_Fill (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
 
     clevel = level + depth;
     local_rect = *node_rect;
+    SCE_Rectangle3_Pow2l (&local_rect, -depth);
+    /* origin in the node's level space */
     SCE_Rectangle3_GetOriginlv (&local_rect, &x, &y, &z);
     SCE_VOctree_SetNodeOrigin (node, x, y, z);
-    SCE_Rectangle3_Pow2l (&local_rect, -depth);
 
     switch (node->status) {
     case SCE_VOCTREE_NODE_EMPTY:
@@ -1157,15 +1834,10 @@ SCE_VOctree_Fill (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
         SCE_Rectangle3_SubOriginl (&region, area);
 
         /* create this node */
-        SCE_VOctree_MakeNodeFilename (vo, &local_rect, clevel, node->fname);
+        SCE_VOctree_MakeNodeFilename (vo, &local_rect, clevel, node);
         node->level = clevel;
-        SCE_VOctree_SetNodeGrid (node,
-                                 SCE_Rectangle3_GetWidthl (&local_rect),
-                                 SCE_Rectangle3_GetHeightl (&local_rect),
-                                 SCE_Rectangle3_GetDepthl (&local_rect), 1);
-        if (SCE_VOctree_CacheNode (vo, node) < 0)
+        if (SCE_VOctree_MakeNodeGrid (vo, node, &local_rect, empty_pattern) < 0)
             goto fail;
-        SCE_VGrid_Fill (&node->grid, NULL, empty_pattern);
 
         if (depth == 0) {
             /* simple copy */
@@ -1418,6 +2090,92 @@ SCE_VOctree_FetchNode (SCE_SVoxelOctree *vo, SCEuint level,
     return data;
 }
 
+/* merges the status of the nodes of level depth overlapping area into
+   *status, -1 if no node has been seen yet, returns SCE_TRUE once the
+   region is known to be mixed */
+static int
+SCE_VOctree_RegionStatus (SCE_SVoxelOctree *vo, SCE_SVoxelOctreeNode *node,
+                          const SCE_SLongRect3 *node_rect, SCEuint depth,
+                          const SCE_SLongRect3 *area, int *status)
+{
+    SCE_SLongRect3 inter;
+    int ns = SCE_VOCTREE_NODE_LEAF;
+
+    if (!SCE_Rectangle3_Intersectionl (node_rect, area, &inter))
+        return SCE_FALSE;
+
+    switch (node->status) {
+    case SCE_VOCTREE_NODE_EMPTY:
+    case SCE_VOCTREE_NODE_FULL:
+        /* holds for every level under it as well */
+        ns = node->status;
+        break;
+    case SCE_VOCTREE_NODE_LEAF:
+        if (depth > 0)
+            ns = SCE_VOCTREE_NODE_LEAF;
+        else
+            ns = SCE_VOctree_GetNodeRegionStatus (vo, node, area);
+        break;
+    case SCE_VOCTREE_NODE_NODE:
+        if (depth == 0)
+            ns = SCE_VOctree_GetNodeRegionStatus (vo, node, area);
+        else {
+            /* recurse */
+            size_t i;
+            SCE_SLongRect3 r;
+            for (i = 0; i < 8; i++) {
+                SCE_VOctree_ConstructRect (node_rect, i, &r);
+                if (SCE_VOctree_RegionStatus (vo, node->children[i], &r,
+                                              depth - 1, area, status))
+                    return SCE_TRUE;
+            }
+            return SCE_FALSE;
+        }
+        break;
+    }
+
+    if (ns == SCE_VOCTREE_NODE_LEAF || ns == SCE_VOCTREE_NODE_NODE ||
+        (*status != -1 && *status != ns)) {
+        *status = SCE_VOCTREE_NODE_LEAF;
+        return SCE_TRUE;
+    }
+    *status = ns;
+    return SCE_FALSE;
+}
+/**
+ * \brief Gets the status of a region of a level
+ * \param vo a voxel octree
+ * \param level a level
+ * \param area a region in \p level space
+ * \param status SCE_VOCTREE_NODE_EMPTY or SCE_VOCTREE_NODE_FULL if the part
+ * of \p area inside \p vo is known to be empty or full,
+ * SCE_VOCTREE_NODE_LEAF otherwise
+ *
+ * Unlike SCE_VOctree_FetchNodes(), the nodes are not listed, hence several
+ * threads holding the read lock of the tree may call this function at once.
+ * See SCE_VOctree_GetNodeRegionStatus() for the nodes holding voxels.
+ * \return SCE_FALSE if \p area is outside of \p vo, SCE_TRUE otherwise
+ */
+int SCE_VOctree_GetRegionStatus (SCE_SVoxelOctree *vo, SCEuint level,
+                                 const SCE_SLongRect3 *area,
+                                 SCE_EVoxelOctreeStatus *status)
+{
+    SCEuint depth;
+    SCE_SLongRect3 node_rect;
+    int s = -1;
+
+    depth = vo->max_depth - level;
+    SCE_Rectangle3_SetFromOriginl (&node_rect, vo->x, vo->y, vo->z,
+                                   vo->w, vo->h, vo->d);
+    SCE_Rectangle3_Pow2l (&node_rect, depth);
+
+    SCE_VOctree_RegionStatus (vo, &vo->root, &node_rect, depth, area, &s);
+    if (s == -1)
+        return SCE_FALSE;
+    *status = s;
+    return SCE_TRUE;
+}
+
 int SCE_VOctree_FetchAllNodes (SCE_SVoxelOctree *vo, SCEuint level,
                                SCE_SList *list)
 {
@@ -1435,50 +2193,240 @@ int SCE_VOctree_FetchAllNodes (SCE_SVoxelOctree *vo, SCEuint level,
 }
 
 
+/**
+ * \brief Finds the node of a given level containing a point
+ * \param vo a voxel octree
+ * \param level level of the node
+ * \param x,y,z coordinates of a point, in \p level space
+ *
+ * Unlike SCE_VOctree_FetchNode(), this function does not modify the nodes,
+ * thus it can be called by several threads holding a read lock on \p vo.
+ * \return the node, NULL if \p vo has no node of \p level there
+ * \sa SCE_VOctree_FetchNode()
+ */
+SCE_SVoxelOctreeNode*
+SCE_VOctree_FindNode (SCE_SVoxelOctree *vo, SCEuint level,
+                      long x, long y, long z)
+{
+    SCEuint depth;
+    SCE_SLongRect3 node_rect;
+    SCE_SVoxelOctreeNode *node = &vo->root;
+    long p1[3], p2[3];
+
+    if (level > vo->max_depth)
+        return NULL;
+
+    depth = vo->max_depth - level;
+    SCE_Rectangle3_SetFromOriginl (&node_rect, vo->x, vo->y, vo->z,
+                                   vo->w, vo->h, vo->d);
+    SCE_Rectangle3_Pow2l (&node_rect, depth);
+    SCE_Rectangle3_GetPointslv (&node_rect, p1, p2);
+    if (x < p1[0] || y < p1[1] || z < p1[2] ||
+        x >= p2[0] || y >= p2[1] || z >= p2[2])
+        return NULL;
+
+    while (depth > 0) {
+        SCEuint id = 0;
+        SCE_SLongRect3 r;
+
+        if (node->status != SCE_VOCTREE_NODE_NODE)
+            return NULL;
+
+        SCE_Rectangle3_GetPointslv (&node_rect, p1, p2);
+        if (x >= (p1[0] + p2[0]) / 2) id |= 1;
+        if (y >= (p1[1] + p2[1]) / 2) id |= 2;
+        if (z >= (p1[2] + p2[2]) / 2) id |= 4;
+        SCE_VOctree_ConstructRect (&node_rect, id, &r);
+        node_rect = r;
+        node = node->children[id];
+        depth--;
+    }
+
+    return node;
+}
+
+
 size_t SCE_VOctree_GetNodeCompressedSize (SCE_SVoxelOctreeNode *node)
 
 {
+    if (node->vo && node->vo->pack) {
+        size_t size = 0;
+        SCE_VPack_Lock (node->vo->pack);
+        SCE_VPack_Get (node->vo->pack, node->key[0], node->key[1],
+                       node->key[2], node->key[3], &size);
+        SCE_VPack_Unlock (node->vo->pack);
+        return size;
+    }
     return SCE_File_Length (&node->file);
 }
+/**
+ * \brief Gets the compressed data of a node
+ * \param node a node
+ *
+ * When the octree of \p node uses a pack, the returned pointer points into
+ * the pack mapping. The pack is locked during the lookup only, keep it
+ * locked with SCE_VPack_Lock() while reading the data if other threads may
+ * synchronize or compact it.
+ * \sa SCE_VOctree_SetPack(), SCE_VPack_Get()
+ */
 void* SCE_VOctree_GetNodeCompressedData (SCE_SVoxelOctreeNode *node)
 {
+    if (node->vo && node->vo->pack) {
+        const void *data = NULL;
+        size_t size;
+        SCE_VPack_Lock (node->vo->pack);
+        data = SCE_VPack_Get (node->vo->pack, node->key[0], node->key[1],
+                              node->key[2], node->key[3], &size);
+        SCE_VPack_Unlock (node->vo->pack);
+        return (void*)data;
+    }
     return SCE_FileCache_GetRaw (&node->file);
 }
 
 
+/* least recently used node that nobody is reading, cache_mutex must be
+   locked */
+static SCE_SVoxelOctreeNode* SCE_VOctree_GetLRUNode (SCE_SVoxelOctree *vo)
+{
+    SCE_SListIterator *it = NULL;
+    SCE_List_ForEach (it, &vo->cached) {
+        SCE_SVoxelOctreeNode *node = SCE_List_GetData (it);
+        if (node->pinned <= 0)
+            return node;
+    }
+    return NULL;
+}
+
+/**
+ * \brief Evicts least recently used nodes until the cache fits its budget
+ * \param vo a voxel octree
+ *
+ * Evicted nodes are synchronized with their file before their grid is
+ * released. The cache is not locked during compression, so that other
+ * threads can keep reading cached nodes. Nodes being copied by
+ * SCE_VOctree_GetRegion() are pinned and never evicted.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VOctree_SetMaxCachedSize(), SCE_VOctree_CacheNode()
+ */
 int SCE_VOctree_UpdateCache (SCE_SVoxelOctree *vo)
 {
-    while (vo->n_cached > vo->max_cached) {
+    size_t budget = SCE_VOctree_GetMaxCachedSize (vo);
+
+    pthread_mutex_lock (&vo->sync_mutex);
+    for (;;) {
         SCE_SVoxelOctreeNode *node = NULL;
-        node = SCE_List_GetData (SCE_List_GetFirst (&vo->cached));
-        if (SCE_VOctree_SyncNode (vo, node) < 0) {
+
+        pthread_mutex_lock (&vo->cache_mutex);
+        if (vo->cached_size > budget && vo->n_cached > 0)
+            node = SCE_VOctree_GetLRUNode (vo);
+        pthread_mutex_unlock (&vo->cache_mutex);
+        if (!node)
+            break;
+
+        if (SCE_VOctree_Sync (vo, node) < 0) {
+            pthread_mutex_unlock (&vo->sync_mutex);
             SCEE_LogSrc ();
             return SCE_ERROR;
         }
-        SCE_VOctree_UncacheNode (vo, node);
+
+        pthread_mutex_lock (&vo->cache_mutex);
+        /* dont evict the node if it has been used in the meantime */
+        if (node->cached && SCE_VOctree_GetLRUNode (vo) == node) {
+            SCE_VOctree_Uncache (vo, node);
+            vo->cache_evictions++;
+        }
+        pthread_mutex_unlock (&vo->cache_mutex);
     }
+    pthread_mutex_unlock (&vo->sync_mutex);
     return SCE_OK;
 }
 
+/**
+ * \brief Writes every modified cached node into its file
+ * \param vo a voxel octree
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VOctree_SyncNode()
+ */
 int SCE_VOctree_SyncCache (SCE_SVoxelOctree *vo)
 {
     SCE_SListIterator *it = NULL;
+    SCE_SVoxelOctreeNode **nodes = NULL;
+    size_t i, n = 0;
 
+    pthread_mutex_lock (&vo->sync_mutex);
+
+    /* gather the modified nodes, the cache is not locked during their
+       compression */
+    pthread_mutex_lock (&vo->cache_mutex);
+    if (vo->n_cached > 0 &&
+        !(nodes = SCE_malloc (vo->n_cached * sizeof *nodes))) {
+        pthread_mutex_unlock (&vo->cache_mutex);
+        goto fail;
+    }
     SCE_List_ForEach (it, &vo->cached) {
-        SCE_SVoxelOctreeNode *node = NULL;
-        node = SCE_List_GetData (it);
-        if (SCE_VOctree_SyncNode (vo, node) < 0)
+        SCE_SVoxelOctreeNode *node = SCE_List_GetData (it);
+        if (!node->is_sync)
+            nodes[n++] = node;
+    }
+    pthread_mutex_unlock (&vo->cache_mutex);
+
+    for (i = 0; i < n; i++) {
+        if (SCE_VOctree_Sync (vo, nodes[i]) < 0)
             goto fail;
     }
+    SCE_free (nodes);
+    nodes = NULL;
+
+    if (vo->pack) {
+        if (SCE_VPack_Sync (vo->pack) < 0)
+            goto fail;
+        pthread_mutex_unlock (&vo->sync_mutex);
+        return SCE_OK;
+    }
 
     /* files have potentially been open */
     /* NOTE: maybe this operation should be performed in the loop above */
+    SCE_VOctree_LockFiles (vo);
     SCE_FileCache_Update (vo->fcache);
-    if (SCE_FileCache_Sync (vo->fcache) < 0)
+    if (SCE_FileCache_Sync (vo->fcache) < 0) {
+        SCE_VOctree_UnlockFiles (vo);
         goto fail;
+    }
+    SCE_VOctree_UnlockFiles (vo);
 
+    pthread_mutex_unlock (&vo->sync_mutex);
     return SCE_OK;
 fail:
+    SCE_free (nodes);
+    pthread_mutex_unlock (&vo->sync_mutex);
     SCEE_LogSrc ();
     return SCE_ERROR;
 }
+
+/**
+ * \brief Gets the statistics of the node cache of an octree
+ * \param vo a voxel octree
+ * \param stats filled with the current statistics of \p vo
+ * \sa SCE_VOctree_ResetCacheStats(), SCE_VWorld_GetCacheStats()
+ */
+void SCE_VOctree_GetCacheStats (SCE_SVoxelOctree *vo,
+                                SCE_SVoxelOctreeCacheStats *stats)
+{
+    pthread_mutex_lock (&vo->cache_mutex);
+    stats->n_nodes = vo->n_cached;
+    stats->size = vo->cached_size;
+    stats->hits = vo->cache_hits;
+    stats->misses = vo->cache_misses;
+    stats->evictions = vo->cache_evictions;
+    pthread_mutex_unlock (&vo->cache_mutex);
+}
+/**
+ * \brief Resets the hit, miss and eviction counters of an octree
+ * \param vo a voxel octree
+ */
+void SCE_VOctree_ResetCacheStats (SCE_SVoxelOctree *vo)
+{
+    pthread_mutex_lock (&vo->cache_mutex);
+    vo->cache_hits = vo->cache_misses = vo->cache_evictions = 0;
+    pthread_mutex_unlock (&vo->cache_mutex);
+}
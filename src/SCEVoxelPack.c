@@ -0,0 +1,733 @@
+/*------------------------------------------------------------------------------
+    SCEngine - A 3D real time rendering engine written in the C language
+    Copyright (C) 2006-2013  Antony Martin <martin(dot)antony(at)yahoo(dot)fr>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ -----------------------------------------------------------------------------*/
+
+/* created: 17/10/2026
+   updated: 17/10/2026 */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#define SCE_VPACK_USE_MMAP
+#endif
+#include <SCE/utils/SCEUtils.h>
+
+#include "SCE/core/SCEVoxelPack.h"
+
+/* file format, every number is stored on 8 bytes, little endian:
+
+   header:  magic, version, offset of the index, number of entries
+   blobs:   data of the entries, in any order, possibly with holes
+   index:   level, x, y, z, offset and size of each entry
+
+   Synchronization appends the modified blobs and a new index after the
+   previous index, then rewrites the header: if it is interrupted the
+   previous header still describes a valid archive. */
+
+#define SCE_VPACK_MAGIC "SCEVPACK"
+#define SCE_VPACK_VERSION 1
+#define SCE_VPACK_NUMBER_SIZE 8
+#define SCE_VPACK_HEADER_SIZE (4 * SCE_VPACK_NUMBER_SIZE)
+#define SCE_VPACK_INDEX_ENTRY_SIZE (6 * SCE_VPACK_NUMBER_SIZE)
+
+#define SCE_VPACK_SLOT_FREE 0
+#define SCE_VPACK_SLOT_USED 1
+#define SCE_VPACK_SLOT_REMOVED 2
+
+#define SCE_VPACK_MIN_SLOTS 64
+
+static void SCE_VPack_PutNumber (SCEulong n, SCEubyte *data)
+{
+    size_t i;
+    for (i = 0; i < SCE_VPACK_NUMBER_SIZE; i++) {
+        data[i] = n & 0xff;
+        n >>= 8;
+    }
+}
+static SCEulong SCE_VPack_GetNumber (const SCEubyte *data)
+{
+    SCEulong n = 0;
+    size_t i;
+    for (i = SCE_VPACK_NUMBER_SIZE; i > 0; i--)
+        n = (n << 8) | data[i - 1];
+    return n;
+}
+
+
+void SCE_VPack_Init (SCE_SVoxelPack *pack)
+{
+    pthread_rwlock_init (&pack->rwlock, NULL);
+    memset (pack->fname, 0, sizeof pack->fname);
+    pack->fp = NULL;
+    pack->map = NULL;
+    pack->map_size = 0;
+    pack->mapped = SCE_FALSE;
+    pack->file_size = 0;
+    pack->index_size = 0;
+    pack->entries = NULL;
+    pack->n_slots = 0;
+    pack->n_used = 0;
+    pack->n_entries = 0;
+    pack->wasted = 0;
+    pack->dirty = SCE_FALSE;
+}
+void SCE_VPack_Clear (SCE_SVoxelPack *pack)
+{
+    SCE_VPack_Close (pack);
+    pthread_rwlock_destroy (&pack->rwlock);
+}
+SCE_SVoxelPack* SCE_VPack_Create (void)
+{
+    SCE_SVoxelPack *pack = NULL;
+    if (!(pack = SCE_malloc (sizeof *pack)))
+        SCEE_LogSrc ();
+    else
+        SCE_VPack_Init (pack);
+    return pack;
+}
+void SCE_VPack_Delete (SCE_SVoxelPack *pack)
+{
+    if (pack) {
+        SCE_VPack_Clear (pack);
+        SCE_free (pack);
+    }
+}
+
+
+static size_t SCE_VPack_Hash (long level, long x, long y, long z)
+{
+    SCEulong h = (SCEulong)level * 2654435761UL;
+    h ^= (SCEulong)x * 73856093UL;
+    h ^= (SCEulong)y * 19349663UL;
+    h ^= (SCEulong)z * 83492791UL;
+    return h ^ (h >> 15);
+}
+
+/* returns the slot of the given key, or the slot where it should be inserted
+   if it is not in the table and \p insert is true, NULL otherwise */
+static SCE_SVoxelPackEntry*
+SCE_VPack_Find (SCE_SVoxelPack *pack, long level, long x, long y, long z,
+                int insert)
+{
+    SCE_SVoxelPackEntry *removed = NULL;
+    size_t i, n, mask;
+
+    if (pack->n_slots == 0)
+        return NULL;
+
+    mask = pack->n_slots - 1;
+    i = SCE_VPack_Hash (level, x, y, z) & mask;
+    for (n = 0; n < pack->n_slots; n++, i = (i + 1) & mask) {
+        SCE_SVoxelPackEntry *e = &pack->entries[i];
+        switch (e->used) {
+        case SCE_VPACK_SLOT_FREE:
+            if (!insert)
+                return NULL;
+            return removed ? removed : e;
+        case SCE_VPACK_SLOT_REMOVED:
+            if (!removed)
+                removed = e;
+            break;
+        case SCE_VPACK_SLOT_USED:
+            if (e->level == level && e->x == x && e->y == y && e->z == z)
+                return e;
+        }
+    }
+    return insert ? removed : NULL;
+}
+
+static int SCE_VPack_Grow (SCE_SVoxelPack *pack)
+{
+    SCE_SVoxelPackEntry *entries = pack->entries;
+    size_t i, n_slots = pack->n_slots;
+
+    /* also cleans up the removed slots */
+    pack->n_slots = SCE_VPACK_MIN_SLOTS;
+    while (pack->n_slots < 4 * (pack->n_entries + 1))
+        pack->n_slots *= 2;
+    if (!(pack->entries = SCE_malloc (pack->n_slots * sizeof *entries))) {
+        pack->entries = entries;
+        pack->n_slots = n_slots;
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    for (i = 0; i < pack->n_slots; i++)
+        pack->entries[i].used = SCE_VPACK_SLOT_FREE;
+
+    for (i = 0; i < n_slots; i++) {
+        SCE_SVoxelPackEntry *e = &entries[i];
+        if (e->used == SCE_VPACK_SLOT_USED)
+            *SCE_VPack_Find (pack, e->level, e->x, e->y, e->z, SCE_TRUE) = *e;
+    }
+    pack->n_used = pack->n_entries;
+    SCE_free (entries);
+
+    return SCE_OK;
+}
+
+/* returns the entry of the given key, inserting it if needed */
+static SCE_SVoxelPackEntry*
+SCE_VPack_Insert (SCE_SVoxelPack *pack, long level, long x, long y, long z)
+{
+    SCE_SVoxelPackEntry *e = NULL;
+
+    if (4 * (pack->n_used + 1) > 3 * pack->n_slots) {
+        if (SCE_VPack_Grow (pack) < 0) {
+            SCEE_LogSrc ();
+            return NULL;
+        }
+    }
+
+    e = SCE_VPack_Find (pack, level, x, y, z, SCE_TRUE);
+    if (e->used != SCE_VPACK_SLOT_USED) {
+        if (e->used == SCE_VPACK_SLOT_FREE)
+            pack->n_used++;
+        e->used = SCE_VPACK_SLOT_USED;
+        e->level = level;
+        e->x = x;
+        e->y = y;
+        e->z = z;
+        e->offset = 0;
+        e->size = 0;
+        e->data = NULL;
+        pack->n_entries++;
+    }
+    return e;
+}
+
+
+static void SCE_VPack_Unmap (SCE_SVoxelPack *pack)
+{
+#ifdef SCE_VPACK_USE_MMAP
+    if (pack->mapped && pack->map)
+        munmap (pack->map, pack->map_size);
+#endif
+    if (!pack->mapped)
+        SCE_free (pack->map);
+    pack->map = NULL;
+    pack->map_size = 0;
+    pack->mapped = SCE_FALSE;
+}
+static int SCE_VPack_Map (SCE_SVoxelPack *pack)
+{
+    long size;
+
+    SCE_VPack_Unmap (pack);
+
+    if (fflush (pack->fp) || fseek (pack->fp, 0, SEEK_END) ||
+        (size = ftell (pack->fp)) < 0)
+        goto fail;
+    pack->file_size = size;
+
+#ifdef SCE_VPACK_USE_MMAP
+    pack->map = mmap (NULL, pack->file_size, PROT_READ, MAP_SHARED,
+                      fileno (pack->fp), 0);
+    if (pack->map != MAP_FAILED) {
+        pack->map_size = pack->file_size;
+        pack->mapped = SCE_TRUE;
+        return SCE_OK;
+    }
+    pack->map = NULL;
+#endif
+    /* fallback: read the whole file */
+    if (!(pack->map = SCE_malloc (pack->file_size)))
+        goto fail;
+    pack->map_size = pack->file_size;
+    if (fseek (pack->fp, 0, SEEK_SET) ||
+        fread (pack->map, 1, pack->map_size, pack->fp) != pack->map_size)
+        goto fail;
+
+    return SCE_OK;
+fail:
+    SCEE_Log (SCE_INVALID_OPERATION);
+    SCEE_LogMsg ("failed to map voxel pack %s", pack->fname);
+    return SCE_ERROR;
+}
+
+static int SCE_VPack_ReadIndex (SCE_SVoxelPack *pack)
+{
+    const SCEubyte *data = pack->map;
+    size_t i, n, offset, used = 0;
+
+    if (pack->map_size < SCE_VPACK_HEADER_SIZE ||
+        memcmp (data, SCE_VPACK_MAGIC, SCE_VPACK_NUMBER_SIZE) ||
+        SCE_VPack_GetNumber (&data[8]) != SCE_VPACK_VERSION)
+        goto corrupted;
+    offset = SCE_VPack_GetNumber (&data[16]);
+    n = SCE_VPack_GetNumber (&data[24]);
+    if (offset < SCE_VPACK_HEADER_SIZE || offset > pack->map_size ||
+        n > (pack->map_size - offset) / SCE_VPACK_INDEX_ENTRY_SIZE)
+        goto corrupted;
+
+    data = &data[offset];
+    for (i = 0; i < n; i++) {
+        SCE_SVoxelPackEntry *e = NULL;
+        long level, x, y, z;
+
+        level = SCE_VPack_GetNumber (&data[0]);
+        x = SCE_VPack_GetNumber (&data[8]);
+        y = SCE_VPack_GetNumber (&data[16]);
+        z = SCE_VPack_GetNumber (&data[24]);
+        if (!(e = SCE_VPack_Insert (pack, level, x, y, z)))
+            goto fail;
+        e->offset = SCE_VPack_GetNumber (&data[32]);
+        e->size = SCE_VPack_GetNumber (&data[40]);
+        if (e->offset < SCE_VPACK_HEADER_SIZE || e->offset > offset ||
+            e->size > offset - e->offset)
+            goto corrupted;
+        used += e->size;
+        data = &data[SCE_VPACK_INDEX_ENTRY_SIZE];
+    }
+    pack->index_size = n * SCE_VPACK_INDEX_ENTRY_SIZE;
+    pack->wasted = pack->file_size - SCE_VPACK_HEADER_SIZE - pack->index_size;
+    pack->wasted = used > pack->wasted ? 0 : pack->wasted - used;
+
+    return SCE_OK;
+corrupted:
+    SCEE_Log (SCE_BAD_FORMAT);
+    SCEE_LogMsg ("corrupted voxel pack %s", pack->fname);
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/* writes the index at the current position of \p fp, which is at \p offset,
+   then the header. \p offsets are the offsets of the entries, NULL to use
+   the offsets of the entries */
+static int SCE_VPack_WriteIndex (FILE *fp, SCE_SVoxelPackEntry **entries,
+                                 const size_t *offsets, size_t n,
+                                 size_t offset)
+{
+    SCEubyte data[SCE_VPACK_INDEX_ENTRY_SIZE];
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        SCE_SVoxelPackEntry *e = entries[i];
+        SCE_VPack_PutNumber (e->level, &data[0]);
+        SCE_VPack_PutNumber (e->x, &data[8]);
+        SCE_VPack_PutNumber (e->y, &data[16]);
+        SCE_VPack_PutNumber (e->z, &data[24]);
+        SCE_VPack_PutNumber (offsets ? offsets[i] : e->offset, &data[32]);
+        SCE_VPack_PutNumber (e->size, &data[40]);
+        if (fwrite (data, 1, sizeof data, fp) != sizeof data)
+            return SCE_ERROR;
+    }
+    /* the index must be on disk before the header points to it */
+    if (fflush (fp))
+        return SCE_ERROR;
+
+    memcpy (data, SCE_VPACK_MAGIC, SCE_VPACK_NUMBER_SIZE);
+    SCE_VPack_PutNumber (SCE_VPACK_VERSION, &data[8]);
+    SCE_VPack_PutNumber (offset, &data[16]);
+    SCE_VPack_PutNumber (n, &data[24]);
+    if (fseek (fp, 0, SEEK_SET) ||
+        fwrite (data, 1, SCE_VPACK_HEADER_SIZE, fp) != SCE_VPACK_HEADER_SIZE ||
+        fflush (fp))
+        return SCE_ERROR;
+
+    return SCE_OK;
+}
+
+/* gathers the used entries, wrlock must be held */
+static SCE_SVoxelPackEntry** SCE_VPack_GetEntries (SCE_SVoxelPack *pack)
+{
+    SCE_SVoxelPackEntry **entries = NULL;
+    size_t i, n = 0;
+
+    if (!(entries = SCE_malloc ((pack->n_entries + 1) * sizeof *entries))) {
+        SCEE_LogSrc ();
+        return NULL;
+    }
+    for (i = 0; i < pack->n_slots; i++) {
+        if (pack->entries[i].used == SCE_VPACK_SLOT_USED)
+            entries[n++] = &pack->entries[i];
+    }
+    return entries;
+}
+
+
+/**
+ * \brief Opens a pack file, creates it if it does not exist
+ * \param pack a voxel pack
+ * \param fname file name, shorter than SCE_VPACK_FNAME_LENGTH characters
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VPack_Open (SCE_SVoxelPack *pack, const char *fname)
+{
+    SCE_VPack_Close (pack);
+    /* compaction renames a copy to this name, it must be whole */
+    if (strlen (fname) >= SCE_VPACK_FNAME_LENGTH) {
+        SCEE_Log (SCE_INVALID_ARG);
+        SCEE_LogMsg ("voxel pack file name too long: %s", fname);
+        goto fail;
+    }
+    strcpy (pack->fname, fname);
+
+    if (!(pack->fp = fopen (fname, "r+b"))) {
+        if (!(pack->fp = fopen (fname, "w+b"))) {
+            SCEE_Log (SCE_INVALID_OPERATION);
+            SCEE_LogMsg ("failed to open voxel pack %s", fname);
+            goto fail;
+        }
+        /* empty archive: header and empty index */
+        if (SCE_VPack_WriteIndex (pack->fp, NULL, NULL, 0,
+                                  SCE_VPACK_HEADER_SIZE) < 0) {
+            SCEE_Log (SCE_INVALID_OPERATION);
+            SCEE_LogMsg ("failed to write voxel pack %s", fname);
+            goto fail;
+        }
+    }
+
+    if (SCE_VPack_Map (pack) < 0)
+        goto fail;
+    if (SCE_VPack_ReadIndex (pack) < 0)
+        goto fail;
+
+    return SCE_OK;
+fail:
+    SCE_VPack_Close (pack);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+/**
+ * \brief Closes the file of a pack
+ * \param pack a voxel pack
+ *
+ * Data that have not been synchronized are lost.
+ * \sa SCE_VPack_Sync()
+ */
+void SCE_VPack_Close (SCE_SVoxelPack *pack)
+{
+    size_t i;
+
+    SCE_VPack_Unmap (pack);
+    if (pack->fp)
+        fclose (pack->fp);
+    pack->fp = NULL;
+    for (i = 0; i < pack->n_slots; i++) {
+        if (pack->entries[i].used == SCE_VPACK_SLOT_USED)
+            SCE_free (pack->entries[i].data);
+    }
+    SCE_free (pack->entries);
+    pack->entries = NULL;
+    pack->n_slots = pack->n_used = pack->n_entries = 0;
+    pack->file_size = pack->index_size = pack->wasted = 0;
+    pack->dirty = SCE_FALSE;
+}
+int SCE_VPack_IsOpen (const SCE_SVoxelPack *pack)
+{
+    return pack->fp != NULL;
+}
+
+/**
+ * \brief Locks a pack for reading
+ * \param pack a voxel pack
+ * \sa SCE_VPack_Get()
+ */
+void SCE_VPack_Lock (SCE_SVoxelPack *pack)
+{
+    pthread_rwlock_rdlock (&pack->rwlock);
+}
+void SCE_VPack_Unlock (SCE_SVoxelPack *pack)
+{
+    pthread_rwlock_unlock (&pack->rwlock);
+}
+
+/**
+ * \brief Gets the data of an entry
+ * \param pack a voxel pack
+ * \param level,x,y,z key of the entry
+ * \param size returned size of the data
+ *
+ * The returned pointer points directly into the file mapping, or into the
+ * pending data of the entry. It remains valid while \p pack is locked with
+ * SCE_VPack_Lock(), which must be held during this call if other threads
+ * may modify \p pack.
+ * \return the data, NULL if there is no such entry
+ */
+const SCEubyte* SCE_VPack_Get (SCE_SVoxelPack *pack, long level, long x,
+                               long y, long z, size_t *size)
+{
+    SCE_SVoxelPackEntry *e = NULL;
+
+    *size = 0;
+    if (!(e = SCE_VPack_Find (pack, level, x, y, z, SCE_FALSE)))
+        return NULL;
+    *size = e->size;
+    if (e->data)
+        return e->data;
+    return &pack->map[e->offset];
+}
+/**
+ * \brief Sets the data of an entry
+ * \param pack a voxel pack
+ * \param level,x,y,z key of the entry
+ * \param data the data, allocated with SCE_malloc(), \p pack takes its
+ * ownership even on failure
+ * \param size size of \p data
+ *
+ * The data are written by the next call to SCE_VPack_Sync().
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VPack_Put (SCE_SVoxelPack *pack, long level, long x, long y, long z,
+                   SCEubyte *data, size_t size)
+{
+    SCE_SVoxelPackEntry *e = NULL;
+
+    pthread_rwlock_wrlock (&pack->rwlock);
+    if (!(e = SCE_VPack_Insert (pack, level, x, y, z))) {
+        pthread_rwlock_unlock (&pack->rwlock);
+        SCE_free (data);
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    if (e->data)
+        SCE_free (e->data);
+    else if (e->offset)
+        pack->wasted += e->size;
+    e->data = data;
+    e->size = size;
+    pack->dirty = SCE_TRUE;
+    pthread_rwlock_unlock (&pack->rwlock);
+
+    return SCE_OK;
+}
+/**
+ * \brief Removes an entry
+ * \param pack a voxel pack
+ * \param level,x,y,z key of the entry
+ */
+void SCE_VPack_Remove (SCE_SVoxelPack *pack, long level, long x, long y,
+                       long z)
+{
+    SCE_SVoxelPackEntry *e = NULL;
+
+    pthread_rwlock_wrlock (&pack->rwlock);
+    if ((e = SCE_VPack_Find (pack, level, x, y, z, SCE_FALSE))) {
+        if (e->data)
+            SCE_free (e->data);
+        else
+            pack->wasted += e->size;
+        e->data = NULL;
+        e->used = SCE_VPACK_SLOT_REMOVED;
+        pack->n_entries--;
+        pack->dirty = SCE_TRUE;
+    }
+    pthread_rwlock_unlock (&pack->rwlock);
+}
+
+size_t SCE_VPack_GetNumEntries (SCE_SVoxelPack *pack)
+{
+    size_t n;
+    pthread_rwlock_rdlock (&pack->rwlock);
+    n = pack->n_entries;
+    pthread_rwlock_unlock (&pack->rwlock);
+    return n;
+}
+/**
+ * \brief Gets the size of the file that would be freed by compaction
+ * \param pack a voxel pack
+ * \sa SCE_VPack_Compact()
+ */
+size_t SCE_VPack_GetWastedSize (SCE_SVoxelPack *pack)
+{
+    size_t n;
+    pthread_rwlock_rdlock (&pack->rwlock);
+    n = pack->wasted;
+    pthread_rwlock_unlock (&pack->rwlock);
+    return n;
+}
+
+/**
+ * \brief Writes the modified entries of a pack into its file
+ * \param pack a voxel pack
+ *
+ * Modified entries are appended at the end of the file, their previous data
+ * are left unused until the next compaction.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VPack_Compact()
+ */
+int SCE_VPack_Sync (SCE_SVoxelPack *pack)
+{
+    SCE_SVoxelPackEntry **entries = NULL;
+    size_t i, offset;
+
+    pthread_rwlock_wrlock (&pack->rwlock);
+    if (!pack->dirty) {
+        pthread_rwlock_unlock (&pack->rwlock);
+        return SCE_OK;
+    }
+
+    if (!(entries = SCE_VPack_GetEntries (pack)))
+        goto fail;
+
+    offset = pack->file_size;
+    if (fseek (pack->fp, offset, SEEK_SET))
+        goto fail_io;
+    for (i = 0; i < pack->n_entries; i++) {
+        SCE_SVoxelPackEntry *e = entries[i];
+        if (e->data) {
+            if (fwrite (e->data, 1, e->size, pack->fp) != e->size)
+                goto fail_io;
+            e->offset = offset;
+            offset += e->size;
+        }
+    }
+    if (SCE_VPack_WriteIndex (pack->fp, entries, NULL, pack->n_entries,
+                              offset) < 0)
+        goto fail_io;
+
+    for (i = 0; i < pack->n_entries; i++) {
+        SCE_free (entries[i]->data);
+        entries[i]->data = NULL;
+    }
+    SCE_free (entries);
+    entries = NULL;
+    pack->wasted += pack->index_size;
+    pack->index_size = pack->n_entries * SCE_VPACK_INDEX_ENTRY_SIZE;
+    pack->dirty = SCE_FALSE;
+
+    if (SCE_VPack_Map (pack) < 0) {
+        /* the entries now point past the old mapping */
+        SCE_VPack_Close (pack);
+        goto fail;
+    }
+
+    pthread_rwlock_unlock (&pack->rwlock);
+    return SCE_OK;
+fail_io:
+    SCEE_Log (SCE_INVALID_OPERATION);
+    SCEE_LogMsg ("failed to write voxel pack %s", pack->fname);
+fail:
+    SCE_free (entries);
+    pthread_rwlock_unlock (&pack->rwlock);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+static int SCE_VPack_CompareEntries (const void *a, const void *b)
+{
+    const SCE_SVoxelPackEntry *e1 = *(SCE_SVoxelPackEntry* const*)a;
+    const SCE_SVoxelPackEntry *e2 = *(SCE_SVoxelPackEntry* const*)b;
+
+    if (e1->level != e2->level) return e1->level < e2->level ? -1 : 1;
+    if (e1->z != e2->z) return e1->z < e2->z ? -1 : 1;
+    if (e1->y != e2->y) return e1->y < e2->y ? -1 : 1;
+    if (e1->x != e2->x) return e1->x < e2->x ? -1 : 1;
+    return 0;
+}
+
+/**
+ * \brief Rewrites the file of a pack without its unused data
+ * \param pack a voxel pack
+ *
+ * Modified entries are also written. Entries are sorted by level then
+ * position, so that reading a whole level is a sequential scan of the file.
+ * The new file is written next to the old one, which is only replaced once
+ * the new file is complete. If that fails \p pack keeps using the old file,
+ * if the new file can't be mapped \p pack is closed.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VPack_Compact (SCE_SVoxelPack *pack)
+{
+    SCE_SVoxelPackEntry **entries = NULL;
+    size_t *offsets = NULL;
+    char tmpname[SCE_VPACK_FNAME_LENGTH + 8] = {0};
+    FILE *fp = NULL;
+    size_t i, offset;
+
+    pthread_rwlock_wrlock (&pack->rwlock);
+
+    if (!(entries = SCE_VPack_GetEntries (pack)))
+        goto fail;
+    if (!(offsets = SCE_malloc ((pack->n_entries + 1) * sizeof *offsets)))
+        goto fail;
+    qsort (entries, pack->n_entries, sizeof *entries,
+           SCE_VPack_CompareEntries);
+
+    sprintf (tmpname, "%s.tmp", pack->fname);
+    if (!(fp = fopen (tmpname, "w+b")))
+        goto fail_io;
+
+    offset = SCE_VPACK_HEADER_SIZE;
+    if (fseek (fp, offset, SEEK_SET))
+        goto fail_io;
+    for (i = 0; i < pack->n_entries; i++) {
+        SCE_SVoxelPackEntry *e = entries[i];
+        const SCEubyte *data = e->data ? e->data : &pack->map[e->offset];
+        if (fwrite (data, 1, e->size, fp) != e->size)
+            goto fail_io;
+        offsets[i] = offset;
+        offset += e->size;
+    }
+    if (SCE_VPack_WriteIndex (fp, entries, offsets, pack->n_entries,
+                              offset) < 0 || fflush (fp))
+        goto fail_io;
+
+    /* the old file stays open and mapped until the new one replaced it, so
+       the pack is left untouched if that fails */
+    if (rename (tmpname, pack->fname)) {
+        SCEE_Log (SCE_INVALID_OPERATION);
+        SCEE_LogMsg ("failed to replace voxel pack %s", pack->fname);
+        goto fail;
+    }
+    SCE_VPack_Unmap (pack);
+    fclose (pack->fp);
+    pack->fp = fp;
+    fp = NULL;
+
+    for (i = 0; i < pack->n_entries; i++) {
+        SCE_free (entries[i]->data);
+        entries[i]->data = NULL;
+        entries[i]->offset = offsets[i];
+    }
+    SCE_free (offsets);
+    SCE_free (entries);
+    offsets = NULL;
+    entries = NULL;
+    pack->index_size = pack->n_entries * SCE_VPACK_INDEX_ENTRY_SIZE;
+    pack->wasted = 0;
+    pack->dirty = SCE_FALSE;
+
+    if (SCE_VPack_Map (pack) < 0) {
+        /* the file is complete but can't be read, it has to be reopened */
+        SCE_VPack_Close (pack);
+        goto fail;
+    }
+
+    pthread_rwlock_unlock (&pack->rwlock);
+    return SCE_OK;
+fail_io:
+    SCEE_Log (SCE_INVALID_OPERATION);
+    SCEE_LogMsg ("failed to write voxel pack %s", tmpname);
+fail:
+    if (fp) {
+        fclose (fp);
+        remove (tmpname);
+    }
+    SCE_free (offsets);
+    SCE_free (entries);
+    pthread_rwlock_unlock (&pack->rwlock);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
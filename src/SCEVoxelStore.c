@@ -21,6 +21,7 @@
 
 #include <SCE/utils/SCEUtils.h>
 
+#include "SCE/core/SCEVoxelGrid.h"
 #include "SCE/core/SCEVoxelStore.h"
 
 static void SCE_VStore_InitLevel (SCE_SVoxelStorageLevel *sl)
@@ -439,6 +440,51 @@ static void SCE_VStore_ComputeLOD (SCE_SVoxelStorage *vs, SCEuint level,
     vs->levels[level].data[offset] = value * 256.0;
 }
 
+static int SCE_VStore_ComputeRegionLOD (SCE_SVoxelStorage *vs, SCEuint level,
+                                        const SCE_SIntRect3 *r)
+{
+    SCE_SIntRect3 area;
+    SCE_SVoxelGrid in, out;
+    int p1[3], p2[3], y, z;
+
+    SCE_Rectangle3_GetPointsv (r, p1, p2);
+    SCE_Rectangle3_Set (&area, p1[0] * 2 - 1, p1[1] * 2 - 1, p1[2] * 2 - 1,
+                        p2[0] * 2 + 1, p2[1] * 2 + 1, p2[2] * 2 + 1);
+
+    SCE_VGrid_Init (&in);
+    SCE_VGrid_Init (&out);
+    SCE_VGrid_SetDimensions (&in, SCE_Rectangle3_GetWidth (&area),
+                             SCE_Rectangle3_GetHeight (&area),
+                             SCE_Rectangle3_GetDepth (&area));
+    SCE_VGrid_SetDimensions (&out, SCE_Rectangle3_GetWidth (r),
+                             SCE_Rectangle3_GetHeight (r),
+                             SCE_Rectangle3_GetDepth (r));
+    if (SCE_VGrid_Build (&in) < 0) goto fail;
+    if (SCE_VGrid_Build (&out) < 0) goto fail;
+
+    SCE_VStore_GetRegion (vs, level - 1, &area, in.data);
+    if (SCE_VGrid_ComputeDensityLOD (&in, &out) < 0)
+        goto fail;
+
+    for (z = p1[2]; z < p2[2]; z++) {
+        for (y = p1[1]; y < p2[1]; y++) {
+            size_t offset = getoffset (vs, level, p1[0], y, z);
+            memcpy (&vs->levels[level].data[offset],
+                    SCE_VGrid_Offset (&out, 0, y - p1[1], z - p1[2]),
+                    p2[0] - p1[0]);
+        }
+    }
+
+    SCE_VGrid_Clear (&in);
+    SCE_VGrid_Clear (&out);
+    return SCE_OK;
+fail:
+    SCE_VGrid_Clear (&in);
+    SCE_VGrid_Clear (&out);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
 void SCE_VStore_GenerateLOD (SCE_SVoxelStorage *vs, SCEuint level,
                              const SCE_SIntRect3 *zone, SCE_SIntRect3 *updated)
 {
@@ -455,10 +501,15 @@ void SCE_VStore_GenerateLOD (SCE_SVoxelStorage *vs, SCEuint level,
     }
     SCE_Rectangle3_Setv (&r, p1, p2);
 
-    for (z = p1[2]; z < p2[2]; z++) {
-        for (y = p1[1]; y < p2[1]; y++) {
-            for (x = p1[0]; x < p2[0]; x++) {
-                SCE_VStore_ComputeLOD (vs, level, x, y, z);
+    /* filter the whole region at once, one voxel at a time if we are short
+       of memory */
+    if (vs->data_size != 1 ||
+        SCE_VStore_ComputeRegionLOD (vs, level, &r) < 0) {
+        for (z = p1[2]; z < p2[2]; z++) {
+            for (y = p1[1]; y < p2[1]; y++) {
+                for (x = p1[0]; x < p2[0]; x++) {
+                    SCE_VStore_ComputeLOD (vs, level, x, y, z);
+                }
             }
         }
     }
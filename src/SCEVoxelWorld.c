@@ -75,6 +75,10 @@ static void SCE_VWorld_FreeFunc (void *wt)
 {
     SCE_VWorld_DeleteTree (wt);
 }
+static void SCE_VWorld_FreeZone (void *zone)
+{
+    SCE_free (zone);
+}
 
 void SCE_VWorld_Init (SCE_SVoxelWorld *vw)
 {
@@ -96,26 +100,46 @@ void SCE_VWorld_Init (SCE_SVoxelWorld *vw)
     memset (vw->prefix, 0, sizeof vw->prefix);
     vw->fs = NULL;
     vw->fcache = NULL;
+    pthread_mutex_init (&vw->file_mutex, NULL);
     vw->max_cached_nodes = 16;
-
-    for (i = 0; i < SCE_MAX_VWORLD_UPDATE_ZONES; i++) {
-        SCE_Rectangle3_Initl (&vw->zones[i]);
-        vw->zones_level[i] = 0;
-    }
-    vw->last = vw->first = 0;
+    vw->max_cached_size = 0;
+    vw->codec = SCE_VCodec_Get (SCE_VCODEC_ZLIB);
+    vw->pack = NULL;
+
+    SCE_List_Init (&vw->zones);
+    SCE_List_SetFreeFunc (&vw->zones, SCE_VWorld_FreeZone);
+    vw->n_zones = 0;
+    vw->lost = 0;
+    vw->n_new_zones = 0;
     vw->record_updates = SCE_TRUE;
 
     vw->buffers = NULL;
     vw->n_buffers = 1;
     vw->size1 = vw->size2 = 0;
+
+    SCE_TPool_Init (&vw->workers);
+
+    pthread_mutex_init (&vw->prefetch_mutex, NULL);
+    SCE_List_Init (&vw->prefetched);
+    vw->focus[0] = vw->focus[1] = vw->focus[2] = 0;
+    for (i = 0; i < SCE_MAX_VWORLD_STREAMING_LEVELS; i++)
+        vw->radius[i] = -1;
+    vw->streaming_priority = 0;
 }
 void SCE_VWorld_Clear (SCE_SVoxelWorld *vw)
 {
     size_t i;
+    /* queued jobs reference the trees, let them finish first */
+    SCE_VWorld_WaitJobs (vw);
+    SCE_VWorld_CancelPrefetch (vw);
+    SCE_TPool_Clear (&vw->workers);
+    pthread_mutex_destroy (&vw->prefetch_mutex);
+    pthread_mutex_destroy (&vw->file_mutex);
     pthread_mutex_destroy (&vw->mutex);
     pthread_rwlock_destroy (&vw->rwlock);
     pthread_rwlock_destroy (&vw->rwlock2);
     SCE_List_Clear (&vw->trees);
+    SCE_List_Clear (&vw->zones);
     SCE_Array2D_Clear (&vw->trees_grid);
     if (vw->buffers) {
         for (i = 0; i < vw->n_buffers; i++)
@@ -222,6 +246,41 @@ void SCE_VWorld_SetMaxCachedNodes (SCE_SVoxelWorld *vw, SCEulong max_cached)
 {
     vw->max_cached_nodes = max_cached;
 }
+/**
+ * \brief Must be called before any octree is added to the world
+ * \param vw voxel world
+ * \param size memory budget of the node cache of each tree, in bytes
+ * \sa SCE_VOctree_SetMaxCachedSize()
+ */
+void SCE_VWorld_SetMaxCachedSize (SCE_SVoxelWorld *vw, size_t size)
+{
+    vw->max_cached_size = size;
+}
+/**
+ * \brief Sets the codec used to compress the voxels of the trees
+ * \param vw voxel world
+ * \param codec a codec
+ *
+ * Must be called before any octree is added to the world.
+ * \sa SCE_VOctree_SetCodec()
+ */
+void SCE_VWorld_SetCodec (SCE_SVoxelWorld *vw, const SCE_SVoxelCodec *codec)
+{
+    vw->codec = codec;
+}
+/**
+ * \brief Stores the nodes of every tree in a single pack file
+ * \param vw voxel world
+ * \param pack an open voxel pack, NULL to use one file per node
+ *
+ * Must be called before any octree is added to the world. The octree
+ * structure files of the trees are still saved in their own directories.
+ * \sa SCE_VOctree_SetPack(), SCE_VPack_Compact()
+ */
+void SCE_VWorld_SetPack (SCE_SVoxelWorld *vw, SCE_SVoxelPack *pack)
+{
+    vw->pack = pack;
+}
 /**
  * \brief Buffers used for parallel LOD computation
  * \param vw voxel world
@@ -231,6 +290,20 @@ void SCE_VWorld_SetNumBuffers (SCE_SVoxelWorld *vw, size_t n)
 {
     vw->n_buffers = n;
 }
+/**
+ * \brief Sets the number of threads compressing and decompressing nodes
+ * in the background
+ * \param vw voxel world
+ * \param n number of threads, 0 (the default) runs the queued jobs
+ * immediately in the calling thread
+ *
+ * Must be called before SCE_VWorld_Build().
+ * \sa SCE_VWorld_QueueLoadNode(), SCE_VWorld_QueueUpdateCache()
+ */
+void SCE_VWorld_SetNumWorkers (SCE_SVoxelWorld *vw, size_t n)
+{
+    SCE_TPool_SetNumThreads (&vw->workers, n);
+}
 
 static void
 SCE_VWorld_SetTreePrefix (char *prefix, const SCE_SVoxelWorld *vw,
@@ -273,7 +346,11 @@ SCE_SVoxelWorldTree* SCE_VWorld_NewTree (SCE_SVoxelWorld *vw,
     SCE_VOctree_SetPrefix (&wt->vo, prefix);
     SCE_VOctree_SetFileSystem (&wt->vo, vw->fs);
     SCE_VOctree_SetFileCache (&wt->vo, vw->fcache);
+    SCE_VOctree_SetFileMutex (&wt->vo, &vw->file_mutex);
     SCE_VOctree_SetMaxCachedNodes (&wt->vo, vw->max_cached_nodes);
+    SCE_VOctree_SetMaxCachedSize (&wt->vo, vw->max_cached_size);
+    SCE_VOctree_SetCodec (&wt->vo, vw->codec);
+    SCE_VOctree_SetPack (&wt->vo, vw->pack);
     SCE_VOctree_SetUsage (&wt->vo, vw->usage);
 
     return wt;
@@ -293,7 +370,11 @@ int SCE_VWorld_AddTree (SCE_SVoxelWorld *vw, SCE_SVoxelWorldTree *wt)
 
     SCE_VOctree_SetFileSystem (&wt->vo, vw->fs);
     SCE_VOctree_SetFileCache (&wt->vo, vw->fcache);
+    SCE_VOctree_SetFileMutex (&wt->vo, &vw->file_mutex);
     SCE_VOctree_SetMaxCachedNodes (&wt->vo, vw->max_cached_nodes);
+    SCE_VOctree_SetMaxCachedSize (&wt->vo, vw->max_cached_size);
+    SCE_VOctree_SetCodec (&wt->vo, vw->codec);
+    SCE_VOctree_SetPack (&wt->vo, vw->pack);
 
     SCE_VWorld_GetTreeOriginv (wt, &x, &y, &z);
 
@@ -390,6 +471,9 @@ int SCE_VWorld_Build (SCE_SVoxelWorld *vw)
 {
     size_t i;
 
+    /* one buffer per worker for parallel LOD generation */
+    vw->n_buffers = MAX (vw->n_buffers, SCE_TPool_GetNumThreads (&vw->workers));
+
     if (!(vw->buffers = SCE_malloc (vw->n_buffers * sizeof *vw->buffers)))
         goto fail;
 
@@ -408,6 +492,9 @@ int SCE_VWorld_Build (SCE_SVoxelWorld *vw)
         memset (buf->buffer2, 0, vw->size2);
     }
 
+    if (SCE_TPool_Start (&vw->workers) < 0)
+        goto fail;
+
     return SCE_OK;
 fail:
     SCEE_LogSrc ();
@@ -626,28 +713,195 @@ void SCE_VWorld_TreeRegion (SCE_SVoxelWorld *vw, SCEuint level,
     SCE_Rectangle3_GetPointslv (&r, p1, p2);
 }
 
+/* merges regions sharing voxels or a face, unless the bounding box would
+   mostly cover voxels that were not updated */
+static int SCE_VWorld_CanMergeZones (const SCE_SLongRect3 *a,
+                                     const SCE_SLongRect3 *b)
+{
+    size_t i;
+    long p1[3], p2[3], q1[3], q2[3];
+    SCE_SLongRect3 u;
+
+    SCE_Rectangle3_GetPointslv (a, p1, p2);
+    SCE_Rectangle3_GetPointslv (b, q1, q2);
+    for (i = 0; i < 3; i++) {
+        if (p1[i] > q2[i] || q1[i] > p2[i])
+            return SCE_FALSE;
+    }
+    SCE_Rectangle3_Unionl (a, b, &u);
+    return SCE_Rectangle3_GetAreal (&u) <=
+        2 * (SCE_Rectangle3_GetAreal (a) + SCE_Rectangle3_GetAreal (b));
+}
+
+/* a recorded zone and its place in the queue */
+typedef struct sce_svoxelworldzoneref SCE_SVoxelWorldZoneRef;
+struct sce_svoxelworldzoneref {
+    SCE_SVoxelWorldZone *zone;
+    size_t age;
+    long x1, x2;                /* extent of the zone along x */
+};
+
+static int SCE_VWorld_CompareZones (const void *a, const void *b)
+{
+    const SCE_SVoxelWorldZoneRef *r1 = a, *r2 = b;
+
+    if (r1->zone->level != r2->zone->level)
+        return r1->zone->level < r2->zone->level ? -1 : 1;
+    if (r1->x1 != r2->x1)
+        return r1->x1 < r2->x1 ? -1 : 1;
+    return 0;
+}
+
+/* merges the zones recorded so far. Sorted by level then along x, a zone
+   only has to be compared to the following ones until one starts after it
+   ends. A merged zone keeps the place of the oldest one in the queue.
+   vw->mutex must be locked */
+static void SCE_VWorld_MergeZones (SCE_SVoxelWorld *vw)
+{
+    SCE_SListIterator *it = NULL;
+    SCE_SVoxelWorldZoneRef *refs = NULL;
+    size_t i, j, n = 0;
+    long p1[3], p2[3];
+    int merged;
+
+    vw->n_new_zones = 0;
+    if (vw->n_zones < 2)
+        return;
+    if (!(refs = SCE_malloc (vw->n_zones * sizeof *refs))) {
+        /* the zones are left unmerged, no update is lost */
+        SCEE_LogSrc ();
+        return;
+    }
+    SCE_List_ForEach (it, &vw->zones) {
+        refs[n].zone = SCE_List_GetData (it);
+        refs[n].age = n;
+        SCE_Rectangle3_GetPointslv (&refs[n].zone->zone, p1, p2);
+        refs[n].x1 = p1[0];
+        refs[n].x2 = p2[0];
+        n++;
+    }
+    qsort (refs, n, sizeof *refs, SCE_VWorld_CompareZones);
+
+    /* a merged zone may now touch zones it was already compared to */
+    do {
+        merged = SCE_FALSE;
+        for (i = 0; i < n; i++) {
+            SCE_SVoxelWorldZoneRef *a = &refs[i];
+            if (!a->zone)
+                continue;
+            for (j = i + 1; j < n; j++) {
+                SCE_SVoxelWorldZoneRef *b = &refs[j];
+                SCE_SVoxelWorldZone *tmp = NULL;
+                SCE_SLongRect3 area;
+
+                if (!b->zone)
+                    continue;
+                if (b->zone->level != a->zone->level || b->x1 > a->x2)
+                    break;
+                if (!SCE_VWorld_CanMergeZones (&a->zone->zone, &b->zone->zone))
+                    continue;
+                SCE_Rectangle3_Unionl (&a->zone->zone, &b->zone->zone, &area);
+                if (b->age < a->age) {
+                    tmp = a->zone;
+                    a->zone = b->zone;
+                    b->zone = tmp;
+                    a->age = b->age;
+                }
+                /* b started after a along x, so x1 does not change */
+                a->zone->zone = area;
+                a->x2 = MAX (a->x2, b->x2);
+                SCE_List_Removel (&b->zone->it);
+                SCE_free (b->zone);
+                b->zone = NULL;
+                vw->n_zones--;
+                merged = SCE_TRUE;
+            }
+        }
+    } while (merged);
+
+    SCE_free (refs);
+}
+
+/* zones are appended, then merged in batches once at least as many new
+   zones were recorded as there were zones after the previous merge, which
+   keeps the cost of a push logarithmic. A zone that cannot be allocated is
+   merged into the lost zone of its level, which the consumers return like
+   any other zone */
 static void SCE_VWorld_PushZone (SCE_SVoxelWorld *vw,
                                  const SCE_SLongRect3 *r, int level)
 {
-    /* TODO: this feature _sucks_, we should let the user record its modified
-       regions */
-    /* TODO: make it thread safe */
-    if (vw->record_updates) {
-        vw->zones[vw->last] = *r;
-        vw->zones_level[vw->last] = level;
-        vw->last = SCE_Math_Ring (vw->last + 1, SCE_MAX_VWORLD_UPDATE_ZONES);
+    SCE_SVoxelWorldZone *zone = NULL;
+
+    if (!vw->record_updates)
+        return;
+
+    /* allocated before locking, the fallback below needs no memory */
+    zone = SCE_malloc (sizeof *zone);
+
+    pthread_mutex_lock (&vw->mutex);
+
+    if (zone) {
+        zone->zone = *r;
+        zone->level = level;
+        SCE_List_InitIt (&zone->it);
+        SCE_List_SetData (&zone->it, zone);
+        SCE_List_Appendl (&vw->zones, &zone->it);
+        vw->n_zones++;
+        vw->n_new_zones++;
+        if (vw->n_new_zones >= SCE_VWORLD_ZONE_BATCH &&
+            2 * vw->n_new_zones >= vw->n_zones)
+            SCE_VWorld_MergeZones (vw);
+    } else if (level >= 0 && level < SCE_MAX_VWORLD_LEVELS) {
+        /* never lose an update */
+        if (vw->lost & (1ul << level))
+            SCE_Rectangle3_Unionl (&vw->lost_zones[level], r,
+                                   &vw->lost_zones[level]);
+        else
+            vw->lost_zones[level] = *r;
+        vw->lost |= 1ul << level;
+    } else
+        SCEE_LogSrc ();
+
+    pthread_mutex_unlock (&vw->mutex);
+}
+/* lowest level having a lost zone, -1 if none, vw->mutex must be locked */
+static int SCE_VWorld_GetLostLevel (SCE_SVoxelWorld *vw)
+{
+    int level;
+
+    for (level = 0; level < SCE_MAX_VWORLD_LEVELS; level++) {
+        if (vw->lost & (1ul << level))
+            return level;
     }
+    return -1;
 }
 static int SCE_VWorld_PopZone (SCE_SVoxelWorld *vw, SCE_SLongRect3 *r)
 {
-    if (vw->first == vw->last)
-        return -1;
-    else {
-        int level = vw->zones_level[vw->first];
-        *r = vw->zones[vw->first];
-        vw->first = SCE_Math_Ring (vw->first + 1, SCE_MAX_VWORLD_UPDATE_ZONES);
+    SCE_SVoxelWorldZone *zone = NULL;
+    int level = -1;
+
+    pthread_mutex_lock (&vw->mutex);
+    if ((level = SCE_VWorld_GetLostLevel (vw)) >= 0) {
+        *r = vw->lost_zones[level];
+        vw->lost &= ~(1ul << level);
+        pthread_mutex_unlock (&vw->mutex);
         return level;
     }
+    if (vw->n_new_zones)
+        SCE_VWorld_MergeZones (vw);
+    if (SCE_List_HasElements (&vw->zones)) {
+        zone = SCE_List_GetData (SCE_List_GetFirst (&vw->zones));
+        SCE_List_Removel (&zone->it);
+        vw->n_zones--;
+    }
+    pthread_mutex_unlock (&vw->mutex);
+
+    if (zone) {
+        *r = zone->zone;
+        level = zone->level;
+        SCE_free (zone);
+    }
+    return level;
 }
 
 
@@ -694,8 +948,10 @@ SCE_VWorld_Set (SCE_SVoxelWorld *vw, SCEuint level,
                 pthread_rwlock_wrlock (&wt->rwlock);
                 r = SCE_VOctree_SetRegion (&wt->vo, level, region, data);
                 pthread_rwlock_unlock (&wt->rwlock);
-                if (r < 0)
+                if (r < 0) {
+                    pthread_rwlock_unlock (&vw->rwlock2);
                     goto fail;
+                }
             }
         }
     }
@@ -729,8 +985,10 @@ static int SCE_VWorld_Fill (SCE_SVoxelWorld *vw, SCEuint level,
                 pthread_rwlock_wrlock (&wt->rwlock);
                 r = SCE_VOctree_FillRegion (&wt->vo, level, region, pattern);
                 pthread_rwlock_unlock (&wt->rwlock);
-                if (r < 0)
+                if (r < 0) {
+                    pthread_rwlock_unlock (&vw->rwlock2);
                     goto fail;
+                }
             }
         }
     }
@@ -754,10 +1012,72 @@ void SCE_VWorld_AddUpdatedRegion (SCE_SVoxelWorld *vw, SCEuint level,
 {
     SCE_VWorld_PushZone (vw, zone, level);
 }
+/**
+ * \brief Pops the oldest updated region
+ * \param vw a voxel world
+ * \param zone the region, in the space of its level
+ * \return the level of \p zone, or -1 if there is no updated region left
+ * \sa SCE_VWorld_GetUpdatedRegions()
+ */
 int SCE_VWorld_GetNextUpdatedRegion (SCE_SVoxelWorld *vw, SCE_SLongRect3 *zone)
 {
     return SCE_VWorld_PopZone (vw, zone);
 }
+/**
+ * \brief Pops several updated regions of a given level at once
+ * \param vw a voxel world
+ * \param level level of the regions
+ * \param zones regions, in \p level's space
+ * \param max size of \p zones
+ *
+ * Overlapping and adjacent regions are merged before they are returned, hence
+ * a voxel is usually reported only once between two calls.
+ * \return the number of regions written into \p zones
+ */
+size_t SCE_VWorld_GetUpdatedRegions (SCE_SVoxelWorld *vw, SCEuint level,
+                                     SCE_SLongRect3 *zones, size_t max)
+{
+    SCE_SListIterator *it = NULL, *pro = NULL;
+    size_t n = 0;
+
+    pthread_mutex_lock (&vw->mutex);
+    if (max > 0 && level < SCE_MAX_VWORLD_LEVELS &&
+        (vw->lost & (1ul << level))) {
+        zones[n++] = vw->lost_zones[level];
+        vw->lost &= ~(1ul << level);
+    }
+    if (vw->n_new_zones)
+        SCE_VWorld_MergeZones (vw);
+    SCE_List_ForEachProtected (pro, it, &vw->zones) {
+        SCE_SVoxelWorldZone *zone = SCE_List_GetData (it);
+        if (n >= max)
+            break;
+        if (zone->level != level)
+            continue;
+        zones[n++] = zone->zone;
+        SCE_List_Removel (&zone->it);
+        SCE_free (zone);
+        vw->n_zones--;
+    }
+    pthread_mutex_unlock (&vw->mutex);
+
+    return n;
+}
+size_t SCE_VWorld_GetNumUpdatedRegions (SCE_SVoxelWorld *vw)
+{
+    size_t n;
+    int level;
+    pthread_mutex_lock (&vw->mutex);
+    if (vw->n_new_zones)
+        SCE_VWorld_MergeZones (vw);
+    n = vw->n_zones;
+    for (level = 0; level < SCE_MAX_VWORLD_LEVELS; level++) {
+        if (vw->lost & (1ul << level))
+            n++;
+    }
+    pthread_mutex_unlock (&vw->mutex);
+    return n;
+}
 void SCE_VWorld_EnableUpdateRecording (SCE_SVoxelWorld *vw)
 {
     vw->record_updates = SCE_TRUE;
@@ -784,50 +1104,6 @@ static SCE_SVoxelWorldBuffer* SCE_VWorld_LockBuffer (SCE_SVoxelWorld *vw)
 }
 
 
-static void
-SCE_VWorld_ComputeDensityLODPoint (SCE_SVoxelGrid *in, SCE_SVoxelGrid *out,
-                                   SCEulong x, SCEulong y, SCEulong z)
-{
-    SCEubyte buf[28] = {0};
-    float kernel[28] = {
-        /* slice 0 */
-        1.0/8.0, 1.0/4.0, 1.0/8.0,
-        1.0/4.0, 1.0/2.0, 1.0/4.0,
-        1.0/8.0, 1.0/4.0, 1.0/8.0,
-
-        /* slice 1 */
-        1.0/4.0, 1.0/2.0, 1.0/4.0,
-        1.0/2.0, 1.0/1.0, 1.0/2.0,
-        1.0/4.0, 1.0/2.0, 1.0/4.0,
-
-        /* slice 2 */
-        1.0/8.0, 1.0/4.0, 1.0/8.0,
-        1.0/4.0, 1.0/2.0, 1.0/4.0,
-        1.0/8.0, 1.0/4.0, 1.0/8.0,
-    };
-    float value = 0.0;
-    size_t i, j, k, offset;
-    SCEubyte *ptr = NULL;
-
-    offset = 0;
-    for (k = z - 1; k < z + 2; k++) {
-        for (j = y - 1; j < y + 2; j++) {
-            for (i = x - 1; i < x + 2; i++) {
-                buf[offset] = *SCE_VGrid_Offset (in, i, j, k);
-                offset++;
-            }
-        }
-    }
-
-    for (i = 0; i < 28; i++)
-        value += (kernel[i] * buf[i]) / 256.0;
-
-    value /= 8.0;
-
-    ptr = SCE_VGrid_Offset (out, (x - 1) / 2, (y - 1) / 2, (z - 1) / 2);
-    *ptr = value * 256.0;
-}
-
 static void
 SCE_VWorld_ComputeMaterialLODPoint (SCE_SVoxelGrid *in, SCE_SVoxelGrid *out,
                                     SCEulong x, SCEulong y, SCEulong z)
@@ -854,18 +1130,6 @@ SCE_VWorld_ComputeMaterialLODPoint (SCE_SVoxelGrid *in, SCE_SVoxelGrid *out,
 }
 
 
-static void
-SCE_VWorld_ComputeDensityLOD (SCE_SVoxelGrid *in, SCE_SVoxelGrid *out)
-{
-    SCEulong x, y, z;
-
-    for (z = 1; z < in->d - 1; z += 2) {
-        for (y = 1; y < in->h - 1; y += 2) {
-            for (x = 1; x < in->w - 1; x += 2)
-                SCE_VWorld_ComputeDensityLODPoint (in, out, x, y, z);
-        }
-    }
-}
 static void
 SCE_VWorld_ComputeMaterialLOD (SCE_SVoxelGrid *in, SCE_SVoxelGrid *out)
 {
@@ -879,185 +1143,804 @@ SCE_VWorld_ComputeMaterialLOD (SCE_SVoxelGrid *in, SCE_SVoxelGrid *out)
     }
 }
 
-int SCE_VWorld_GenerateLOD (SCE_SVoxelWorld *vw, SCEuint level,
-                            const SCE_SLongRect3 *zone,
-                            SCE_SLongRect3 *updated)
+/* computes the source (high lod) and destination (low lod) regions */
+static void SCE_VWorld_GetLODRegions (const SCE_SLongRect3 *zone,
+                                      SCE_SLongRect3 *src, SCE_SLongRect3 *dst)
 {
     size_t i;
-    SCE_SLongRect3 src, dst;
-    SCE_EVoxelOctreeStatus status;
     long p1[3], p2[3];
 
-    src = dst = *zone;
-
-    /* compute source (high lod) and destination (low lod) regions */
-    SCE_Rectangle3_GetPointslv (&dst, p1, p2);
+    SCE_Rectangle3_GetPointslv (zone, p1, p2);
     for (i = 0; i < 3; i++) {
         p1[i] = p1[i] / 2;
         p2[i] = (p2[i] + 1) / 2;
     }
-    SCE_Rectangle3_Setlv (&dst, p1, p2);
+    SCE_Rectangle3_Setlv (dst, p1, p2);
     for (i = 0; i < 3; i++) {
         p1[i] = p1[i] * 2 - 1;
         p2[i] = p2[i] * 2 + 1;
     }
-    SCE_Rectangle3_Setlv (&src, p1, p2);
+    SCE_Rectangle3_Setlv (src, p1, p2);
+}
+
+/* src and dst must fit in the buffers of vw */
+static int SCE_VWorld_GenerateLODBlock (SCE_SVoxelWorld *vw, SCEuint level,
+                                        const SCE_SLongRect3 *src,
+                                        const SCE_SLongRect3 *dst)
+{
+    SCE_SVoxelGrid in, out;
+    SCE_SVoxelWorldBuffer *buf = NULL;
 
-    status = SCE_VWorld_GetRegionStatus (vw, level, &src);
-    switch (status) {
+    switch (SCE_VWorld_GetRegionStatus (vw, level, src)) {
     case SCE_VOCTREE_NODE_EMPTY:
-        if (updated)
-            *updated = dst;
         return SCE_OK;
     case SCE_VOCTREE_NODE_FULL:
         /* TODO: might just not work for material voxels but WHATEVER */
         /* TODO: yeah GetRegionsStatus() should return the material. */
-        SCE_VWorld_Fill (vw, level + 1, &dst, 255); /* TODO: full pattern */
-        if (updated)
-            *updated = dst;
+        /* TODO: full pattern */
+        if (SCE_VWorld_Fill (vw, level + 1, dst, 255) < 0)
+            goto fail;
         return SCE_OK;
     default: break;
     }
 
-    /* if one of the region exceed the size in vw's buffers,
-       split LOD generation */
-    /* TODO: doesn't account the number of bytes per voxel */
-    if (SCE_Rectangle3_GetAreal (&src) > vw->size1 ||
-        SCE_Rectangle3_GetAreal (&dst) > vw->size2) {
-        SCE_SLongRect3 up1, up2;
-        SCE_Rectangle3_SplitMaxl (zone, &src, &dst);
-#if 0
-        printf ("split %ld %ld %ld %ld %ld %ld into:\n"
-                "%ld %ld %ld - %ld %ld %ld -- and -- %ld %ld %ld - %ld %ld %ld\n",
-                zone->p1[0], zone->p1[1], zone->p1[2],
-                zone->p2[0], zone->p2[1], zone->p2[2],
-
-                src.p1[0], src.p1[1], src.p1[2],
-                src.p2[0], src.p2[1], src.p2[2],
-
-                dst.p1[0], dst.p1[1], dst.p1[2],
-                dst.p2[0], dst.p2[1], dst.p2[2]);
-#endif
-        /* that will lead to many PushZone() while one whould have suffice */
-        if (SCE_VWorld_GenerateLOD (vw, level, &src, &up1) < 0) goto fail;
-        if (SCE_VWorld_GenerateLOD (vw, level, &dst, &up2) < 0) goto fail;
-        if (updated)
-            SCE_Rectangle3_Unionl (&up1, &up2, updated);
-    } else {
-        SCE_SVoxelGrid in, out;
-        SCE_SVoxelWorldBuffer *buf = NULL;
-
-        SCE_VGrid_Init (&in);
-        SCE_VGrid_Init (&out);
+    SCE_VGrid_Init (&in);
+    SCE_VGrid_Init (&out);
 
-        SCE_VGrid_SetDimensions (&in, SCE_Rectangle3_GetWidthl (&src),
-                                 SCE_Rectangle3_GetHeightl (&src),
-                                 SCE_Rectangle3_GetDepthl (&src));
-        SCE_VGrid_SetDimensions (&out, SCE_Rectangle3_GetWidthl (&dst),
-                                 SCE_Rectangle3_GetHeightl (&dst),
-                                 SCE_Rectangle3_GetDepthl (&dst));
+    SCE_VGrid_SetDimensions (&in, SCE_Rectangle3_GetWidthl (src),
+                             SCE_Rectangle3_GetHeightl (src),
+                             SCE_Rectangle3_GetDepthl (src));
+    SCE_VGrid_SetDimensions (&out, SCE_Rectangle3_GetWidthl (dst),
+                             SCE_Rectangle3_GetHeightl (dst),
+                             SCE_Rectangle3_GetDepthl (dst));
 
-        SCE_VGrid_SetNumComponents (&in, 1);
-        SCE_VGrid_SetNumComponents (&out, 1);
+    SCE_VGrid_SetNumComponents (&in, 1);
+    SCE_VGrid_SetNumComponents (&out, 1);
 
-        buf = SCE_VWorld_LockBuffer (vw);
-        /* TODO: initialize with default "non defined" density value, not 0 */
-        memset (buf->buffer1, 0, vw->size1);
-        memset (buf->buffer2, 0, vw->size2);
-        in.data = buf->buffer1;
-        out.data = buf->buffer2;
+    buf = SCE_VWorld_LockBuffer (vw);
+    /* TODO: initialize with default "non defined" density value, not 0 */
+    memset (buf->buffer1, 0, vw->size1);
+    memset (buf->buffer2, 0, vw->size2);
+    in.data = buf->buffer1;
+    out.data = buf->buffer2;
 
-        /* retrieve source voxels */
-        if (SCE_VWorld_GetRegion (vw, level, &src, in.data) < 0)
-            goto fail;
-        if (vw->usage == SCE_VOCTREE_DENSITY_FIELD)
-            SCE_VWorld_ComputeDensityLOD (&in, &out);
-        else
-            SCE_VWorld_ComputeMaterialLOD (&in, &out);
-        if (SCE_VWorld_Set (vw, level + 1, &dst, out.data) < 0)
+    /* retrieve source voxels */
+    if (SCE_VWorld_GetRegion (vw, level, src, in.data) < 0)
+        goto fail;
+    if (vw->usage == SCE_VOCTREE_DENSITY_FIELD) {
+        if (SCE_VGrid_ComputeDensityLOD (&in, &out) < 0)
             goto fail;
+    } else
+        SCE_VWorld_ComputeMaterialLOD (&in, &out);
+    if (SCE_VWorld_Set (vw, level + 1, dst, out.data) < 0)
+        goto fail;
 
-        pthread_mutex_unlock (&buf->mutex);
-
-        if (updated)
-            *updated = dst;
-    }
+    pthread_mutex_unlock (&buf->mutex);
 
     return SCE_OK;
 fail:
+    if (buf)
+        pthread_mutex_unlock (&buf->mutex);
     SCEE_LogSrc ();
     return SCE_ERROR;
 }
 
-int SCE_VWorld_GenerateAllLOD (SCE_SVoxelWorld *vw, SCEuint level,
-                               const SCE_SLongRect3 *zone)
+
+/* parallel LOD generation: the destination region of each level is split
+   into a grid of blocks fitting the buffers of the world, a block of level
+   N + 1 is queued as soon as the blocks of level N it reads are done */
+
+typedef struct sce_svoxelworldlod SCE_SVoxelWorldLOD;
+
+typedef struct sce_svoxelworldlodtask SCE_SVoxelWorldLODTask;
+struct sce_svoxelworldlodtask {
+    SCE_SThreadPoolJob job;
+    SCE_SVoxelWorldLOD *lod;
+    size_t stage;
+    long idx[3];                /* coordinates of the block in the grid */
+    size_t n_deps;              /* number of unfinished blocks it reads */
+    int error;
+};
+
+typedef struct sce_svoxelworldlodstage SCE_SVoxelWorldLODStage;
+struct sce_svoxelworldlodstage {
+    SCE_SLongRect3 dst;         /* whole destination region */
+    long n[3];                  /* number of blocks along each axis */
+    size_t n_tasks;
+    SCE_SVoxelWorldLODTask *tasks;
+};
+
+struct sce_svoxelworldlod {
+    SCE_SVoxelWorld *vw;
+    SCEuint level;              /* source level of the first stage */
+    long size[3];               /* dimensions of the blocks */
+    size_t n_stages;
+    SCE_SVoxelWorldLODStage *stages;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* every task is over */
+    size_t n_left;
+    int error;
+};
+
+static long SCE_VWorld_FloorDiv (long a, long b)
 {
-    SCEuint i;
-    SCE_SLongRect3 area = *zone;
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
 
-    for (i = level; i < vw->n_lod - 1; i++) {
-        if (SCE_VWorld_GenerateLOD (vw, i, &area, &area) < 0) {
-            SCEE_LogSrc ();
-            return SCE_ERROR;
-        }
+static void SCE_VWorld_GetLODBlock (const SCE_SVoxelWorldLOD *lod,
+                                    const SCE_SVoxelWorldLODTask *task,
+                                    SCE_SLongRect3 *src, SCE_SLongRect3 *dst)
+{
+    size_t i;
+    long p1[3], p2[3], q1[3], q2[3];
+
+    SCE_Rectangle3_GetPointslv (&lod->stages[task->stage].dst, q1, q2);
+    for (i = 0; i < 3; i++) {
+        p1[i] = q1[i] + task->idx[i] * lod->size[i];
+        p2[i] = MIN (p1[i] + lod->size[i], q2[i]);
     }
-    return SCE_OK;
+    SCE_Rectangle3_Setlv (dst, p1, p2);
+    for (i = 0; i < 3; i++) {
+        p1[i] = p1[i] * 2 - 1;
+        p2[i] = p2[i] * 2 + 1;
+    }
+    SCE_Rectangle3_Setlv (src, p1, p2);
 }
 
+/* does \p task read voxels written by \p pred? */
+static int SCE_VWorld_LODDepends (const SCE_SVoxelWorldLOD *lod,
+                                  const SCE_SVoxelWorldLODTask *task,
+                                  const SCE_SVoxelWorldLODTask *pred)
+{
+    size_t i;
+    SCE_SLongRect3 src, dst, unused;
+    long p1[3], p2[3], q1[3], q2[3];
 
-/**
- * \brief Fills a list with trees that are inside a given region
- * \param vw a voxel world
- * \param level LOD of the region coordinates
- * \param region region in \c level's space
- * \param l list to fill, will be filled with SCE_SVoxelWorldTree elements
- *
- * If you call this function twice on the same voxel world, the list filled with
- * the first call might be corrupted but you can still access it safely.
- *
- * Trees inside \p region that do not exist will be created and set empty by
- * default, to change this behavior see SCE_VWorld_SetCreateTrees().
- * \return SCE_ERROR on error, SCE_OK otherwise
- */
-int SCE_VWorld_FetchTrees (SCE_SVoxelWorld *vw, SCEuint level,
-                           const SCE_SLongRect3 *region, SCE_SList *l)
+    SCE_VWorld_GetLODBlock (lod, task, &src, &unused);
+    SCE_VWorld_GetLODBlock (lod, pred, &unused, &dst);
+    SCE_Rectangle3_GetPointslv (&src, p1, p2);
+    SCE_Rectangle3_GetPointslv (&dst, q1, q2);
+    for (i = 0; i < 3; i++) {
+        if (p1[i] >= q2[i] || q1[i] >= p2[i])
+            return SCE_FALSE;
+    }
+    return SCE_TRUE;
+}
+
+/* range of the blocks of a stage overlapping [a1, a2[ in its space */
+static int SCE_VWorld_GetLODRange (const SCE_SVoxelWorldLOD *lod,
+                                   size_t stage, const long *a1,
+                                   const long *a2, long *r1, long *r2)
 {
-    long i, j, p1[3], p2[3];
-    SCE_SVoxelWorldTree *wt = NULL;
+    size_t i;
+    long p1[3], p2[3];
+    const SCE_SVoxelWorldLODStage *st = &lod->stages[stage];
 
-    SCE_VWorld_TreeRegion (vw, level, region, p1, p2);
+    SCE_Rectangle3_GetPointslv (&st->dst, p1, p2);
+    for (i = 0; i < 3; i++) {
+        r1[i] = SCE_VWorld_FloorDiv (a1[i] - p1[i], lod->size[i]);
+        r2[i] = SCE_VWorld_FloorDiv (a2[i] - 1 - p1[i], lod->size[i]);
+        r1[i] = MAX (r1[i], 0);
+        r2[i] = MIN (r2[i], st->n[i] - 1);
+        if (r1[i] > r2[i])
+            return SCE_FALSE;
+    }
+    return SCE_TRUE;
+}
 
-    for (i = p1[0]; i <= p2[0]; i++) {
-        for (j = p1[1]; j <= p2[1]; j++) {
-            wt = SCE_VWorld_GetTree (vw, i, j, 0);
-            if (!wt) {
-                if (!vw->create_trees)
-                    continue;
-                if (!(wt = SCE_VWorld_AddNewTree (vw, i, j, 0))) {
-                    SCEE_LogSrc ();
-                    return SCE_ERROR;
+static SCE_SVoxelWorldLODTask*
+SCE_VWorld_GetLODTask (SCE_SVoxelWorldLOD *lod, size_t stage,
+                       long x, long y, long z)
+{
+    SCE_SVoxelWorldLODStage *st = &lod->stages[stage];
+    return &st->tasks[(z * st->n[1] + y) * st->n[0] + x];
+}
+
+static void SCE_VWorld_RunLODTask (void *data)
+{
+    SCE_SVoxelWorldLODTask *task = data;
+    SCE_SVoxelWorldLOD *lod = task->lod;
+    SCE_SLongRect3 src, dst;
+
+    SCE_VWorld_GetLODBlock (lod, task, &src, &dst);
+    pthread_mutex_lock (&lod->mutex);
+    task->error = lod->error;
+    pthread_mutex_unlock (&lod->mutex);
+    /* do not bother computing anything if another block failed */
+    if (!task->error) {
+        if (SCE_VWorld_GenerateLODBlock (lod->vw, lod->level + task->stage,
+                                         &src, &dst) < 0)
+            task->error = SCE_TRUE;
+    }
+}
+
+/* called once the thread pool is done with the job, releases the blocks
+   of the next stage which were waiting for this one */
+static void SCE_VWorld_FinishLODTask (void *data)
+{
+    SCE_SVoxelWorldLODTask *task = data;
+    SCE_SVoxelWorldLOD *lod = task->lod;
+    long x, y, z, a1[3], a2[3], r1[3], r2[3];
+    size_t i, next = task->stage + 1;
+    SCE_SLongRect3 src, dst;
+
+    pthread_mutex_lock (&lod->mutex);
+    if (task->error)
+        lod->error = SCE_TRUE;
+
+    if (next < lod->n_stages) {
+        SCE_VWorld_GetLODBlock (lod, task, &src, &dst);
+        SCE_Rectangle3_GetPointslv (&dst, a1, a2);
+        /* candidates, SCE_VWorld_LODDepends() gives the exact answer */
+        for (i = 0; i < 3; i++) {
+            a1[i] = SCE_VWorld_FloorDiv (a1[i] - 1, 2);
+            a2[i] = SCE_VWorld_FloorDiv (a2[i], 2) + 1;
+        }
+        if (SCE_VWorld_GetLODRange (lod, next, a1, a2, r1, r2)) {
+            for (z = r1[2]; z <= r2[2]; z++) {
+                for (y = r1[1]; y <= r2[1]; y++) {
+                    for (x = r1[0]; x <= r2[0]; x++) {
+                        SCE_SVoxelWorldLODTask *succ =
+                            SCE_VWorld_GetLODTask (lod, next, x, y, z);
+                        if (!SCE_VWorld_LODDepends (lod, succ, task))
+                            continue;
+                        succ->n_deps--;
+                        if (succ->n_deps == 0)
+                            SCE_TPool_Push (&lod->vw->workers, &succ->job);
+                    }
                 }
             }
-            SCE_List_Remove (&wt->it2);
-            SCE_List_Appendl (l, &wt->it2);
         }
     }
 
-    return SCE_OK;
+    lod->n_left--;
+    if (lod->n_left == 0)
+        pthread_cond_signal (&lod->cond);
+    pthread_mutex_unlock (&lod->mutex);
 }
-/**
- * \brief Fetch a single tree from world space coordinates
- * \param vw
- * \param level 
- * \param x 
- * \param y 
- * \param z 
- * 
- * \return an octree node, NULL if none found
- * \sa SCE_VWorld_FetchTrees()
- */
-SCE_SVoxelWorldTree* SCE_VWorld_FetchTree (SCE_SVoxelWorld *vw, SCEuint level,
-                                           long x, long y, long z)
+
+static int SCE_VWorld_SetupLODStage (SCE_SVoxelWorldLOD *lod, size_t stage,
+                                     const SCE_SLongRect3 *zone)
+{
+    SCE_SVoxelWorldLODStage *st = &lod->stages[stage];
+    SCE_SLongRect3 src;
+    long i, x, y, z, k[3], p1[3], p2[3], a1[3], a2[3], r1[3], r2[3];
+
+    SCE_VWorld_GetLODRegions (zone, &src, &st->dst);
+    SCE_Rectangle3_GetPointslv (&st->dst, p1, p2);
+    st->n_tasks = 1;
+    for (i = 0; i < 3; i++) {
+        st->n[i] = MAX (p2[i] - p1[i], 0);
+        st->n[i] = (st->n[i] + lod->size[i] - 1) / lod->size[i];
+        st->n_tasks *= st->n[i];
+    }
+    if (st->n_tasks == 0)
+        return SCE_OK;
+
+    if (!(st->tasks = SCE_malloc (st->n_tasks * sizeof *st->tasks)))
+        goto fail;
+
+    for (z = 0; z < st->n[2]; z++) {
+        for (y = 0; y < st->n[1]; y++) {
+            for (x = 0; x < st->n[0]; x++) {
+                SCE_SVoxelWorldLODTask *task =
+                    SCE_VWorld_GetLODTask (lod, stage, x, y, z);
+                SCE_SLongRect3 dst;
+
+                SCE_TPool_InitJob (&task->job);
+                SCE_TPool_SetJobFunc (&task->job, SCE_VWorld_RunLODTask);
+                SCE_TPool_SetJobFreeFunc (&task->job,
+                                          SCE_VWorld_FinishLODTask);
+                SCE_TPool_SetJobData (&task->job, task);
+                /* ready blocks of the upper levels go first */
+                SCE_TPool_SetJobPriority (&task->job, (int)stage);
+                task->lod = lod;
+                task->stage = stage;
+                task->idx[0] = x;
+                task->idx[1] = y;
+                task->idx[2] = z;
+                task->n_deps = 0;
+                task->error = SCE_FALSE;
+
+                if (stage == 0)
+                    continue;
+                /* count the blocks of the previous stage it reads */
+                SCE_VWorld_GetLODBlock (lod, task, &src, &dst);
+                SCE_Rectangle3_GetPointslv (&src, a1, a2);
+                if (!SCE_VWorld_GetLODRange (lod, stage - 1, a1, a2, r1, r2))
+                    continue;
+                for (k[2] = r1[2]; k[2] <= r2[2]; k[2]++) {
+                    for (k[1] = r1[1]; k[1] <= r2[1]; k[1]++) {
+                        for (k[0] = r1[0]; k[0] <= r2[0]; k[0]++) {
+                            SCE_SVoxelWorldLODTask *pred =
+                                SCE_VWorld_GetLODTask (lod, stage - 1, k[0],
+                                                       k[1], k[2]);
+                            if (SCE_VWorld_LODDepends (lod, task, pred))
+                                task->n_deps++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/**
+ * \brief Generates several levels of details in parallel
+ * \param vw a voxel world
+ * \param level source level
+ * \param n_levels number of levels to generate, from \p level + 1
+ * \param zone modified region in \p level's space
+ * \param updated updated region in the space of the last generated level,
+ * can be NULL
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+static int SCE_VWorld_GenerateLODParallel (SCE_SVoxelWorld *vw,
+                                           SCEuint level, SCEuint n_levels,
+                                           const SCE_SLongRect3 *zone,
+                                           SCE_SLongRect3 *updated)
+{
+    SCE_SVoxelWorldLOD lod;
+    SCE_SLongRect3 area = *zone;
+    size_t i, j;
+    int error = SCE_FALSE;
+
+    lod.vw = vw;
+    lod.level = level;
+    /* src blocks have to fit buffer1, dst blocks buffer2 */
+    lod.size[0] = (vw->w - 2) / 2;
+    lod.size[1] = (vw->h - 2) / 2;
+    lod.size[2] = (vw->d - 2) / 2;
+    lod.n_stages = n_levels;
+    lod.n_left = 0;
+    lod.error = SCE_FALSE;
+    pthread_mutex_init (&lod.mutex, NULL);
+    pthread_cond_init (&lod.cond, NULL);
+
+    if (!(lod.stages = SCE_malloc (n_levels * sizeof *lod.stages)))
+        goto fail;
+    for (i = 0; i < n_levels; i++) {
+        lod.stages[i].n_tasks = 0;
+        lod.stages[i].tasks = NULL;
+    }
+
+    for (i = 0; i < n_levels; i++) {
+        if (SCE_VWorld_SetupLODStage (&lod, i, &area) < 0)
+            goto fail;
+        area = lod.stages[i].dst;
+        lod.n_left += lod.stages[i].n_tasks;
+    }
+
+    pthread_mutex_lock (&lod.mutex);
+    for (i = 0; i < n_levels; i++) {
+        for (j = 0; j < lod.stages[i].n_tasks; j++) {
+            SCE_SVoxelWorldLODTask *task = &lod.stages[i].tasks[j];
+            if (task->n_deps == 0)
+                SCE_TPool_Push (&vw->workers, &task->job);
+        }
+    }
+    while (lod.n_left > 0)
+        pthread_cond_wait (&lod.cond, &lod.mutex);
+    error = lod.error;
+    pthread_mutex_unlock (&lod.mutex);
+
+    for (i = 0; i < n_levels; i++)
+        SCE_free (lod.stages[i].tasks);
+    SCE_free (lod.stages);
+    pthread_cond_destroy (&lod.cond);
+    pthread_mutex_destroy (&lod.mutex);
+
+    if (error)
+        goto fail2;
+    if (updated)
+        *updated = area;
+
+    return SCE_OK;
+fail:
+    if (lod.stages) {
+        for (i = 0; i < n_levels; i++)
+            SCE_free (lod.stages[i].tasks);
+        SCE_free (lod.stages);
+    }
+    pthread_cond_destroy (&lod.cond);
+    pthread_mutex_destroy (&lod.mutex);
+fail2:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+static int SCE_VWorld_CanGenerateLODParallel (SCE_SVoxelWorld *vw)
+{
+    return SCE_TPool_IsRunning (&vw->workers) &&
+        vw->w >= 4 && vw->h >= 4 && vw->d >= 4;
+}
+
+/**
+ * \brief Generates the level of details \p level + 1 of a region
+ * \param vw a voxel world
+ * \param level source level
+ * \param zone modified region in \p level's space
+ * \param updated updated region in \p level + 1's space, can be NULL
+ *
+ * When the worker threads of \p vw are running, the region is split into
+ * blocks processed by the workers, each one using its own buffer.
+ * \warning This function waits for the jobs it queues to the workers of
+ * \p vw, thus it must not be called from one of their jobs: it would
+ * deadlock.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VWorld_GenerateAllLOD(), SCE_VWorld_SetNumWorkers()
+ */
+int SCE_VWorld_GenerateLOD (SCE_SVoxelWorld *vw, SCEuint level,
+                            const SCE_SLongRect3 *zone,
+                            SCE_SLongRect3 *updated)
+{
+    SCE_SLongRect3 src, dst;
+
+    if (SCE_VWorld_CanGenerateLODParallel (vw)) {
+        if (SCE_VWorld_GenerateLODParallel (vw, level, 1, zone, updated) < 0)
+            goto fail;
+        return SCE_OK;
+    }
+
+    SCE_VWorld_GetLODRegions (zone, &src, &dst);
+
+    /* if one of the region exceed the size in vw's buffers,
+       split LOD generation */
+    /* TODO: doesn't account the number of bytes per voxel */
+    if (SCE_Rectangle3_GetAreal (&src) > vw->size1 ||
+        SCE_Rectangle3_GetAreal (&dst) > vw->size2) {
+        SCE_SLongRect3 up1, up2;
+
+        switch (SCE_VWorld_GetRegionStatus (vw, level, &src)) {
+        case SCE_VOCTREE_NODE_EMPTY:
+        case SCE_VOCTREE_NODE_FULL:
+            /* no need to split */
+            if (SCE_VWorld_GenerateLODBlock (vw, level, &src, &dst) < 0)
+                goto fail;
+            if (updated)
+                *updated = dst;
+            return SCE_OK;
+        default: break;
+        }
+
+        SCE_Rectangle3_SplitMaxl (zone, &src, &dst);
+        if (SCE_VWorld_GenerateLOD (vw, level, &src, &up1) < 0) goto fail;
+        if (SCE_VWorld_GenerateLOD (vw, level, &dst, &up2) < 0) goto fail;
+        if (updated)
+            SCE_Rectangle3_Unionl (&up1, &up2, updated);
+    } else {
+        if (SCE_VWorld_GenerateLODBlock (vw, level, &src, &dst) < 0)
+            goto fail;
+        if (updated)
+            *updated = dst;
+    }
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/**
+ * \brief Generates every level of details above \p level of a region
+ * \param vw a voxel world
+ * \param level source level
+ * \param zone modified region in \p level's space
+ *
+ * When the worker threads of \p vw are running, a level is computed by
+ * blocks and each block is queued as soon as the blocks of the previous
+ * level it depends on are done, so several levels are computed at once.
+ * \warning Like SCE_VWorld_GenerateLOD(), this function must not be called
+ * from a job of the workers of \p vw.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VWorld_GenerateAllLOD (SCE_SVoxelWorld *vw, SCEuint level,
+                               const SCE_SLongRect3 *zone)
+{
+    SCEuint i;
+    SCE_SLongRect3 area = *zone;
+
+    if (level + 1 >= vw->n_lod)
+        return SCE_OK;
+
+    if (SCE_VWorld_CanGenerateLODParallel (vw)) {
+        if (SCE_VWorld_GenerateLODParallel (vw, level, vw->n_lod - 1 - level,
+                                            zone, NULL) < 0)
+            goto fail;
+        return SCE_OK;
+    }
+
+    for (i = level; i < vw->n_lod - 1; i++) {
+        if (SCE_VWorld_GenerateLOD (vw, i, &area, &area) < 0)
+            goto fail;
+    }
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+
+/* a brush touching a node of level 0 */
+typedef struct sce_svoxelworldedit SCE_SVoxelWorldEdit;
+struct sce_svoxelworldedit {
+    long tree[2];               /* coordinates of the tree */
+    long node[3];               /* coordinates of the node */
+    size_t brush;               /* index of the brush in the batch */
+};
+
+static int SCE_VWorld_CompareEdits (const void *a, const void *b)
+{
+    const SCE_SVoxelWorldEdit *e1 = a, *e2 = b;
+    int i;
+
+    for (i = 1; i >= 0; i--) {
+        if (e1->tree[i] != e2->tree[i])
+            return e1->tree[i] < e2->tree[i] ? -1 : 1;
+    }
+    for (i = 2; i >= 0; i--) {
+        if (e1->node[i] != e2->node[i])
+            return e1->node[i] < e2->node[i] ? -1 : 1;
+    }
+    /* brushes of a node must be applied in order */
+    if (e1->brush != e2->brush)
+        return e1->brush < e2->brush ? -1 : 1;
+    return 0;
+}
+
+static int SCE_VWorld_SameNode (const SCE_SVoxelWorldEdit *e1,
+                                const SCE_SVoxelWorldEdit *e2)
+{
+    return e1->node[0] == e2->node[0] && e1->node[1] == e2->node[1] &&
+        e1->node[2] == e2->node[2];
+}
+
+/* lists the nodes touched by each brush, sorted by tree and node */
+static SCE_SVoxelWorldEdit*
+SCE_VWorld_SortEdits (SCE_SVoxelWorld *vw, SCE_SVoxelEditBatch *eb,
+                      size_t *n_edits)
+{
+    SCE_SVoxelWorldEdit *edits = NULL;
+    long p1[3], p2[3], n[3], dim[3], total[2];
+    size_t i, j, n_nodes = 0;
+
+    dim[0] = vw->w;
+    dim[1] = vw->h;
+    dim[2] = vw->d;
+    total[0] = SCE_VWorld_GetTotalWidth (vw);
+    total[1] = SCE_VWorld_GetTotalHeight (vw);
+
+    for (i = 0; i < eb->n_brushes; i++) {
+        SCE_Rectangle3_GetPointslv (&eb->brushes[i].bounds, p1, p2);
+        for (j = 0; j < 3; j++) {
+            p1[j] = SCE_VWorld_FloorDiv (p1[j], dim[j]);
+            p2[j] = SCE_VWorld_FloorDiv (p2[j] - 1, dim[j]);
+        }
+        n_nodes += (p2[0] - p1[0] + 1) * (p2[1] - p1[1] + 1) *
+            (p2[2] - p1[2] + 1);
+    }
+
+    if (!(edits = SCE_malloc (n_nodes * sizeof *edits))) {
+        SCEE_LogSrc ();
+        return NULL;
+    }
+
+    *n_edits = 0;
+    for (i = 0; i < eb->n_brushes; i++) {
+        SCE_Rectangle3_GetPointslv (&eb->brushes[i].bounds, p1, p2);
+        for (j = 0; j < 3; j++) {
+            p1[j] = SCE_VWorld_FloorDiv (p1[j], dim[j]);
+            p2[j] = SCE_VWorld_FloorDiv (p2[j] - 1, dim[j]);
+        }
+        for (n[2] = p1[2]; n[2] <= p2[2]; n[2]++) {
+            for (n[1] = p1[1]; n[1] <= p2[1]; n[1]++) {
+                for (n[0] = p1[0]; n[0] <= p2[0]; n[0]++) {
+                    SCE_SVoxelWorldEdit *e = &edits[(*n_edits)++];
+                    e->tree[0] = SCE_VWorld_FloorDiv (n[0] * dim[0], total[0]);
+                    e->tree[1] = SCE_VWorld_FloorDiv (n[1] * dim[1], total[1]);
+                    e->node[0] = n[0];
+                    e->node[1] = n[1];
+                    e->node[2] = n[2];
+                    e->brush = i;
+                }
+            }
+        }
+    }
+
+    qsort (edits, *n_edits, sizeof *edits, SCE_VWorld_CompareEdits);
+
+    return edits;
+}
+
+/**
+ * \brief Applies a batch of brushes on the level 0 of a voxel world
+ * \param vw a voxel world
+ * \param eb brushes to apply
+ * \param updated modified region, in level 0's space, can be NULL
+ *
+ * The brushes are sorted by the node of level 0 they touch. Each node is
+ * looked up and read once, every brush touching it is applied, then the
+ * node is written back. Each tree is locked once. A single updated region is
+ * recorded for the whole batch, on error it covers the nodes written so far.
+ *
+ * Levels of details are not updated. Pass \p updated to
+ * SCE_VWorld_GenerateAllLOD() when convenient, e.g. once per frame. As with
+ * SCE_VWorld_SetRegion(), voxels of trees that do not exist are ignored.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VEdit_AddSphere(), SCE_VEdit_AddBox(), SCE_VEdit_AddCylinder()
+ */
+int SCE_VWorld_ApplyEdits (SCE_SVoxelWorld *vw, SCE_SVoxelEditBatch *eb,
+                           SCE_SLongRect3 *updated)
+{
+    SCE_SVoxelWorldEdit *edits = NULL;
+    SCE_SVoxelWorldBuffer *buf = NULL;
+    SCE_SLongRect3 written;     /* modified so far */
+    size_t i, j, k, n_edits = 0;
+    int r = SCE_OK, has_written = SCE_FALSE;
+
+    if (eb->n_brushes == 0) {
+        if (updated)
+            SCE_Rectangle3_Initl (updated);
+        return SCE_OK;
+    }
+
+    if (!(edits = SCE_VWorld_SortEdits (vw, eb, &n_edits)))
+        goto fail;
+
+    buf = SCE_VWorld_LockBuffer (vw);
+    pthread_rwlock_rdlock (&vw->rwlock2);
+
+    for (i = 0; i < n_edits && r >= 0;) {
+        SCE_SVoxelWorldTree *wt = NULL;
+        long tx = edits[i].tree[0], ty = edits[i].tree[1];
+
+        if ((wt = SCE_VWorld_GetTree (vw, tx, ty, 0)))
+            pthread_rwlock_wrlock (&wt->rwlock);
+
+        while (i < n_edits && r >= 0 &&
+               edits[i].tree[0] == tx && edits[i].tree[1] == ty) {
+            SCE_SVoxelOctreeNode *node = NULL;
+            SCE_SLongRect3 node_rect, area;
+            long x, y, z;
+
+            for (j = i + 1; j < n_edits; j++) {
+                if (!SCE_VWorld_SameNode (&edits[i], &edits[j]))
+                    break;
+            }
+            if (!wt) {
+                i = j;
+                continue;
+            }
+
+            x = edits[i].node[0] * vw->w;
+            y = edits[i].node[1] * vw->h;
+            z = edits[i].node[2] * vw->d;
+            SCE_Rectangle3_SetFromOriginl (&node_rect, x, y, z,
+                                           vw->w, vw->h, vw->d);
+            /* part of the node touched by its brushes */
+            area = eb->brushes[edits[i].brush].bounds;
+            for (k = i + 1; k < j; k++) {
+                const SCE_SVoxelBrush *brush = &eb->brushes[edits[k].brush];
+                SCE_Rectangle3_Unionl (&area, &brush->bounds, &area);
+            }
+            SCE_Rectangle3_Intersectionl (&node_rect, &area, &area);
+
+            /* nodes holding voxels are edited without walking the tree
+               from its root, the others have to be created by SetRegion() */
+            node = SCE_VOctree_FindNode (&wt->vo, 0, x, y, z);
+            if (node &&
+                SCE_VOctree_GetNodeStatus (node) == SCE_VOCTREE_NODE_LEAF)
+                r = SCE_VOctree_GetNodeVoxels (&wt->vo, node, buf->buffer1);
+            else {
+                node = NULL;
+                r = SCE_VOctree_GetRegion (&wt->vo, 0, &node_rect,
+                                           buf->buffer1);
+            }
+            for (; i < j && r >= 0; i++) {
+                SCE_VEdit_ApplyBrush (&eb->brushes[edits[i].brush],
+                                      vw->usage, &node_rect, buf->buffer1);
+            }
+            if (r >= 0) {
+                if (node) {
+                    SCE_SLongRect3 local = area;
+                    SCE_Rectangle3_Movel (&local, -x, -y, -z);
+                    r = SCE_VOctree_SetNodeVoxels (&wt->vo, node, &local,
+                                                   buf->buffer1);
+                } else
+                    r = SCE_VOctree_SetRegion (&wt->vo, 0, &node_rect,
+                                               buf->buffer1);
+                /* a failed write may still have modified the node */
+                if (has_written)
+                    SCE_Rectangle3_Unionl (&written, &area, &written);
+                else
+                    written = area;
+                has_written = SCE_TRUE;
+            }
+            i = j;
+        }
+
+        if (wt)
+            pthread_rwlock_unlock (&wt->rwlock);
+    }
+
+    if (r >= 0)
+        SCE_VWorld_PushZone (vw, &eb->bounds, 0);
+    else if (has_written)
+        SCE_VWorld_PushZone (vw, &written, 0);
+    pthread_rwlock_unlock (&vw->rwlock2);
+    pthread_mutex_unlock (&buf->mutex);
+    SCE_free (edits);
+
+    if (r < 0)
+        goto fail;
+    if (updated)
+        *updated = eb->bounds;
+
+    return SCE_OK;
+fail:
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+
+/**
+ * \brief Fills a list with trees that are inside a given region
+ * \param vw a voxel world
+ * \param level LOD of the region coordinates
+ * \param region region in \c level's space
+ * \param l list to fill, will be filled with SCE_SVoxelWorldTree elements
+ *
+ * If you call this function twice on the same voxel world, the list filled with
+ * the first call might be corrupted but you can still access it safely.
+ *
+ * Trees inside \p region that do not exist will be created and set empty by
+ * default, to change this behavior see SCE_VWorld_SetCreateTrees().
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VWorld_FetchTrees (SCE_SVoxelWorld *vw, SCEuint level,
+                           const SCE_SLongRect3 *region, SCE_SList *l)
+{
+    long i, j, p1[3], p2[3];
+    SCE_SVoxelWorldTree *wt = NULL;
+
+    SCE_VWorld_TreeRegion (vw, level, region, p1, p2);
+
+    for (i = p1[0]; i <= p2[0]; i++) {
+        for (j = p1[1]; j <= p2[1]; j++) {
+            wt = SCE_VWorld_GetTree (vw, i, j, 0);
+            if (!wt) {
+                if (!vw->create_trees)
+                    continue;
+                if (!(wt = SCE_VWorld_AddNewTree (vw, i, j, 0))) {
+                    SCEE_LogSrc ();
+                    return SCE_ERROR;
+                }
+            }
+            SCE_List_Remove (&wt->it2);
+            SCE_List_Appendl (l, &wt->it2);
+        }
+    }
+
+    return SCE_OK;
+}
+/**
+ * \brief Fetch a single tree from world space coordinates
+ * \param vw
+ * \param level 
+ * \param x 
+ * \param y 
+ * \param z 
+ * 
+ * \return an octree node, NULL if none found
+ * \sa SCE_VWorld_FetchTrees()
+ */
+SCE_SVoxelWorldTree* SCE_VWorld_FetchTree (SCE_SVoxelWorld *vw, SCEuint level,
+                                           long x, long y, long z)
 {
     SCE_SLongRect3 r;
     long p1[3], p2[3];
@@ -1174,40 +2057,49 @@ int SCE_VWorld_FetchAllTreeNodes (SCE_SVoxelWorld *vw, long x, long y, long z,
     return SCE_OK;
 }
 
+/**
+ * \brief Gets the status of a region of a level
+ * \param vw a voxel world
+ * \param level a level
+ * \param r a region in \p level space
+ *
+ * Only read locks are taken, the LOD workers call it concurrently.
+ * \return SCE_VOCTREE_NODE_EMPTY or SCE_VOCTREE_NODE_FULL if the whole
+ * region is known to be empty or full, SCE_VOCTREE_NODE_LEAF otherwise
+ * \sa SCE_VOctree_GetRegionStatus()
+ */
 SCE_EVoxelOctreeStatus
 SCE_VWorld_GetRegionStatus (SCE_SVoxelWorld *vw, SCEuint level,
                             const SCE_SLongRect3 *r)
 {
-    SCE_SList list;
-    SCE_SListIterator *it = NULL;
     SCE_EVoxelOctreeStatus status = SCE_VOCTREE_NODE_LEAF, ns;
+    long i, j, p1[3], p2[3];
+    int first = SCE_TRUE, inside;
 
-    SCE_List_Init (&list);
-
-    /* should also lock mutexes of all overlapping trees to prevent them
-       from adding/removing nodes while fetching */
-
-    pthread_rwlock_wrlock (&vw->rwlock2);
-
-    SCE_VWorld_FetchNodes (vw, level, r, &list);
-    SCE_List_ForEach (it, &list) {
-        SCE_SVoxelOctreeNode *node = SCE_List_GetData (it);
-
-        ns = SCE_VOctree_GetNodeStatus (node);
-        if (ns == SCE_VOCTREE_NODE_LEAF || ns == SCE_VOCTREE_NODE_NODE) {
-            status = SCE_VOCTREE_NODE_LEAF;
-            break;
-        }
+    SCE_VWorld_TreeRegion (vw, level, r, p1, p2);
 
-        if (status == SCE_VOCTREE_NODE_LEAF || status == ns)
+    pthread_rwlock_rdlock (&vw->rwlock2);
+    for (i = p1[0]; i <= p2[0]; i++) {
+        for (j = p1[1]; j <= p2[1]; j++) {
+            SCE_SVoxelWorldTree *wt = SCE_VWorld_GetTree (vw, i, j, 0);
+            if (!wt)
+                continue;
+
+            pthread_rwlock_rdlock (&wt->rwlock);
+            inside = SCE_VOctree_GetRegionStatus (&wt->vo, level, r, &ns);
+            pthread_rwlock_unlock (&wt->rwlock);
+            if (!inside)
+                continue;
+
+            if (ns == SCE_VOCTREE_NODE_LEAF || (!first && ns != status)) {
+                status = SCE_VOCTREE_NODE_LEAF;
+                goto end;
+            }
             status = ns;
-        else {
-            status = SCE_VOCTREE_NODE_LEAF;
-            break;
+            first = SCE_FALSE;
         }
     }
-
-    SCE_List_Flush (&list);
+end:
     pthread_rwlock_unlock (&vw->rwlock2);
 
     return status;
@@ -1219,8 +2111,12 @@ int SCE_VWorld_UpdateCache (SCE_SVoxelWorld *vw)
 
     pthread_rwlock_rdlock (&vw->rwlock);
     SCE_List_ForEach (it, &vw->trees) {
+        int r;
         SCE_SVoxelWorldTree *wt = SCE_List_GetData (it);
-        if (SCE_VOctree_UpdateCache (&wt->vo) < 0)
+        pthread_rwlock_rdlock (&wt->rwlock);
+        r = SCE_VOctree_UpdateCache (&wt->vo);
+        pthread_rwlock_unlock (&wt->rwlock);
+        if (r < 0)
             goto fail;
     }
     pthread_rwlock_unlock (&vw->rwlock);
@@ -1237,8 +2133,12 @@ int SCE_VWorld_SyncCache (SCE_SVoxelWorld *vw)
 
     pthread_rwlock_rdlock (&vw->rwlock);
     SCE_List_ForEach (it, &vw->trees) {
+        int r;
         SCE_SVoxelWorldTree *wt = SCE_List_GetData (it);
-        if (SCE_VOctree_SyncCache (&wt->vo) < 0)
+        pthread_rwlock_rdlock (&wt->rwlock);
+        r = SCE_VOctree_SyncCache (&wt->vo);
+        pthread_rwlock_unlock (&wt->rwlock);
+        if (r < 0)
             goto fail;
     }
     pthread_rwlock_unlock (&vw->rwlock);
@@ -1249,3 +2149,578 @@ fail:
     SCEE_LogSrc ();
     return SCE_ERROR;
 }
+
+
+static void SCE_VWorld_RunJob (void *data)
+{
+    SCE_SVoxelWorldJob *job = data;
+    SCE_SVoxelWorld *vw = job->vw;
+    SCE_SVoxelWorldTree *wt = NULL;
+    SCE_SVoxelOctreeNode *node = NULL;
+    SCE_EVoxelOctreeStatus status;
+    int r = SCE_OK;
+
+    if (!(wt = SCE_VWorld_GetTree (vw, job->tx, job->ty, job->tz))) {
+        /* the tree has been removed in the meantime */
+        if (job->fun)
+            job->fun (vw, NULL, SCE_ERROR, job->udata);
+        return;
+    }
+
+    pthread_rwlock_rdlock (&wt->rwlock);
+    switch (job->type) {
+    case SCE_VWORLD_JOB_LOAD_NODE:
+    case SCE_VWORLD_JOB_SYNC_NODE:
+        node = SCE_VOctree_FindNode (&wt->vo, job->level,
+                                     job->x, job->y, job->z);
+        if (!node)
+            break;
+        status = SCE_VOctree_GetNodeStatus (node);
+        /* empty and full nodes have no grid */
+        if (status == SCE_VOCTREE_NODE_LEAF ||
+            status == SCE_VOCTREE_NODE_NODE) {
+            if (job->type == SCE_VWORLD_JOB_LOAD_NODE)
+                r = SCE_VOctree_CacheNode (&wt->vo, node);
+            else if (node->cached)
+                r = SCE_VOctree_SyncNode (&wt->vo, node);
+        }
+        /* the node is ready only once the job is over */
+        SCE_VOctree_AddNodePending (node, -1);
+        break;
+    case SCE_VWORLD_JOB_UPDATE_TREE:
+        r = SCE_VOctree_UpdateCache (&wt->vo);
+        break;
+    case SCE_VWORLD_JOB_SYNC_TREE:
+        r = SCE_VOctree_SyncCache (&wt->vo);
+    }
+    if (r < 0)
+        SCEE_LogSrc ();
+    if (job->fun)
+        job->fun (vw, node, r, job->udata);
+    pthread_rwlock_unlock (&wt->rwlock);
+}
+
+static void SCE_VWorld_FreeJob (void *job)
+{
+    SCE_free (job);
+}
+static SCE_SVoxelWorldJob*
+SCE_VWorld_CreateJob (SCE_SVoxelWorld *vw, SCE_EVoxelWorldJobType type,
+                      const SCE_SVoxelOctree *vo, SCE_FVoxelWorldJobCallback f,
+                      void *udata)
+{
+    SCE_SVoxelWorldJob *job = NULL;
+    long x, y, z, w, h, d;
+
+    if (!(job = SCE_malloc (sizeof *job))) {
+        SCEE_LogSrc ();
+        return NULL;
+    }
+    SCE_TPool_InitJob (&job->job);
+    SCE_TPool_SetJobFunc (&job->job, SCE_VWorld_RunJob);
+    SCE_TPool_SetJobFreeFunc (&job->job, SCE_VWorld_FreeJob);
+    SCE_TPool_SetJobData (&job->job, job);
+    job->type = type;
+    job->vw = vw;
+    SCE_VOctree_GetOriginv (vo, &x, &y, &z);
+    SCE_VOctree_GetDimensionsv (vo, &w, &h, &d);
+    job->tx = x / w;
+    job->ty = y / h;
+    job->tz = z / d;
+    job->level = 0;
+    job->x = job->y = job->z = 0;
+    job->streaming = SCE_FALSE;
+    job->fun = f;
+    job->udata = udata;
+    SCE_List_InitIt (&job->it);
+    SCE_List_SetData (&job->it, job);
+    return job;
+}
+
+static int
+SCE_VWorld_QueueNode (SCE_SVoxelWorld *vw, SCE_EVoxelWorldJobType type,
+                      SCE_SVoxelOctreeNode *node, int priority,
+                      SCE_FVoxelWorldJobCallback f, void *udata)
+{
+    SCE_SVoxelWorldJob *job = NULL;
+
+    job = SCE_VWorld_CreateJob (vw, type, SCE_VOctree_GetNodeOctree (node),
+                                f, udata);
+    if (!job) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    job->level = SCE_VOctree_GetNodeLevel (node);
+    SCE_VOctree_GetNodeOriginv (node, &job->x, &job->y, &job->z);
+    SCE_TPool_SetJobPriority (&job->job, priority);
+    SCE_VOctree_AddNodePending (node, 1);
+    SCE_TPool_Push (&vw->workers, &job->job);
+    return SCE_OK;
+}
+
+/**
+ * \brief Decompresses a node in the background
+ * \param vw a voxel world
+ * \param node a node of \p vw
+ * \param priority jobs of highest priority are run first
+ * \param f called once the node is in memory, can be NULL
+ * \param udata user data given to \p f
+ *
+ * Until the job is over, SCE_VOctree_IsNodeLoading() returns SCE_TRUE
+ * for \p node. The job holds the read lock of the
+ * tree of \p node, so edits of this tree wait for it.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VWorld_SetNumWorkers(), SCE_VWorld_QueueSyncNode()
+ */
+int SCE_VWorld_QueueLoadNode (SCE_SVoxelWorld *vw, SCE_SVoxelOctreeNode *node,
+                              int priority, SCE_FVoxelWorldJobCallback f,
+                              void *udata)
+{
+    return SCE_VWorld_QueueNode (vw, SCE_VWORLD_JOB_LOAD_NODE, node, priority,
+                                 f, udata);
+}
+/**
+ * \brief Compresses a node into its file in the background
+ * \param vw a voxel world
+ * \param node a node of \p vw
+ * \param f called once the node has been written, can be NULL
+ * \param udata user data given to \p f
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VWorld_QueueLoadNode()
+ */
+int SCE_VWorld_QueueSyncNode (SCE_SVoxelWorld *vw, SCE_SVoxelOctreeNode *node,
+                              SCE_FVoxelWorldJobCallback f, void *udata)
+{
+    return SCE_VWorld_QueueNode (vw, SCE_VWORLD_JOB_SYNC_NODE, node, 0,
+                                 f, udata);
+}
+
+static int
+SCE_VWorld_QueueTrees (SCE_SVoxelWorld *vw, SCE_EVoxelWorldJobType type,
+                       SCE_FVoxelWorldJobCallback f, void *udata)
+{
+    SCE_SListIterator *it = NULL;
+    SCE_SVoxelWorldJob **jobs = NULL;
+    size_t i, n = 0;
+
+    /* create the jobs first: without worker, SCE_TPool_Push() runs them
+       right away and they lock vw->rwlock themselves */
+    pthread_rwlock_rdlock (&vw->rwlock);
+    n = SCE_List_GetLength (&vw->trees);
+    if (n > 0 && !(jobs = SCE_malloc (n * sizeof *jobs)))
+        goto fail;
+    i = 0;
+    SCE_List_ForEach (it, &vw->trees) {
+        SCE_SVoxelWorldTree *wt = SCE_List_GetData (it);
+        if (!(jobs[i] = SCE_VWorld_CreateJob (vw, type, &wt->vo, f, udata))) {
+            while (i > 0)
+                SCE_free (jobs[--i]);
+            goto fail;
+        }
+        i++;
+    }
+    pthread_rwlock_unlock (&vw->rwlock);
+
+    for (i = 0; i < n; i++)
+        SCE_TPool_Push (&vw->workers, &jobs[i]->job);
+    SCE_free (jobs);
+
+    return SCE_OK;
+fail:
+    pthread_rwlock_unlock (&vw->rwlock);
+    SCE_free (jobs);
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+/**
+ * \brief Background version of SCE_VWorld_UpdateCache()
+ * \param vw a voxel world
+ * \param f called once per tree when its cache fits its budget, can be NULL
+ * \param udata user data given to \p f
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VWorld_QueueUpdateCache (SCE_SVoxelWorld *vw,
+                                 SCE_FVoxelWorldJobCallback f, void *udata)
+{
+    return SCE_VWorld_QueueTrees (vw, SCE_VWORLD_JOB_UPDATE_TREE, f, udata);
+}
+/**
+ * \brief Background version of SCE_VWorld_SyncCache()
+ * \param vw a voxel world
+ * \param f called once per synchronized tree, can be NULL
+ * \param udata user data given to \p f
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ */
+int SCE_VWorld_QueueSyncCache (SCE_SVoxelWorld *vw,
+                               SCE_FVoxelWorldJobCallback f, void *udata)
+{
+    return SCE_VWorld_QueueTrees (vw, SCE_VWORLD_JOB_SYNC_TREE, f, udata);
+}
+/**
+ * \brief Waits for every queued background job to be over
+ * \param vw a voxel world
+ */
+void SCE_VWorld_WaitJobs (SCE_SVoxelWorld *vw)
+{
+    SCE_TPool_Wait (&vw->workers);
+}
+
+
+/* undoes SCE_VOctree_AddNodePending() for a job that will never run */
+static void SCE_VWorld_ReleaseJobNode (SCE_SVoxelWorldJob *job)
+{
+    SCE_SVoxelWorldTree *wt = NULL;
+    SCE_SVoxelOctreeNode *node = NULL;
+
+    if (!(wt = SCE_VWorld_GetTree (job->vw, job->tx, job->ty, job->tz)))
+        return;
+    pthread_rwlock_rdlock (&wt->rwlock);
+    node = SCE_VOctree_FindNode (&wt->vo, job->level, job->x, job->y, job->z);
+    if (node)
+        SCE_VOctree_AddNodePending (node, -1);
+    pthread_rwlock_unlock (&wt->rwlock);
+}
+
+/* is the node of a prefetch job still inside the streaming ring, jobs
+   queued by SCE_VWorld_Prefetch() are left alone */
+static int SCE_VWorld_IsInRing (SCE_SVoxelWorld *vw, SCE_SVoxelWorldJob *job)
+{
+    long r, c[3];
+    SCEuint level = job->level;
+
+    if (!job->streaming)
+        return SCE_TRUE;
+    if (level >= SCE_MAX_VWORLD_STREAMING_LEVELS || vw->radius[level] < 0)
+        return SCE_FALSE;
+
+    r = vw->radius[level];
+    c[0] = vw->focus[0] >> level;
+    c[1] = vw->focus[1] >> level;
+    c[2] = vw->focus[2] >> level;
+    return job->x + (long)vw->w > c[0] - r && job->x <= c[0] + r &&
+           job->y + (long)vw->h > c[1] - r && job->y <= c[1] + r &&
+           job->z + (long)vw->d > c[2] - r && job->z <= c[2] + r;
+}
+
+static int SCE_VWorld_KeepAll (SCE_SVoxelWorld *vw, SCE_SVoxelWorldJob *job)
+{
+    return SCE_TRUE;
+}
+
+/* frees the prefetch jobs that are over and cancels the queued ones that
+   are rejected by \p keep (all of them if NULL) */
+static void
+SCE_VWorld_SweepPrefetch (SCE_SVoxelWorld *vw,
+                          int (*keep)(SCE_SVoxelWorld*, SCE_SVoxelWorldJob*))
+{
+    SCE_SListIterator *it = NULL, *pro = NULL;
+
+    pthread_mutex_lock (&vw->prefetch_mutex);
+    SCE_List_ForEachProtected (pro, it, &vw->prefetched) {
+        SCE_SVoxelWorldJob *job = SCE_List_GetData (it);
+        SCE_EThreadPoolJobState state = SCE_TPool_GetJobState (&job->job);
+
+        if (state == SCE_TPOOL_JOB_QUEUED && (!keep || !keep (vw, job))) {
+            if (SCE_TPool_Cancel (&vw->workers, &job->job)) {
+                SCE_VWorld_ReleaseJobNode (job);
+                state = SCE_TPOOL_JOB_DONE;
+            }
+        }
+        if (state == SCE_TPOOL_JOB_DONE || state == SCE_TPOOL_JOB_IDLE) {
+            SCE_List_Removel (&job->it);
+            SCE_free (job);
+        }
+    }
+    pthread_mutex_unlock (&vw->prefetch_mutex);
+}
+
+/* queues the loading of the nodes of a region, priority decreasing with
+   the distance to the center of the region if \p ring is true */
+static int
+SCE_VWorld_PrefetchRegion (SCE_SVoxelWorld *vw, SCEuint level,
+                           const SCE_SLongRect3 *region, int priority,
+                           int ring)
+{
+    SCE_SList nodes, jobs;
+    SCE_SListIterator *it = NULL, *pro = NULL;
+    long i, j, p1[3], p2[3], c[3];
+
+    SCE_List_Init (&nodes);
+    SCE_List_Init (&jobs);
+    SCE_Rectangle3_GetPointslv (region, p1, p2);
+    c[0] = (p1[0] + p2[0]) / 2;
+    c[1] = (p1[1] + p2[1]) / 2;
+    c[2] = (p1[2] + p2[2]) / 2;
+
+    SCE_VWorld_TreeRegion (vw, level, region, p1, p2);
+
+    /* fetching uses the it2 iterator of the nodes */
+    pthread_rwlock_wrlock (&vw->rwlock2);
+    for (i = p1[0]; i <= p2[0]; i++) {
+        for (j = p1[1]; j <= p2[1]; j++) {
+            SCE_SVoxelWorldTree *wt = SCE_VWorld_GetTree (vw, i, j, 0);
+            if (!wt)
+                continue;
+
+            pthread_rwlock_rdlock (&wt->rwlock);
+            if (SCE_VOctree_FetchNodes (&wt->vo, level, region, &nodes) < 0) {
+                pthread_rwlock_unlock (&wt->rwlock);
+                goto fail;
+            }
+            SCE_List_ForEach (it, &nodes) {
+                SCE_SVoxelOctreeNode *node = SCE_List_GetData (it);
+                SCE_EVoxelOctreeStatus status;
+                SCE_SVoxelWorldJob *job = NULL;
+                long x, y, z, dist;
+
+                if (SCE_VOctree_IsNodeLoading (node))
+                    continue;
+                status = SCE_VOctree_GetNodeStatus (node);
+                if (status != SCE_VOCTREE_NODE_LEAF &&
+                    status != SCE_VOCTREE_NODE_NODE)
+                    continue;
+                /* keep resident nodes at the end of the LRU list */
+                if (SCE_VOctree_TouchNode (&wt->vo, node))
+                    continue;
+
+                job = SCE_VWorld_CreateJob (vw, SCE_VWORLD_JOB_LOAD_NODE,
+                                            &wt->vo, NULL, NULL);
+                if (!job) {
+                    pthread_rwlock_unlock (&wt->rwlock);
+                    goto fail;
+                }
+                SCE_TPool_SetJobFreeFunc (&job->job, NULL);
+                job->level = SCE_VOctree_GetNodeLevel (node);
+                SCE_VOctree_GetNodeOriginv (node, &x, &y, &z);
+                job->x = x;
+                job->y = y;
+                job->z = z;
+                job->streaming = ring;
+                if (ring) {
+                    /* distance in nodes, closest nodes first */
+                    x = (x + (long)vw->w / 2 - c[0]) / (long)vw->w;
+                    y = (y + (long)vw->h / 2 - c[1]) / (long)vw->h;
+                    z = (z + (long)vw->d / 2 - c[2]) / (long)vw->d;
+                    dist = MAX (MAX (x < 0 ? -x : x, y < 0 ? -y : y),
+                                z < 0 ? -z : z);
+                    SCE_TPool_SetJobPriority (&job->job, priority - dist);
+                } else
+                    SCE_TPool_SetJobPriority (&job->job, priority);
+                SCE_VOctree_AddNodePending (node, 1);
+                SCE_List_Appendl (&jobs, &job->it);
+            }
+            /* important: we dont want any iterator to keep a pointer to
+               this list */
+            SCE_List_Flush (&nodes);
+            pthread_rwlock_unlock (&wt->rwlock);
+        }
+    }
+    pthread_rwlock_unlock (&vw->rwlock2);
+
+    /* without worker the jobs are run by SCE_TPool_Push(), which locks the
+       trees, so push them once everything is unlocked */
+    pthread_mutex_lock (&vw->prefetch_mutex);
+    SCE_List_ForEachProtected (pro, it, &jobs) {
+        SCE_SVoxelWorldJob *job = SCE_List_GetData (it);
+        SCE_List_Removel (&job->it);
+        SCE_List_Appendl (&vw->prefetched, &job->it);
+        SCE_TPool_Push (&vw->workers, &job->job);
+    }
+    pthread_mutex_unlock (&vw->prefetch_mutex);
+
+    return SCE_OK;
+fail:
+    SCE_List_Flush (&nodes);
+    pthread_rwlock_unlock (&vw->rwlock2);
+    SCE_List_ForEachProtected (pro, it, &jobs) {
+        SCE_SVoxelWorldJob *job = SCE_List_GetData (it);
+        SCE_List_Removel (&job->it);
+        SCE_VWorld_ReleaseJobNode (job);
+        SCE_free (job);
+    }
+    SCEE_LogSrc ();
+    return SCE_ERROR;
+}
+
+/**
+ * \brief Loads the nodes of a region in the background
+ * \param vw a voxel world
+ * \param level level of the nodes
+ * \param region a region in \p level space
+ * \param priority priority of the loading jobs
+ *
+ * Nodes already in memory or being loaded are skipped, cached nodes are
+ * marked as recently used so that they are not the next ones to be evicted.
+ * This function may be called again with the same region at any time, for
+ * instance once per frame. Jobs queued by previous calls or by the streaming
+ * ring are not cancelled, see SCE_VWorld_CancelPrefetch().
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VWorld_CancelPrefetch(), SCE_VWorld_UpdateStreaming(),
+ * SCE_VWorld_QueueLoadNode()
+ */
+int SCE_VWorld_Prefetch (SCE_SVoxelWorld *vw, SCEuint level,
+                         const SCE_SLongRect3 *region, int priority)
+{
+    /* only reap the jobs that are over, the queued ones may belong to
+       another region or to the streaming ring */
+    SCE_VWorld_SweepPrefetch (vw, SCE_VWorld_KeepAll);
+    if (SCE_VWorld_PrefetchRegion (vw, level, region, priority,
+                                   SCE_FALSE) < 0) {
+        SCEE_LogSrc ();
+        return SCE_ERROR;
+    }
+    return SCE_OK;
+}
+/**
+ * \brief Cancels every prefetch job that has not started yet
+ * \param vw a voxel world
+ */
+void SCE_VWorld_CancelPrefetch (SCE_SVoxelWorld *vw)
+{
+    SCE_VWorld_SweepPrefetch (vw, NULL);
+}
+/**
+ * \brief Gets the number of prefetch jobs not over yet
+ * \param vw a voxel world
+ */
+size_t SCE_VWorld_GetNumPrefetching (SCE_SVoxelWorld *vw)
+{
+    SCE_SListIterator *it = NULL;
+    size_t n = 0;
+
+    pthread_mutex_lock (&vw->prefetch_mutex);
+    SCE_List_ForEach (it, &vw->prefetched) {
+        SCE_SVoxelWorldJob *job = SCE_List_GetData (it);
+        SCE_EThreadPoolJobState state = SCE_TPool_GetJobState (&job->job);
+        if (state == SCE_TPOOL_JOB_QUEUED || state == SCE_TPOOL_JOB_RUNNING)
+            n++;
+    }
+    pthread_mutex_unlock (&vw->prefetch_mutex);
+    return n;
+}
+
+/**
+ * \brief Sets the distance around the streaming focus within which the
+ * nodes of a level are kept in memory
+ * \param vw a voxel world
+ * \param level a level, lower than SCE_MAX_VWORLD_STREAMING_LEVELS
+ * \param radius distance in voxels of \p level, negative to not stream
+ * \p level (default)
+ * \sa SCE_VWorld_SetStreamingFocus(), SCE_VWorld_UpdateStreaming()
+ */
+void SCE_VWorld_SetStreamingRadius (SCE_SVoxelWorld *vw, SCEuint level,
+                                    long radius)
+{
+    if (level < SCE_MAX_VWORLD_STREAMING_LEVELS)
+        vw->radius[level] = radius;
+}
+long SCE_VWorld_GetStreamingRadius (const SCE_SVoxelWorld *vw, SCEuint level)
+{
+    if (level < SCE_MAX_VWORLD_STREAMING_LEVELS)
+        return vw->radius[level];
+    return -1;
+}
+/**
+ * \brief Sets the base priority of the streaming jobs
+ * \param vw a voxel world
+ * \param priority base priority, jobs of nodes far from the focus get a
+ * lower priority
+ */
+void SCE_VWorld_SetStreamingPriority (SCE_SVoxelWorld *vw, int priority)
+{
+    vw->streaming_priority = priority;
+}
+/**
+ * \brief Sets the center of the streaming ring, usually the viewer position
+ * \param vw a voxel world
+ * \param x,y,z coordinates in level 0 space
+ * \sa SCE_VWorld_UpdateStreaming()
+ */
+void SCE_VWorld_SetStreamingFocus (SCE_SVoxelWorld *vw, long x, long y, long z)
+{
+    vw->focus[0] = x;
+    vw->focus[1] = y;
+    vw->focus[2] = z;
+}
+/**
+ * \brief Updates the streaming ring
+ * \param vw a voxel world
+ *
+ * Queued loading jobs of nodes that left the ring are cancelled (jobs of
+ * SCE_VWorld_Prefetch() are not), nodes of the ring that are not in memory
+ * are queued for loading, closest nodes first. Call this function whenever
+ * the focus moves, or once per frame.
+ * The caches of the trees must still be trimmed with
+ * SCE_VWorld_UpdateCache(), the nodes of the ring being evicted last.
+ * \return SCE_ERROR on error, SCE_OK otherwise
+ * \sa SCE_VWorld_SetStreamingRadius(), SCE_VWorld_SetStreamingFocus()
+ */
+int SCE_VWorld_UpdateStreaming (SCE_SVoxelWorld *vw)
+{
+    SCEuint level;
+
+    SCE_VWorld_SweepPrefetch (vw, SCE_VWorld_IsInRing);
+
+    for (level = 0; level < MIN (vw->n_lod, SCE_MAX_VWORLD_STREAMING_LEVELS);
+         level++) {
+        SCE_SLongRect3 r;
+        long x, y, z, radius = vw->radius[level];
+
+        if (radius < 0)
+            continue;
+        x = vw->focus[0] >> level;
+        y = vw->focus[1] >> level;
+        z = vw->focus[2] >> level;
+        SCE_Rectangle3_SetFromOriginl (&r, x - radius, y - radius, z - radius,
+                                       2 * radius + 1, 2 * radius + 1,
+                                       2 * radius + 1);
+        /* finer levels first */
+        if (SCE_VWorld_PrefetchRegion (vw, level, &r, vw->streaming_priority -
+                                       (int)level, SCE_TRUE) < 0) {
+            SCEE_LogSrc ();
+            return SCE_ERROR;
+        }
+    }
+
+    return SCE_OK;
+}
+
+/**
+ * \brief Gets the statistics of the node caches of all the trees of a world
+ * \param vw a voxel world
+ * \param stats filled with the sum of the statistics of every tree
+ * \sa SCE_VOctree_GetCacheStats()
+ */
+void SCE_VWorld_GetCacheStats (SCE_SVoxelWorld *vw,
+                               SCE_SVoxelOctreeCacheStats *stats)
+{
+    SCE_SListIterator *it = NULL;
+
+    stats->n_nodes = 0;
+    stats->size = 0;
+    stats->hits = stats->misses = stats->evictions = 0;
+
+    pthread_rwlock_rdlock (&vw->rwlock);
+    SCE_List_ForEach (it, &vw->trees) {
+        SCE_SVoxelOctreeCacheStats s;
+        SCE_SVoxelWorldTree *wt = SCE_List_GetData (it);
+        SCE_VOctree_GetCacheStats (&wt->vo, &s);
+        stats->n_nodes += s.n_nodes;
+        stats->size += s.size;
+        stats->hits += s.hits;
+        stats->misses += s.misses;
+        stats->evictions += s.evictions;
+    }
+    pthread_rwlock_unlock (&vw->rwlock);
+}
+void SCE_VWorld_ResetCacheStats (SCE_SVoxelWorld *vw)
+{
+    SCE_SListIterator *it = NULL;
+
+    pthread_rwlock_rdlock (&vw->rwlock);
+    SCE_List_ForEach (it, &vw->trees) {
+        SCE_SVoxelWorldTree *wt = SCE_List_GetData (it);
+        SCE_VOctree_ResetCacheStats (&wt->vo);
+    }
+    pthread_rwlock_unlock (&vw->rwlock);
+}